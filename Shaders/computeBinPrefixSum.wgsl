@@ -0,0 +1,101 @@
+// Exclusive prefix sum of the per brick triangle counts of the binning pre-pass.
+// c scans blocks of 256 bins and records each block total, p adds the totals of the previous blocks.
+
+struct Uniforms {
+    voxelResolution: u32,
+    brickResolution: u32,
+    voxelSize: f32,
+    numTriangles: u32,
+    meshMinBounds: vec3<f32>,
+    triangleBase: u32,
+    brickStart: u32,
+    brickEnd: u32,
+    triangleStart: u32,
+    triangleEnd: u32,
+    meshExtent: vec3<f32>,
+    _pad2: u32,
+    uvOffset: vec2<f32>,
+    uvExtent: vec2<f32>,
+}
+
+@group(0) @binding(0) var<uniform> uniforms: Uniforms;
+@group(0) @binding(1) var<storage, read> binCounts: array<u32>;
+@group(0) @binding(2) var<storage, read_write> binOffsets: array<u32>;
+@group(0) @binding(3) var<storage, read_write> blockSums: array<u32>;
+@group(0) @binding(4) var<storage, read_write> binCursors: array<u32>;
+@group(0) @binding(5) var<storage, read_write> binTotal: array<u32>; // Single value, read back to size the triangle lists
+
+const BLOCK_SIZE: u32 = 256u;
+
+var<workgroup> scratch: array<u32, 256>;
+
+//================================//
+@compute @workgroup_size(256)
+fn c(@builtin(local_invocation_index) localIndex: u32, @builtin(workgroup_id) wid: vec3<u32>, @builtin(num_workgroups) numWorkgroups: vec3<u32>)
+{
+    let block = wid.x + wid.y * numWorkgroups.x;
+    let numBins = uniforms.brickEnd - uniforms.brickStart;
+    let index = block * BLOCK_SIZE + localIndex;
+
+    var value = 0u;
+    if (index < numBins) {
+        value = binCounts[index];
+    }
+    scratch[localIndex] = value;
+    workgroupBarrier();
+
+    // Inclusive scan in shared memory
+    for (var offset = 1u; offset < BLOCK_SIZE; offset <<= 1u)
+    {
+        var sum = scratch[localIndex];
+        if (localIndex >= offset) {
+            sum += scratch[localIndex - offset];
+        }
+        workgroupBarrier();
+        scratch[localIndex] = sum;
+        workgroupBarrier();
+    }
+
+    if (index < numBins) {
+        binOffsets[index] = scratch[localIndex] - value;
+    }
+    if (localIndex == BLOCK_SIZE - 1u) {
+        blockSums[block] = scratch[localIndex];
+    }
+}
+
+//================================//
+// Every block sums the totals before it, there are few enough blocks for this to beat a second scan level
+@compute @workgroup_size(256)
+fn p(@builtin(local_invocation_index) localIndex: u32, @builtin(workgroup_id) wid: vec3<u32>, @builtin(num_workgroups) numWorkgroups: vec3<u32>)
+{
+    let block = wid.x + wid.y * numWorkgroups.x;
+    let numBins = uniforms.brickEnd - uniforms.brickStart;
+
+    var sum = 0u;
+    for (var i = localIndex; i < block; i += BLOCK_SIZE) {
+        sum += blockSums[i];
+    }
+    scratch[localIndex] = sum;
+    workgroupBarrier();
+
+    for (var stride = BLOCK_SIZE / 2u; stride > 0u; stride >>= 1u)
+    {
+        if (localIndex < stride) {
+            scratch[localIndex] += scratch[localIndex + stride];
+        }
+        workgroupBarrier();
+    }
+
+    let index = block * BLOCK_SIZE + localIndex;
+    if (index >= numBins) {
+        return;
+    }
+
+    let offset = binOffsets[index] + scratch[0];
+    binOffsets[index] = offset;
+    binCursors[index] = offset; // Advanced by the scatter
+    if (index == numBins - 1u) {
+        binTotal[0] = offset + binCounts[index];
+    }
+}
@@ -0,0 +1,132 @@
+// Coarse pre-pass of the voxelization: marks every brick of the grid some triangle overlaps.
+// The voxelizer compacts the marked bricks into the candidate list its passes range over.
+
+struct Uniforms {
+    voxelResolution: u32,
+    brickResolution: u32,
+    voxelSize: f32,
+    numTriangles: u32,
+    meshMinBounds: vec3<f32>,
+    triangleBase: u32,
+    brickStart: u32,
+    brickEnd: u32,
+    triangleStart: u32,
+    triangleEnd: u32,
+    meshExtent: vec3<f32>,
+    _pad2: u32,
+    uvOffset: vec2<f32>,
+    uvExtent: vec2<f32>,
+}
+
+@group(0) @binding(0) var<uniform> uniforms: Uniforms;
+@group(0) @binding(1) var<storage, read> vertices: array<u32>;  // Three words per vertex, see vertexPosition
+@group(0) @binding(2) var<storage, read> triangles: array<u32>; // Three vertex indices per triangle
+@group(0) @binding(3) var<storage, read_write> candidateBits: array<atomic<u32>>; // One bit per brick of the grid
+
+const WORKGROUP_SIZE: u32 = 64u;
+
+//================================//
+// Vertices are packed as x | y << 16, z | u << 16 and v, 16 bit unorms over the mesh and UV bounds
+fn vertexPosition(index: u32) -> vec3<f32>
+{
+    let xy = unpack2x16unorm(vertices[index * 3u]);
+    let zu = unpack2x16unorm(vertices[index * 3u + 1u]);
+    return uniforms.meshMinBounds + vec3<f32>(xy, zu.x) * uniforms.meshExtent;
+}
+
+//================================//
+// Same test as the voxelization shader, see computeVoxelization.wgsl
+fn triangleAABBIntersect(v0: vec3<f32>, v1: vec3<f32>, v2: vec3<f32>, boxCenter: vec3<f32>, boxHalfSize: vec3<f32>) -> bool
+{
+    let EPSILON: f32 = 1e-6;
+
+    let v0t = v0 - boxCenter;
+    let v1t = v1 - boxCenter;
+    let v2t = v2 - boxCenter;
+
+    let e0 = v1t - v0t;
+    let e1 = v2t - v1t;
+    let e2 = v0t - v2t;
+
+    // Box axes
+    for (var i = 0u; i < 3u; i++)
+    {
+        let minValue = min(min(v0t[i], v1t[i]), v2t[i]);
+        let maxValue = max(max(v0t[i], v1t[i]), v2t[i]);
+        if (minValue > boxHalfSize[i] + EPSILON || maxValue < -boxHalfSize[i] - EPSILON)
+        {
+            return false;
+        }
+    }
+
+    // Triangle normal
+    let normal = cross(e0, e1);
+    let d = -dot(normal, v0t);
+    let r = boxHalfSize.x * abs(normal.x) + boxHalfSize.y * abs(normal.y) + boxHalfSize.z * abs(normal.z);
+    if (abs(d) > r + EPSILON) { return false; }
+
+    // Box axes crossed with the edges
+    let axes = array<vec3<f32>, 3>(vec3<f32>(1.0, 0.0, 0.0), vec3<f32>(0.0, 1.0, 0.0), vec3<f32>(0.0, 0.0, 1.0));
+    let edges = array<vec3<f32>, 3>(e0, e1, e2);
+    for (var i = 0u; i < 3u; i++) {
+        for (var j = 0u; j < 3u; j++) {
+            let axis = cross(axes[i], edges[j]);
+            let len2 = dot(axis, axis);
+            if (len2 < 1e-10) { continue; }
+
+            let p0 = dot(axis, v0t);
+            let p1 = dot(axis, v1t);
+            let p2 = dot(axis, v2t);
+            let minProj = min(min(p0, p1), p2);
+            let maxProj = max(max(p0, p1), p2);
+            let rr = boxHalfSize.x * abs(axis.x) + boxHalfSize.y * abs(axis.y) + boxHalfSize.z * abs(axis.z);
+            if (minProj > rr + EPSILON || maxProj < -rr - EPSILON) { return false; }
+        }
+    }
+
+    return true;
+}
+
+//================================//
+// Same brick test as the binning, so every brick a triangle gets binned to is a candidate
+@compute @workgroup_size(64)
+fn c(@builtin(global_invocation_id) gid: vec3<u32>, @builtin(num_workgroups) numWorkgroups: vec3<u32>)
+{
+    let triIndex = uniforms.triangleStart + gid.x + gid.y * numWorkgroups.x * WORKGROUP_SIZE;
+    if (triIndex >= uniforms.triangleEnd) {
+        return;
+    }
+
+    let p0 = vertexPosition(triangles[triIndex * 3u]);
+    let p1 = vertexPosition(triangles[triIndex * 3u + 1u]);
+    let p2 = vertexPosition(triangles[triIndex * 3u + 2u]);
+
+    let brickSize = uniforms.voxelSize * 8.0;
+    let maxBrick = i32(uniforms.brickResolution) - 1;
+    let triMin = (min(min(p0, p1), p2) - uniforms.meshMinBounds) / brickSize;
+    let triMax = (max(max(p0, p1), p2) - uniforms.meshMinBounds) / brickSize;
+    let brickMin = vec3<u32>(clamp(vec3<i32>(floor(triMin)), vec3<i32>(0), vec3<i32>(maxBrick)));
+    let brickMax = vec3<u32>(clamp(vec3<i32>(floor(triMax)), vec3<i32>(0), vec3<i32>(maxBrick)));
+    let halfSize = vec3<f32>(brickSize * 0.5 + uniforms.voxelSize * 0.01);
+
+    for (var z = brickMin.z; z <= brickMax.z; z++) {
+        for (var y = brickMin.y; y <= brickMax.y; y++) {
+            for (var x = brickMin.x; x <= brickMax.x; x++)
+            {
+                let globalBrickIndex = x + y * uniforms.brickResolution + z * uniforms.brickResolution * uniforms.brickResolution;
+                let word = globalBrickIndex / 32u;
+                let bit = 1u << (globalBrickIndex % 32u);
+
+                // Neighbouring triangles mostly mark the same bricks, skip the atomic when it is already set
+                if ((atomicLoad(&candidateBits[word]) & bit) != 0u) {
+                    continue;
+                }
+
+                let center = uniforms.meshMinBounds + (vec3<f32>(f32(x), f32(y), f32(z)) + 0.5) * brickSize;
+                if (triangleAABBIntersect(p0, p1, p2, center, halfSize)) {
+                    atomicOr(&candidateBits[word], bit);
+                }
+            }
+        }
+    }
+}
@@ -6,10 +6,15 @@ struct Uniforms {
     voxelSize: f32,
     numTriangles: u32,
     meshMinBounds: vec3<f32>,
-    _pad: u32,
+    triangleBase: u32,
     brickStart: u32,
     brickEnd: u32,
-    _pad2: vec2<u32>,
+    triangleStart: u32,
+    triangleEnd: u32,
+    meshExtent: vec3<f32>,
+    _pad2: u32,
+    uvOffset: vec2<f32>,
+    uvExtent: vec2<f32>,
 }
 
 struct BrickOutput {
@@ -67,15 +72,6 @@ fn c(@builtin(global_invocation_id) gid: vec3<u32>) {
     let outputIndex = atomicAdd(&counters[0], 1u);
     let colorOffset = atomicAdd(&counters[1], occupiedCount);
     
-    // global to local brick index
-    let globalBrickIndex = uniforms.brickStart + localBrickIndex;
-    let brickZ = globalBrickIndex / (uniforms.brickResolution * uniforms.brickResolution);
-    let brickY = (globalBrickIndex / uniforms.brickResolution) % uniforms.brickResolution;
-    let brickX = globalBrickIndex % uniforms.brickResolution;
-    
-    // Voxel base in global voxel coordinates
-    let voxelBase = vec3<u32>(brickX, brickY, brickZ) * 8u;
-    
     // compute LOD average color
     var colorSum = vec3<u32>(0u);
     var colorIdx = 0u;
@@ -111,7 +107,7 @@ fn c(@builtin(global_invocation_id) gid: vec3<u32>) {
     
     // Store as local indices, since there will be multiple passes, 
     // In the cpu Side I retake them and transform to global
-    // depending on the brickStart and brickEnd offsets.
+    // through the candidate list, from brickStart.
     brickOutputs[outputIndex].brickGridIndex = localBrickIndex;
     brickOutputs[outputIndex].lodColor = (avgR & 0xFFu) | ((avgG & 0xFFu) << 8u) | ((avgB & 0xFFu) << 16u);
     brickOutputs[outputIndex].dataOffset = colorOffset;
@@ -0,0 +1,251 @@
+// Solid mode: fills the interior of closed meshes after the surface voxelization of a pass.
+// c flips the parity of the voxels past every crossing of a triangle with a row of voxel centers along x,
+// p turns the flips into inside bits with a prefix XOR along each row and colors the filled voxels.
+// In solid mode the candidate list holds whole brick rows along x and passes split on rows, so every row is complete.
+
+struct Uniforms {
+    voxelResolution: u32,
+    brickResolution: u32,
+    voxelSize: f32,
+    numTriangles: u32,
+    meshMinBounds: vec3<f32>,
+    triangleBase: u32,
+    brickStart: u32,
+    brickEnd: u32,
+    triangleStart: u32,
+    triangleEnd: u32,
+    meshExtent: vec3<f32>,
+    _pad2: u32,
+    uvOffset: vec2<f32>,
+    uvExtent: vec2<f32>,
+}
+
+@group(0) @binding(0) var<uniform> uniforms: Uniforms;
+@group(0) @binding(1) var<storage, read> vertices: array<u32>;  // Three words per vertex, see vertexPosition
+@group(0) @binding(2) var<storage, read> triangles: array<u32>; // Three vertex indices per triangle
+@group(0) @binding(3) var<storage, read_write> flips: array<atomic<u32>>; // Occupancy layout, one parity flip per voxel
+@group(0) @binding(4) var<storage, read_write> occupancy: array<atomic<u32>>;
+@group(0) @binding(5) var<storage, read_write> denseColors: array<u32>;
+@group(0) @binding(6) var<storage, read> candidateBits: array<u32>;
+@group(0) @binding(7) var<storage, read> candidateRanks: array<u32>;
+@group(0) @binding(8) var<storage, read> candidateBricks: array<u32>;
+
+const WORKGROUP_SIZE: u32 = 64u;
+const NOT_CANDIDATE: u32 = 0xFFFFFFFFu;
+
+//================================//
+// Vertices are packed as x | y << 16, z | u << 16 and v, 16 bit unorms over the mesh and UV bounds
+fn vertexPosition(index: u32) -> vec3<f32>
+{
+    let xy = unpack2x16unorm(vertices[index * 3u]);
+    let zu = unpack2x16unorm(vertices[index * 3u + 1u]);
+    return uniforms.meshMinBounds + vec3<f32>(xy, zu.x) * uniforms.meshExtent;
+}
+
+//================================//
+// Position of a brick in the candidate list, see computeTriangleBinning.wgsl
+fn candidateSlot(globalBrickIndex: u32) -> u32
+{
+    let word = globalBrickIndex / 32u;
+    let bit = globalBrickIndex % 32u;
+    let bits = candidateBits[word];
+    if ((bits & (1u << bit)) == 0u) {
+        return NOT_CANDIDATE;
+    }
+    return candidateRanks[word] + countOneBits(bits & ((1u << bit) - 1u));
+}
+
+//================================//
+// Twice the signed area of (a, b, p), endpoints taken in a fixed order so that the two triangles
+// sharing an edge get exactly opposite values
+fn edgeFunction(a: vec2<f32>, b: vec2<f32>, p: vec2<f32>) -> f32
+{
+    if (a.x < b.x || (a.x == b.x && a.y < b.y)) {
+        return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+    }
+    return -((a.x - b.x) * (p.y - b.y) - (a.y - b.y) * (p.x - b.x));
+}
+
+//================================//
+// Points exactly on an edge belong to one side only, opposite directions give opposite answers
+fn ownsEdge(edge: vec2<f32>) -> bool
+{
+    return edge.y > 0.0 || (edge.y == 0.0 && edge.x < 0.0);
+}
+
+//================================//
+// Whether the row through p along x crosses the triangle, projected on the yz plane
+fn rowCrossesTriangle(a: vec2<f32>, b: vec2<f32>, c: vec2<f32>, p: vec2<f32>) -> bool
+{
+    let area = edgeFunction(a, b, c);
+    if (area == 0.0) {
+        return false; // Parallel to the rows
+    }
+
+    // Counter clockwise order
+    var v0 = a;
+    var v1 = b;
+    var v2 = c;
+    if (area < 0.0) {
+        v1 = c;
+        v2 = b;
+    }
+
+    let w0 = edgeFunction(v0, v1, p);
+    let w1 = edgeFunction(v1, v2, p);
+    let w2 = edgeFunction(v2, v0, p);
+    let inside0 = w0 > 0.0 || (w0 == 0.0 && ownsEdge(v1 - v0));
+    let inside1 = w1 > 0.0 || (w1 == 0.0 && ownsEdge(v2 - v1));
+    let inside2 = w2 > 0.0 || (w2 == 0.0 && ownsEdge(v0 - v2));
+    return inside0 && inside1 && inside2;
+}
+
+//================================//
+// Index of a voxel in its brick. The bricks of a row are consecutive in the pass, from the first one along x
+fn localVoxelIndex(x: u32, y: u32, z: u32) -> u32
+{
+    return x % 8u + (y % 8u) * 8u + (z % 8u) * 64u;
+}
+
+//================================//
+// One invocation per triangle, flips the first voxel past its crossing with every row of the pass
+@compute @workgroup_size(64)
+fn c(@builtin(global_invocation_id) gid: vec3<u32>, @builtin(num_workgroups) numWorkgroups: vec3<u32>)
+{
+    let triIndex = uniforms.triangleStart + gid.x + gid.y * numWorkgroups.x * WORKGROUP_SIZE;
+    if (triIndex >= uniforms.triangleEnd) {
+        return;
+    }
+
+    let p0 = vertexPosition(triangles[triIndex * 3u]);
+    let p1 = vertexPosition(triangles[triIndex * 3u + 1u]);
+    let p2 = vertexPosition(triangles[triIndex * 3u + 2u]);
+
+    let normal = cross(p1 - p0, p2 - p0);
+    if (normal.x == 0.0) {
+        return;
+    }
+
+    // Rows whose center falls in the projected bounds, limited to the brick rows of the pass
+    let minBounds = (min(min(p0, p1), p2) - uniforms.meshMinBounds) / uniforms.voxelSize - 0.5;
+    let maxBounds = (max(max(p0, p1), p2) - uniforms.meshMinBounds) / uniforms.voxelSize - 0.5;
+    let maxVoxel = i32(uniforms.voxelResolution) - 1;
+    let rowMin = clamp(vec2<i32>(ceil(minBounds.yz)), vec2<i32>(0), vec2<i32>(maxVoxel));
+    let rowMax = clamp(vec2<i32>(floor(maxBounds.yz)), vec2<i32>(-1), vec2<i32>(maxVoxel));
+
+    for (var z = rowMin.y; z <= rowMax.y; z++) {
+        for (var y = rowMin.x; y <= rowMax.x; y++)
+        {
+            // First brick of the row along x
+            let rowSlot = candidateSlot((u32(y) / 8u) * uniforms.brickResolution + (u32(z) / 8u) * uniforms.brickResolution * uniforms.brickResolution);
+            if (rowSlot == NOT_CANDIDATE || rowSlot < uniforms.brickStart || rowSlot >= uniforms.brickEnd) {
+                continue;
+            }
+
+            let center = uniforms.meshMinBounds.yz + (vec2<f32>(f32(y), f32(z)) + 0.5) * uniforms.voxelSize;
+            if (!rowCrossesTriangle(p0.yz, p1.yz, p2.yz, center)) {
+                continue;
+            }
+
+            // Crossing on the plane of the triangle, the voxels after it change side
+            let planeX = p0.x - (normal.y * (center.x - p0.y) + normal.z * (center.y - p0.z)) / normal.x;
+            let crossingX = clamp(planeX, min(min(p0.x, p1.x), p2.x), max(max(p0.x, p1.x), p2.x));
+            let firstVoxel = max(i32(floor((crossingX - uniforms.meshMinBounds.x) / uniforms.voxelSize - 0.5)) + 1, 0);
+            if (firstVoxel > maxVoxel) {
+                continue;
+            }
+
+            let localBrickIndex = rowSlot - uniforms.brickStart + u32(firstVoxel) / 8u;
+            let voxelIndex = localVoxelIndex(u32(firstVoxel), u32(y), u32(z));
+            atomicXor(&flips[localBrickIndex * 16u + voxelIndex / 32u], 1u << (voxelIndex % 32u));
+        }
+    }
+}
+
+//================================//
+// One invocation per row of voxels along x. Inside voxels are filled with the color of the closer
+// of the surface voxels around them on the row
+@compute @workgroup_size(64)
+fn p(@builtin(global_invocation_id) gid: vec3<u32>, @builtin(num_workgroups) numWorkgroups: vec3<u32>)
+{
+    let rowIndex = gid.x + gid.y * numWorkgroups.x * WORKGROUP_SIZE;
+    let numRows = (uniforms.brickEnd - uniforms.brickStart) / uniforms.brickResolution * 64u;
+    if (rowIndex >= numRows) {
+        return;
+    }
+
+    // First brick of the row in the pass, and its place in the grid
+    let rowBrick = (rowIndex / 64u) * uniforms.brickResolution;
+    let rowGlobalIndex = candidateBricks[uniforms.brickStart + rowBrick];
+    let y = ((rowGlobalIndex / uniforms.brickResolution) % uniforms.brickResolution) * 8u + rowIndex % 8u;
+    let z = (rowGlobalIndex / (uniforms.brickResolution * uniforms.brickResolution)) * 8u + (rowIndex % 64u) / 8u;
+    let rowBase = localVoxelIndex(0u, y, z);
+    let shift = rowBase % 32u; // Byte of the row in its occupancy word
+
+    var parity = 0u;
+    var entryX = -1;                // Last surface voxel
+    var entryColor = 0xFFFFFFu;
+    var runStart = -1;              // First voxel of the filled run after it
+
+    for (var brickX = 0u; brickX < uniforms.brickResolution; brickX++)
+    {
+        let word = (rowBrick + brickX) * 16u + rowBase / 32u;
+
+        // Prefix XOR of the flips along the row, continued from the previous brick
+        var inside = (atomicLoad(&flips[word]) >> shift) & 0xFFu;
+        inside ^= (inside << 1u) & 0xFFu;
+        inside ^= (inside << 2u) & 0xFFu;
+        inside ^= (inside << 4u) & 0xFFu;
+        inside ^= parity * 0xFFu;
+        parity = inside >> 7u;
+
+        let surface = (atomicLoad(&occupancy[word]) >> shift) & 0xFFu;
+        let fill = inside & ~surface;
+        if ((fill | surface) == 0u)
+        {
+            runStart = -1;
+            continue;
+        }
+        if (fill != 0u) {
+            atomicOr(&occupancy[word], fill << shift);
+        }
+
+        for (var bit = 0u; bit < 8u; bit++)
+        {
+            let x = i32(brickX * 8u + bit);
+            let denseIndex = (rowBrick + brickX) * 512u + rowBase + bit;
+
+            if ((surface & (1u << bit)) != 0u)
+            {
+                let exitColor = denseColors[denseIndex];
+
+                // The second half of the run is closer to this voxel
+                if (runStart >= 0)
+                {
+                    var fillFrom = runStart;
+                    if (entryX >= 0) {
+                        fillFrom = max(runStart, (entryX + x + 1) / 2);
+                    }
+                    for (var runX = fillFrom; runX < x; runX++) {
+                        denseColors[(rowBrick + u32(runX) / 8u) * 512u + rowBase + u32(runX) % 8u] = exitColor;
+                    }
+                }
+
+                entryX = x;
+                entryColor = exitColor;
+                runStart = -1;
+            }
+            else if ((fill & (1u << bit)) != 0u)
+            {
+                denseColors[denseIndex] = entryColor;
+                if (runStart < 0) {
+                    runStart = x;
+                }
+            }
+            else
+            {
+                runStart = -1;
+            }
+        }
+    }
+}
@@ -0,0 +1,192 @@
+// Pre-pass of the voxelization: lists the triangles overlapping each candidate brick of the pass.
+// c counts the triangles per brick, the prefix sum turns the counts into offsets, p scatters the triangle ids.
+
+struct Uniforms {
+    voxelResolution: u32,
+    brickResolution: u32,
+    voxelSize: f32,
+    numTriangles: u32,
+    meshMinBounds: vec3<f32>,
+    triangleBase: u32,
+    brickStart: u32,
+    brickEnd: u32,
+    triangleStart: u32,
+    triangleEnd: u32,
+    meshExtent: vec3<f32>,
+    _pad2: u32,
+    uvOffset: vec2<f32>,
+    uvExtent: vec2<f32>,
+}
+
+@group(0) @binding(0) var<uniform> uniforms: Uniforms;
+@group(0) @binding(1) var<storage, read> vertices: array<u32>;  // Three words per vertex, see vertexPosition
+@group(0) @binding(2) var<storage, read> triangles: array<u32>; // Three vertex indices per triangle
+@group(0) @binding(3) var<storage, read_write> binCounts: array<atomic<u32>>;
+@group(0) @binding(4) var<storage, read_write> binCursors: array<atomic<u32>>;
+@group(0) @binding(5) var<storage, read_write> binnedTriangles: array<u32>;
+@group(0) @binding(6) var<storage, read> candidateBits: array<u32>;    // One bit per brick of the grid
+@group(0) @binding(7) var<storage, read> candidateRanks: array<u32>;   // Candidates before each word of candidateBits
+@group(0) @binding(8) var<storage, read> candidateBricks: array<u32>;  // Grid index of each candidate
+
+const WORKGROUP_SIZE: u32 = 64u;
+const NOT_CANDIDATE: u32 = 0xFFFFFFFFu;
+
+//================================//
+// Vertices are packed as x | y << 16, z | u << 16 and v, 16 bit unorms over the mesh and UV bounds
+fn vertexPosition(index: u32) -> vec3<f32>
+{
+    let xy = unpack2x16unorm(vertices[index * 3u]);
+    let zu = unpack2x16unorm(vertices[index * 3u + 1u]);
+    return uniforms.meshMinBounds + vec3<f32>(xy, zu.x) * uniforms.meshExtent;
+}
+
+//================================//
+// Position of a brick in the candidate list
+fn candidateSlot(globalBrickIndex: u32) -> u32
+{
+    let word = globalBrickIndex / 32u;
+    let bit = globalBrickIndex % 32u;
+    let bits = candidateBits[word];
+    if ((bits & (1u << bit)) == 0u) {
+        return NOT_CANDIDATE;
+    }
+    return candidateRanks[word] + countOneBits(bits & ((1u << bit) - 1u));
+}
+
+//================================//
+// Same test as the voxelization shader, see computeVoxelization.wgsl
+fn triangleAABBIntersect(v0: vec3<f32>, v1: vec3<f32>, v2: vec3<f32>, boxCenter: vec3<f32>, boxHalfSize: vec3<f32>) -> bool
+{
+    let EPSILON: f32 = 1e-6;
+
+    let v0t = v0 - boxCenter;
+    let v1t = v1 - boxCenter;
+    let v2t = v2 - boxCenter;
+
+    let e0 = v1t - v0t;
+    let e1 = v2t - v1t;
+    let e2 = v0t - v2t;
+
+    // Box axes
+    for (var i = 0u; i < 3u; i++)
+    {
+        let minValue = min(min(v0t[i], v1t[i]), v2t[i]);
+        let maxValue = max(max(v0t[i], v1t[i]), v2t[i]);
+        if (minValue > boxHalfSize[i] + EPSILON || maxValue < -boxHalfSize[i] - EPSILON)
+        {
+            return false;
+        }
+    }
+
+    // Triangle normal
+    let normal = cross(e0, e1);
+    let d = -dot(normal, v0t);
+    let r = boxHalfSize.x * abs(normal.x) + boxHalfSize.y * abs(normal.y) + boxHalfSize.z * abs(normal.z);
+    if (abs(d) > r + EPSILON) { return false; }
+
+    // Box axes crossed with the edges
+    let axes = array<vec3<f32>, 3>(vec3<f32>(1.0, 0.0, 0.0), vec3<f32>(0.0, 1.0, 0.0), vec3<f32>(0.0, 0.0, 1.0));
+    let edges = array<vec3<f32>, 3>(e0, e1, e2);
+    for (var i = 0u; i < 3u; i++) {
+        for (var j = 0u; j < 3u; j++) {
+            let axis = cross(axes[i], edges[j]);
+            let len2 = dot(axis, axis);
+            if (len2 < 1e-10) { continue; }
+
+            let p0 = dot(axis, v0t);
+            let p1 = dot(axis, v1t);
+            let p2 = dot(axis, v2t);
+            let minProj = min(min(p0, p1), p2);
+            let maxProj = max(max(p0, p1), p2);
+            let rr = boxHalfSize.x * abs(axis.x) + boxHalfSize.y * abs(axis.y) + boxHalfSize.z * abs(axis.z);
+            if (minProj > rr + EPSILON || maxProj < -rr - EPSILON) { return false; }
+        }
+    }
+
+    return true;
+}
+
+//================================//
+// Dispatches past the per dimension limit spill into y
+fn linearInvocationIndex(gid: vec3<u32>, numWorkgroups: vec3<u32>) -> u32
+{
+    return gid.x + gid.y * numWorkgroups.x * WORKGROUP_SIZE;
+}
+
+//================================//
+// Visits every candidate brick of the pass the triangle overlaps, counting it there or writing its id when scattering
+fn binTriangle(triIndex: u32, scatter: bool)
+{
+    let p0 = vertexPosition(triangles[triIndex * 3u]);
+    let p1 = vertexPosition(triangles[triIndex * 3u + 1u]);
+    let p2 = vertexPosition(triangles[triIndex * 3u + 2u]);
+
+    // Brick range covered by the triangle bounds
+    let brickSize = uniforms.voxelSize * 8.0;
+    let maxBrick = i32(uniforms.brickResolution) - 1;
+    let triMin = (min(min(p0, p1), p2) - uniforms.meshMinBounds) / brickSize;
+    let triMax = (max(max(p0, p1), p2) - uniforms.meshMinBounds) / brickSize;
+    let brickMin = clamp(vec3<i32>(floor(triMin)), vec3<i32>(0), vec3<i32>(maxBrick));
+    let brickMax = clamp(vec3<i32>(floor(triMax)), vec3<i32>(0), vec3<i32>(maxBrick));
+
+    // Only the z slices of the pass, the candidates are in grid order
+    let bricksPerSlice = uniforms.brickResolution * uniforms.brickResolution;
+    let zMin = max(u32(brickMin.z), candidateBricks[uniforms.brickStart] / bricksPerSlice);
+    let zMax = min(u32(brickMax.z), candidateBricks[uniforms.brickEnd - 1u] / bricksPerSlice);
+
+    // Slightly larger than the brick, the voxel tests have their own epsilon
+    let halfSize = vec3<f32>(brickSize * 0.5 + uniforms.voxelSize * 0.01);
+
+    for (var z = zMin; z <= zMax; z++) {
+        for (var y = u32(brickMin.y); y <= u32(brickMax.y); y++) {
+            for (var x = u32(brickMin.x); x <= u32(brickMax.x); x++)
+            {
+                let slot = candidateSlot(x + y * uniforms.brickResolution + z * bricksPerSlice);
+                if (slot == NOT_CANDIDATE || slot < uniforms.brickStart || slot >= uniforms.brickEnd) {
+                    continue;
+                }
+
+                let center = uniforms.meshMinBounds + (vec3<f32>(f32(x), f32(y), f32(z)) + 0.5) * brickSize;
+                if (!triangleAABBIntersect(p0, p1, p2, center, halfSize)) {
+                    continue;
+                }
+
+                let localBrickIndex = slot - uniforms.brickStart;
+                if (scatter)
+                {
+                    let position = atomicAdd(&binCursors[localBrickIndex], 1u);
+                    binnedTriangles[position] = triIndex;
+                }
+                else
+                {
+                    atomicAdd(&binCounts[localBrickIndex], 1u);
+                }
+            }
+        }
+    }
+}
+
+//================================//
+@compute @workgroup_size(64)
+fn c(@builtin(global_invocation_id) gid: vec3<u32>, @builtin(num_workgroups) numWorkgroups: vec3<u32>)
+{
+    let triIndex = uniforms.triangleStart + linearInvocationIndex(gid, numWorkgroups);
+    if (triIndex >= uniforms.triangleEnd) {
+        return;
+    }
+
+    binTriangle(triIndex, false);
+}
+
+//================================//
+// Dispatched after the prefix sum, the cursors start at the bin offsets
+@compute @workgroup_size(64)
+fn p(@builtin(global_invocation_id) gid: vec3<u32>, @builtin(num_workgroups) numWorkgroups: vec3<u32>)
+{
+    let triIndex = uniforms.triangleStart + linearInvocationIndex(gid, numWorkgroups);
+    if (triIndex >= uniforms.triangleEnd) {
+        return;
+    }
+
+    binTriangle(triIndex, true);
+}
@@ -2,8 +2,10 @@
 struct UploadEntry
 {
     gpuBrickSlot: u32, // the allocated brick slot for the position in the brick pool, should be written inside brick grid at the position brickGridIndex
+    colorOffset: u32, // start of the brick colors in the color address space, in blocks of COLOR_BLOCK_WORDS
+    colorWords: u32, // number of valid words in colors
     occupancy: array<u32, 16>, // 8 x u64 = 16 x u32
-    // for the colors, its r,g,b (uint8 each) per voxel, so 8x8x8 = 512 colors
+    // for the colors, its r,g,b (uint8 each) per occupied voxel, in voxel index order, at most 8x8x8 = 512 colors
     colors: array<u32, 512>,
 };
 
@@ -13,9 +15,27 @@ struct Params
     uploadCount: u32,
     maxColorBufferSize: u32,
     hasColor: u32,
-    _pad: u32,
+    colorFormat: u32,
+    colorWordsPerBrick: u32,
+    pointerUpdateCount: u32,
+    _pad0: u32,
+    _pad1: u32,
 };
 
+//================================//
+struct PointerUpdate
+{
+    poolIndex: u32, // Cell in the brick grid page pool
+    gridPointer: u32,
+};
+
+// Color pool encodings, same values as ColorFormat
+const COLOR_FORMAT_RGBA8: u32 = 0u;
+const COLOR_FORMAT_RGB565: u32 = 1u;
+
+// Color blocks are allocated in multiples of this many words and never straddle two color pools
+const COLOR_BLOCK_WORDS: u32 = 16u;
+
 //================================//
 struct Brick
 {
@@ -30,27 +50,35 @@ var<uniform> params: Params;
 var<storage, read_write> brickPool: array<Brick>;
 
 @group(0) @binding(3)
-var<storage, read_write> colorPool1: array<u32>;
+var<storage, read_write> brickColorOffsets: array<u32>;
+
 @group(0) @binding(4)
-var<storage, read_write> colorPool2: array<u32>;
+var<storage, read> pointerUpdates: array<PointerUpdate>;
 @group(0) @binding(5)
-var<storage, read_write> colorPool3: array<u32>;
+var<storage, read_write> brickGrid: array<u32>;
+
+// Colors, one binding per color pool from binding 6, generated for the number of pools the device can bind
+//@COLOR_POOL_BINDINGS
 
 //================================//
-fn writeColorToPool(globalOffset: u32, color: u32)
+fn writeColorToPool(bufferIdx: u32, localOffset: u32, color: u32)
 {
-    let bufferIdx = globalOffset / params.maxColorBufferSize;
-    let localOffset = globalOffset % params.maxColorBufferSize;
-    
     switch (bufferIdx)
     {
-        case 0u: { colorPool1[localOffset] = color; }
-        case 1u: { colorPool2[localOffset] = color; }
-        case 2u: { colorPool3[localOffset] = color; }
+        //@COLOR_POOL_WRITE_CASES
         default: { /* Out of bounds */ } // SHOULD NOT HAPPEN
     }
 }
 
+//================================//
+fn packRGB565(color: u32) -> u32
+{
+    let r = (color & 255u) >> 3u;
+    let g = ((color >> 8u) & 255u) >> 2u;
+    let b = ((color >> 16u) & 255u) >> 3u;
+    return r | (g << 5u) | (b << 11u);
+}
+
 //================================//
 fn writeBrick(brickSlot: u32, entry: UploadEntry)
 {
@@ -65,12 +93,30 @@ fn writeBrick(brickSlot: u32, entry: UploadEntry)
         return;
     }
     
-    // Write colors
-    let globalStart = brickSlot * 512u;
-    for (var i: u32 = 0u; i < 512u; i = i + 1u)
+    // Write colors, the CPU already encoded palette formats in their pool layout
+    brickColorOffsets[brickSlot] = entry.colorOffset;
+
+    let blocksPerPool = params.maxColorBufferSize / COLOR_BLOCK_WORDS;
+    let pool = entry.colorOffset / blocksPerPool;
+    let start = (entry.colorOffset % blocksPerPool) * COLOR_BLOCK_WORDS;
+
+    if (params.colorFormat == COLOR_FORMAT_RGB565)
     {
-        let globalOffset = globalStart + i;
-        writeColorToPool(globalOffset, entry.colors[i]);
+        for (var i: u32 = 0u; 2u * i < entry.colorWords; i = i + 1u)
+        {
+            var packed = packRGB565(entry.colors[2u * i]);
+            if (2u * i + 1u < entry.colorWords)
+            {
+                packed = packed | (packRGB565(entry.colors[2u * i + 1u]) << 16u);
+            }
+            writeColorToPool(pool, start + i, packed);
+        }
+        return;
+    }
+
+    for (var i: u32 = 0u; i < entry.colorWords; i = i + 1u)
+    {
+        writeColorToPool(pool, start + i, entry.colors[i]);
     }
 }
 
@@ -88,4 +134,18 @@ fn c(@builtin(global_invocation_id) gid: vec3<u32>)
     
     let entry = uploadEntries[uploadIndex];
     writeBrick(entry.gpuBrickSlot, entry);
-}
\ No newline at end of file
+}
+
+//================================//
+// Dispatched after c, publishes the brick grid pointers of the frame
+@compute @workgroup_size(128, 1, 1)
+fn p(@builtin(global_invocation_id) gid: vec3<u32>)
+{
+    if (gid.x >= params.pointerUpdateCount)
+    {
+        return;
+    }
+
+    let pointerUpdate = pointerUpdates[gid.x];
+    brickGrid[pointerUpdate.poolIndex] = pointerUpdate.gridPointer;
+}
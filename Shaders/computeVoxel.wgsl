@@ -13,6 +13,10 @@ struct ComputeVoxelParams
     time: f32,
     hasColor: u32,
     flipBits: u32,
+    colorFormat: u32,
+    colorWordsPerBrick: u32,
+    pixelSpread: f32,           // Pixel size at distance 1, in voxels
+    coarseThresholdPixels: f32, // Bricks smaller than this on screen use the coarse levels, 0 disables them
 };
 
 //================================//
@@ -24,6 +28,25 @@ struct Brick
 // MAX FEEDBACK SIZE 8192
 const MAX_FEEDBACK: u32 = 8192u;
 
+// Brick grid pages of 8x8x8 bricks
+const BRICK_PAGE_SIZE: u32 = 8u;
+const BRICK_PAGE_CELLS: u32 = 512u;
+
+// Coarse levels of a page, 4x4x4 cells of 2x2x2 bricks then 2x2x2 cells of 4x4x4 bricks
+const BRICK_PAGE_COARSE_CELLS_L1: u32 = 64u;
+const BRICK_PAGE_COARSE_CELLS: u32 = 72u;
+
+// Color pool encodings, same values as ColorFormat
+const COLOR_FORMAT_RGBA8: u32 = 0u;
+const COLOR_FORMAT_RGB565: u32 = 1u;
+const COLOR_FORMAT_PALETTE8: u32 = 2u;
+const COLOR_FORMAT_PALETTE4: u32 = 3u;
+const PALETTE8_ENTRIES: u32 = 256u;
+const PALETTE4_ENTRIES: u32 = 16u;
+
+// Color blocks are allocated in multiples of this many words and never straddle two color pools
+const COLOR_BLOCK_WORDS: u32 = 16u;
+
 //================================//
 //           BINDINGS             //
 //================================//
@@ -33,7 +56,7 @@ var targetTexture: texture_storage_2d<rgba8unorm, write>;
 // Params
 @group(0) @binding(1)
 var<uniform> params: ComputeVoxelParams;
-// Brick grid (read-only for fast parallel access)
+// Brick grid page pool, BRICK_PAGE_CELLS pointers per allocated page (read-only for fast parallel access)
 @group(0) @binding(2)
 var<storage, read> brickGrid: array<u32>;
 // Brick pool
@@ -46,17 +69,26 @@ var<storage, read_write> feedbackCount: atomic<u32>;
 @group(0) @binding(5)
 var<storage, read_write> feedbackIndices: array<u32>;
 
-// Colors (max 3 buffers)
+// Separate atomic buffer for request flags (avoids contention on brickGrid reads)
+// one bit per brick of each allocated page
 @group(0) @binding(6)
-var<storage, read> colorPool: array<u32>;
+var<storage, read_write> brickRequestFlags: array<atomic<u32>>;
+
+// Page table, one entry per page of the brick grid: [31] allocated, [30:0] page slot in brickGrid
 @group(0) @binding(7)
-var<storage, read> colorPool2: array<u32>;
+var<storage, read> brickPageTable: array<u32>;
+
+// Start of the colors of each brick pool slot in the color address space, in blocks of COLOR_BLOCK_WORDS
+// colors only exist for occupied voxels
 @group(0) @binding(8)
-var<storage, read> colorPool3: array<u32>;
+var<storage, read> brickColorOffsets: array<u32>;
 
-// Separate atomic buffer for request flags (avoids contention on brickGrid reads)
+// Coarse levels of every allocated page, BRICK_PAGE_COARSE_CELLS per page slot: [31] occupied, [23:0] average LOD color
 @group(0) @binding(9)
-var<storage, read_write> brickRequestFlags: array<atomic<u32>>;
+var<storage, read> brickCoarse: array<u32>;
+
+// Colors, one binding per color pool from binding 10, generated for the number of pools the device can bind
+//@COLOR_POOL_BINDINGS
 
 //================================//
 //           HELPERS              //
@@ -65,7 +97,8 @@ var<storage, read_write> brickRequestFlags: array<atomic<u32>>;
 // [31]     : resident flag
 // [30]     : requested flag (GPU feedback) - NOW IN SEPARATE BUFFER
 // [29]     : unloaded flag (has LOD color)
-// [28:24]  : unused
+// [28]     : uniform flag (solid brick, color in [23:0], no brick pool slot)
+// [27:24]  : unused
 // [23:0]   : brick pool index OR packed LOD color
 fn flippedAxis(axisIndex: u32) -> bool
 {
@@ -97,51 +130,117 @@ fn isBrickUnloaded(pointer: u32) -> bool
 }
 
 //================================//
-fn isVoxelSet(brick: Brick, x: u32, y: u32, z: u32) -> bool
+fn isBrickUniform(pointer: u32) -> bool
 {
-    var xV = x;
-    var yV = y;
-    var zV = z;
+    return (pointer & 0x10000000u) != 0u; // Check uniform flag at 28th bit
+}
 
-    if (flippedAxis(0u))
-    {
-        xV = 7u - xV;
-    }
-    if (flippedAxis(1u))
-    {
-        yV = 7u - yV;
-    }
-    if (flippedAxis(2u))
-    {
-        zV = 7u - zV;
-    }
+//================================//
+fn isPageAllocated(pageEntry: u32) -> bool
+{
+    return (pageEntry & 0x80000000u) != 0u;
+}
+
+//================================//
+fn pageSlotFromEntry(pageEntry: u32) -> u32
+{
+    return pageEntry & 0x7FFFFFFFu;
+}
 
-    let bit = xV + yV * 8u;           // 0..63
-    let word = zV * 2u + (bit >> 5u); // Which slice
+//================================//
+fn isVoxelSet(brick: Brick, x: u32, y: u32, z: u32) -> bool
+{
+    let bit = x + y * 8u;            // 0..63
+    let word = z * 2u + (bit >> 5u); // Which slice
     let mask = 1u << (bit & 31u);
     return (brick.occupancy[word] & mask) != 0u;
 }
 
 //================================//
-fn readColorFromPool(globalOffset: u32) -> u32
+// Number of occupied voxels before voxelIndex, which is where its color sits in the compact color layout
+fn occupiedRank(brick: Brick, voxelIndex: u32) -> u32
 {
-    let bufferIdx   = globalOffset / params.maxColorBufferSize;
-    let localOffset = globalOffset % params.maxColorBufferSize;
+    let word = voxelIndex >> 5u;
+    var rank: u32 = countOneBits(brick.occupancy[word] & ((1u << (voxelIndex & 31u)) - 1u));
+    for (var i: u32 = 0u; i < word; i = i + 1u)
+    {
+        rank = rank + countOneBits(brick.occupancy[i]);
+    }
+    return rank;
+}
 
+//================================//
+fn readColorFromPool(bufferIdx: u32, localOffset: u32) -> u32
+{
     switch (bufferIdx)
     {
-        case 0u: { return colorPool[localOffset]; }
-        case 1u: { return colorPool2[localOffset]; }
-        case 2u: { return colorPool3[localOffset]; }
+        //@COLOR_POOL_READ_CASES
         default: { return 0u; }
     }
 }
 
 //================================//
-fn loadColor(brickSlot: u32, voxelIndex: u32) -> vec3<f32>
+struct ColorLocation
+{
+    pool: u32,
+    start: u32, // word offset inside the pool
+};
+
+//================================//
+// A brick's colors all sit in the same pool, the pool is found once from its block address
+fn locateBrickColors(brickSlot: u32) -> ColorLocation
+{
+    let blocksPerPool: u32 = params.maxColorBufferSize / COLOR_BLOCK_WORDS;
+    let block: u32 = brickColorOffsets[brickSlot];
+    return ColorLocation(block / blocksPerPool, (block % blocksPerPool) * COLOR_BLOCK_WORDS);
+}
+
+//================================//
+fn unpackRGB565(packed: u32) -> vec3<f32>
+{
+    let r: f32 = f32(packed & 31u) / 31.0;
+    let g: f32 = f32((packed >> 5u) & 63u) / 63.0;
+    let b: f32 = f32((packed >> 11u) & 31u) / 31.0;
+
+    return vec3<f32>(r, g, b);
+}
+
+//================================//
+fn loadColor(brickSlot: u32, brick: Brick, voxelIndex: u32) -> vec3<f32>
 {
-    let globalOffset: u32 = brickSlot * 512u + voxelIndex;  
-    let packedColor: u32 = readColorFromPool(globalOffset);
+    let location: ColorLocation = locateBrickColors(brickSlot);
+    let pool: u32 = location.pool;
+    let brickStart: u32 = location.start;
+    let rank: u32 = occupiedRank(brick, voxelIndex);
+    var packedColor: u32 = 0u;
+
+    switch (params.colorFormat)
+    {
+        case COLOR_FORMAT_RGB565:
+        {
+            let word: u32 = readColorFromPool(pool, brickStart + rank / 2u);
+            return unpackRGB565((word >> ((rank & 1u) * 16u)) & 0xFFFFu);
+        }
+        case COLOR_FORMAT_PALETTE8:
+        {
+            // [palette size][palette][indices]
+            let paletteSize: u32 = readColorFromPool(pool, brickStart);
+            let word: u32 = readColorFromPool(pool, brickStart + 1u + paletteSize + rank / 4u);
+            let paletteIndex: u32 = (word >> ((rank & 3u) * 8u)) & 0xFFu;
+            packedColor = readColorFromPool(pool, brickStart + 1u + paletteIndex);
+        }
+        case COLOR_FORMAT_PALETTE4:
+        {
+            let paletteSize: u32 = readColorFromPool(pool, brickStart);
+            let word: u32 = readColorFromPool(pool, brickStart + 1u + paletteSize + rank / 8u);
+            let paletteIndex: u32 = (word >> ((rank & 7u) * 4u)) & 0xFu;
+            packedColor = readColorFromPool(pool, brickStart + 1u + paletteIndex);
+        }
+        default:
+        {
+            packedColor = readColorFromPool(pool, brickStart + rank);
+        }
+    }
 
     let r: f32 = f32(packedColor & 255u) / 255.0;
     let g: f32 = f32((packedColor >> 8u) & 255u) / 255.0;
@@ -163,11 +262,12 @@ fn loadLODColorFromPointer(pointer: u32) -> vec3<f32>
 }
 
 //================================//
-fn writeFeedback(brickIndex: u32)
+fn writeFeedback(brickIndex: u32, poolIndex: u32)
 {
     // Atomic on SEPARATE buffer - no contention with reads
-    let old = atomicOr(&brickRequestFlags[brickIndex], 1u);
-    if (old != 0u)
+    let mask = 1u << (poolIndex & 31u);
+    let old = atomicOr(&brickRequestFlags[poolIndex >> 5u], mask);
+    if ((old & mask) != 0u)
     {
         return; // Already requested this frame
     }
@@ -186,42 +286,70 @@ fn writeFeedback(brickIndex: u32)
 fn brickToIndex(brickCoord: vec3<u32>) -> u32
 {
     let gridResolution: u32 = params.voxelResolution / 8u;
-    var brickCoordV = brickCoord;
+    return brickCoord.x + brickCoord.y * gridResolution + brickCoord.z * gridResolution * gridResolution;
+}
 
-    if (flippedAxis(0u))
-    {
-        brickCoordV.x = gridResolution - 1u - brickCoordV.x;
-    }
-    if (flippedAxis(1u))
-    {
-        brickCoordV.y = gridResolution - 1u - brickCoordV.y;
-    }
-    if (flippedAxis(2u))
-    {
-        brickCoordV.z = gridResolution - 1u - brickCoordV.z;
-    }
+//================================//
+fn pageToIndex(pageCoord: vec3<u32>) -> u32
+{
+    let pageResolution: u32 = (params.voxelResolution / 8u + BRICK_PAGE_SIZE - 1u) / BRICK_PAGE_SIZE;
+    return pageCoord.x + pageCoord.y * pageResolution + pageCoord.z * pageResolution * pageResolution;
+}
 
-    return brickCoordV.x + brickCoordV.y * gridResolution + brickCoordV.z * gridResolution * gridResolution;
+//================================//
+fn brickToCellIndex(brickCoord: vec3<u32>) -> u32
+{
+    let cellCoord = brickCoord % vec3<u32>(BRICK_PAGE_SIZE);
+    return cellCoord.x + cellCoord.y * BRICK_PAGE_SIZE + cellCoord.z * BRICK_PAGE_SIZE * BRICK_PAGE_SIZE;
 }
 
 //================================//
 fn localCoordToVoxelIndex(localCoord: vec3<u32>) -> u32
 {
-    var localCoordV = localCoord;
-    if (flippedAxis(0u))
+    return localCoord.x + localCoord.y * 8u + localCoord.z * 64u;
+}
+
+//================================//
+// 0 for the bricks themselves, 1 or 2 once a brick is below the threshold on screen, 2 once a 2x2x2 block of them is
+fn selectCoarseLevel(brickCoord: vec3<i32>, rayOrigin: vec3<f32>) -> u32
+{
+    if (params.coarseThresholdPixels <= 0.0)
+    {
+        return 0u;
+    }
+
+    let brickCenter: vec3<f32> = (vec3<f32>(brickCoord) + 0.5) * 8.0;
+    let brickPixels: f32 = 8.0 / max(distance(brickCenter, rayOrigin) * params.pixelSpread, 1e-6);
+
+    if (brickPixels * 2.0 < params.coarseThresholdPixels)
     {
-        localCoordV.x = 7u - localCoordV.x;
+        return 2u;
     }
-    if (flippedAxis(1u))
+    if (brickPixels < params.coarseThresholdPixels)
     {
-        localCoordV.y = 7u - localCoordV.y;
+        return 1u;
     }
-    if (flippedAxis(2u))
+    return 0u;
+}
+
+//================================//
+fn coarseCellIndex(pageSlot: u32, brickCoord: vec3<u32>, level: u32) -> u32
+{
+    let cellCoord = brickCoord % vec3<u32>(BRICK_PAGE_SIZE);
+    if (level == 1u)
     {
-        localCoordV.z = 7u - localCoordV.z;
+        let coarseCoord = cellCoord / 2u;
+        return pageSlot * BRICK_PAGE_COARSE_CELLS + coarseCoord.x + coarseCoord.y * 4u + coarseCoord.z * 16u;
     }
 
-    return localCoordV.x + localCoordV.y * 8u + localCoordV.z * 64u;
+    let coarseCoord = cellCoord / 4u;
+    return pageSlot * BRICK_PAGE_COARSE_CELLS + BRICK_PAGE_COARSE_CELLS_L1 + coarseCoord.x + coarseCoord.y * 2u + coarseCoord.z * 4u;
+}
+
+//================================//
+fn isCoarseCellOccupied(coarseCell: u32) -> bool
+{
+    return (coarseCell & 0x80000000u) != 0u;
 }
 
 //================================//
@@ -245,11 +373,23 @@ fn c(@builtin(global_invocation_id) gid: vec3<u32>)
     let x_ndc = px * 2.0 - 1.0;
     let y_ndc = 1.0 - py * 2.0;
 
-    let rayDir = normalize(
+    var rayDir = normalize(
         (params.pixelToRay * vec4<f32>(x_ndc, y_ndc, 1.0, 0.0)).xyz
     );
 
-    let rayOrigin = params.cameraOrigin;
+    var rayOrigin = params.cameraOrigin;
+
+    // Flipping an axis of the grid is the same as mirroring the ray,
+    // so the traversal happens directly in storage space
+    let gridMax: f32 = f32(params.voxelResolution);
+    for (var axis: u32 = 0u; axis < 3u; axis = axis + 1u)
+    {
+        if (flippedAxis(axis))
+        {
+            rayOrigin[axis] = gridMax - rayOrigin[axis];
+            rayDir[axis] = -rayDir[axis];
+        }
+    }
 
     var color: vec3<f32> = vec3<f32>(0.0, 0.0, 0.0);
     let hit = traverseGrid(rayOrigin, rayDir, &color);
@@ -309,8 +449,9 @@ fn traverseGrid(rayOrigin: vec3<f32>, rayDir: vec3<f32>, color: ptr<function, ve
     
     let deltaBrick: vec3<f32> = abs(rayDirInv) * brickSize;
 
-    // Main DDA loop
-    for (var i: i32 = 0; i < 512; i = i + 1) // Safety limit
+    // Main DDA loop, a ray crosses at most 3 * brickResolution bricks, page skips only shorten it
+    let maxSteps: i32 = 3 * brickResolution + 3;
+    for (var i: i32 = 0; i < maxSteps; i = i + 1) // Safety limit
     {
         // Bounds check
         if (brickCoord.x < 0 || brickCoord.y < 0 || brickCoord.z < 0 ||
@@ -321,42 +462,115 @@ fn traverseGrid(rayOrigin: vec3<f32>, rayDir: vec3<f32>, color: ptr<function, ve
             break;
         }
 
-        let brickIndex: u32 = brickToIndex(vec3<u32>(brickCoord));
-        let brickPointer: u32 = brickGrid[brickIndex]; // Non-atomic read to try and speed up
+        // Page table lookup, empty pages are skipped entirely
+        let pageCoord: vec3<u32> = vec3<u32>(brickCoord) / BRICK_PAGE_SIZE;
+        let pageEntry: u32 = brickPageTable[pageToIndex(pageCoord)];
 
-        let brickLoaded: bool = isBrickLoaded(brickPointer);
-        let brickUnloaded: bool = isBrickUnloaded(brickPointer);
+        if (!isPageAllocated(pageEntry))
+        {
+            let pageMin: vec3<f32> = vec3<f32>(pageCoord * BRICK_PAGE_SIZE) * brickSize;
+            let pageMax: vec3<f32> = min(pageMin + f32(BRICK_PAGE_SIZE) * brickSize, vec3<f32>(gridMax));
+            let tExitPageVec: vec3<f32> = (select(pageMin, pageMax, rayDir > vec3<f32>(0.0)) - rayOrigin) * rayDirInv;
+            let tExitPage: f32 = min(min(tExitPageVec.x, tExitPageVec.y), tExitPageVec.z);
 
-        if (brickUnloaded)
+            if (tExitPage >= tFar)
+            {
+                break;
+            }
+
+            // Restart the brick DDA right after the page, the exit axis is set explicitly
+            // so that float error can never keep us inside the same page
+            let restartPoint: vec3<f32> = rayOrigin + rayDir * tExitPage;
+            brickCoord = vec3<i32>(floor(restartPoint / brickSize));
+            brickCoord = clamp(brickCoord, vec3<i32>(pageCoord * BRICK_PAGE_SIZE), vec3<i32>(pageCoord * BRICK_PAGE_SIZE + BRICK_PAGE_SIZE - 1u));
+
+            var exitAxis: u32 = 0u;
+            if (tExitPageVec.y <= tExitPageVec.x && tExitPageVec.y <= tExitPageVec.z)
+            {
+                exitAxis = 1u;
+            }
+            else if (tExitPageVec.z <= tExitPageVec.x && tExitPageVec.z <= tExitPageVec.y)
+            {
+                exitAxis = 2u;
+            }
+            brickCoord[exitAxis] = select(i32(pageCoord[exitAxis] * BRICK_PAGE_SIZE) - 1, i32((pageCoord[exitAxis] + 1u) * BRICK_PAGE_SIZE), rayDir[exitAxis] > 0.0);
+
+            let restartBoundary: vec3<f32> = (vec3<f32>(brickCoord) + max(rayDirSign, vec3<f32>(0.0))) * brickSize;
+            tBrick = max((restartBoundary - rayOrigin) * rayDirInv, vec3<f32>(tExitPage));
+            continue;
+        }
+
+        // Far bricks are smaller than a pixel, the coarse cell around them is drawn and they are never requested
+        let coarseLevel: u32 = selectCoarseLevel(brickCoord, rayOrigin);
+        if (coarseLevel > 0u)
         {
-            (*color) = loadLODColorFromPointer(brickPointer);
-            writeFeedback(brickIndex);
-            return true;
+            let coarseCell: u32 = brickCoarse[coarseCellIndex(pageSlotFromEntry(pageEntry), vec3<u32>(brickCoord), coarseLevel)];
+            if (isCoarseCellOccupied(coarseCell))
+            {
+                if (params.hasColor == 0u)
+                {
+                    (*color) = vec3<f32>(1.0, 1.0, 1.0);
+                }
+                else
+                {
+                    (*color) = loadLODColorFromPointer(coarseCell);
+                }
+                return true;
+            }
         }
-        else if (brickLoaded)
+        else
         {
-            let brickSlot: u32 = brickSlotFromPointer(brickPointer);
-            let brickMin: vec3<f32> = vec3<f32>(brickCoord) * brickSize;
+            let brickIndex: u32 = brickToIndex(vec3<u32>(brickCoord));
+            let poolIndex: u32 = pageSlotFromEntry(pageEntry) * BRICK_PAGE_CELLS + brickToCellIndex(vec3<u32>(brickCoord));
+            let brickPointer: u32 = brickGrid[poolIndex]; // Non-atomic read to try and speed up
 
-            // Compute entry/exit for this brick
-            let t1_local: vec3<f32> = (brickMin - rayOrigin) * rayDirInv;
-            let t2_local: vec3<f32> = (brickMin + brickSize - rayOrigin) * rayDirInv;
+            let brickLoaded: bool = isBrickLoaded(brickPointer);
+            let brickUnloaded: bool = isBrickUnloaded(brickPointer);
 
-            let tEnterVec: vec3<f32> = min(t1_local, t2_local);
-            let tExitVec: vec3<f32> = max(t1_local, t2_local);
+            if (isBrickUniform(brickPointer))
+            {
+                // Every voxel is set, the ray hits where it enters the brick
+                if (params.hasColor == 0u)
+                {
+                    (*color) = vec3<f32>(1.0, 1.0, 1.0);
+                }
+                else
+                {
+                    (*color) = loadLODColorFromPointer(brickPointer);
+                }
+                return true;
+            }
+            else if (brickUnloaded)
+            {
+                (*color) = loadLODColorFromPointer(brickPointer);
+                writeFeedback(brickIndex, poolIndex);
+                return true;
+            }
+            else if (brickLoaded)
+            {
+                let brickSlot: u32 = brickSlotFromPointer(brickPointer);
+                let brickMin: vec3<f32> = vec3<f32>(brickCoord) * brickSize;
 
-            var tEnter: f32 = max(max(tEnterVec.x, tEnterVec.y), tEnterVec.z);
-            let tExit: f32 = min(min(tExitVec.x, tExitVec.y), tExitVec.z);
+                // Compute entry/exit for this brick
+                let t1_local: vec3<f32> = (brickMin - rayOrigin) * rayDirInv;
+                let t2_local: vec3<f32> = (brickMin + brickSize - rayOrigin) * rayDirInv;
 
-            // Don't enter brick from behind camera
-            tEnter = max(tEnter, 0.0);
+                let tEnterVec: vec3<f32> = min(t1_local, t2_local);
+                let tExitVec: vec3<f32> = max(t1_local, t2_local);
 
-            if (tEnter <= tExit)
-            {
-                let hit = traverseBrick(rayOrigin, rayDir, tEnter, tExit, brickMin, brickSlot, color);
-                if (hit)
+                var tEnter: f32 = max(max(tEnterVec.x, tEnterVec.y), tEnterVec.z);
+                let tExit: f32 = min(min(tExitVec.x, tExitVec.y), tExitVec.z);
+
+                // Don't enter brick from behind camera
+                tEnter = max(tEnter, 0.0);
+
+                if (tEnter <= tExit)
                 {
-                    return true;
+                    let hit = traverseBrick(rayOrigin, rayDir, tEnter, tExit, brickMin, brickSlot, color);
+                    if (hit)
+                    {
+                        return true;
+                    }
                 }
             }
         }
@@ -416,6 +630,8 @@ fn traverseBrick(rayOrigin: vec3<f32>, rayDir: vec3<f32>, tEnter: f32, tExit: f3
     
     let deltaVoxel: vec3<f32> = abs(rayDirInv);
 
+    let brick: Brick = brickPool[brickSlot];
+
     // Voxel DDA loop
     for (var i: i32 = 0; i < 24; i = i + 1) // Max ~24 steps through 8x8x8
     {
@@ -427,7 +643,7 @@ fn traverseBrick(rayOrigin: vec3<f32>, rayDir: vec3<f32>, tEnter: f32, tExit: f3
         }
 
         // Check occupancy
-        if (isVoxelSet(brickPool[brickSlot], u32(voxel.x), u32(voxel.y), u32(voxel.z)))
+        if (isVoxelSet(brick, u32(voxel.x), u32(voxel.y), u32(voxel.z)))
         {
             if (params.hasColor == 0u)
             {
@@ -436,7 +652,7 @@ fn traverseBrick(rayOrigin: vec3<f32>, rayDir: vec3<f32>, tEnter: f32, tExit: f3
             else
             {
                 let voxelIndex: u32 = localCoordToVoxelIndex(vec3<u32>(voxel));
-                (*color) = loadColor(brickSlot, voxelIndex);
+                (*color) = loadColor(brickSlot, brick, voxelIndex);
             }
             return true;
         }
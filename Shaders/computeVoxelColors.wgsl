@@ -0,0 +1,164 @@
+// Second pass of each chunk: colors the voxels won by a triangle of the chunk in computeVoxelization.wgsl.
+// Run once the chunk went through every triangle range, so each voxel is sampled once from a single triangle
+
+struct Uniforms {
+    voxelResolution: u32,
+    brickResolution: u32,
+    voxelSize: f32,
+    numTriangles: u32,
+    meshMinBounds: vec3<f32>,
+    triangleBase: u32, // Index in the mesh of the first triangle of the chunk
+    brickStart: u32,
+    brickEnd: u32,
+    triangleStart: u32,
+    triangleEnd: u32,
+    meshExtent: vec3<f32>,
+    _pad2: u32,
+    uvOffset: vec2<f32>,
+    uvExtent: vec2<f32>,
+}
+
+@group(0) @binding(0) var<uniform> uniforms: Uniforms;
+@group(0) @binding(1) var<storage, read> vertices: array<u32>;  // Three words per vertex, see vertexPosition
+@group(0) @binding(2) var<storage, read> triangles: array<u32>; // Three vertex indices per triangle
+@group(0) @binding(3) var meshTexture: texture_2d_array<f32>; // One layer per material, with mips
+@group(0) @binding(4) var meshSampler: sampler;
+@group(0) @binding(5) var<storage, read> voxelWinners: array<u32>; // 1 + mesh index of the winning triangle, 0 for none
+@group(0) @binding(6) var<storage, read_write> denseColors: array<u32>;
+@group(0) @binding(7) var<storage, read> candidateBricks: array<u32>; // Grid index of each candidate, the pass covers [brickStart, brickEnd)
+
+//================================//
+// Vertices are packed as x | y << 16, z | u << 16 and v | layer << 16, 16 bit unorms over the mesh and UV bounds
+fn vertexPosition(index: u32) -> vec3<f32>
+{
+    let xy = unpack2x16unorm(vertices[index * 3u]);
+    let zu = unpack2x16unorm(vertices[index * 3u + 1u]);
+    return uniforms.meshMinBounds + vec3<f32>(xy, zu.x) * uniforms.meshExtent;
+}
+
+//================================//
+fn vertexUV(index: u32) -> vec2<f32>
+{
+    let zu = unpack2x16unorm(vertices[index * 3u + 1u]);
+    let v = unpack2x16unorm(vertices[index * 3u + 2u]);
+    return uniforms.uvOffset + vec2<f32>(zu.y, v.x) * uniforms.uvExtent;
+}
+
+//================================//
+fn vertexLayer(index: u32) -> u32
+{
+    return vertices[index * 3u + 2u] >> 16u;
+}
+
+//================================//
+// Mip level where a texel covers about a voxel, from the texel density of the triangle
+fn triangleTextureLod(p0: vec3<f32>, p1: vec3<f32>, p2: vec3<f32>, uv0: vec2<f32>, uv1: vec2<f32>, uv2: vec2<f32>) -> f32
+{
+    let textureSize = vec2<f32>(textureDimensions(meshTexture, 0));
+    let worldArea = length(cross(p1 - p0, p2 - p0));
+    let texel1 = (uv1 - uv0) * textureSize;
+    let texel2 = (uv2 - uv0) * textureSize;
+    let texelArea = abs(texel1.x * texel2.y - texel1.y * texel2.x);
+    if (worldArea <= 0.0 || texelArea <= 0.0) {
+        return 0.0;
+    }
+    return max(log2(sqrt(texelArea / worldArea) * uniforms.voxelSize), 0.0);
+}
+
+//================================//
+fn packColor(r: u32, g: u32, b: u32) -> u32 
+{
+    return (r & 0xFFu) | ((g & 0xFFu) << 8u) | ((b & 0xFFu) << 16u);
+}
+
+//================================//
+fn barycentric(p: vec3<f32>, v0: vec3<f32>, v1: vec3<f32>, v2: vec3<f32>) -> vec3<f32> 
+{
+    let e0 = v1 - v0;
+    let e1 = v2 - v0;
+    let e2 = p - v0;
+    
+    let d00 = dot(e0, e0);
+    let d01 = dot(e0, e1);
+    let d11 = dot(e1, e1);
+    let d20 = dot(e2, e0);
+    let d21 = dot(e2, e1);
+    
+    let denom = d00 * d11 - d01 * d01;
+    if (abs(denom) < 1e-10) {
+        return vec3<f32>(1.0, 0.0, 0.0);
+    }
+    
+    var v = (d11 * d20 - d01 * d21) / denom;
+    var w = (d00 * d21 - d01 * d20) / denom;
+
+    // Make sure to clamp v and w
+    v = clamp(v, 0.0, 1.0);
+    w = clamp(w, 0.0, 1.0);
+    if (v + w > 1.0) {
+        let scale = 1.0 / (v + w);
+        v *= scale;
+        w *= scale;
+    }
+    let u = 1.0 - v - w;
+    
+    return vec3<f32>(u, v, w);
+}
+
+//================================//
+// First voxel of the brick, in voxel space
+fn brickVoxelBase(localBrickIndex: u32) -> vec3<u32>
+{
+    let globalBrickIndex = candidateBricks[uniforms.brickStart + localBrickIndex];
+
+    let bricksPerRow = uniforms.brickResolution;
+    let brickZ = globalBrickIndex / (bricksPerRow * bricksPerRow);
+    let brickY = (globalBrickIndex / bricksPerRow) % bricksPerRow;
+    let brickX = globalBrickIndex % bricksPerRow;
+    return vec3<u32>(brickX, brickY, brickZ) * 8u;
+}
+
+//================================//
+// One invocation per voxel of the pass, voxels won by another chunk keep the color it gave them
+@compute @workgroup_size(64)
+fn c(@builtin(global_invocation_id) gid: vec3<u32>, @builtin(num_workgroups) numWorkgroups: vec3<u32>) 
+{
+    let denseIndex = gid.x + gid.y * numWorkgroups.x * 64u;
+    if (denseIndex >= (uniforms.brickEnd - uniforms.brickStart) * 512u) {
+        return;
+    }
+
+    let winnerKey = voxelWinners[denseIndex];
+    if (winnerKey <= uniforms.triangleBase || winnerKey > uniforms.triangleBase + uniforms.numTriangles) {
+        return;
+    }
+    let triIndex = winnerKey - 1u - uniforms.triangleBase;
+
+    // Voxel center, same as the overlap test
+    let localVoxelIndex = denseIndex % 512u;
+    let voxel = brickVoxelBase(denseIndex / 512u) + vec3<u32>(localVoxelIndex % 8u, (localVoxelIndex / 8u) % 8u, localVoxelIndex / 64u);
+    let voxelCenter = uniforms.meshMinBounds + (vec3<f32>(voxel) + 0.5) * uniforms.voxelSize;
+
+    let i0 = triangles[triIndex * 3u];
+    let i1 = triangles[triIndex * 3u + 1u];
+    let i2 = triangles[triIndex * 3u + 2u];
+    let p0 = vertexPosition(i0);
+    let p1 = vertexPosition(i1);
+    let p2 = vertexPosition(i2);
+    let uv0 = vertexUV(i0);
+    let uv1 = vertexUV(i1);
+    let uv2 = vertexUV(i2);
+
+    // The material and mip level are the same for the whole triangle
+    let layer = vertexLayer(i0);
+    let lod = triangleTextureLod(p0, p1, p2, uv0, uv1, uv2);
+
+    let bary = barycentric(voxelCenter, p0, p1, p2);
+    let uv = bary.x * uv0 + bary.y * uv1 + bary.z * uv2;
+    let texColor = textureSampleLevel(meshTexture, meshSampler, uv, layer, lod);
+
+    let r = u32(clamp(texColor.r * 255.0, 0.0, 255.0));
+    let g = u32(clamp(texColor.g * 255.0, 0.0, 255.0));
+    let b = u32(clamp(texColor.b * 255.0, 0.0, 255.0));
+    denseColors[denseIndex] = packColor(r, g, b);
+}
@@ -1,4 +1,5 @@
-// First pass: performs the voxelization of the triangle mesh.
+// First pass: performs the voxelization of the triangle mesh. Colors are picked afterwards by computeVoxelColors.wgsl,
+// from the triangle that won each voxel here
 
 struct Uniforms {
     voxelResolution: u32,
@@ -6,38 +7,36 @@ struct Uniforms {
     voxelSize: f32,
     numTriangles: u32,
     meshMinBounds: vec3<f32>,
-    _pad: u32,
+    triangleBase: u32, // Index in the mesh of the first triangle of the chunk
     brickStart: u32,
     brickEnd: u32,
-    _pad2: vec2<u32>,
-}
-
-struct Vertex {
-    position: vec3<f32>,
-    _pad: f32,
-    uv: vec2<f32>,
-    _pad2: vec2<f32>,
-    normal: vec3<f32>,
-    _pad3: f32,
-}
-
-struct Triangle {
-    indices: vec3<u32>,
-    _pad: u32,
+    triangleStart: u32,
+    triangleEnd: u32,
+    meshExtent: vec3<f32>,
+    _pad2: u32,
+    uvOffset: vec2<f32>,
+    uvExtent: vec2<f32>,
 }
 
 @group(0) @binding(0) var<uniform> uniforms: Uniforms;
-@group(0) @binding(1) var<storage, read> vertices: array<Vertex>;
-@group(0) @binding(2) var<storage, read> triangles: array<Triangle>;
-@group(0) @binding(3) var meshTexture: texture_2d<f32>;
-@group(0) @binding(4) var meshSampler: sampler;
-@group(0) @binding(5) var<storage, read_write> occupancy: array<atomic<u32>>;
-@group(0) @binding(6) var<storage, read_write> denseColors: array<atomic<u32>>;
+@group(0) @binding(1) var<storage, read> vertices: array<u32>;  // Three words per vertex, see vertexPosition
+@group(0) @binding(2) var<storage, read> triangles: array<u32>; // Three vertex indices per triangle
+@group(0) @binding(3) var<storage, read_write> occupancy: array<atomic<u32>>;
+// Per voxel, 1 + mesh index of the last triangle in mesh order overlapping it, 0 when none does
+@group(0) @binding(4) var<storage, read_write> voxelWinners: array<atomic<u32>>;
+// Triangles overlapping each brick, filled by computeTriangleBinning.wgsl
+@group(0) @binding(5) var<storage, read> binOffsets: array<u32>;
+@group(0) @binding(6) var<storage, read> binCounts: array<u32>;
+@group(0) @binding(7) var<storage, read> binnedTriangles: array<u32>;
+@group(0) @binding(8) var<storage, read> candidateBricks: array<u32>; // Grid index of each candidate, the pass covers [brickStart, brickEnd)
 
 //================================//
-fn packColor(r: u32, g: u32, b: u32) -> u32 
+// Vertices are packed as x | y << 16, z | u << 16 and v | layer << 16, 16 bit unorms over the mesh and UV bounds
+fn vertexPosition(index: u32) -> vec3<f32>
 {
-    return (r & 0xFFu) | ((g & 0xFFu) << 8u) | ((b & 0xFFu) << 16u);
+    let xy = unpack2x16unorm(vertices[index * 3u]);
+    let zu = unpack2x16unorm(vertices[index * 3u + 1u]);
+    return uniforms.meshMinBounds + vec3<f32>(xy, zu.x) * uniforms.meshExtent;
 }
 
 //================================//
@@ -112,123 +111,123 @@ fn triangleAABBIntersect(v0: vec3<f32>, v1: vec3<f32>, v2: vec3<f32>, boxCenter:
 }
 
 //================================//
-fn barycentric(p: vec3<f32>, v0: vec3<f32>, v1: vec3<f32>, v2: vec3<f32>) -> vec3<f32> 
-{
-    let e0 = v1 - v0;
-    let e1 = v2 - v0;
-    let e2 = p - v0;
-    
-    let d00 = dot(e0, e0);
-    let d01 = dot(e0, e1);
-    let d11 = dot(e1, e1);
-    let d20 = dot(e2, e0);
-    let d21 = dot(e2, e1);
-    
-    let denom = d00 * d11 - d01 * d01;
-    if (abs(denom) < 1e-10) {
-        return vec3<f32>(1.0, 0.0, 0.0);
-    }
-    
-    var v = (d11 * d20 - d01 * d21) / denom;
-    var w = (d00 * d21 - d01 * d20) / denom;
-
-    // Make sure to clamp v and w
-    v = clamp(v, 0.0, 1.0);
-    w = clamp(w, 0.0, 1.0);
-    if (v + w > 1.0) {
-        let scale = 1.0 / (v + w);
-        v *= scale;
-        w *= scale;
-    }
-    let u = 1.0 - v - w;
-    
-    return vec3<f32>(u, v, w);
-}
-
-//================================//
-@compute @workgroup_size(64)
-fn c(@builtin(global_invocation_id) gid: vec3<u32>) 
+// First voxel of the brick, in voxel space
+fn brickVoxelBase(localBrickIndex: u32) -> vec3<u32>
 {
-    let localBrickIndex = gid.x;
-    let bricksThisPass = uniforms.brickEnd - uniforms.brickStart;
-    if (localBrickIndex >= bricksThisPass) {
-        return;
-    }
-
-    // Convert local brick index to global brick coordinates
-    let globalBrickIndex = uniforms.brickStart + localBrickIndex;
+    let globalBrickIndex = candidateBricks[uniforms.brickStart + localBrickIndex];
 
     let bricksPerRow = uniforms.brickResolution;
     let brickZ = globalBrickIndex / (bricksPerRow * bricksPerRow);
     let brickY = (globalBrickIndex / bricksPerRow) % bricksPerRow;
     let brickX = globalBrickIndex % bricksPerRow;
+    return vec3<u32>(brickX, brickY, brickZ) * 8u;
+}
 
-    // Brick bounds in voxel space
-    let brickVoxelBase = vec3<u32>(brickX, brickY, brickZ) * 8u;
-    let brickVoxelMax  = brickVoxelBase + vec3<u32>(7u);
+//================================//
+// Tests the voxels of the brick inside the triangle bounds, marks the ones the triangle overlaps. The later triangle
+// in mesh order wins a voxel whatever order the lists were filled and walked in, like the CPU backend
+fn voxelizeTriangleInBrick(triIndex: u32, localBrickIndex: u32, voxelBase: vec3<u32>)
+{
+    let i0 = triangles[triIndex * 3u];
+    let i1 = triangles[triIndex * 3u + 1u];
+    let i2 = triangles[triIndex * 3u + 2u];
+
+    let p0 = vertexPosition(i0);
+    let p1 = vertexPosition(i1);
+    let p2 = vertexPosition(i2);
+
+    // Triangle AABB in voxel space, padded for the epsilon of the overlap test
+    let triMin = vec3<i32>(floor((min(min(p0, p1), p2) - uniforms.meshMinBounds) / uniforms.voxelSize - 0.001));
+    let triMax = vec3<i32>(floor((max(max(p0, p1), p2) - uniforms.meshMinBounds) / uniforms.voxelSize + 0.001));
+
+    // BREAK EARLY: Triangle does not intersect brick AABB
+    let brickMin = vec3<i32>(voxelBase);
+    let brickMax = brickMin + vec3<i32>(7);
+    if (any(triMax < brickMin) || any(triMin > brickMax)) {
+        return;
+    }
 
-    // Brick bounds in world space
-    let brickMinWorld = uniforms.meshMinBounds + vec3<f32>(brickVoxelBase) * uniforms.voxelSize;
-    let brickMaxWorld = uniforms.meshMinBounds + (vec3<f32>(brickVoxelMax) + 1.0) * uniforms.voxelSize;
+    let voxelMin = vec3<u32>(max(triMin, brickMin));
+    let voxelMax = vec3<u32>(min(triMax, brickMax));
     let halfVoxel = uniforms.voxelSize * 0.5;
 
-    // Iterate triangles
-    for (var triIndex = 0u; triIndex < uniforms.numTriangles; triIndex++) 
-    {
-        let tri = triangles[triIndex];
-
-        let v0 = vertices[tri.indices.x];
-        let v1 = vertices[tri.indices.y];
-        let v2 = vertices[tri.indices.z];
+    let winnerKey = uniforms.triangleBase + triIndex + 1u;
 
-        let p0 = v0.position;
-        let p1 = v1.position;
-        let p2 = v2.position;
+    // Only the voxels of the brick the triangle bounds cover
+    for (var z = voxelMin.z; z <= voxelMax.z; z++) {
+        for (var y = voxelMin.y; y <= voxelMax.y; y++) {
+            for (var x = voxelMin.x; x <= voxelMax.x; x++) 
+            {
+                let voxel = vec3<u32>(x, y, z);
+                let voxelCenter = uniforms.meshMinBounds + (vec3<f32>(voxel) + 0.5) * uniforms.voxelSize;
 
-        // Triangle AABB in world space
-        let triMin = min(min(p0, p1), p2);
-        let triMax = max(max(p0, p1), p2);
+                if (!triangleAABBIntersect(p0, p1, p2, voxelCenter, vec3<f32>(halfVoxel))) 
+                {
+                    continue;
+                }
 
-        // BREKA EARLY: Triangle does not intersect brick AABB
-        if (triMax.x < brickMinWorld.x || triMin.x > brickMaxWorld.x ||
-            triMax.y < brickMinWorld.y || triMin.y > brickMaxWorld.y ||
-            triMax.z < brickMinWorld.z || triMin.z > brickMaxWorld.z) {
-            continue;
-        }
+                let localVoxel = voxel - voxelBase;
+                let localVoxelIndex = localVoxel.x + localVoxel.y * 8u + localVoxel.z * 64u;
 
-        // Iterate all 512 voxels in the brick
-        for (var z = 0u; z < 8u; z++) {
-            for (var y = 0u; y < 8u; y++) {
-                for (var x = 0u; x < 8u; x++) 
-                {
-                    let voxel = brickVoxelBase + vec3<u32>(x, y, z);
-                    let voxelCenter = uniforms.meshMinBounds + (vec3<f32>(voxel) + 0.5) * uniforms.voxelSize;
+                // Occupancy
+                let wordIndex = localBrickIndex * 16u + (localVoxelIndex / 32u);
+                let bitIndex = localVoxelIndex % 32u;
+                atomicOr(&occupancy[wordIndex], 1u << bitIndex);
 
-                    if (!triangleAABBIntersect(p0, p1, p2, voxelCenter, vec3<f32>(halfVoxel))) 
-                    {
-                        continue;
-                    }
+                // Color source
+                atomicMax(&voxelWinners[localBrickIndex * 512u + localVoxelIndex], winnerKey);
+            }
+        }
+    }
+}
 
-                    let localVoxelIndex = x + y * 8u + z * 64u;
+//================================//
+// Brick parallel: one invocation per brick, walking the triangles binned to it
+@compute @workgroup_size(64)
+fn c(@builtin(global_invocation_id) gid: vec3<u32>) 
+{
+    let localBrickIndex = gid.x;
+    let bricksThisPass = uniforms.brickEnd - uniforms.brickStart;
+    if (localBrickIndex >= bricksThisPass) {
+        return;
+    }
 
-                    // Occupancy
-                    let wordIndex = localBrickIndex * 16u + (localVoxelIndex / 32u);
-                    let bitIndex = localVoxelIndex % 32u;
-                    atomicOr(&occupancy[wordIndex], 1u << bitIndex);
+    let voxelBase = brickVoxelBase(localBrickIndex);
 
-                    // Sample color
-                    let bary = barycentric(voxelCenter, p0, p1, p2);
-                    let uv = bary.x * v0.uv + bary.y * v1.uv + bary.z * v2.uv;
-                    let texColor = textureSampleLevel(meshTexture, meshSampler, uv, 0.0);
+    // Iterate the triangles binned to this brick
+    let binStart = binOffsets[localBrickIndex];
+    let binCount = binCounts[localBrickIndex];
+    for (var binIndex = 0u; binIndex < binCount; binIndex++) 
+    {
+        voxelizeTriangleInBrick(binnedTriangles[binStart + binIndex], localBrickIndex, voxelBase);
+    }
+}
 
-                    let r = u32(clamp(texColor.r * 255.0, 0.0, 255.0));
-                    let g = u32(clamp(texColor.g * 255.0, 0.0, 255.0));
-                    let b = u32(clamp(texColor.b * 255.0, 0.0, 255.0));
+//================================//
+// Triangle parallel: one invocation per triangle and brick it overlaps. The binning already split large
+// triangles in brick sized tiles, so no invocation walks more than 512 voxels
+@compute @workgroup_size(64)
+fn t(@builtin(global_invocation_id) gid: vec3<u32>, @builtin(num_workgroups) numWorkgroups: vec3<u32>) 
+{
+    let entryIndex = gid.x + gid.y * numWorkgroups.x * 64u;
+    let bricksThisPass = uniforms.brickEnd - uniforms.brickStart;
+    let numEntries = binOffsets[bricksThisPass - 1u] + binCounts[bricksThisPass - 1u];
+    if (entryIndex >= numEntries) {
+        return;
+    }
 
-                    let localDenseIdx = localBrickIndex * 512u + localVoxelIndex;
-                    atomicStore(&denseColors[localDenseIdx], packColor(r, g, b));
-                }
-            }
+    // Last brick whose list starts at or before the entry, the empty lists after it start past it
+    var low = 0u;
+    var high = bricksThisPass - 1u;
+    while (low < high)
+    {
+        let mid = (low + high + 1u) / 2u;
+        if (binOffsets[mid] <= entryIndex) {
+            low = mid;
+        } else {
+            high = mid - 1u;
         }
     }
+
+    voxelizeTriangleInBrick(binnedTriangles[entryIndex], low, brickVoxelBase(low));
 }
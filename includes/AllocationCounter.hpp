@@ -0,0 +1,35 @@
+#ifndef ALLOCATION_COUNTER_HPP
+#define ALLOCATION_COUNTER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <memory_resource>
+
+// Heap allocations made by the calling thread so far. Counted by a global operator new in builds
+// configured with SKYEGRID_COUNT_ALLOCATIONS (benchmark builds), always 0 otherwise
+uint64_t GetThreadAllocationCount();
+
+//================================//
+// Forwards to the default heap and counts the allocations it made, so that the growth of a pooled
+// storage can be told apart from per frame churn
+class CountingMemoryResource : public std::pmr::memory_resource
+{
+public:
+    uint64_t GetAllocationCount() const { return this->allocationCount; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        this->allocationCount++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    uint64_t allocationCount = 0;
+};
+
+#endif // ALLOCATION_COUNTER_HPP
@@ -0,0 +1,151 @@
+#ifndef BRICK_PAGE_TABLE_HPP
+#define BRICK_PAGE_TABLE_HPP
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <cstring>
+
+// The brick grid is split into pages of 8x8x8 bricks. A dense (but small) page table
+// maps every page to a slot in the page pool, and pages are only allocated when at least
+// one of their bricks is non empty. Same layout is mirrored on the GPU.
+const uint32_t BRICK_PAGE_SIZE = 8;
+const uint32_t BRICK_PAGE_CELLS = BRICK_PAGE_SIZE * BRICK_PAGE_SIZE * BRICK_PAGE_SIZE; // 512 bricks per page
+const uint32_t BRICK_PAGE_REQUEST_WORDS = BRICK_PAGE_CELLS / 32; // request flags, 1 bit per brick
+const uint32_t INVALID_PAGE_SLOT = UINT32_MAX;
+
+// Coarse levels of a page, drawn instead of the bricks far from the camera: 4x4x4 cells of 2x2x2 bricks,
+// then 2x2x2 cells of 4x4x4 bricks. Each cell is [31] occupied, [23:0] average LOD color of its bricks
+const uint32_t BRICK_PAGE_COARSE_LEVELS = 2;
+const uint32_t BRICK_PAGE_COARSE_CELLS_L1 = 64;
+const uint32_t BRICK_PAGE_COARSE_CELLS_L2 = 8;
+const uint32_t BRICK_PAGE_COARSE_CELLS = BRICK_PAGE_COARSE_CELLS_L1 + BRICK_PAGE_COARSE_CELLS_L2;
+
+//================================//
+struct ColorRGB
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t _pad;
+};
+
+//================================//
+// One bit per cell of a page, CPU bookkeeping is kept as bitsets so status scans go a word at a time
+struct BrickPageBitset
+{
+    uint32_t words[BRICK_PAGE_CELLS / 32];
+
+    bool Test(uint32_t cellIndex) const { return (this->words[cellIndex >> 5] & (1u << (cellIndex & 31u))) != 0u; }
+    void Set(uint32_t cellIndex) { this->words[cellIndex >> 5] |= 1u << (cellIndex & 31u); }
+    void Reset(uint32_t cellIndex) { this->words[cellIndex >> 5] &= ~(1u << (cellIndex & 31u)); }
+    void Assign(uint32_t cellIndex, bool value) { value ? Set(cellIndex) : Reset(cellIndex); }
+    void ResetAll() { std::memset(this->words, 0, sizeof(this->words)); }
+};
+
+// Residency of a brick, what releasing its slot needs once the cell itself has changed
+struct BrickResidency
+{
+    bool onGPU = false;
+    bool uniform = false;
+    uint32_t gpuBrickIndex = UINT32_MAX;
+};
+
+struct BrickGridCell
+{
+    // [23:0]   : pointer / index or LOD in case unl oaded (r, g, b)
+    // [31]     : resident flag
+    // [30]     : requested flag
+    // [29]     : unloaded flag
+    // [28]     : uniform flag, every voxel set with the color in [23:0]
+    // [27:24]  : unused
+    uint32_t pointer;
+};
+
+//================================//
+struct BrickGridPage
+{
+    BrickGridCell cells[BRICK_PAGE_CELLS];         // What goes to the GPU page pool
+    uint32_t coarseCells[BRICK_PAGE_COARSE_CELLS]; // What goes to the GPU coarse pool, level 1 then level 2
+    uint32_t pageIndex = 0;                        // Index of this page in the page table
+
+    // CPU only bookkeeping
+    BrickPageBitset dirty;
+    BrickPageBitset onGPU;
+    BrickPageBitset reading;
+    BrickPageBitset pendingRead;
+    BrickPageBitset uniform; // Solid single color brick, lives in the pointer only, no pool slot
+    BrickPageBitset edited;  // Changed at runtime, the copy on disk is stale
+    uint32_t lodColors[BRICK_PAGE_CELLS]; // Packed like the color of a LOD pointer, [23:0] (r, g, b)
+    uint32_t brickSlots[BRICK_PAGE_CELLS];  // Brick pool slot per cell, UINT32_MAX without one. Filled by AllocatePage
+
+    ColorRGB GetLODColor(uint32_t cellIndex) const
+    {
+        const uint32_t packed = this->lodColors[cellIndex];
+        return {static_cast<uint8_t>(packed & 0xFFu), static_cast<uint8_t>((packed >> 8) & 0xFFu), static_cast<uint8_t>((packed >> 16) & 0xFFu), 0};
+    }
+    void SetLODColor(uint32_t cellIndex, ColorRGB color)
+    {
+        this->lodColors[cellIndex] = uint32_t(color.r) | (uint32_t(color.g) << 8) | (uint32_t(color.b) << 16);
+    }
+
+    uint32_t GetBrickSlot(uint32_t cellIndex) const { return this->brickSlots[cellIndex]; }
+    void SetBrickSlot(uint32_t cellIndex, uint32_t slot) { this->brickSlots[cellIndex] = slot; }
+
+    BrickResidency GetResidency(uint32_t cellIndex) const
+    {
+        return {this->onGPU.Test(cellIndex), this->uniform.Test(cellIndex), GetBrickSlot(cellIndex)};
+    }
+};
+
+//================================//
+class BrickPageTable
+{
+public:
+    void Init(uint32_t brickResolution);
+    void Clear();
+
+    // Returns the slot of the page, allocating it if needed
+    uint32_t AllocatePage(uint32_t pageIndex);
+    uint32_t FindPageSlot(uint32_t pageIndex) const;
+
+    // brickGridIndex is the usual (x + y*res + z*res^2) index of a brick
+    uint32_t PageIndexOf(uint32_t brickGridIndex) const;
+    uint32_t CellIndexOf(uint32_t brickGridIndex) const;
+    uint32_t BrickGridIndexOf(uint32_t pageIndex, uint32_t cellIndex) const; // Inverse of the two above
+    bool Locate(uint32_t brickGridIndex, uint32_t& pageSlot, uint32_t& cellIndex) const;
+
+    // Recomputes the coarse levels of a page from the LOD colors of its non empty bricks
+    void BuildCoarseCells(uint32_t pageSlot);
+
+    BrickGridCell* FindCell(uint32_t brickGridIndex);
+    BrickGridPage* FindPage(uint32_t brickGridIndex, uint32_t& cellIndex);
+
+    // Index of a cell inside the GPU page pool buffer
+    static inline uint32_t PoolIndex(uint32_t pageSlot, uint32_t cellIndex)
+    {
+        return pageSlot * BRICK_PAGE_CELLS + cellIndex;
+    }
+
+    BrickGridPage& GetPage(uint32_t pageSlot) { return *this->pages[pageSlot]; }
+    const BrickGridPage& GetPage(uint32_t pageSlot) const { return *this->pages[pageSlot]; }
+    const std::vector<uint32_t>& GetEntries() const { return this->entries; }
+
+    uint32_t GetBrickResolution() const { return this->brickResolution; }
+    uint32_t GetPageResolution() const { return this->pageResolution; }
+    uint32_t GetNumPages() const { return static_cast<uint32_t>(this->entries.size()); }
+    uint32_t GetNumAllocatedPages() const { return static_cast<uint32_t>(this->pages.size()); }
+    uint64_t GetNumBricks() const
+    {
+        return static_cast<uint64_t>(this->brickResolution) * this->brickResolution * this->brickResolution;
+    }
+
+private:
+    uint32_t brickResolution = 0;
+    uint32_t pageResolution = 0;
+
+    std::vector<uint32_t> entries; // One per page: [31] allocated flag, [30:0] page slot
+    std::vector<std::unique_ptr<BrickGridPage>> pages;
+};
+
+#endif // BRICK_PAGE_TABLE_HPP
@@ -0,0 +1,59 @@
+#ifndef BRICK_PREFETCHER_HPP
+#define BRICK_PREFETCHER_HPP
+
+#include "BrickPageTable.hpp"
+#include "Rendering/Camera/Camera.hpp"
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <vector>
+
+// Prefetch tuning
+const float PREFETCH_LOOKAHEAD_SECONDS = 0.5f;  // How far ahead in time we extrapolate the camera
+const double PREFETCH_INTERVAL_SECONDS = 0.1;   // How often a new prediction is made
+const float PREFETCH_RANGE_BRICKS = 48.0f;      // Far plane of the predicted frustum, in bricks
+const float PREFETCH_FOV_MARGIN = 1.2f;         // Widens the predicted frustum to absorb prediction error
+const float PREFETCH_VELOCITY_SMOOTHING = 0.3f; // Exponential smoothing of the camera motion
+const int MAX_PREFETCH_READS = 128;             // Max bricks queued per prediction
+
+//================================//
+struct PrefetchFrustum
+{
+    Eigen::Vector3f origin;
+    Eigen::Vector3f forward;
+    Eigen::Vector3f planeNormals[4]; // left, right, bottom, top, all pointing inside, through origin
+    float farDistance;
+};
+
+//================================//
+class BrickPrefetcher
+{
+public:
+    void Reset();
+
+    // Record the camera pose of this frame, returns true when a new prediction is due
+    bool Update(const Camera& camera, double time);
+
+    // Collect unloaded bricks inside the predicted frustum, nearest first.
+    // flipBits and voxelResolution are needed to go from camera space to brick grid storage space
+    void CollectBricks(const BrickPageTable& pageTable, uint32_t flipBits, int voxelResolution, uint32_t maxBricks, std::vector<uint32_t>& outBrickIndices);
+
+private:
+    PrefetchFrustum buildPredictedFrustum(uint32_t flipBits, int voxelResolution) const;
+    static bool isBoxInside(const PrefetchFrustum& frustum, const Eigen::Vector3f& boxMin, const Eigen::Vector3f& boxMax);
+
+    bool hasSample = false;
+    double lastSampleTime = 0.0;
+    double lastPredictionTime = 0.0;
+
+    Eigen::Vector3f lastPosition = Eigen::Vector3f::Zero();
+    Eigen::Quaternionf lastOrientation = Eigen::Quaternionf::Identity();
+    float tanHalfFovX = 0.0f;
+    float tanHalfFovY = 0.0f;
+
+    Eigen::Vector3f velocity = Eigen::Vector3f::Zero();        // voxels per second
+    Eigen::Vector3f angularVelocity = Eigen::Vector3f::Zero(); // axis * radians per second, world space
+
+    std::vector<std::pair<float, uint32_t>> candidates; // (squared distance, brickGridIndex)
+};
+
+#endif // BRICK_PREFETCHER_HPP
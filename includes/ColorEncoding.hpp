@@ -0,0 +1,37 @@
+#ifndef COLOR_ENCODING_HPP
+#define COLOR_ENCODING_HPP
+
+#include "BrickPageTable.hpp"
+#include <cstdint>
+
+//================================//
+// GPU encodings of the brick colors in the color pools, same values in the shaders
+// Only occupied voxels get a color, in voxel index order, so a voxel color is found by its rank in the occupancy
+enum class ColorFormat : uint32_t
+{
+    RGBA8 = 0,    // 1 u32 per voxel
+    RGB565 = 1,   // 2 voxels per u32, packed by the upload shader
+    Palette8 = 2, // Palette size, up to 256 u32 palette entries, 8 bit index per voxel
+    Palette4 = 3  // Palette size, up to 16 u32 palette entries, 4 bit index per voxel
+};
+
+const uint32_t NUM_COLOR_FORMATS = 4;
+const ColorFormat DEFAULT_COLOR_FORMAT = ColorFormat::RGBA8;
+
+const uint32_t PALETTE8_ENTRIES = 256;
+const uint32_t PALETTE4_ENTRIES = 16;
+
+// Worst case size of a brick in the color pool (fully occupied, full palette), in u32 words
+uint32_t ColorWordsPerBrick(ColorFormat format);
+inline uint32_t ColorBytesPerBrick(ColorFormat format) { return ColorWordsPerBrick(format) * sizeof(uint32_t); }
+const char* ColorFormatName(ColorFormat format);
+
+// Fills the colors of an UploadEntry, returns the number of words written. RGBA8 and RGB565 get the raw colors
+// of the occupied voxels, the upload shader packs them, palette formats are encoded here in their final pool layout
+// (palette size, palette, then indices), quantized with a median cut when the brick has more colors than palette entries
+uint32_t EncodeBrickColors(ColorFormat format, const uint32_t occupancy[16], const ColorRGB colors[512], uint32_t out[512]);
+
+// Size in the color pool of colors encoded by EncodeBrickColors, in u32 words
+uint32_t ColorPoolWords(ColorFormat format, uint32_t encodedWords);
+
+#endif // COLOR_ENCODING_HPP
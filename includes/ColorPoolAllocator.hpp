@@ -0,0 +1,52 @@
+#ifndef COLOR_POOL_ALLOCATOR_HPP
+#define COLOR_POOL_ALLOCATOR_HPP
+
+#include <cstdint>
+#include <vector>
+#include <array>
+
+// Brick colors take a variable number of u32 words in the color pools, rounded up to size classes
+const uint32_t COLOR_ALLOCATION_GRANULARITY = 16; // words
+const uint32_t COLOR_MAX_ALLOCATION_WORDS = 512;  // A full RGBA8 brick
+const uint32_t COLOR_NUM_SIZE_CLASSES = COLOR_MAX_ALLOCATION_WORDS / COLOR_ALLOCATION_GRANULARITY;
+
+// Fraction of the worst case color size the pools are sized for, surface bricks are mostly empty
+const float COLOR_POOL_FILL_ESTIMATE = 0.5f;
+
+//================================//
+// Sub-allocator over the color address space (in words), split in pool buffers of poolWords each, as many as needed.
+// Blocks never straddle two pools. Freed blocks go to a free list per size class, and are reused
+// as is, larger blocks are only taken when the bump pointer reached the end of the space
+class ColorPoolAllocator
+{
+public:
+    void Init(uint64_t capacityWords, uint64_t poolWords);
+    void Reset(); // Frees every block
+
+    // outBlockWords is the size actually reserved, to give back to Free. Offsets are multiples of COLOR_ALLOCATION_GRANULARITY
+    bool Allocate(uint32_t words, uint64_t& outOffset, uint32_t& outBlockWords);
+    void Free(uint64_t offset, uint32_t blockWords);
+
+    uint64_t GetCapacityWords() const { return this->capacityWords; }
+    uint64_t GetUsedWords() const { return this->usedWords; }
+    uint64_t GetFreeListWords() const { return this->freeListWords; }
+
+private:
+    static uint32_t sizeClassOf(uint32_t words) { return (words + COLOR_ALLOCATION_GRANULARITY - 1) / COLOR_ALLOCATION_GRANULARITY - 1; }
+    static uint32_t sizeOfClass(uint32_t sizeClass) { return (sizeClass + 1) * COLOR_ALLOCATION_GRANULARITY; }
+    uint64_t popFreeBlock(uint32_t sizeClass); // Offset of the first block of a non-empty free list
+
+    uint64_t capacityWords = 0;
+    uint64_t poolWords = 0;
+    uint64_t top = 0; // Bump pointer
+
+    uint64_t usedWords = 0;
+    uint64_t freeListWords = 0;
+
+    // Free lists are linked through a next index per granule, sized by Init so Free never allocates during a frame
+    static const uint32_t INVALID_GRANULE = UINT32_MAX;
+    std::array<uint32_t, COLOR_NUM_SIZE_CLASSES> freeListHeads;
+    std::vector<uint32_t> nextFreeGranule;
+};
+
+#endif // COLOR_POOL_ALLOCATOR_HPP
@@ -0,0 +1,64 @@
+#ifndef FIXED_RING_HPP
+#define FIXED_RING_HPP
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+
+//================================//
+// FIFO over storage allocated once by Init, Push fails instead of growing when the ring is full.
+// Not thread safe, callers lock around it
+template <typename T>
+class FixedRing
+{
+public:
+    void Init(uint32_t capacity)
+    {
+        this->slots.assign(capacity, T{});
+        this->capacity = capacity;
+        Clear();
+    }
+
+    void Clear()
+    {
+        this->head = 0;
+        this->count = 0;
+    }
+
+    // Returns false when full, the value is then left to the caller
+    bool Push(const T& value)
+    {
+        if (this->count == this->capacity)
+            return false;
+
+        this->slots[(this->head + this->count) % this->capacity] = value;
+        this->count++;
+        return true;
+    }
+
+    T& Front()
+    {
+        assert(this->count > 0);
+        return this->slots[this->head];
+    }
+
+    void Pop()
+    {
+        assert(this->count > 0);
+        this->head = (this->head + 1) % this->capacity;
+        this->count--;
+    }
+
+    bool Empty() const { return this->count == 0; }
+    bool Full() const { return this->count == this->capacity; }
+    uint32_t Size() const { return this->count; }
+    uint32_t GetCapacity() const { return this->capacity; }
+
+private:
+    std::vector<T> slots;
+    uint32_t capacity = 0;
+    uint32_t head = 0;
+    uint32_t count = 0;
+};
+
+#endif // FIXED_RING_HPP
@@ -0,0 +1,130 @@
+#ifndef JOB_SYSTEM_HPP
+#define JOB_SYSTEM_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <type_traits>
+
+const uint32_t JOB_QUEUE_CAPACITY = 1024;   // Per queue, a job that does not fit runs on the submitting thread
+const uint32_t JOBS_PER_THREAD = 4;         // ParallelFor splits in about this many chunks per thread, for stealing to balance them
+
+//================================//
+// Plain job, no ownership, the submitter keeps the context alive until the batch counter reaches zero
+struct Job
+{
+    void (*function)(void* context, uint32_t begin, uint32_t end) = nullptr;
+    void* context = nullptr;
+    uint32_t begin = 0;
+    uint32_t end = 0;
+    std::atomic<uint32_t>* pending = nullptr; // Decremented once the job ran
+};
+
+//================================//
+// Fixed capacity deque, the owner pushes and pops at the back, other threads steal from the front
+class JobQueue
+{
+public:
+    bool Push(const Job& job);
+    bool Pop(Job& outJob);
+    bool Steal(Job& outJob);
+
+private:
+    std::mutex mutex;
+    Job jobs[JOB_QUEUE_CAPACITY];
+    uint32_t head = 0;
+    uint32_t count = 0;
+};
+
+//================================//
+// Fixed pool of worker threads with one queue each, plus a queue for jobs submitted from other threads.
+// Idle workers steal from the others. Waiting threads run jobs instead of blocking, so calls can nest.
+// Every non worker thread shares the last queue, a thread waiting on its batch may run another thread's jobs first.
+// Submitting never allocates, the frame loop can use it
+class JobSystem
+{
+public:
+    explicit JobSystem(uint32_t numWorkers);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Process wide pool, one worker per core minus the calling thread. No workers on web, everything runs inline
+    static JobSystem& Shared();
+
+    uint32_t GetNumWorkers() const { return static_cast<uint32_t>(this->workers.size()); }
+    uint32_t GetNumThreads() const { return GetNumWorkers() + 1; } // Workers and the waiting thread
+
+    // Calls function(i) for every i in [0, count), grainSize indices at least per job. Returns once all ran
+    template <typename Function>
+    void ParallelFor(uint32_t count, uint32_t grainSize, Function&& function)
+    {
+        using FunctionType = std::remove_reference_t<Function>;
+        auto runRange = [](void* context, uint32_t begin, uint32_t end) {
+            FunctionType& rangeFunction = *static_cast<FunctionType*>(context);
+            for (uint32_t i = begin; i < end; ++i)
+                rangeFunction(i);
+        };
+        parallelFor(count, grainSize, runRange, const_cast<void*>(static_cast<const void*>(&function)));
+    }
+
+    // Runs one queued job if there is any, for threads waiting on something else than a batch
+    bool RunPendingJob();
+
+    void Submit(const Job& job);
+    void Wait(const std::atomic<uint32_t>& pending);
+
+private:
+    void parallelFor(uint32_t count, uint32_t grainSize, void (*function)(void*, uint32_t, uint32_t), void* context);
+    void workerLoop(uint32_t workerIndex);
+    bool findJob(int workerIndex, Job& outJob);
+    static void runJob(const Job& job);
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<JobQueue[]> queues; // One per worker, the last one takes jobs from non worker threads
+    uint32_t numQueues = 0;
+
+    std::atomic<uint32_t> queuedJobs = 0;
+    std::atomic<bool> running = true;
+    std::mutex sleepMutex;
+    std::condition_variable sleepCV;
+};
+
+//================================//
+// Tasks with dependencies, built once and run on a JobSystem. A task starts when every task it depends on completed
+class JobGraph
+{
+public:
+    uint32_t AddTask(std::function<void()> task);
+    void AddDependency(uint32_t before, uint32_t after);
+
+    // Blocks until every task ran, the graph can be run again
+    void Run(JobSystem& jobSystem);
+
+    uint32_t GetNumTasks() const { return static_cast<uint32_t>(this->tasks.size()); }
+
+private:
+    struct TaskNode
+    {
+        std::function<void()> task;
+        std::vector<uint32_t> successors;
+        uint32_t numDependencies = 0;
+    };
+
+    static void runTask(void* context, uint32_t taskIndex, uint32_t);
+
+    std::vector<TaskNode> tasks;
+
+    // Only valid during Run
+    JobSystem* runningSystem = nullptr;
+    std::unique_ptr<std::atomic<uint32_t>[]> remainingDependencies;
+    std::atomic<uint32_t> remainingTasks = 0;
+};
+
+#endif // JOB_SYSTEM_HPP
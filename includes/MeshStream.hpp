@@ -0,0 +1,132 @@
+#ifndef MESH_STREAM_HPP
+#define MESH_STREAM_HPP
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+const uint32_t MESH_STREAM_DEFAULT_CHUNK_TRIANGLES = 1 << 19; // About 80 MB of GPU vertex and triangle data per chunk
+
+//================================//
+struct StreamedTriangle
+{
+    float positions[3][3];
+    float uvs[3][2];
+    uint32_t material; // Index in GetMaterials, 0 for the formats without materials
+};
+
+//================================//
+// OBJ material from the MTL libraries of the file, only what the voxelizer colors with
+struct StreamedMaterial
+{
+    std::string name;
+    std::string diffuseTexture; // map_Kd, resolved against the directory of the MTL file
+    float diffuse[3] = {1.0f, 1.0f, 1.0f};
+};
+
+//================================//
+enum class MeshStreamFormat
+{
+    STL,
+    PLY,
+    OBJ,
+};
+
+//================================//
+// Reads the triangles of a mesh file a chunk at a time, for meshes too large to load at once.
+// STL is read straight from the file, PLY and OBJ keep their vertices as floats and read the faces in chunks.
+// Opening the stream reads it once for the triangle count and bounds
+class MeshStream
+{
+public:
+    static bool IsSupported(const std::string& filename);
+
+    bool Open(const std::string& filename);
+    void Rewind();
+
+    // Up to maxTriangles triangles, polygons are split in fans. False at the end of the stream or on a read error
+    bool ReadChunk(std::vector<StreamedTriangle>& outTriangles, uint32_t maxTriangles);
+    bool Failed() const { return this->failed; }
+
+    uint64_t GetTriangleCount() const { return this->triangleCount; }
+    const std::array<double, 3>& GetMinBounds() const { return this->minBounds; }
+    const std::array<double, 3>& GetMaxBounds() const { return this->maxBounds; }
+    const std::array<double, 2>& GetUVMinBounds() const { return this->uvMinBounds; }
+    const std::array<double, 2>& GetUVMaxBounds() const { return this->uvMaxBounds; }
+    const std::vector<StreamedMaterial>& GetMaterials() const { return this->materials; } // OBJ only, empty without mtllib
+    double GetExtentSum() const { return this->extentSum; } // Sum of the largest bounds side of the triangles
+
+private:
+    // PLY header, the vertex element is read whole and the face element streamed
+    struct PlyProperty
+    {
+        std::string name;
+        int type = 0;       // Byte size, negative for signed integers, 8 + size for floats
+        int countType = 0;  // Same encoding, lists only
+        bool isList = false;
+    };
+    struct PlyElement
+    {
+        std::string name;
+        uint64_t count = 0;
+        std::vector<PlyProperty> properties;
+    };
+
+    bool openSTL();
+    bool openPLY();
+    bool openOBJ();
+
+    bool readSTLTriangle(StreamedTriangle& outTriangle);
+    bool readPLYFace(std::vector<uint32_t>& outIndices);
+    bool readOBJFace(std::vector<uint32_t>& outPositions, std::vector<uint32_t>& outUVs);
+    void loadOBJMaterials(const std::string& libraryPath);
+
+    bool readPLYValue(int type, double& outValue);
+    bool skipPLYElement(const PlyElement& element);
+    void emitFan(const std::vector<uint32_t>& positions, const std::vector<uint32_t>& uvs, bool hasUVs);
+    bool fail(const std::string& message);
+
+    std::string filename;
+    MeshStreamFormat format = MeshStreamFormat::STL;
+    std::ifstream file;
+    std::streampos dataStart = 0;
+    bool failed = false;
+
+    uint64_t triangleCount = 0;
+    std::array<double, 3> minBounds{};
+    std::array<double, 3> maxBounds{};
+    std::array<double, 2> uvMinBounds{};
+    std::array<double, 2> uvMaxBounds{};
+    double extentSum = 0.0;
+
+    // STL
+    bool stlBinary = false;
+    uint32_t stlTriangleCount = 0;
+    uint32_t stlTrianglesRead = 0;
+
+    // PLY
+    bool plyBinary = false;
+    bool plyBigEndian = false;
+    PlyElement plyFaces;
+    uint64_t plyFacesRead = 0;
+
+    // OBJ, counts of the vertices seen so far resolve negative indices
+    uint32_t objPositionsSeen = 0;
+    uint32_t objUVsSeen = 0;
+    uint32_t objMaterial = 0; // Set by usemtl, faces before the first one take material 0
+    std::vector<StreamedMaterial> materials;
+    std::unordered_map<std::string, uint32_t> materialIndices;
+
+    // Vertex pools of the indexed formats. UVs are flipped like the Assimp path does
+    std::vector<float> positions;
+    std::vector<float> uvs;
+
+    // Fan triangles of the last polygon not yet handed out
+    std::vector<StreamedTriangle> pending;
+    size_t pendingRead = 0;
+};
+
+#endif
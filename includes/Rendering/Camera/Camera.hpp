@@ -26,6 +26,8 @@ public:
     Eigen::Vector3f GetPosition() const { return this->position; }
     void SetPosition(const Eigen::Vector3f& position) { this->position = position; }
 
+    Eigen::Quaternionf GetOrientation() const { return this->orientation; }
+
     // Methods
     void LookAtDirection(const Eigen::Vector3f& direction, const Eigen::Vector3f& up = Eigen::Vector3f(0.0f, 1.0f, 0.0f));
     void LookAtPoint(const Eigen::Vector3f& point, const Eigen::Vector3f& up = Eigen::Vector3f(0.0f, 1.0f, 0.0f));
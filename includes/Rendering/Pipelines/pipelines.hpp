@@ -9,6 +9,7 @@ struct RenderPipelineWrapper
 {
     wgpu::RenderPipeline pipeline;
     wgpu::ComputePipeline computePipeline;
+    wgpu::ComputePipeline secondaryComputePipeline; // Other entry point of the same shader and layout, if any
     wgpu::PipelineLayout pipelineLayout;
 
     wgpu::BindGroup bindGroup;
@@ -78,6 +79,12 @@ struct RenderPipelineWrapper
 };
 
 
+// Color pools take the last bindings of the voxel shaders, one per pool starting at these
+const uint32_t COMPUTE_VOXEL_COLOR_POOL_BINDING = 10;
+const uint32_t UPLOAD_VOXEL_COLOR_POOL_BINDING = 6;
+// Storage buffers of the traversal shader that are not color pools, they count against maxStorageBuffersPerShaderStage
+const uint32_t COMPUTE_VOXEL_FIXED_STORAGE_BUFFERS = 8;
+
 //================================//
 void CreateRenderPipelineDebug(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipelineWrapper);
 void CreateComputeVoxelPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipelineWrapper, int numColorBuffers);
@@ -87,6 +94,11 @@ void CreateBlitVoxelPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipe
 //================================//
 // Voxelization pipelines
 void CreateVoxelizationPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipelineWrapper);
+void CreateVoxelColorPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipelineWrapper);
 void CreateCompactVoxelPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipelineWrapper);
+void CreateTriangleBinningPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipelineWrapper);
+void CreateBinPrefixSumPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipelineWrapper);
+void CreateSolidFillPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipelineWrapper);
+void CreateCandidateBricksPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipelineWrapper);
 
 #endif // PIPELINES_HPP
\ No newline at end of file
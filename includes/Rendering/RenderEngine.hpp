@@ -35,6 +35,10 @@ struct VoxelParameters
     float time;
     uint32_t hasColor;
     uint32_t flip; // bits 0: flipX, 1: flipY, 2: flipZ
+    uint32_t colorFormat; // ColorFormat
+    uint32_t colorWordsPerBrick;
+    float pixelSpread;           // Pixel size at distance 1, in voxels
+    float coarseThresholdPixels; // Bricks smaller than this on screen are drawn from the coarse levels, 0 disables them
 };
 
 struct TimingCtx 
@@ -78,8 +82,9 @@ public:
 
         std::cout << "[RenderEngine] Creating Pipelines...\n";
         CreateRenderPipelineDebug(*this->wgpuBundle, this->debugPipeline);
-        CreateComputeVoxelPipeline(*this->wgpuBundle, this->computeVoxelPipeline, MAX_COLOR_POOLS);
-        CreateComputeUploadVoxelPipeline(*this->wgpuBundle, this->computeUploadVoxelPipeline, MAX_COLOR_POOLS);
+        const int numColorPools = static_cast<int>(this->voxelManager->GetMaxColorPools());
+        CreateComputeVoxelPipeline(*this->wgpuBundle, this->computeVoxelPipeline, numColorPools);
+        CreateComputeUploadVoxelPipeline(*this->wgpuBundle, this->computeUploadVoxelPipeline, numColorPools);
         CreateBlitVoxelPipeline(*this->wgpuBundle, this->blitVoxelPipeline);
         std::cout << "[RenderEngine] Creating pipelines completed.\n";
 
@@ -108,6 +113,7 @@ private:
     void RenderImGui(wgpu::RenderPassEncoder& pass);
     void onResolutionValueChanged(int newResolution);
     void onVisibleBricksValueChanged(int newMaxVisibleBricks);
+    void onGridRebuilt();
 
     void flipAxis(int axis); // 0, 1, 2
 
@@ -140,6 +146,14 @@ private:
     int flipYCheckbox = 0;
     int flipZCheckbox = 0;
 
+    // Editing brush, centered in front of the camera
+    float brushRadius = 4.0f;
+    float brushDistance = 32.0f;
+    float brushColor[3] = {1.0f, 0.0f, 0.0f};
+    char editSavePath[256] = ""; // Next to the loaded file when left empty
+
+    float coarseThresholdPixels = 1.0f;
+
     // Timing info
     float cpuFrameTimeMS = 0.0f;
     std::vector<float> cpuFrameAccumulator;
@@ -39,6 +39,8 @@ public:
     }
 
     void SafeCreateBuffer(const wgpu::BufferDescriptor* descriptor, wgpu::Buffer& outBuffer);
+    // Keeps outBuffer when it has the same usage and at least the requested size, for resources reused across jobs
+    void ReuseOrCreateBuffer(const wgpu::BufferDescriptor* descriptor, wgpu::Buffer& outBuffer);
 
     bool SupportsTimestampQuery()
     {
@@ -0,0 +1,57 @@
+#ifndef STAGING_RING_HPP
+#define STAGING_RING_HPP
+
+#include "Rendering/wgpuBundle.hpp"
+#include <cstdint>
+#include <vector>
+
+// Staging memory is a ring of MapWrite chunks, sized by a budget instead of the worst case frame
+const uint64_t STAGING_CHUNK_SIZE = 1 << 20; // 1 MB per chunk
+const uint32_t STAGING_RING_CHUNKS = 16;     // 16 MB of staging in total
+
+//================================//
+enum class StagingChunkState
+{
+    Mapped,          // Writable by the CPU
+    Submitted,       // Copied from this frame, remapped once the frame is submitted
+    MappingInFlight  // MapAsync requested, mapping completes when the GPU is done with the copy
+};
+
+struct StagingChunk
+{
+    wgpu::Buffer buffer; // MapWrite | CopySrc
+    StagingChunkState state = StagingChunkState::Mapped;
+    uint8_t* mappedData = nullptr; // Only valid while Mapped
+    uint64_t cursor = 0;           // Bytes written this frame
+};
+
+//================================//
+// Sub-allocates variable size regions out of mapped chunks. Every chunk written during a frame
+// is copied to the destination buffer on Flush, back to back, so allocations of a frame end up contiguous.
+// Allocation never waits, it fails when no mapped chunk has room left and the caller carries on next frame.
+class StagingRing
+{
+public:
+    void Init(WgpuBundle& wgpuBundle, uint64_t chunkSize, uint32_t numChunks, const std::string& label);
+
+    // Returns nullptr when there is no mapped room left this frame, size must fit in a chunk
+    void* Allocate(uint64_t size);
+
+    // Unmaps the chunks written this frame and records their copies into dst, returns the bytes copied
+    uint64_t Flush(const wgpu::CommandEncoder& encoder, const wgpu::Buffer& dst, uint64_t dstOffset);
+
+    // Requests a map on chunks copied from in previous frames, must be called after they were submitted
+    void RemapSubmitted();
+
+    uint64_t GetChunkSize() const { return this->chunkSize; }
+    uint64_t GetCapacity() const { return this->chunkSize * this->chunks.size(); }
+    uint32_t GetNumMappedChunks() const;
+
+private:
+    std::vector<StagingChunk> chunks;
+    std::vector<uint32_t> frameChunks; // Chunks written this frame, in allocation order
+    uint64_t chunkSize = 0;
+    uint32_t head = 0; // Chunk allocations are served from
+};
+
+#endif // STAGING_RING_HPP
@@ -0,0 +1,64 @@
+#ifndef STREAMING_BUDGET_HPP
+#define STREAMING_BUDGET_HPP
+
+#include <cstdint>
+
+// Bounds of the adaptive per-frame budgets
+const uint32_t STREAMING_MIN_DISK_READS = 16;
+const uint32_t STREAMING_MAX_DISK_READS = 2048;
+const uint32_t STREAMING_MIN_READY_BRICKS = 16;
+const uint32_t STREAMING_MAX_READY_BRICKS = 4096;
+const uint32_t STREAMING_MIN_UPLOADS = 16;
+
+const float STREAMING_DEFAULT_TARGET_FRAME_MS = 1000.0f / 60.0f;
+const float STREAMING_UPLOAD_SHARE = 0.25f; // Max share of the target frame time the upload pass can take
+
+//================================//
+enum class StreamingDecision
+{
+    Hold,      // Frame time is around the target
+    Increase,  // Headroom, stream more
+    Decrease,  // Over the target, back off
+    DiskBound  // Headroom, but the disk does not keep up with reads already queued
+};
+
+//================================//
+// Additive increase / multiplicative decrease controller over the number of bricks
+// read, decoded and uploaded each frame, holding a target frame time
+class StreamingBudget
+{
+public:
+    StreamingBudget(uint32_t initialDiskReads, uint32_t initialReadyBricks, uint32_t initialUploads, uint32_t maxUploads);
+
+    // gpuFrameMs is the sum of all GPU passes, 0 when timestamps are not supported
+    void Update(float gpuUploadMs, float gpuFrameMs, float cpuFrameMs, uint32_t diskQueueDepth, uint32_t uploadedLastFrame);
+
+    uint32_t GetMaxDiskReads() const { return static_cast<uint32_t>(this->diskReads); }
+    uint32_t GetMaxReadyBricks() const { return static_cast<uint32_t>(this->readyBricks); }
+    uint32_t GetMaxUploads() const { return static_cast<uint32_t>(this->uploads); }
+
+    float GetTargetFrameMs() const { return this->targetFrameMs; }
+    void SetTargetFrameMs(float targetMs);
+
+    StreamingDecision GetDecision() const { return this->decision; }
+    const char* GetDecisionName() const;
+    float GetUploadCostPerBrickMs() const { return this->uploadCostPerBrickMs; }
+    uint32_t GetDiskQueueDepth() const { return this->diskQueueDepth; }
+
+private:
+    float targetFrameMs = STREAMING_DEFAULT_TARGET_FRAME_MS;
+
+    float diskReads;
+    float readyBricks;
+    float uploads;
+    float maxUploads;
+
+    float smoothedUploadMs = 0.0f;
+    float smoothedUploadCount = 0.0f;
+    float uploadCostPerBrickMs = 0.0f;
+
+    uint32_t diskQueueDepth = 0;
+    StreamingDecision decision = StreamingDecision::Hold;
+};
+
+#endif // STREAMING_BUDGET_HPP
@@ -0,0 +1,52 @@
+#ifndef TEXTURE_ARRAY_HPP
+#define TEXTURE_ARRAY_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const uint32_t TEXTURE_ARRAY_MAX_SIZE = 4096;           // Largest layer side
+const uint64_t TEXTURE_ARRAY_MAX_BYTES = 256ull << 20;  // Level 0 of all layers, the layers are scaled down past it
+
+//================================//
+struct TextureInfo
+{
+    bool hasTexture;
+    int width;
+    int height;
+    int channels;
+    unsigned char* data; // Freed with stbi_image_free
+    std::string name;
+};
+
+//================================//
+// Material textures as the layers of one RGBA8 array with a full mip chain, for a texture_2d_array binding.
+// Layers share a size, each texture is resampled to the largest width and height among them
+class TextureArray
+{
+public:
+    // One layer per texture, in order. Textures without data become white layers
+    void Build(const std::vector<TextureInfo>& textures);
+
+    uint32_t GetWidth() const { return this->width; }
+    uint32_t GetHeight() const { return this->height; }
+    uint32_t GetLayerCount() const { return this->numLayers; }
+    uint32_t GetMipCount() const { return static_cast<uint32_t>(this->levels.size()); }
+    uint32_t GetMipWidth(uint32_t level) const { return std::max(this->width >> level, 1u); }
+    uint32_t GetMipHeight(uint32_t level) const { return std::max(this->height >> level, 1u); }
+    const std::vector<uint8_t>& GetMip(uint32_t level) const { return this->levels[level]; } // Layer after layer
+
+    // Trilinear with repeat addressing, like the mesh sampler of the GPU path. Returns the packed 0x00BBGGRR color
+    uint32_t Sample(uint32_t layer, float u, float v, float lod) const;
+
+private:
+    void generateMips();
+
+    uint32_t width = 1;
+    uint32_t height = 1;
+    uint32_t numLayers = 0;
+    std::vector<std::vector<uint8_t>> levels;
+};
+
+#endif
@@ -74,6 +74,15 @@ public:
     }
 
     void AddBrick(uint32_t brickGridIndex, const uint32_t occupancy[16], const std::vector<VoxelColorRGB>& colors, VoxelColorRGB lodColor, uint8_t FLAGS=0)
+    {
+        brickDataEntry dataEntry;
+        std::memcpy(dataEntry.occupancy, occupancy, 64);
+        dataEntry.colors = colors;
+        AddBrick(brickGridIndex, std::move(dataEntry), lodColor, FLAGS);
+    }
+
+    // Same, the brick data is moved in instead of copied
+    void AddBrick(uint32_t brickGridIndex, brickDataEntry&& dataEntry, VoxelColorRGB lodColor, uint8_t FLAGS=0)
     {
         brickIndexEntry indexEntry;
         indexEntry.brickGridIndex = brickGridIndex;
@@ -82,14 +91,11 @@ public:
         indexEntry.LOD_B = lodColor.b;
         indexEntry.FLAGS = FLAGS;
         indexEntry.dataOffset = currentDataOffset;
-        indexEntry.dataSize = 64 + colors.size() * 3;
+        indexEntry.dataSize = 64 + dataEntry.colors.size() * 3;
         indexEntry.reserved = 0;
         brickIndex.push_back(indexEntry);
 
-        brickDataEntry dataEntry;
-        std::memcpy(dataEntry.occupancy, occupancy, 64);
-        dataEntry.colors = colors;
-        brickDataEntries.push_back(dataEntry);
+        brickDataEntries.push_back(std::move(dataEntry));
 
         currentDataOffset += indexEntry.dataSize;
         align();
@@ -4,43 +4,62 @@
 #include "../includes/Rendering/Pipelines/pipelines.hpp"
 #include "../includes/constants.hpp"
 #include "../includes/VoxelIO.hpp"
+#include "../includes/BrickPageTable.hpp"
+#include "../includes/BrickPrefetcher.hpp"
+#include "../includes/StreamingBudget.hpp"
+#include "../includes/StagingRing.hpp"
+#include "../includes/ColorEncoding.hpp"
+#include "../includes/ColorPoolAllocator.hpp"
+#include "../includes/FixedRing.hpp"
+#include "../includes/AllocationCounter.hpp"
+#include "../includes/JobSystem.hpp"
+#include <Eigen/Core>
 #include <cstdint>
 #include <vector>
 #include <array>
 #include <map>
+#include <unordered_map>
+#include <memory_resource>
 #include <atomic>
 #include <mutex>
 #include <thread>
-#include <queue>
 #include <condition_variable>
+#include <future>
 #include <iostream>
 
 class VoxelManager; // Forward declaration
 
 const int MAX_FEEDBACK = 8192;
 
-// Max bricks is max index that we can pack in 24 bits, which is 2^24 - 1
+// Brick grid pointers changed in a frame are scattered by the upload shader, at most this many per frame
+const uint32_t MAX_POINTER_UPDATES = 16384;
+const uint32_t POINTER_STAGING_CHUNKS = 4;
+
+// Max bricks is max brick pool slot that we can pack in 24 bits, which is 2^24 - 1
 const int MAX_BRICKS = 16777215;
-const int COLOR_BYTES_PER_BRICK = 2048; // 8x8x8 voxels, 1 byte per voxel (RGB packed), aligned to 2048 bytes
-const int MAX_COLOR_POOLS = 3;
+// Color pools are bound as separate storage buffers, as many as the device limits allow, up to this
+const uint32_t MAX_COLOR_POOLS = 32;
 
 // Number of buffered frames for async operations
-const int NUM_UPLOAD_BUFFERS = 2;
 const int NUM_FEEDBACK_BUFFERS = 2;
 
-// Async disk read limits
+// Async disk read limits, starting budgets that StreamingBudget then adapts every frame
 const int MAX_PENDING_DISK_READS = 256; // Max bricks queued for disk reading per frame
 const int MAX_READY_BRICKS = 512;      // Max bricks ready to be uploaded per frame
 
-//================================//
-struct ColorRGB
-{
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-    uint8_t _pad;
-};
+// Disk read queues are rings allocated once, a full ring refuses the read and the brick is requested again later
+const uint32_t DISK_READ_QUEUE_CAPACITY = 2 * STREAMING_MAX_DISK_READS;
+const uint32_t DISK_PREFETCH_QUEUE_CAPACITY = MAX_PREFETCH_READS;
+const uint32_t DISK_RESULT_QUEUE_CAPACITY = STREAMING_MAX_READY_BRICKS; // The reader thread waits when the main thread falls behind
+const uint32_t DISK_READ_BATCH = 64; // Bricks the reader thread takes per wake, read in order then decoded in parallel
+
+// Uploads are prepared in batches, bricks are picked in order, then encoded and copied to staging in parallel
+const uint32_t UPLOAD_BATCH_BRICKS = 256;
+
+// Frames after a grid is applied before the frame loop has to be allocation free, containers reach their working size meanwhile
+const uint32_t ALLOCATION_WARMUP_FRAMES = 16;
 
+//================================//
 struct BrickMapCPU
 {
     // first slice in z is occupancy[0] for first half, occupancy[1] for second half
@@ -48,25 +67,9 @@ struct BrickMapCPU
     ColorRGB colors[512];
 };
 
-struct BrickGridCellCPU
-{
-    bool dirty = false;
-    bool onGPU = false;
-    bool reading = false;
-    bool pendingRead = false;
-    uint32_t gpuBrickIndex = UINT32_MAX;
-    ColorRGB LODColor;
-};
-
-struct BrickGridCell
-{
-    // [23:0]   : pointer / index or LOD in case unl oaded (r, g, b)
-    // [31]     : resident flag
-    // [30]     : requested flag
-    // [29]     : unloaded flag
-    // [28:24]  : unused
-    uint32_t pointer;
-};
+// Resident bricks on the CPU, nodes come from a pool so streaming bricks in does not hit the heap every time
+using BrickMapStore = std::pmr::map<uint32_t, BrickMapCPU>;
+const size_t BRICK_STORAGE_BLOCKS_PER_CHUNK = 256;
 
 struct Feedback 
 {
@@ -77,16 +80,28 @@ struct Feedback
 struct UploadEntry
 {
     uint32_t gpuBrickSlot;
+    uint32_t colorOffset; // Start of the brick colors in the color address space, in blocks of COLOR_ALLOCATION_GRANULARITY words
+    uint32_t colorWords;  // Valid words in colors, only occupied voxels have one
     uint32_t occupancy[16];
     ColorRGB colors[512];
 };
 
+// A brick grid pointer to publish, applied on the GPU after the bricks of the same frame are written
+struct PointerUpdate
+{
+    uint32_t poolIndex; // Cell index in the page pool
+    uint32_t pointer;
+};
+
 struct UploadUniform
 {
     uint32_t uploadCount;
     uint32_t maxColorBufferSize;
     uint32_t hasColor;
-    uint32_t _pad;
+    uint32_t colorFormat;        // ColorFormat
+    uint32_t colorWordsPerBrick;
+    uint32_t pointerUpdateCount;
+    uint32_t _pad[2];
 };
 
 //================================//
@@ -98,17 +113,17 @@ enum class BufferState
     Mapped
 };
 
-struct UploadBufferSlot
+struct FeedbackMapCallbackContext
 {
-    wgpu::Buffer cpuBuffer;      // MapWrite | CopySrc
-    BufferState state = BufferState::Available;
-    uint32_t pendingCount = 0;
+    VoxelManager* voxelManager;
+    int slotIndex;
 };
 
 struct FeedbackBufferSlot
 {
     wgpu::Buffer cpuBuffer;      // MapRead | CopyDst
     BufferState state = BufferState::Available;
+    FeedbackMapCallbackContext mapContext; // Lives with the slot, a map in flight points to it
 };
 
 //================================//
@@ -118,9 +133,63 @@ struct DiskReadResult
     uint32_t brickGridIndex;
     uint32_t occupancy[16];
     ColorRGB colors[512];
+    uint32_t generation; // Grid the read was requested for, stale results are dropped after a rebuild
     bool success;
 };
 
+// A brick of the upload batch, its colors are encoded in the batch scratch before it gets a staging entry
+struct UploadBatchEntry
+{
+    const BrickMapCPU* brickMap;
+    BrickGridPage* page;
+    uint32_t pageSlot;
+    uint32_t cellIndex;
+    uint32_t slot;
+    uint32_t colorWords;
+    UploadEntry* stagedEntry; // nullptr until staged
+};
+
+//================================//
+// Runtime voxel edits
+enum class VoxelEditOp
+{
+    Set,   // Fill the voxels with the color
+    Clear, // Empty the voxels
+    Paint  // Recolor the occupied voxels only
+};
+
+// Voxels touched by an edit, inclusive box in voxel coordinates, optionally restricted to a sphere
+struct VoxelEditShape
+{
+    Eigen::Vector3i boxMin;
+    Eigen::Vector3i boxMax;
+    bool sphere = false;
+    Eigen::Vector3f center = Eigen::Vector3f::Zero();
+    float radius = 0.0f;
+};
+
+//================================//
+// Validated grid dimensions, everything the dynamic buffers are sized from
+struct GridSettings
+{
+    int voxelResolution = 8;
+    int brickResolution = 1;
+    int maxVisibleBricks = 1;
+    uint32_t numberOfColorPools = 0;
+    uint32_t maxColorBufferEntries = 0;
+    ColorFormat colorFormat = DEFAULT_COLOR_FORMAT;
+
+    bool operator==(const GridSettings& other) const = default;
+};
+
+// CPU side of a grid, built off the render thread and swapped in once ready
+struct GridBuildResult
+{
+    GridSettings settings;
+    BrickPageTable pageTable;
+    std::vector<uint32_t> freeBrickSlots;
+};
+
 //================================//
 class VoxelManager
 {
@@ -129,16 +198,30 @@ public:
     {
         static_assert(sizeof(ColorRGB) == 4); // packed in UINT32
         this->hasColor = HAS_VOXEL_COLOR;
-        validateResolution(bundle, resolution, maxVisibleBricks);
+        this->maxColorPools = computeMaxColorPools(bundle);
+        applyGridSettings(validateResolution(bundle, resolution, maxVisibleBricks, DEFAULT_COLOR_FORMAT));
+
+        // Everything the frame loop fills is sized once here
+        diskReadRequestQueue.Init(DISK_READ_QUEUE_CAPACITY);
+        diskPrefetchRequestQueue.Init(DISK_PREFETCH_QUEUE_CAPACITY);
+        diskReadResultQueue.Init(DISK_RESULT_QUEUE_CAPACITY);
+        feedbackRequests.reserve(MAX_FEEDBACK);
+        modifiedPoolIndices.reserve(MAX_POINTER_UPDATES);
+        uploadBatch.reserve(UPLOAD_BATCH_BRICKS);
+        uploadBatchColors.resize(static_cast<size_t>(UPLOAD_BATCH_BRICKS) * 512);
 
         startDiskReaderThread(); // This thread will be woken up and sleep as needed to read async bricks
     };
     ~VoxelManager()
     {
+        // The builder reads the file index, let it finish first
+        if (pendingGridBuild.valid())
+            pendingGridBuild.wait();
+
         stopDiskReaderThread();
 
-        // free vectors
-        brickGrid.clear();
+        // free pages
+        pageTable.Clear();
     };
 
     void update(WgpuBundle& wgpuBundle, const wgpu::Queue& queue, const wgpu::CommandEncoder& encoder);
@@ -149,6 +232,9 @@ public:
     void initStaticBuffers(WgpuBundle& wgpuBundle);
     void createUploadBindGroup(RenderPipelineWrapper& pipelineWrapper, WgpuBundle& wgpuBundle);
     void startOfFrame();
+    void updatePrefetch(const Camera& camera, double time, uint32_t flipBits);
+    void updateStreamingBudget(float gpuUploadMs, float gpuFrameMs, float cpuFrameMs);
+    uint32_t GetDiskQueueDepth();
 
     inline uint32_t BrickGridIndex(uint32_t bx, uint32_t by, uint32_t bz)
     {
@@ -156,41 +242,45 @@ public:
     }
 
     bool GetHasColor() const { return this->hasColor; }
+    const std::string& GetLoadedFilename() const { return this->loadedFilename; }
     int GetVoxelResolution() const { return this->voxelResolution; }
     int GetMaxVisibleBricks() const { return this->maxVisibleBricks; }
-    void ChangeVoxelResolution(WgpuBundle& bundle, int newResolution, int maxVisibleBricks = -1)
-    {
-        int currentResolution = this->voxelResolution;
-        int currentMaxVisibleBricks = this->maxVisibleBricks;
-        if (maxVisibleBricks < 0)
-            maxVisibleBricks = currentMaxVisibleBricks;
-        validateResolution(bundle, newResolution, maxVisibleBricks);
-        if (currentResolution == this->voxelResolution && currentMaxVisibleBricks == this->maxVisibleBricks)
-            return; // We literally did not change anything
-            
-        // Clear any pending feedback/uploads that reference old brick indices
-        feedbackRequests.clear();
-        dirtyBrickIndices.clear();
-        hasPendingFeedback = false;
-        pendingUploadCount = 0;
-
-        clearDiskReadQueues();
-        
-        initDynamicBuffers(bundle);
-    }
+    ColorFormat GetColorFormat() const { return this->colorFormat; }
+    uint32_t GetMaxColorPools() const { return this->maxColorPools; } // Color pool bindings of the voxel shaders
+    uint64_t GetFrameAllocations() const { return this->frameAllocations; } // Only counted in SKYEGRID_COUNT_ALLOCATIONS builds
+    bool IsRebuildingGrid() const { return this->pendingGridBuild.valid(); }
+    const ColorPoolAllocator& GetColorAllocator() const { return this->colorAllocator; }
+
+    // Starts building the new grid in the background, the current one keeps rendering until pollGridRebuild swaps it
+    void ChangeVoxelResolution(WgpuBundle& bundle, int newResolution, int maxVisibleBricks = -1);
+    void ChangeColorFormat(WgpuBundle& bundle, ColorFormat newColorFormat);
+    // Returns true when a new grid was swapped in or the page pool grew, bind groups referencing the dynamic buffers must then be recreated
+    bool pollGridRebuild(WgpuBundle& bundle);
 
     void loadFile(const std::string& filename);
 
+    // Runtime editing in voxel coordinates, only the touched bricks are uploaded again. Returns true if anything changed
+    bool SetVoxel(int x, int y, int z, ColorRGB color);
+    bool ClearVoxel(int x, int y, int z);
+    bool EditBox(const Eigen::Vector3i& boxMin, const Eigen::Vector3i& boxMax, VoxelEditOp op, ColorRGB color = {});
+    bool EditSphere(const Eigen::Vector3f& center, float radius, VoxelEditOp op, ColorRGB color = {});
+    // Writes the grid with its edits to a new voxel file, the loaded file is read for the bricks that were never streamed in
+    bool SaveToFile(const std::string& filename);
+
     //CPU storage
-    std::vector<BrickGridCell> brickGrid;
-    std::vector<BrickGridCellCPU> brickGridCPU;
-    std::map<uint32_t, BrickMapCPU> brickMaps;
+    BrickPageTable pageTable;
+    CountingMemoryResource brickStorageUpstream; // Growth of the brick storage, told apart from frame allocations
+    std::pmr::unsynchronized_pool_resource brickStoragePool{{BRICK_STORAGE_BLOCKS_PER_CHUNK, sizeof(BrickMapCPU) + 64}, &brickStorageUpstream};
+    BrickMapStore brickMaps{&brickStoragePool};
 
     //GPU storage
-    wgpu::Buffer brickGridBuffer;
+    wgpu::Buffer brickPageTableBuffer;
+    wgpu::Buffer brickGridBuffer; // Page pool, BRICK_PAGE_CELLS pointers per allocated page
+    wgpu::Buffer brickCoarseBuffer; // BRICK_PAGE_COARSE_CELLS coarse cells per allocated page, same slots as brickGridBuffer
     wgpu::Buffer brickPoolBuffer;
 
     std::vector<wgpu::Buffer> colorPoolBuffers;
+    wgpu::Buffer brickColorOffsetsBuffer; // Start of the colors of each brick pool slot, written by the upload shader
 
     wgpu::Buffer feedbackCountBuffer;
     wgpu::Buffer feedbackCountRESET;
@@ -198,66 +288,159 @@ public:
 
     wgpu::Buffer uploadBuffer;
     wgpu::Buffer uploadCountUniform;
+    wgpu::Buffer pointerUpdateBuffer; // PointerUpdate list of the frame, scattered into brickGridBuffer by the upload shader
 
     wgpu::Buffer brickRequestFlagsBuffer;
     wgpu::Buffer brickRequestFlagsRESET;
 
     // pools
-    std::array<UploadBufferSlot, NUM_UPLOAD_BUFFERS> uploadBufferSlots;
-    int currentUploadSlot = 0;
+    StagingRing uploadStaging; // Upload entries are written here, then copied to uploadBuffer
+    StagingRing pointerStaging; // Same for the pointer updates, copied to pointerUpdateBuffer
     std::array<FeedbackBufferSlot, NUM_FEEDBACK_BUFFERS> feedbackBufferSlots;
     int currentFeedbackWriteSlot = 0;  // Slot GPU writes to
     int currentFeedbackReadSlot = 0;   // Slot CPU reads from
 
     uint32_t pendingUploadCount = 0;
+    uint32_t pendingPointerUpdateCount = 0;
+    uint32_t pagePoolCapacity = 0; // Number of pages the GPU page pool can hold
     uint32_t numberOfColorPools = 0;
     uint32_t maxColorBufferEntries = 0;
 
     uint64_t lastBrickIndex = 0; // DEBUG
+
+    // Dedup stats
+    uint32_t sharedBrickCount = 0;  // Resident bricks pointing to a slot owned by an identical brick
+    uint32_t uniformBrickCount = 0; // Resident bricks encoded in their pointer
+    uint32_t colorPoolDefragCount = 0;
+    uint32_t editedBrickCount = 0;
+
+    StreamingBudget streamingBudget{MAX_PENDING_DISK_READS, MAX_READY_BRICKS, MAX_READY_BRICKS, MAX_FEEDBACK};
     
     bool hasPendingFeedback = false;
 
     std::vector<uint32_t> feedbackRequests;
     std::vector<uint32_t> freeBrickSlots;
     std::vector<uint32_t> dirtyBrickIndices;
+    std::vector<uint32_t> prefetchRequests;
+    std::vector<uint32_t> modifiedPoolIndices; // Cells whose pointer changed this frame, reused every frame
+    std::vector<UploadBatchEntry> uploadBatch;
+    std::vector<uint32_t> uploadBatchColors; // 512 words per batch entry
 
 private:
 
-    void validateResolution(WgpuBundle& bundle, int resolution, int maxVisibleBricks);
+    uint32_t computeMaxColorPools(WgpuBundle& bundle) const;
+    GridSettings validateResolution(WgpuBundle& bundle, int resolution, int maxVisibleBricks, ColorFormat colorFormat) const;
+    GridSettings getGridSettings() const;
+    void applyGridSettings(const GridSettings& settings);
+    GridBuildResult buildGrid(const GridSettings& settings);
+    void applyGrid(WgpuBundle& wgpuBundle, GridBuildResult& result);
+    void requestGridRebuild(const GridSettings& settings);
+    void startGridRebuild(const GridSettings& settings);
+    std::vector<uint32_t> collectEditedBricks() const;
+    void carryOverResidentBricks(BrickMapStore& residentBricks, const std::vector<uint32_t>& editedBricks);
+    void createPagePoolBuffers(WgpuBundle& wgpuBundle);
+    bool growPagePool(WgpuBundle& wgpuBundle);
     ColorRGB computeBrickAverageColor(const BrickMapCPU& brick);
     void cleanupBuffers();
 
-    void requestUploadBufferMap(int slotIndex);
     void requestFeedbackBufferMap(int slotIndex);
     void processPendingFeedback();
     void requestRead(const std::vector<uint32_t>& indices);
 
+    // Allocations of startOfFrame and update are counted apart, the rest of the frame belongs to the renderer
+    void beginAllocationScope();
+    void endAllocationScope();
+    void checkFrameAllocations();
+
     // Async disk reading thread methods
     void startDiskReaderThread();
     void stopDiskReaderThread();
     void diskReaderThreadFunc();
     void clearDiskReadQueues();
-    void queueDiskRead(uint32_t brickGridIndex);
+    bool queueDiskRead(uint32_t brickGridIndex); // False when the queue is full
+    bool queuePrefetchRead(uint32_t brickGridIndex);
+    void cancelPrefetchReads();
     void processCompletedDiskReads();
+    bool applyDiskReadResult(const DiskReadResult& result, bool& outRetry);
+#ifdef __EMSCRIPTEN__
+    bool processSingleDiskRead(uint32_t brickGridIndex); // No reader thread on web, reads synchronously
+#endif
+
+    // Runtime editing
+    bool applyEdit(const VoxelEditShape& shape, VoxelEditOp op, ColorRGB color);
+    bool loadEditableBrick(uint32_t brickGridIndex, BrickMapCPU& outBrick);
+    bool commitEditedBrick(uint32_t brickGridIndex, const BrickMapCPU& brick);
+
+    // Brick slot sharing
+    bool assignBrickSlot(uint32_t brickGridIndex, BrickGridPage& page, uint32_t cellIndex, const uint32_t* occupancy, const ColorRGB* colors);
+    void releaseBrickSlot(uint32_t brickGridIndex, const BrickResidency& previousState);
+    bool isUniformBrick(const uint32_t* occupancy, const ColorRGB* colors) const;
+    uint64_t hashBrick(const uint32_t* occupancy, const ColorRGB* colors) const;
+    void defragmentColorPool();
+    void parkForColorBlock(const UploadBatchEntry& batchEntry, std::vector<uint32_t>& modifiedIndices);
+    void retryColorWaitingBricks();
+    bool stageUploadBatch(std::vector<uint32_t>& modifiedIndices); // Returns false when the frame cannot take more uploads
 
     int voxelResolution; 
     int BrickResolution;
     int maxVisibleBricks;
+    ColorFormat colorFormat = DEFAULT_COLOR_FORMAT;
+    uint32_t maxColorPools = 1;
 
     bool hasColor = false;
 
     std::unique_ptr<VoxelFileReader> voxelFileReader;
+    std::string loadedFilename;
     bool loadedMesh = false;
 
+    // Edits allocate pages on the CPU, the GPU page table and page pool follow before the pointers are written
+    bool pageTableDirty = false;
+    std::vector<uint32_t> pendingPointerWrites; // Page pool indices of pointer only changes, bricks emptied by edits or sent back to LOD by defragmentation
+    std::vector<uint32_t> pendingCoarseWrites;  // Page slots whose coarse levels changed with an edit
+
+    BrickPrefetcher prefetcher;
+
+    // Identical bricks share a pool slot, indexed by content hash. Per slot bookkeeping is sized to maxVisibleBricks
+    std::pmr::unordered_map<uint64_t, uint32_t> slotByHash{&brickStoragePool};
+    std::vector<uint32_t> slotRefCounts;
+    std::vector<uint32_t> slotOwners;      // brickGridIndex the slot content was compared against
+    std::vector<uint8_t> slotHashed;       // Slot is registered in slotByHash
+    std::vector<uint64_t> slotHashes;
+    std::vector<uint8_t> slotNeedsUpload;  // Content not uploaded yet, only the first brick using the slot uploads it. 2 while in the upload batch
+
+    // Colors of a slot take a variable size block in the color pools
+    ColorPoolAllocator colorAllocator;
+    std::vector<uint64_t> slotColorOffsets; // In words
+    std::vector<uint32_t> slotColorBlockWords; // 0 when the slot holds no color block
+    bool colorPoolDefragPending = false;
+    std::vector<uint32_t> colorWaitingBricks; // Gave their slot back for lack of a color block, pendingRead until retried
+    bool colorBlocksFreed = false;            // Since the waiting bricks were last retried
+
+    // Allocations of the frame loop, brick storage growth aside
+    uint64_t frameAllocations = 0;
+    uint64_t allocationScopeStart = 0;
+    uint64_t storageGrowthScopeStart = 0;
+    uint32_t allocationWarmupFrames = ALLOCATION_WARMUP_FRAMES;
+
+    // Background grid rebuild, only the latest request made while one is running is kept
+    std::future<GridBuildResult> pendingGridBuild;
+    GridSettings queuedGridSettings;
+    bool hasQueuedGridBuild = false;
+
     // The thread
     std::thread diskReaderThread;
     std::atomic<bool> diskReaderThreadRunning = false;
 
-    std::queue<uint32_t> diskReadRequestQueue; // So that we process them in order of arrival
+    FixedRing<uint32_t> diskReadRequestQueue; // So that we process them in order of arrival
+    FixedRing<uint32_t> diskPrefetchRequestQueue; // Low priority, only read when diskReadRequestQueue is empty
     std::mutex diskReadQueueMutex;
+    uint32_t diskReadGeneration = 0; // Bumped under diskReadQueueMutex every time the queues are cleared
     std::condition_variable diskReadQueueCV;
 
-    std::queue<DiskReadResult> diskReadResultQueue;
+    FixedRing<DiskReadResult> diskReadResultQueue;
+#ifdef __EMSCRIPTEN__
+    brickDataEntry diskReadScratch; // Reused by the synchronous reads
+#endif
     std::mutex diskReadResultMutex;
 
     std::mutex fileReadMutex; // To protect file reading operations during async reads
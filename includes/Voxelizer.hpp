@@ -3,7 +3,11 @@
 
 #include "Rendering/wgpuBundle.hpp"
 #include "Rendering/Pipelines/pipelines.hpp"
+#include "MeshStream.hpp"
+#include "TextureArray.hpp"
 #include <algorithm>
+#include <functional>
+#include <memory>
 #include <vector>
 #include <array>
 #include <fstream>
@@ -13,8 +17,12 @@
 // Forward declarations
 class VoxelFileWriter;
 class VoxelFileReader;
+struct aiScene;
 
-const uint32_t MAX_TEXTURES = 4;
+const uint32_t MAX_TEXTURES = 64; // Layers of the material texture array, within the 256 array layers WebGPU guarantees
+const uint32_t TRIANGLE_BINNING_WORKGROUP_SIZE = 64; // Triangles per workgroup, matches computeTriangleBinning.wgsl
+const uint32_t BIN_PREFIX_SUM_BLOCK_SIZE = 256; // Bins scanned per workgroup, matches computeBinPrefixSum.wgsl
+const double TRIANGLE_PARALLEL_MAX_EXTENT = 4.0; // Mean triangle extent in voxels up to which the triangle parallel mode is picked
 
 //================================//
 struct VoxelizerUniforms
@@ -24,89 +32,197 @@ struct VoxelizerUniforms
     float    voxelSize;
     uint32_t numTriangles;
     float    meshMinBounds[3];
-    uint32_t _pad1;
-    uint32_t brickStart;
+    uint32_t triangleBase;  // Index in the mesh of the first triangle of the current chunk
+    uint32_t brickStart;    // Range of the candidate list covered by the pass
     uint32_t brickEnd;
-    uint32_t _pad2[2];
+    uint32_t triangleStart; // Range binned and voxelized by the current dispatches
+    uint32_t triangleEnd;
+    float    meshExtent[3]; // Dequantization of the vertices, see Vertex
+    uint32_t _pad2;
+    float    uvOffset[2];
+    float    uvExtent[2];
 };
 
+// Positions and UVs as 16 bit unorms over the mesh and UV bounds: x | y << 16, z | u << 16, v | layer << 16.
+// The layer is the material texture of the vertex in the texture array
 struct Vertex
 {
-    float position[3];
-    float _pad;
-    float uv[2];
-    float _pad2[2];
-    float normal[3];
-    float padding;
+    uint32_t words[3];
 };
 
+// Read as a flat index stream by the shaders
 struct Triangle
 {
     uint32_t indices[3];
-    uint32_t _pad;
 };
 
-struct TextureInfo
+//================================//
+enum class VoxelizerBackend
+{
+    GPU,    // WebGPU compute passes
+    CPU,    // Worker threads with SIMD overlap tests, for machines without a GPU
+};
+
+//================================//
+enum class VoxelizationMode
+{
+    BrickParallel,      // One invocation per brick, walking its triangle list. Best with large triangles
+    TriangleParallel,   // One invocation per triangle and brick it overlaps. Best with many small triangles
+};
+
+//================================//
+// Readback of one pass. There are two, a pass is written out while the next one computes
+struct PassReadback
 {
-    bool hasTexture;
-    int width;
-    int height;
-    int channels;
-    unsigned char* data;
-    std::string name;
+    wgpu::Buffer counters;
+    wgpu::Buffer occupancy;
+    wgpu::Buffer brickOutput;
+    wgpu::Buffer packedColors;
+    wgpu::Future countersMap;
+    wgpu::Future dataMaps[3];
+
+    uint32_t brickStart = 0;
+    uint32_t bricksThisPass = 0;
+    uint32_t occupiedBrickCount = 0;
+    uint32_t totalColorCount = 0;
+    bool pending = false; // Data maps requested, not written out yet
 };
 
 //================================//
 class Voxelizer
 {
 public:
-    Voxelizer();
+    explicit Voxelizer(VoxelizerBackend backend = VoxelizerBackend::GPU);
     ~Voxelizer();
 
     bool loadMesh(const std::string& filename, const std::string& texturePath = "");
-    void checkLimits(uint32_t& voxelResolution, uint32_t& maxBricksPerPass, uint8_t& numPasses);
-    bool voxelizeMesh(const std::string& outputVoxelFile, uint32_t voxelResolution, uint32_t maxBricksPerPass, uint8_t numPasses);
+    // Exchanges the loaded meshes of two voxelizers. A mesh can load on another thread, in a voxelizer
+    // without a device, while this one voxelizes the previous mesh
+    void swapMesh(Voxelizer& other);
+    void checkLimits(uint32_t& voxelResolution, uint32_t& maxBricksPerPass, uint32_t& numPasses);
+    bool voxelizeMesh(const std::string& outputVoxelFile, uint32_t voxelResolution, uint32_t maxBricksPerPass, uint32_t numPasses);
+
+    // Fills the interior of closed meshes after the surface pass, inside voxels take the color of the closest surface voxel along x
+    void setSolid(bool solid) { this->solid = solid; }
+
+    // STL, PLY and OBJ meshes are read and voxelized a chunk of triangles at a time instead of loaded whole.
+    // GPU backend only, every pass reads the file again. Call before loadMesh, 0 turns it off.
+    // Only STL is bounded by the chunk, PLY and OBJ still hold every vertex in memory (12 bytes each, 20 with UVs)
+    void setStreaming(uint32_t chunkTriangles) { this->streamChunkTriangles = chunkTriangles; }
 
 private:
 
+    void loadMeshTexture(const std::string& filename, const std::string& texturePath);
+    // Diffuse texture of every material, returns the texture array layer of each material
+    std::vector<int> loadMaterialTextures(const aiScene* scene, const std::string& filename);
+    std::vector<int> buildMaterialLayers(const std::vector<std::string>& materialTextures, const std::vector<std::array<float, 3>>& diffuseColors,
+                                         const std::function<bool(const std::string& texture, TextureInfo& texInfo)>& loadTexture);
+    // Load time reordering of the mesh, identical vertices are merged and triangles sorted along a Morton curve
+    void weldVertices();
+    void sortTrianglesSpatially();
+    bool openMeshStream(const std::string& filename, const std::string& texturePath);
+
+    Vertex packVertex(const double position[3], const double uv[2], uint32_t layer) const;
+    void unpackVertex(const Vertex& vertex, float outPosition[3], float outUV[2]) const;
+    void setQuantizationUniforms(VoxelizerUniforms& uniforms) const;
+    void uploadMeshBuffers();
+    void uploadMeshChunk(const std::vector<StreamedTriangle>& chunk);
+    // Runs once over the whole mesh, or once per streamed chunk after uploading it
+    bool forEachMeshChunk(const std::function<bool(uint32_t numTriangles)>& processChunk);
     void initializeGpuResources(uint32_t maxBricksPerPass);
 
-    std::unique_ptr<WgpuBundle> gpuBundle;
+    // Coarse pre-pass, lists the bricks some triangle overlaps. Passes range over that list
+    void findCandidateBricks(uint32_t voxelResolution);
+
+    // Defined in VoxelizerCPU.cpp
+    bool voxelizeMeshCPU(const std::string& outputVoxelFile, uint32_t voxelResolution);
+
+    // Triangle binning of a pass, counts the overlaps of the uniform triangle range then scatters them once the list fits
+    bool countTriangleBins(const wgpu::Buffer& uniformBuffer, uint32_t bricksThisPass, uint32_t numTrianglesInRange, uint32_t& outNumBinned);
+    bool reserveBinnedTriangles(uint32_t numBinned);
+    void voxelizeBinnedTriangles(const wgpu::Buffer& uniformBuffer, uint32_t bricksThisPass, uint32_t numTrianglesInRange, uint32_t numBinned);
+    // Samples the colors of the voxels a triangle of the current chunk won, once every range went through
+    void resolveVoxelColors(const wgpu::Buffer& uniformBuffer, uint32_t bricksThisPass);
+    // Pass readback, the counters size the copies of the data
+    bool readPassCounters(PassReadback& readback);
+    void requestPassData(PassReadback& readback);
+    bool writePassData(PassReadback& readback, VoxelFileWriter& writer);
+
+    // Solid mode, crossings are flipped per chunk and the rows filled once per pass
+    void flipSolidCrossings(const wgpu::Buffer& uniformBuffer, VoxelizerUniforms& uniforms, uint32_t bricksThisPass, uint32_t numTriangles);
+    void fillSolidInterior(wgpu::CommandEncoder& encoder, const wgpu::Buffer& uniformBuffer, const VoxelizerUniforms& uniforms, uint32_t bricksThisPass);
+    wgpu::BindGroup createSolidFillBindGroup(const wgpu::Buffer& uniformBuffer, uint32_t bricksThisPass);
+    wgpu::BindGroup createTriangleBinningBindGroup(const wgpu::Buffer& uniformBuffer, uint32_t bricksThisPass);
+    VoxelizationMode chooseVoxelizationMode(double voxelSize) const;
+
+    VoxelizerBackend backend;
+    bool solid = false;
+    std::unique_ptr<WgpuBundle> gpuBundle; // GPU backend only
 
     std::vector<std::array<double, 3>> verticesVec;
     std::vector<std::array<int, 3>> facesVec;
     std::vector<std::array<double, 3>> normalsVec;
     std::vector<std::array<double, 2>> uvsVec;
-    std::vector<int> textureIndicesVec;
+    std::vector<int> textureIndicesVec; // Texture array layer per vertex
 
     std::vector<TextureInfo> texturesInfo;
+    TextureArray textureArray; // Built from texturesInfo, for both backends
+
+    std::unique_ptr<MeshStream> meshStream; // Set instead of the vectors above when streaming
+    std::vector<int> streamMaterialLayers;  // Texture array layer per material of the stream
+    uint32_t streamChunkTriangles = 0;
 
     double meshWidth; // x axis extent
     double meshHeight; // y axis extent
     double meshDepth; // z axis extent
     std::array<double, 3> meshMinBounds;
     std::array<double, 3> meshMaxBounds;
+    std::array<double, 2> uvMinBounds;
+    std::array<double, 2> uvMaxBounds;
 
     // GPU resources
     wgpu::Buffer vertexBuffer;
     wgpu::Buffer triangleBuffer;
     wgpu::Buffer occupancyBuffer;
     wgpu::Buffer denseColorsBuffer;
-    std::vector<wgpu::Texture> textures;
-    std::vector<wgpu::TextureView> textureViews;
-    std::vector<wgpu::Sampler> textureSamplers;
+    wgpu::Buffer voxelWinnersBuffer; // 1 + mesh index of the last triangle overlapping each dense voxel
+    wgpu::Texture texture;
+    wgpu::TextureView textureView;
+    wgpu::Sampler textureSampler;
 
     wgpu::Buffer brickOutputBuffer;
     wgpu::Buffer packedColorBuffer;
     wgpu::Buffer countersBuffer;
 
-    wgpu::Buffer counterReadbackBuffer;
-    wgpu::Buffer occupancyReadbackBuffer;
-    wgpu::Buffer brickOutputReadbackBuffer;
-    wgpu::Buffer packedColorReadbackBuffer;
+    std::array<PassReadback, 2> passReadbacks;
+
+    // Triangle lists per brick of the pass
+    wgpu::Buffer binCountsBuffer;
+    wgpu::Buffer binOffsetsBuffer;
+    wgpu::Buffer binCursorsBuffer;
+    wgpu::Buffer binBlockSumsBuffer;
+    wgpu::Buffer binTotalBuffer;
+    wgpu::Buffer binTotalReadbackBuffer;
+    wgpu::Buffer binnedTrianglesBuffer;
+    uint32_t binnedTrianglesCapacity = 0;
+
+    wgpu::Buffer parityFlipsBuffer; // Solid mode only, occupancy layout
+
+    // Candidate bricks, as a bitset over the grid with the count before each word and as a list in grid order
+    std::vector<uint32_t> candidateBricks;
+    wgpu::Buffer candidateBitsBuffer;
+    wgpu::Buffer candidateRanksBuffer;
+    wgpu::Buffer candidateBricksBuffer;
+
+    VoxelizationMode voxelizationMode = VoxelizationMode::BrickParallel;
 
     RenderPipelineWrapper voxelizationPipeline;
+    RenderPipelineWrapper voxelColorPipeline;
     RenderPipelineWrapper compactVoxelPipeline;
+    RenderPipelineWrapper triangleBinningPipeline;
+    RenderPipelineWrapper binPrefixSumPipeline;
+    RenderPipelineWrapper solidFillPipeline;
+    RenderPipelineWrapper candidateBricksPipeline;
 };
 
 #endif
\ No newline at end of file
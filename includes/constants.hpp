@@ -14,4 +14,7 @@ constexpr bool HAS_VOXEL_COLOR = true;
 
 constexpr uint32_t MAX_BUFFER_SIZE = UINT32_MAX - 1;
 
+// Bricks per axis, the brick grid is paged so this is only bound by 32 bit brick grid indices
+constexpr uint32_t MAX_BRICK_RESOLUTION = 1024;
+
 #endif // CONSTANTS_HPP
\ No newline at end of file
@@ -2,19 +2,182 @@
 #include <iostream>
 #include <string>
 #include <charconv>
+#include <chrono>
 #include <cstring>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <vector>
+
+//================================//
+struct VoxelizationJob
+{
+    std::string inputMeshFile;
+    uint32_t voxelResolution;
+    std::string outputVoxelFile;
+};
+
+//================================//
+// One job per line: input mesh, voxel resolution, output voxel file. Blank lines and lines starting with # are skipped
+static bool parseManifest(const std::string& manifestFile, std::vector<VoxelizationJob>& outJobs)
+{
+    std::ifstream manifest(manifestFile);
+    if (!manifest)
+    {
+        std::cerr << "Error: Failed to open batch manifest: " << manifestFile << "\n";
+        return false;
+    }
+
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(manifest, line))
+    {
+        lineNumber++;
+        std::istringstream fields(line);
+        VoxelizationJob job;
+        std::string resolution;
+        if (!(fields >> job.inputMeshFile) || job.inputMeshFile[0] == '#')
+            continue;
+
+        std::string trailing;
+        if (!(fields >> resolution >> job.outputVoxelFile) || (fields >> trailing))
+        {
+            std::cerr << "Error: " << manifestFile << ":" << lineNumber << ": expected <mesh> <resolution> <output>\n";
+            return false;
+        }
+        auto result = std::from_chars(resolution.data(), resolution.data() + resolution.size(), job.voxelResolution);
+        if (result.ec != std::errc() || result.ptr != resolution.data() + resolution.size())
+        {
+            std::cerr << "Error: " << manifestFile << ":" << lineNumber << ": invalid voxel resolution '" << resolution << "'\n";
+            return false;
+        }
+        outJobs.push_back(job);
+    }
+    return true;
+}
+
+//================================//
+static bool voxelizeLoadedMesh(Voxelizer& voxelizer, const std::string& outputVoxelFile, uint32_t voxelResolution)
+{
+    uint32_t maxBricksPerPass;
+    uint32_t numPasses;
+    voxelizer.checkLimits(voxelResolution, maxBricksPerPass, numPasses);
+    if (!voxelizer.voxelizeMesh(outputVoxelFile, voxelResolution, maxBricksPerPass, numPasses))
+    {
+        std::cerr << "Error: Failed to voxelize mesh and save to file: " << outputVoxelFile << "\n";
+        return false;
+    }
+    return true;
+}
+
+//================================//
+// The jobs share the device, the compiled pipelines and the GPU buffers that are large enough.
+// The next mesh loads on another thread while the current one voxelizes. Failed jobs are reported and skipped
+static int runBatch(const std::string& manifestFile, VoxelizerBackend backend, bool solid, bool stream)
+{
+    std::vector<VoxelizationJob> jobs;
+    if (!parseManifest(manifestFile, jobs))
+        return 1;
+
+    auto startTime = std::chrono::steady_clock::now();
+    Voxelizer voxelizer = Voxelizer(backend);
+    voxelizer.setSolid(solid);
+    if (stream)
+        voxelizer.setStreaming(MESH_STREAM_DEFAULT_CHUNK_TRIANGLES);
+
+    // Streamed meshes are read by the passes themselves, they load in place
+    std::unique_ptr<Voxelizer> loader;
+    if (!stream)
+        loader = std::make_unique<Voxelizer>(VoxelizerBackend::CPU);
+    auto loadAhead = [&](size_t jobIndex) {
+        return std::async(std::launch::async, [&loader, &jobs, jobIndex]() { return loader->loadMesh(jobs[jobIndex].inputMeshFile); });
+    };
+
+    std::future<bool> nextLoad;
+    if (loader && !jobs.empty())
+        nextLoad = loadAhead(0);
+
+    uint32_t numFailed = 0;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        const VoxelizationJob& job = jobs[i];
+        std::cout << "[Batch] Job " << (i + 1) << "/" << jobs.size() << ": " << job.inputMeshFile << " at " << job.voxelResolution << std::endl;
+
+        bool succeeded = false;
+        try
+        {
+            bool loaded = false;
+            if (loader)
+            {
+                loaded = nextLoad.get();
+                if (loaded)
+                    voxelizer.swapMesh(*loader);
+                if (i + 1 < jobs.size())
+                    nextLoad = loadAhead(i + 1);
+            }
+            else
+            {
+                loaded = voxelizer.loadMesh(job.inputMeshFile);
+            }
+
+            if (!loaded)
+                std::cerr << "Error: Failed to load mesh from file: " << job.inputMeshFile << "\n";
+            else
+                succeeded = voxelizeLoadedMesh(voxelizer, job.outputVoxelFile, job.voxelResolution);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error: Job " << (i + 1) << " failed: " << e.what() << "\n";
+            if (loader && !nextLoad.valid() && i + 1 < jobs.size())
+                nextLoad = loadAhead(i + 1);
+        }
+
+        if (!succeeded)
+            numFailed++;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "[Batch] " << (jobs.size() - numFailed) << " of " << jobs.size() << " jobs done in " << seconds << " s" << std::endl;
+    return numFailed == 0 ? 0 : 1;
+}
 
 //================================//
 int main(int argc, char** argv)
 {
-    // parse first arg as input mesh file, second arg as output voxel file, third arg as voxel resolution
+    // parse first arg as input mesh file, second arg as output voxel file, third arg as voxel resolution.
+    // --cpu anywhere voxelizes on the CPU, for machines without a GPU
+    // --solid anywhere fills the interior of closed meshes instead of keeping only their surface
+    // --stream anywhere reads STL, PLY and OBJ meshes in chunks of triangles, for meshes too large to load at once
+    // --batch <manifest> runs the jobs of a manifest with one device instead of the positional arguments
     std::string inputMeshFile = "meshes/wallE.ply";
     std::string outputVoxelFile = "data/output_voxel.vox";
     uint32_t voxelResolution = 16;
+    VoxelizerBackend backend = VoxelizerBackend::GPU;
+    bool solid = false;
+    bool stream = false;
+    std::string manifestFile;
+
+    std::vector<char*> args;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--cpu") == 0)
+            backend = VoxelizerBackend::CPU;
+        else if (std::strcmp(argv[i], "--solid") == 0)
+            solid = true;
+        else if (std::strcmp(argv[i], "--stream") == 0)
+            stream = true;
+        else if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+            manifestFile = argv[++i];
+        else
+            args.push_back(argv[i]);
+    }
+
+    if (!manifestFile.empty())
+        return runBatch(manifestFile, backend, solid, stream);
 
-    if (argc > 1)
+    if (args.size() > 0)
     {
-        inputMeshFile = argv[1];
+        inputMeshFile = args[0];
     }
     else
     {
@@ -22,14 +185,14 @@ int main(int argc, char** argv)
         return 1;
     }
 
-    if (argc > 2)
+    if (args.size() > 1)
     {
-        outputVoxelFile = argv[2];
+        outputVoxelFile = args[1];
     }
 
-    if (argc > 3)
+    if (args.size() > 2)
     {
-        const char* str = argv[3];
+        const char* str = args[2];
         auto result = std::from_chars(str, str + std::strlen(str), voxelResolution);
 
         if (result.ec != std::errc()) { // Parsing failed
@@ -42,21 +205,18 @@ int main(int argc, char** argv)
         }
     }
 
-    Voxelizer voxelizer = Voxelizer();
+    Voxelizer voxelizer = Voxelizer(backend);
+    voxelizer.setSolid(solid);
+    if (stream)
+        voxelizer.setStreaming(MESH_STREAM_DEFAULT_CHUNK_TRIANGLES);
     if (!voxelizer.loadMesh(inputMeshFile))
     {
         std::cerr << "Error: Failed to load mesh from file: " << inputMeshFile << "\n";
         return 1;
     }
 
-    uint32_t maxBricksPerPass;
-    uint8_t numPasses;
-    voxelizer.checkLimits(voxelResolution, maxBricksPerPass, numPasses);
-    if (!voxelizer.voxelizeMesh(outputVoxelFile, voxelResolution, maxBricksPerPass, numPasses))
-    {
-        std::cerr << "Error: Failed to voxelize mesh and save to file: " << outputVoxelFile << "\n";
+    if (!voxelizeLoadedMesh(voxelizer, outputVoxelFile, voxelResolution))
         return 1;
-    }
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "../includes/AllocationCounter.hpp"
+
+#ifdef SKYEGRID_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+static thread_local uint64_t threadAllocationCount = 0;
+
+//================================//
+// GLOBAL ALLOCATION HOOKS
+//================================//
+static void* CountedAllocate(size_t size)
+{
+    threadAllocationCount++;
+
+    void* ptr = std::malloc(size > 0 ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+//================================//
+static void* CountedAlignedAllocate(size_t size, size_t alignment)
+{
+    threadAllocationCount++;
+
+#ifdef _WIN32
+    void* ptr = _aligned_malloc(size > 0 ? size : 1, alignment);
+#else
+    // aligned_alloc wants a size multiple of the alignment
+    void* ptr = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+//================================//
+static void AlignedFree(void* ptr)
+{
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+//================================//
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return CountedAlignedAllocate(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return CountedAlignedAllocate(size, static_cast<size_t>(alignment)); }
+
+//================================//
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try { return CountedAllocate(size); }
+    catch (...) { return nullptr; }
+}
+
+//================================//
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    try { return CountedAllocate(size); }
+    catch (...) { return nullptr; }
+}
+
+//================================//
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { AlignedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { AlignedFree(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { AlignedFree(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { AlignedFree(ptr); }
+
+//================================//
+uint64_t GetThreadAllocationCount()
+{
+    return threadAllocationCount;
+}
+
+#else
+
+//================================//
+uint64_t GetThreadAllocationCount()
+{
+    return 0;
+}
+
+#endif
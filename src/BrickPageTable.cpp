@@ -0,0 +1,186 @@
+#include "../includes/BrickPageTable.hpp"
+#include <algorithm>
+
+//================================//
+// HELPER FUNCTIONS
+//================================//
+static uint32_t PackPage(uint32_t pageSlot)
+{
+    return (pageSlot & 0x7FFFFFFFu) | (1u << 31); // Set allocated flag
+}
+
+//================================//
+static bool IsPageAllocated(uint32_t entry)
+{
+    return (entry & 0x80000000u) != 0u;
+}
+
+//================================//
+void BrickPageTable::Init(uint32_t brickResolution)
+{
+    Clear();
+
+    this->brickResolution = brickResolution;
+    this->pageResolution = (brickResolution + BRICK_PAGE_SIZE - 1) / BRICK_PAGE_SIZE;
+
+    const uint64_t numPages = static_cast<uint64_t>(this->pageResolution) * this->pageResolution * this->pageResolution;
+    this->entries.assign(numPages, 0u);
+}
+
+//================================//
+void BrickPageTable::Clear()
+{
+    this->entries.clear();
+    this->pages.clear();
+    this->brickResolution = 0;
+    this->pageResolution = 0;
+}
+
+//================================//
+uint32_t BrickPageTable::AllocatePage(uint32_t pageIndex)
+{
+    uint32_t& entry = this->entries[pageIndex];
+    if (IsPageAllocated(entry))
+        return entry & 0x7FFFFFFFu;
+
+    const uint32_t pageSlot = static_cast<uint32_t>(this->pages.size());
+
+    // Value initialization, every cell starts as an empty pointer
+    this->pages.push_back(std::make_unique<BrickGridPage>());
+    this->pages.back()->pageIndex = pageIndex;
+    std::fill(std::begin(this->pages.back()->brickSlots), std::end(this->pages.back()->brickSlots), UINT32_MAX);
+
+    entry = PackPage(pageSlot);
+    return pageSlot;
+}
+
+//================================//
+uint32_t BrickPageTable::FindPageSlot(uint32_t pageIndex) const
+{
+    if (pageIndex >= this->entries.size())
+        return INVALID_PAGE_SLOT;
+
+    const uint32_t entry = this->entries[pageIndex];
+    return IsPageAllocated(entry) ? (entry & 0x7FFFFFFFu) : INVALID_PAGE_SLOT;
+}
+
+//================================//
+uint32_t BrickPageTable::PageIndexOf(uint32_t brickGridIndex) const
+{
+    const uint32_t res = this->brickResolution;
+    const uint32_t bx = brickGridIndex % res;
+    const uint32_t by = (brickGridIndex / res) % res;
+    const uint32_t bz = brickGridIndex / (res * res);
+
+    const uint32_t px = bx / BRICK_PAGE_SIZE;
+    const uint32_t py = by / BRICK_PAGE_SIZE;
+    const uint32_t pz = bz / BRICK_PAGE_SIZE;
+    return px + py * this->pageResolution + pz * this->pageResolution * this->pageResolution;
+}
+
+//================================//
+uint32_t BrickPageTable::CellIndexOf(uint32_t brickGridIndex) const
+{
+    const uint32_t res = this->brickResolution;
+    const uint32_t lx = (brickGridIndex % res) % BRICK_PAGE_SIZE;
+    const uint32_t ly = ((brickGridIndex / res) % res) % BRICK_PAGE_SIZE;
+    const uint32_t lz = (brickGridIndex / (res * res)) % BRICK_PAGE_SIZE;
+    return lx + ly * BRICK_PAGE_SIZE + lz * BRICK_PAGE_SIZE * BRICK_PAGE_SIZE;
+}
+
+//================================//
+uint32_t BrickPageTable::BrickGridIndexOf(uint32_t pageIndex, uint32_t cellIndex) const
+{
+    const uint32_t res = this->brickResolution;
+    const uint32_t bx = (pageIndex % this->pageResolution) * BRICK_PAGE_SIZE + cellIndex % BRICK_PAGE_SIZE;
+    const uint32_t by = ((pageIndex / this->pageResolution) % this->pageResolution) * BRICK_PAGE_SIZE + (cellIndex / BRICK_PAGE_SIZE) % BRICK_PAGE_SIZE;
+    const uint32_t bz = (pageIndex / (this->pageResolution * this->pageResolution)) * BRICK_PAGE_SIZE + cellIndex / (BRICK_PAGE_SIZE * BRICK_PAGE_SIZE);
+    return bx + by * res + bz * res * res;
+}
+
+//================================//
+bool BrickPageTable::Locate(uint32_t brickGridIndex, uint32_t& pageSlot, uint32_t& cellIndex) const
+{
+    if (static_cast<uint64_t>(brickGridIndex) >= GetNumBricks())
+        return false;
+
+    pageSlot = FindPageSlot(PageIndexOf(brickGridIndex));
+    if (pageSlot == INVALID_PAGE_SLOT)
+        return false;
+
+    cellIndex = CellIndexOf(brickGridIndex);
+    return true;
+}
+
+//================================//
+void BrickPageTable::BuildCoarseCells(uint32_t pageSlot)
+{
+    BrickGridPage& page = *this->pages[pageSlot];
+
+    // Color sums and counts per level 1 cell, level 2 cells are the sum of 8 of them
+    uint32_t sums[BRICK_PAGE_COARSE_CELLS_L1][3] = {};
+    uint32_t counts[BRICK_PAGE_COARSE_CELLS_L1] = {};
+    for (uint32_t cellIndex = 0; cellIndex < BRICK_PAGE_CELLS; ++cellIndex)
+    {
+        // Edited bricks only get their resident pointer once uploaded, onGPU already tells they are there
+        if (page.cells[cellIndex].pointer == 0u && !page.onGPU.Test(cellIndex))
+            continue;
+
+        const uint32_t x = cellIndex % BRICK_PAGE_SIZE;
+        const uint32_t y = (cellIndex / BRICK_PAGE_SIZE) % BRICK_PAGE_SIZE;
+        const uint32_t z = cellIndex / (BRICK_PAGE_SIZE * BRICK_PAGE_SIZE);
+        const uint32_t coarseIndex = (x / 2) + (y / 2) * 4 + (z / 2) * 16;
+
+        const ColorRGB lod = page.GetLODColor(cellIndex);
+        sums[coarseIndex][0] += lod.r;
+        sums[coarseIndex][1] += lod.g;
+        sums[coarseIndex][2] += lod.b;
+        counts[coarseIndex]++;
+    }
+
+    auto packCoarse = [](const uint32_t sum[3], uint32_t count) -> uint32_t {
+        if (count == 0)
+            return 0u;
+        return (sum[0] / count) | ((sum[1] / count) << 8) | ((sum[2] / count) << 16) | (1u << 31);
+    };
+
+    uint32_t sumsL2[BRICK_PAGE_COARSE_CELLS_L2][3] = {};
+    uint32_t countsL2[BRICK_PAGE_COARSE_CELLS_L2] = {};
+    for (uint32_t coarseIndex = 0; coarseIndex < BRICK_PAGE_COARSE_CELLS_L1; ++coarseIndex)
+    {
+        page.coarseCells[coarseIndex] = packCoarse(sums[coarseIndex], counts[coarseIndex]);
+
+        const uint32_t x = coarseIndex % 4;
+        const uint32_t y = (coarseIndex / 4) % 4;
+        const uint32_t z = coarseIndex / 16;
+        const uint32_t parentIndex = (x / 2) + (y / 2) * 2 + (z / 2) * 4;
+        for (int channel = 0; channel < 3; ++channel)
+            sumsL2[parentIndex][channel] += sums[coarseIndex][channel];
+        countsL2[parentIndex] += counts[coarseIndex];
+    }
+
+    for (uint32_t parentIndex = 0; parentIndex < BRICK_PAGE_COARSE_CELLS_L2; ++parentIndex)
+    {
+        page.coarseCells[BRICK_PAGE_COARSE_CELLS_L1 + parentIndex] = packCoarse(sumsL2[parentIndex], countsL2[parentIndex]);
+    }
+}
+
+//================================//
+BrickGridCell* BrickPageTable::FindCell(uint32_t brickGridIndex)
+{
+    uint32_t pageSlot, cellIndex;
+    if (!Locate(brickGridIndex, pageSlot, cellIndex))
+        return nullptr;
+
+    return &this->pages[pageSlot]->cells[cellIndex];
+}
+
+//================================//
+BrickGridPage* BrickPageTable::FindPage(uint32_t brickGridIndex, uint32_t& cellIndex)
+{
+    uint32_t pageSlot;
+    if (!Locate(brickGridIndex, pageSlot, cellIndex))
+        return nullptr;
+
+    return this->pages[pageSlot].get();
+}
@@ -0,0 +1,206 @@
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <algorithm>
+#include <bit>
+#include "../includes/BrickPrefetcher.hpp"
+
+//================================//
+void BrickPrefetcher::Reset()
+{
+    this->hasSample = false;
+    this->velocity = Eigen::Vector3f::Zero();
+    this->angularVelocity = Eigen::Vector3f::Zero();
+    this->candidates.clear();
+}
+
+//================================//
+bool BrickPrefetcher::Update(const Camera& camera, double time)
+{
+    const Eigen::Vector3f position = camera.GetPosition();
+    const Eigen::Quaternionf orientation = camera.GetOrientation();
+
+    // Same projection as Camera::PixelToRayMatrix
+    const Eigen::Vector2f extent = camera.GetExtent();
+    this->tanHalfFovY = std::tan(camera.GetFov() * static_cast<float>(M_PI) / 360.0f);
+    this->tanHalfFovX = this->tanHalfFovY * (extent.x() / std::max(extent.y(), 1.0f));
+
+    if (!this->hasSample)
+    {
+        this->hasSample = true;
+        this->lastSampleTime = time;
+        this->lastPredictionTime = time;
+        this->lastPosition = position;
+        this->lastOrientation = orientation;
+        return false;
+    }
+
+    const double dt = time - this->lastSampleTime;
+    if (dt <= 1e-6)
+        return false;
+
+    // Instant linear and angular velocity, smoothed over the last frames
+    const Eigen::Vector3f instantVelocity = (position - this->lastPosition) / static_cast<float>(dt);
+
+    Eigen::AngleAxisf deltaRotation(orientation * this->lastOrientation.inverse());
+    const Eigen::Vector3f instantAngularVelocity = deltaRotation.axis() * (deltaRotation.angle() / static_cast<float>(dt));
+
+    this->velocity += PREFETCH_VELOCITY_SMOOTHING * (instantVelocity - this->velocity);
+    this->angularVelocity += PREFETCH_VELOCITY_SMOOTHING * (instantAngularVelocity - this->angularVelocity);
+
+    this->lastSampleTime = time;
+    this->lastPosition = position;
+    this->lastOrientation = orientation;
+
+    if (time - this->lastPredictionTime < PREFETCH_INTERVAL_SECONDS)
+        return false;
+    this->lastPredictionTime = time;
+
+    // A static camera is already served by the GPU feedback
+    const float minSpeed = 1.0f;         // voxels per second
+    const float minAngularSpeed = 0.05f; // radians per second
+    return this->velocity.norm() > minSpeed || this->angularVelocity.norm() > minAngularSpeed;
+}
+
+//================================//
+PrefetchFrustum BrickPrefetcher::buildPredictedFrustum(uint32_t flipBits, int voxelResolution) const
+{
+    // Extrapolate the pose
+    const Eigen::Vector3f predictedPosition = this->lastPosition + this->velocity * PREFETCH_LOOKAHEAD_SECONDS;
+
+    Eigen::Quaternionf predictedOrientation = this->lastOrientation;
+    const float angle = this->angularVelocity.norm() * PREFETCH_LOOKAHEAD_SECONDS;
+    if (angle > 1e-6f)
+    {
+        Eigen::AngleAxisf rotation(angle, this->angularVelocity.normalized());
+        predictedOrientation = (Eigen::Quaternionf(rotation) * this->lastOrientation).normalized();
+    }
+
+    const Eigen::Matrix3f R = predictedOrientation.toRotationMatrix();
+    Eigen::Vector3f right = R.col(0);
+    Eigen::Vector3f up = R.col(1);
+    Eigen::Vector3f forward = R.col(2);
+    Eigen::Vector3f origin = predictedPosition;
+
+    // The GPU mirrors the ray on flipped axes, do the same with the frustum
+    const float gridMax = static_cast<float>(voxelResolution);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if ((flipBits & (1u << axis)) != 0u)
+        {
+            origin[axis] = gridMax - origin[axis];
+            right[axis] = -right[axis];
+            up[axis] = -up[axis];
+            forward[axis] = -forward[axis];
+        }
+    }
+
+    const float tanX = this->tanHalfFovX * PREFETCH_FOV_MARGIN;
+    const float tanY = this->tanHalfFovY * PREFETCH_FOV_MARGIN;
+
+    PrefetchFrustum frustum;
+    frustum.origin = origin;
+    frustum.forward = forward;
+    frustum.planeNormals[0] = (right + forward * tanX).normalized();  // left
+    frustum.planeNormals[1] = (-right + forward * tanX).normalized(); // right
+    frustum.planeNormals[2] = (up + forward * tanY).normalized();     // bottom
+    frustum.planeNormals[3] = (-up + forward * tanY).normalized();    // top
+    frustum.farDistance = PREFETCH_RANGE_BRICKS * 8.0f;
+    return frustum;
+}
+
+//================================//
+bool BrickPrefetcher::isBoxInside(const PrefetchFrustum& frustum, const Eigen::Vector3f& boxMin, const Eigen::Vector3f& boxMax)
+{
+    // Positive vertex test, the box is out as soon as its farthest corner along a plane normal is behind it
+    auto positiveVertex = [&](const Eigen::Vector3f& normal) {
+        return Eigen::Vector3f(
+            normal.x() > 0.0f ? boxMax.x() : boxMin.x(),
+            normal.y() > 0.0f ? boxMax.y() : boxMin.y(),
+            normal.z() > 0.0f ? boxMax.z() : boxMin.z()
+        );
+    };
+
+    for (const Eigen::Vector3f& normal : frustum.planeNormals)
+    {
+        if (normal.dot(positiveVertex(normal) - frustum.origin) < 0.0f)
+            return false;
+    }
+
+    // Near plane at the camera, far plane at farDistance
+    if (frustum.forward.dot(positiveVertex(frustum.forward) - frustum.origin) < 0.0f)
+        return false;
+    if (frustum.forward.dot(positiveVertex(-frustum.forward) - frustum.origin) > frustum.farDistance)
+        return false;
+
+    return true;
+}
+
+//================================//
+void BrickPrefetcher::CollectBricks(const BrickPageTable& pageTable, uint32_t flipBits, int voxelResolution, uint32_t maxBricks, std::vector<uint32_t>& outBrickIndices)
+{
+    outBrickIndices.clear();
+    this->candidates.clear();
+
+    const PrefetchFrustum frustum = buildPredictedFrustum(flipBits, voxelResolution);
+
+    const uint32_t brickResolution = pageTable.GetBrickResolution();
+    const uint32_t pageResolution = pageTable.GetPageResolution();
+    const float pageExtent = static_cast<float>(BRICK_PAGE_SIZE * 8);
+    const Eigen::Vector3f gridMax = Eigen::Vector3f::Constant(static_cast<float>(voxelResolution));
+
+    // Only allocated pages can hold bricks of the file, coarse test on the page first
+    for (uint32_t pageSlot = 0; pageSlot < pageTable.GetNumAllocatedPages(); ++pageSlot)
+    {
+        const BrickGridPage& page = pageTable.GetPage(pageSlot);
+        const uint32_t px = page.pageIndex % pageResolution;
+        const uint32_t py = (page.pageIndex / pageResolution) % pageResolution;
+        const uint32_t pz = page.pageIndex / (pageResolution * pageResolution);
+
+        const Eigen::Vector3f pageMin = Eigen::Vector3f(static_cast<float>(px), static_cast<float>(py), static_cast<float>(pz)) * pageExtent;
+        const Eigen::Vector3f pageMax = (pageMin + Eigen::Vector3f::Constant(pageExtent)).cwiseMin(gridMax);
+        if (!isBoxInside(frustum, pageMin, pageMax))
+            continue;
+
+        // Bricks neither resident nor being read, 32 at a time
+        for (uint32_t word = 0; word < BRICK_PAGE_CELLS / 32; ++word)
+        {
+            uint32_t candidateBits = ~(page.onGPU.words[word] | page.reading.words[word] | page.pendingRead.words[word]);
+            while (candidateBits != 0u)
+            {
+                const uint32_t cellIndex = word * 32 + static_cast<uint32_t>(std::countr_zero(candidateBits));
+                candidateBits &= candidateBits - 1u;
+
+                if ((page.cells[cellIndex].pointer & (1u << 29)) == 0u)
+                    continue; // Only bricks with an unloaded LOD pointer exist in the file
+
+                const uint32_t bx = px * BRICK_PAGE_SIZE + cellIndex % BRICK_PAGE_SIZE;
+                const uint32_t by = py * BRICK_PAGE_SIZE + (cellIndex / BRICK_PAGE_SIZE) % BRICK_PAGE_SIZE;
+                const uint32_t bz = pz * BRICK_PAGE_SIZE + cellIndex / (BRICK_PAGE_SIZE * BRICK_PAGE_SIZE);
+                if (bx >= brickResolution || by >= brickResolution || bz >= brickResolution)
+                    continue;
+
+                const Eigen::Vector3f brickMin = Eigen::Vector3f(static_cast<float>(bx), static_cast<float>(by), static_cast<float>(bz)) * 8.0f;
+                const Eigen::Vector3f brickMax = brickMin + Eigen::Vector3f::Constant(8.0f);
+                if (!isBoxInside(frustum, brickMin, brickMax))
+                    continue;
+
+                const float distanceSq = ((brickMin + brickMax) * 0.5f - frustum.origin).squaredNorm();
+                this->candidates.emplace_back(distanceSq, bx + by * brickResolution + bz * brickResolution * brickResolution);
+            }
+        }
+    }
+
+    // Keep the nearest ones only
+    if (this->candidates.size() > maxBricks)
+    {
+        std::nth_element(this->candidates.begin(), this->candidates.begin() + maxBricks, this->candidates.end());
+        this->candidates.resize(maxBricks);
+    }
+    std::sort(this->candidates.begin(), this->candidates.end());
+
+    outBrickIndices.reserve(this->candidates.size());
+    for (const auto& candidate : this->candidates)
+    {
+        outBrickIndices.push_back(candidate.second);
+    }
+}
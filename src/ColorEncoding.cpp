@@ -0,0 +1,205 @@
+#include "../includes/ColorEncoding.hpp"
+#include <algorithm>
+#include <cstring>
+
+//================================//
+// HELPER FUNCTIONS
+//================================//
+static uint32_t PackColor(ColorRGB c)
+{
+    return uint32_t(c.r) | (uint32_t(c.g) << 8) | (uint32_t(c.b) << 16);
+}
+
+//================================//
+static uint8_t Channel(uint32_t packed, int channel)
+{
+    return static_cast<uint8_t>((packed >> (channel * 8)) & 0xFFu);
+}
+
+//================================//
+static bool IsVoxelOccupied(const uint32_t occupancy[16], uint32_t voxelIndex)
+{
+    return (occupancy[voxelIndex >> 5] & (1u << (voxelIndex & 31u))) != 0u;
+}
+
+//================================//
+// Median cut over the distinct colors of the brick. Fills the palette and, for every distinct color
+// (sorted), the palette index it maps to. Returns the number of palette entries used.
+// Everything lives on the stack, a brick has at most 512 distinct colors and this runs in the frame loop
+static uint32_t BuildPalette(const uint32_t* distinctColors, uint32_t numDistinct, uint32_t maxEntries, uint32_t* palette, uint8_t* paletteIndexOfDistinct)
+{
+    std::memset(paletteIndexOfDistinct, 0, numDistinct);
+
+    if (numDistinct <= maxEntries)
+    {
+        for (uint32_t i = 0; i < numDistinct; ++i)
+        {
+            palette[i] = distinctColors[i];
+            paletteIndexOfDistinct[i] = static_cast<uint8_t>(i);
+        }
+        return numDistinct;
+    }
+
+    // Boxes are ranges of a working copy, split along their widest channel at the median
+    struct Box { uint32_t begin, end; };
+    uint32_t work[512];
+    std::memcpy(work, distinctColors, numDistinct * sizeof(uint32_t));
+    Box boxes[PALETTE8_ENTRIES];
+    uint32_t numBoxes = 0;
+    boxes[numBoxes++] = {0, numDistinct};
+
+    auto widestChannel = [&work](const Box& box, int& outChannel) {
+        int bestRange = -1;
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            uint8_t lo = 255, hi = 0;
+            for (uint32_t i = box.begin; i < box.end; ++i)
+            {
+                lo = std::min(lo, Channel(work[i], channel));
+                hi = std::max(hi, Channel(work[i], channel));
+            }
+            if (hi - lo > bestRange)
+            {
+                bestRange = hi - lo;
+                outChannel = channel;
+            }
+        }
+        return bestRange;
+    };
+
+    while (numBoxes < maxEntries)
+    {
+        int splitBox = -1, splitChannel = 0, bestRange = 0;
+        for (uint32_t b = 0; b < numBoxes; ++b)
+        {
+            if (boxes[b].end - boxes[b].begin < 2)
+                continue;
+            int channel = 0;
+            const int range = widestChannel(boxes[b], channel);
+            if (range > bestRange)
+            {
+                bestRange = range;
+                splitBox = static_cast<int>(b);
+                splitChannel = channel;
+            }
+        }
+        if (splitBox < 0)
+            break; // Every box holds a single color
+
+        Box& box = boxes[splitBox];
+        std::sort(work + box.begin, work + box.end, [splitChannel](uint32_t a, uint32_t b) {
+            return Channel(a, splitChannel) < Channel(b, splitChannel);
+        });
+        const uint32_t median = box.begin + (box.end - box.begin) / 2;
+        boxes[numBoxes++] = {median, box.end};
+        boxes[splitBox].end = median;
+    }
+
+    // Palette entry is the mean of its box, distinct colors map to the box they ended in
+    for (uint32_t b = 0; b < numBoxes; ++b)
+    {
+        uint32_t sum[3] = {0, 0, 0};
+        for (uint32_t i = boxes[b].begin; i < boxes[b].end; ++i)
+        {
+            for (int channel = 0; channel < 3; ++channel)
+                sum[channel] += Channel(work[i], channel);
+
+            const uint32_t distinctIndex = static_cast<uint32_t>(std::lower_bound(distinctColors, distinctColors + numDistinct, work[i]) - distinctColors);
+            paletteIndexOfDistinct[distinctIndex] = static_cast<uint8_t>(b);
+        }
+
+        const uint32_t count = boxes[b].end - boxes[b].begin;
+        palette[b] = (sum[0] / count) | ((sum[1] / count) << 8) | ((sum[2] / count) << 16);
+    }
+
+    return numBoxes;
+}
+
+//================================//
+uint32_t ColorWordsPerBrick(ColorFormat format)
+{
+    switch (format)
+    {
+        case ColorFormat::RGBA8:    return 512;
+        case ColorFormat::RGB565:   return 256;
+        case ColorFormat::Palette8: return 1 + PALETTE8_ENTRIES + 512 / 4;
+        case ColorFormat::Palette4: return 1 + PALETTE4_ENTRIES + 512 / 8;
+    }
+    return 512;
+}
+
+//================================//
+const char* ColorFormatName(ColorFormat format)
+{
+    switch (format)
+    {
+        case ColorFormat::RGBA8:    return "RGBA8";
+        case ColorFormat::RGB565:   return "RGB565";
+        case ColorFormat::Palette8: return "Palette 8 bit";
+        case ColorFormat::Palette4: return "Palette 4 bit";
+    }
+    return "Unknown";
+}
+
+//================================//
+uint32_t EncodeBrickColors(ColorFormat format, const uint32_t occupancy[16], const ColorRGB colors[512], uint32_t out[512])
+{
+    if (format == ColorFormat::RGBA8 || format == ColorFormat::RGB565)
+    {
+        uint32_t count = 0;
+        for (uint32_t voxelIndex = 0; voxelIndex < 512; ++voxelIndex)
+        {
+            if (IsVoxelOccupied(occupancy, voxelIndex))
+                out[count++] = PackColor(colors[voxelIndex]);
+        }
+        return count;
+    }
+
+    const uint32_t paletteEntries = format == ColorFormat::Palette8 ? PALETTE8_ENTRIES : PALETTE4_ENTRIES;
+    const uint32_t bitsPerIndex = format == ColorFormat::Palette8 ? 8 : 4;
+    const uint32_t indicesPerWord = 32 / bitsPerIndex;
+
+    uint32_t distinctColors[512];
+    uint32_t occupiedCount = 0;
+    for (uint32_t voxelIndex = 0; voxelIndex < 512; ++voxelIndex)
+    {
+        if (IsVoxelOccupied(occupancy, voxelIndex))
+            distinctColors[occupiedCount++] = PackColor(colors[voxelIndex]);
+    }
+    std::sort(distinctColors, distinctColors + occupiedCount);
+    const uint32_t numDistinct = static_cast<uint32_t>(std::unique(distinctColors, distinctColors + occupiedCount) - distinctColors);
+
+    uint8_t paletteIndexOfDistinct[512];
+    const uint32_t paletteSize = BuildPalette(distinctColors, numDistinct, paletteEntries, out + 1, paletteIndexOfDistinct);
+    out[0] = paletteSize;
+
+    // Indices right after the palette, in occupied voxel order
+    uint32_t* indices = out + 1 + paletteSize;
+    const uint32_t indexWords = (occupiedCount + indicesPerWord - 1) / indicesPerWord;
+    std::memset(indices, 0, indexWords * sizeof(uint32_t));
+
+    uint32_t rank = 0;
+    for (uint32_t voxelIndex = 0; voxelIndex < 512; ++voxelIndex)
+    {
+        if (!IsVoxelOccupied(occupancy, voxelIndex))
+            continue;
+
+        const uint32_t packed = PackColor(colors[voxelIndex]);
+        const uint32_t distinctIndex = static_cast<uint32_t>(std::lower_bound(distinctColors, distinctColors + numDistinct, packed) - distinctColors);
+        const uint32_t paletteIndex = paletteIndexOfDistinct[distinctIndex];
+
+        indices[rank / indicesPerWord] |= paletteIndex << ((rank % indicesPerWord) * bitsPerIndex);
+        rank++;
+    }
+
+    return 1 + paletteSize + indexWords;
+}
+
+//================================//
+uint32_t ColorPoolWords(ColorFormat format, uint32_t encodedWords)
+{
+    // RGB565 is uploaded unpacked
+    if (format == ColorFormat::RGB565)
+        return (encodedWords + 1) / 2;
+    return encodedWords;
+}
@@ -0,0 +1,94 @@
+#include "../includes/ColorPoolAllocator.hpp"
+
+//================================//
+void ColorPoolAllocator::Init(uint64_t capacityWords, uint64_t poolWords)
+{
+    this->capacityWords = capacityWords;
+    this->poolWords = poolWords > 0 ? poolWords : capacityWords;
+    this->nextFreeGranule.assign(capacityWords / COLOR_ALLOCATION_GRANULARITY, INVALID_GRANULE);
+    Reset();
+}
+
+//================================//
+void ColorPoolAllocator::Reset()
+{
+    this->top = 0;
+    this->usedWords = 0;
+    this->freeListWords = 0;
+    this->freeListHeads.fill(INVALID_GRANULE);
+}
+
+//================================//
+bool ColorPoolAllocator::Allocate(uint32_t words, uint64_t& outOffset, uint32_t& outBlockWords)
+{
+    if (words == 0 || words > COLOR_MAX_ALLOCATION_WORDS)
+        return false;
+
+    const uint32_t sizeClass = sizeClassOf(words);
+
+    // [1] Exact size class
+    if (this->freeListHeads[sizeClass] != INVALID_GRANULE)
+    {
+        outOffset = popFreeBlock(sizeClass);
+        outBlockWords = sizeOfClass(sizeClass);
+
+        this->freeListWords -= outBlockWords;
+        this->usedWords += outBlockWords;
+        return true;
+    }
+
+    // [2] Bump, skipping the end of a pool when the block would straddle it
+    const uint64_t blockWords = sizeOfClass(sizeClass);
+    uint64_t offset = this->top;
+    const uint64_t poolEnd = (offset / this->poolWords + 1) * this->poolWords;
+    if (offset + blockWords > poolEnd)
+        offset = poolEnd;
+
+    if (offset + blockWords <= this->capacityWords)
+    {
+        this->top = offset + blockWords;
+        outOffset = offset;
+        outBlockWords = static_cast<uint32_t>(blockWords);
+        this->usedWords += blockWords;
+        return true;
+    }
+
+    // [3] Out of space, a larger free block is better than nothing
+    for (uint32_t largerClass = sizeClass + 1; largerClass < COLOR_NUM_SIZE_CLASSES; ++largerClass)
+    {
+        if (this->freeListHeads[largerClass] == INVALID_GRANULE)
+            continue;
+
+        outOffset = popFreeBlock(largerClass);
+        outBlockWords = sizeOfClass(largerClass);
+
+        this->freeListWords -= outBlockWords;
+        this->usedWords += outBlockWords;
+        return true;
+    }
+
+    return false;
+}
+
+//================================//
+void ColorPoolAllocator::Free(uint64_t offset, uint32_t blockWords)
+{
+    if (blockWords == 0)
+        return;
+
+    const uint32_t sizeClass = sizeClassOf(blockWords);
+    const uint32_t granule = static_cast<uint32_t>(offset / COLOR_ALLOCATION_GRANULARITY);
+    this->nextFreeGranule[granule] = this->freeListHeads[sizeClass];
+    this->freeListHeads[sizeClass] = granule;
+    this->freeListWords += blockWords;
+    this->usedWords -= blockWords;
+}
+
+
+//================================//
+uint64_t ColorPoolAllocator::popFreeBlock(uint32_t sizeClass)
+{
+    const uint32_t granule = this->freeListHeads[sizeClass];
+    this->freeListHeads[sizeClass] = this->nextFreeGranule[granule];
+    return static_cast<uint64_t>(granule) * COLOR_ALLOCATION_GRANULARITY;
+}
@@ -0,0 +1,307 @@
+#include "../includes/JobSystem.hpp"
+#include <algorithm>
+#include <cassert>
+
+// Queue of the worker running on this thread, -1 on threads that are not workers of the pool
+static thread_local int currentWorkerIndex = -1;
+static thread_local const JobSystem* currentWorkerSystem = nullptr;
+
+//================================//
+// JOB QUEUE
+//================================//
+bool JobQueue::Push(const Job& job)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->count == JOB_QUEUE_CAPACITY)
+        return false;
+
+    this->jobs[(this->head + this->count) % JOB_QUEUE_CAPACITY] = job;
+    this->count++;
+    return true;
+}
+
+//================================//
+bool JobQueue::Pop(Job& outJob)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->count == 0)
+        return false;
+
+    // Newest first, its data is the most likely to still be in cache
+    this->count--;
+    outJob = this->jobs[(this->head + this->count) % JOB_QUEUE_CAPACITY];
+    return true;
+}
+
+//================================//
+bool JobQueue::Steal(Job& outJob)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->count == 0)
+        return false;
+
+    outJob = this->jobs[this->head];
+    this->head = (this->head + 1) % JOB_QUEUE_CAPACITY;
+    this->count--;
+    return true;
+}
+
+//================================//
+// JOB SYSTEM
+//================================//
+JobSystem::JobSystem(uint32_t numWorkers)
+{
+    this->numQueues = numWorkers + 1;
+    this->queues = std::make_unique<JobQueue[]>(this->numQueues);
+
+    this->workers.reserve(numWorkers);
+    for (uint32_t i = 0; i < numWorkers; ++i)
+        this->workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+//================================//
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->sleepMutex);
+        this->running.store(false);
+    }
+    this->sleepCV.notify_all();
+
+    for (std::thread& worker : this->workers)
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+}
+
+//================================//
+JobSystem& JobSystem::Shared()
+{
+#ifdef __EMSCRIPTEN__
+    static JobSystem shared(0);
+#else
+    static JobSystem shared(std::max(1u, std::thread::hardware_concurrency()) - 1);
+#endif
+    return shared;
+}
+
+//================================//
+void JobSystem::Submit(const Job& job)
+{
+    // Workers keep their jobs local, everyone else shares the last queue
+    const bool isWorker = currentWorkerSystem == this && currentWorkerIndex >= 0;
+    JobQueue& queue = this->queues[isWorker ? currentWorkerIndex : this->numQueues - 1];
+
+    if (this->workers.empty())
+    {
+        runJob(job); // No one to give it to
+        return;
+    }
+
+    // Counted before it is visible, a thief taking it right away must not see the count wrap
+    this->queuedJobs.fetch_add(1);
+    if (!queue.Push(job))
+    {
+        this->queuedJobs.fetch_sub(1);
+        runJob(job); // Queue full
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->sleepMutex);
+    }
+    this->sleepCV.notify_one();
+}
+
+//================================//
+void JobSystem::Wait(const std::atomic<uint32_t>& pending)
+{
+    while (pending.load() > 0)
+    {
+        if (!RunPendingJob())
+            std::this_thread::yield(); // The last jobs of the batch run on other threads
+    }
+}
+
+//================================//
+bool JobSystem::RunPendingJob()
+{
+    const int workerIndex = currentWorkerSystem == this ? currentWorkerIndex : -1;
+
+    Job job;
+    if (!findJob(workerIndex, job))
+        return false;
+
+    runJob(job);
+    return true;
+}
+
+//================================//
+void JobSystem::parallelFor(uint32_t count, uint32_t grainSize, void (*function)(void*, uint32_t, uint32_t), void* context)
+{
+    if (count == 0)
+        return;
+
+    // Enough chunks for stealing to balance uneven work, not so many the queues overflow
+    const uint32_t maxJobs = std::min(GetNumThreads() * JOBS_PER_THREAD, JOB_QUEUE_CAPACITY / 2);
+    grainSize = std::max({grainSize, 1u, (count + maxJobs - 1) / maxJobs});
+    const uint32_t numJobs = (count + grainSize - 1) / grainSize;
+
+    if (numJobs == 1 || this->workers.empty())
+    {
+        function(context, 0, count);
+        return;
+    }
+
+    // The first chunk is ours, the rest goes to the queues
+    std::atomic<uint32_t> pending = numJobs - 1;
+    for (uint32_t jobIndex = 1; jobIndex < numJobs; ++jobIndex)
+    {
+        Job job;
+        job.function = function;
+        job.context = context;
+        job.begin = jobIndex * grainSize;
+        job.end = std::min(count, job.begin + grainSize);
+        job.pending = &pending;
+        Submit(job);
+    }
+
+    function(context, 0, grainSize);
+    Wait(pending);
+}
+
+//================================//
+void JobSystem::workerLoop(uint32_t workerIndex)
+{
+    currentWorkerIndex = static_cast<int>(workerIndex);
+    currentWorkerSystem = this;
+
+    while (this->running.load())
+    {
+        Job job;
+        if (findJob(static_cast<int>(workerIndex), job))
+        {
+            runJob(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(this->sleepMutex);
+        this->sleepCV.wait(lock, [this]() {
+            return this->queuedJobs.load() > 0 || !this->running.load();
+        });
+    }
+}
+
+//================================//
+bool JobSystem::findJob(int workerIndex, Job& outJob)
+{
+    if (this->queuedJobs.load() == 0)
+        return false;
+
+    // [1] Own queue
+    if (workerIndex >= 0 && this->queues[workerIndex].Pop(outJob))
+    {
+        this->queuedJobs.fetch_sub(1);
+        return true;
+    }
+
+    // [2] Steal, starting after our own queue so thieves spread over the victims
+    const uint32_t start = workerIndex >= 0 ? static_cast<uint32_t>(workerIndex) + 1 : 0;
+    for (uint32_t i = 0; i < this->numQueues; ++i)
+    {
+        const uint32_t victim = (start + i) % this->numQueues;
+        if (static_cast<int>(victim) == workerIndex)
+            continue;
+
+        if (this->queues[victim].Steal(outJob))
+        {
+            this->queuedJobs.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//================================//
+void JobSystem::runJob(const Job& job)
+{
+    job.function(job.context, job.begin, job.end);
+    if (job.pending)
+        job.pending->fetch_sub(1);
+}
+
+//================================//
+// JOB GRAPH
+//================================//
+uint32_t JobGraph::AddTask(std::function<void()> task)
+{
+    TaskNode node;
+    node.task = std::move(task);
+    this->tasks.push_back(std::move(node));
+    return static_cast<uint32_t>(this->tasks.size() - 1);
+}
+
+//================================//
+void JobGraph::AddDependency(uint32_t before, uint32_t after)
+{
+    assert(before < this->tasks.size() && after < this->tasks.size() && before != after);
+    this->tasks[before].successors.push_back(after);
+    this->tasks[after].numDependencies++;
+}
+
+//================================//
+void JobGraph::Run(JobSystem& jobSystem)
+{
+    const uint32_t numTasks = GetNumTasks();
+    if (numTasks == 0)
+        return;
+
+    this->runningSystem = &jobSystem;
+    this->remainingDependencies = std::make_unique<std::atomic<uint32_t>[]>(numTasks);
+    for (uint32_t i = 0; i < numTasks; ++i)
+        this->remainingDependencies[i].store(this->tasks[i].numDependencies);
+    this->remainingTasks.store(numTasks);
+
+    // Roots first, the others are submitted by the last task they wait on
+    for (uint32_t i = 0; i < numTasks; ++i)
+    {
+        if (this->tasks[i].numDependencies > 0)
+            continue;
+
+        Job job;
+        job.function = &JobGraph::runTask;
+        job.context = this;
+        job.begin = i;
+        job.end = i + 1;
+        job.pending = &this->remainingTasks;
+        jobSystem.Submit(job);
+    }
+
+    jobSystem.Wait(this->remainingTasks);
+    this->runningSystem = nullptr;
+}
+
+//================================//
+void JobGraph::runTask(void* context, uint32_t taskIndex, uint32_t)
+{
+    JobGraph& graph = *static_cast<JobGraph*>(context);
+    const TaskNode& node = graph.tasks[taskIndex];
+    node.task();
+
+    // Successors are released before this task counts as done, so remainingTasks cannot reach 0 early
+    for (uint32_t successor : node.successors)
+    {
+        if (graph.remainingDependencies[successor].fetch_sub(1) != 1)
+            continue;
+
+        Job job;
+        job.function = &JobGraph::runTask;
+        job.context = &graph;
+        job.begin = successor;
+        job.end = successor + 1;
+        job.pending = &graph.remainingTasks;
+        graph.runningSystem->Submit(job);
+    }
+}
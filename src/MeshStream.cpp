@@ -0,0 +1,690 @@
+#include "../includes/MeshStream.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+//================================//
+static std::string LowerExtension(const std::string& filename)
+{
+    std::string extension = std::filesystem::path(filename).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+//================================//
+// Type encoding of PlyProperty, 0 when unknown
+static int PlyType(const std::string& name)
+{
+    if (name == "char" || name == "int8") return -1;
+    if (name == "uchar" || name == "uint8") return 1;
+    if (name == "short" || name == "int16") return -2;
+    if (name == "ushort" || name == "uint16") return 2;
+    if (name == "int" || name == "int32") return -4;
+    if (name == "uint" || name == "uint32") return 4;
+    if (name == "float" || name == "float32") return 12;
+    if (name == "double" || name == "float64") return 16;
+    return 0;
+}
+
+//================================//
+bool MeshStream::IsSupported(const std::string& filename)
+{
+    std::string extension = LowerExtension(filename);
+    return extension == ".stl" || extension == ".ply" || extension == ".obj";
+}
+
+//================================//
+bool MeshStream::fail(const std::string& message)
+{
+    std::cout << "[MeshStream] " << message << " in " << this->filename << std::endl;
+    this->failed = true;
+    return false;
+}
+
+//================================//
+bool MeshStream::Open(const std::string& filename)
+{
+    this->filename = filename;
+    this->failed = false;
+    this->positions.clear();
+    this->uvs.clear();
+    this->materials.clear();
+    this->materialIndices.clear();
+
+    if (this->file.is_open())
+        this->file.close();
+    this->file.open(filename, std::ios::binary);
+    if (!this->file.is_open())
+        return this->fail("Failed to open file");
+
+    std::string extension = LowerExtension(filename);
+    bool opened = false;
+    if (extension == ".stl")
+    {
+        this->format = MeshStreamFormat::STL;
+        opened = this->openSTL();
+    }
+    else if (extension == ".ply")
+    {
+        this->format = MeshStreamFormat::PLY;
+        opened = this->openPLY();
+    }
+    else if (extension == ".obj")
+    {
+        this->format = MeshStreamFormat::OBJ;
+        opened = this->openOBJ();
+    }
+    else
+    {
+        return this->fail("Unsupported format " + extension);
+    }
+    if (!opened)
+        return false;
+
+    // Count and bounds, the voxel grid is sized from them before any chunk is voxelized
+    this->triangleCount = 0;
+    this->extentSum = 0.0;
+    this->minBounds.fill(std::numeric_limits<double>::max());
+    this->maxBounds.fill(std::numeric_limits<double>::lowest());
+    this->uvMinBounds.fill(std::numeric_limits<double>::max());
+    this->uvMaxBounds.fill(std::numeric_limits<double>::lowest());
+
+    std::vector<StreamedTriangle> chunk;
+    this->Rewind();
+    while (this->ReadChunk(chunk, MESH_STREAM_DEFAULT_CHUNK_TRIANGLES))
+    {
+        for (const StreamedTriangle& triangle : chunk)
+        {
+            double extent = 0.0;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float minValue = std::min({triangle.positions[0][axis], triangle.positions[1][axis], triangle.positions[2][axis]});
+                float maxValue = std::max({triangle.positions[0][axis], triangle.positions[1][axis], triangle.positions[2][axis]});
+                this->minBounds[axis] = std::min(this->minBounds[axis], static_cast<double>(minValue));
+                this->maxBounds[axis] = std::max(this->maxBounds[axis], static_cast<double>(maxValue));
+                extent = std::max(extent, static_cast<double>(maxValue - minValue));
+            }
+            this->extentSum += extent;
+
+            for (int corner = 0; corner < 3; corner++)
+            {
+                for (int axis = 0; axis < 2; axis++)
+                {
+                    this->uvMinBounds[axis] = std::min(this->uvMinBounds[axis], static_cast<double>(triangle.uvs[corner][axis]));
+                    this->uvMaxBounds[axis] = std::max(this->uvMaxBounds[axis], static_cast<double>(triangle.uvs[corner][axis]));
+                }
+            }
+        }
+        this->triangleCount += chunk.size();
+    }
+    if (this->failed)
+        return false;
+    if (this->triangleCount == 0)
+        return this->fail("No triangles");
+
+    this->Rewind();
+    std::cout << "[MeshStream] Streaming " << this->triangleCount << " triangles from " << filename << std::endl;
+    return true;
+}
+
+//================================//
+void MeshStream::Rewind()
+{
+    this->file.clear();
+    this->file.seekg(this->dataStart);
+    this->stlTrianglesRead = 0;
+    this->plyFacesRead = 0;
+    this->objPositionsSeen = 0;
+    this->objUVsSeen = 0;
+    this->objMaterial = 0;
+    this->pending.clear();
+    this->pendingRead = 0;
+}
+
+//================================//
+bool MeshStream::ReadChunk(std::vector<StreamedTriangle>& outTriangles, uint32_t maxTriangles)
+{
+    outTriangles.clear();
+    if (this->failed)
+        return false;
+
+    std::vector<uint32_t> positionIndices;
+    std::vector<uint32_t> uvIndices;
+    while (outTriangles.size() < maxTriangles)
+    {
+        if (this->pendingRead < this->pending.size())
+        {
+            outTriangles.push_back(this->pending[this->pendingRead++]);
+            continue;
+        }
+        this->pending.clear();
+        this->pendingRead = 0;
+
+        bool more = false;
+        if (this->format == MeshStreamFormat::STL)
+        {
+            StreamedTriangle triangle;
+            more = this->readSTLTriangle(triangle);
+            if (more)
+                outTriangles.push_back(triangle);
+        }
+        else if (this->format == MeshStreamFormat::PLY)
+        {
+            more = this->readPLYFace(positionIndices);
+            if (more)
+                this->emitFan(positionIndices, positionIndices, !this->uvs.empty());
+        }
+        else
+        {
+            more = this->readOBJFace(positionIndices, uvIndices);
+            if (more)
+                this->emitFan(positionIndices, uvIndices, !uvIndices.empty());
+        }
+
+        if (!more)
+            break;
+    }
+
+    return !this->failed && !outTriangles.empty();
+}
+
+//================================//
+void MeshStream::emitFan(const std::vector<uint32_t>& positionIndices, const std::vector<uint32_t>& uvIndices, bool hasUVs)
+{
+    for (size_t i = 1; i + 1 < positionIndices.size(); i++)
+    {
+        const size_t fan[3] = {0, i, i + 1};
+        StreamedTriangle triangle{};
+        triangle.material = this->objMaterial;
+        for (int corner = 0; corner < 3; corner++)
+        {
+            const uint32_t p = positionIndices[fan[corner]];
+            std::memcpy(triangle.positions[corner], &this->positions[p * 3], sizeof(float) * 3);
+            if (hasUVs)
+                std::memcpy(triangle.uvs[corner], &this->uvs[uvIndices[fan[corner]] * 2], sizeof(float) * 2);
+        }
+        this->pending.push_back(triangle);
+    }
+}
+
+//================================//
+bool MeshStream::openSTL()
+{
+    // Binary files may also start with "solid", the size tells them apart
+    char header[80]{};
+    uint32_t count = 0;
+    this->file.read(header, sizeof(header));
+    this->file.read(reinterpret_cast<char*>(&count), sizeof(count));
+    uint64_t fileSize = std::filesystem::file_size(this->filename);
+
+    bool sizeMatches = this->file.good() && fileSize == 84 + 50 * static_cast<uint64_t>(count);
+    this->stlBinary = sizeMatches || std::strncmp(header, "solid", 5) != 0;
+    if (this->stlBinary && !sizeMatches)
+    {
+        if (!this->file.good() || fileSize < 84 + 50 * static_cast<uint64_t>(count))
+            return this->fail("Truncated binary STL");
+    }
+
+    this->stlTriangleCount = count;
+    this->dataStart = this->stlBinary ? 84 : 0;
+    return true;
+}
+
+//================================//
+bool MeshStream::readSTLTriangle(StreamedTriangle& outTriangle)
+{
+    outTriangle = StreamedTriangle{};
+
+    if (this->stlBinary)
+    {
+        if (this->stlTrianglesRead >= this->stlTriangleCount)
+            return false;
+
+        // Normal, three vertices and the attribute count
+        char record[50];
+        this->file.read(record, sizeof(record));
+        if (this->file.gcount() != sizeof(record))
+            return this->fail("Truncated binary STL");
+
+        std::memcpy(outTriangle.positions, record + 12, sizeof(float) * 9);
+        this->stlTrianglesRead++;
+        return true;
+    }
+
+    // ASCII, every other keyword is skipped
+    std::string token;
+    int corner = 0;
+    while (this->file >> token)
+    {
+        if (token != "vertex")
+            continue;
+
+        float* position = outTriangle.positions[corner];
+        if (!(this->file >> position[0] >> position[1] >> position[2]))
+            return this->fail("Malformed STL vertex");
+        if (++corner == 3)
+            return true;
+    }
+
+    if (corner != 0)
+        return this->fail("Truncated ASCII STL facet");
+    return false;
+}
+
+//================================//
+bool MeshStream::openPLY()
+{
+    std::string line;
+    std::getline(this->file, line);
+    if (line.rfind("ply", 0) != 0)
+        return this->fail("Missing PLY magic");
+
+    std::vector<PlyElement> elements;
+    bool ascii = false;
+    this->plyBinary = false;
+    this->plyBigEndian = false;
+    while (std::getline(this->file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+
+        if (keyword == "format")
+        {
+            std::string format;
+            words >> format;
+            ascii = format == "ascii";
+            this->plyBigEndian = format == "binary_big_endian";
+            this->plyBinary = this->plyBigEndian || format == "binary_little_endian";
+            if (!ascii && !this->plyBinary)
+                return this->fail("Unknown PLY format " + format);
+        }
+        else if (keyword == "element")
+        {
+            PlyElement element;
+            words >> element.name >> element.count;
+            elements.push_back(element);
+        }
+        else if (keyword == "property")
+        {
+            if (elements.empty())
+                return this->fail("PLY property outside of an element");
+
+            PlyProperty property;
+            std::string type;
+            words >> type;
+            if (type == "list")
+            {
+                std::string countType;
+                words >> countType >> type;
+                property.isList = true;
+                property.countType = PlyType(countType);
+                if (property.countType == 0)
+                    return this->fail("Unknown PLY type " + countType);
+            }
+            property.type = PlyType(type);
+            if (property.type == 0)
+                return this->fail("Unknown PLY type " + type);
+            words >> property.name;
+            elements.back().properties.push_back(property);
+        }
+        else if (keyword == "end_header")
+        {
+            break;
+        }
+    }
+    if (!this->file.good())
+        return this->fail("Truncated PLY header");
+    if (!ascii && !this->plyBinary)
+        return this->fail("PLY header without format");
+
+    // Elements before the faces are read or skipped, the faces are streamed from where they start
+    bool hasVertices = false;
+    for (const PlyElement& element : elements)
+    {
+        if (element.name == "face")
+        {
+            if (!hasVertices)
+                return this->fail("PLY faces before the vertices are not supported");
+
+            bool hasIndices = false;
+            for (const PlyProperty& property : element.properties)
+                hasIndices |= property.isList && (property.name == "vertex_indices" || property.name == "vertex_index");
+            if (!hasIndices)
+                return this->fail("PLY faces without vertex indices");
+
+            this->plyFaces = element;
+            this->dataStart = this->file.tellg();
+            return true;
+        }
+
+        if (element.name != "vertex")
+        {
+            if (!this->skipPLYElement(element))
+                return false;
+            continue;
+        }
+
+        // Property slots of the position and UVs
+        int slots[5] = {-1, -1, -1, -1, -1};
+        for (size_t p = 0; p < element.properties.size(); p++)
+        {
+            const std::string& name = element.properties[p].name;
+            if (name == "x") slots[0] = static_cast<int>(p);
+            else if (name == "y") slots[1] = static_cast<int>(p);
+            else if (name == "z") slots[2] = static_cast<int>(p);
+            else if (name == "u" || name == "s" || name == "texture_u") slots[3] = static_cast<int>(p);
+            else if (name == "v" || name == "t" || name == "texture_v") slots[4] = static_cast<int>(p);
+        }
+        if (slots[0] < 0 || slots[1] < 0 || slots[2] < 0)
+            return this->fail("PLY vertices without positions");
+        bool hasUVs = slots[3] >= 0 && slots[4] >= 0;
+
+        this->positions.resize(element.count * 3);
+        if (hasUVs)
+            this->uvs.resize(element.count * 2);
+
+        double values[5] = {};
+        for (uint64_t v = 0; v < element.count; v++)
+        {
+            for (size_t p = 0; p < element.properties.size(); p++)
+            {
+                const PlyProperty& property = element.properties[p];
+                double value = 0.0;
+                if (property.isList)
+                {
+                    double count = 0.0;
+                    if (!this->readPLYValue(property.countType, count))
+                        return false;
+                    for (uint32_t i = 0; i < static_cast<uint32_t>(count); i++)
+                    {
+                        if (!this->readPLYValue(property.type, value))
+                            return false;
+                    }
+                    continue;
+                }
+                if (!this->readPLYValue(property.type, value))
+                    return false;
+                for (int s = 0; s < 5; s++)
+                {
+                    if (slots[s] == static_cast<int>(p))
+                        values[s] = value;
+                }
+            }
+
+            this->positions[v * 3 + 0] = static_cast<float>(values[0]);
+            this->positions[v * 3 + 1] = static_cast<float>(values[1]);
+            this->positions[v * 3 + 2] = static_cast<float>(values[2]);
+            if (hasUVs)
+            {
+                this->uvs[v * 2 + 0] = static_cast<float>(values[3]);
+                this->uvs[v * 2 + 1] = 1.0f - static_cast<float>(values[4]);
+            }
+        }
+        hasVertices = true;
+    }
+
+    return this->fail("PLY without faces");
+}
+
+//================================//
+bool MeshStream::readPLYValue(int type, double& outValue)
+{
+    if (!this->plyBinary)
+    {
+        if (!(this->file >> outValue))
+            return this->fail("Truncated ASCII PLY data");
+        return true;
+    }
+
+    const int size = type < 0 ? -type : (type > 8 ? type - 8 : type);
+    unsigned char bytes[8];
+    this->file.read(reinterpret_cast<char*>(bytes), size);
+    if (this->file.gcount() != size)
+        return this->fail("Truncated binary PLY data");
+    if (this->plyBigEndian)
+        std::reverse(bytes, bytes + size);
+
+    switch (type)
+    {
+        case -1: { int8_t value; std::memcpy(&value, bytes, 1); outValue = value; break; }
+        case 1: { uint8_t value; std::memcpy(&value, bytes, 1); outValue = value; break; }
+        case -2: { int16_t value; std::memcpy(&value, bytes, 2); outValue = value; break; }
+        case 2: { uint16_t value; std::memcpy(&value, bytes, 2); outValue = value; break; }
+        case -4: { int32_t value; std::memcpy(&value, bytes, 4); outValue = value; break; }
+        case 4: { uint32_t value; std::memcpy(&value, bytes, 4); outValue = value; break; }
+        case 12: { float value; std::memcpy(&value, bytes, 4); outValue = value; break; }
+        default: { double value; std::memcpy(&value, bytes, 8); outValue = value; break; }
+    }
+    return true;
+}
+
+//================================//
+bool MeshStream::skipPLYElement(const PlyElement& element)
+{
+    double value = 0.0;
+    for (uint64_t i = 0; i < element.count; i++)
+    {
+        for (const PlyProperty& property : element.properties)
+        {
+            double count = 1.0;
+            if (property.isList && !this->readPLYValue(property.countType, count))
+                return false;
+            for (uint32_t j = 0; j < static_cast<uint32_t>(count); j++)
+            {
+                if (!this->readPLYValue(property.type, value))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+//================================//
+bool MeshStream::readPLYFace(std::vector<uint32_t>& outIndices)
+{
+    outIndices.clear();
+    if (this->plyFacesRead >= this->plyFaces.count)
+        return false;
+
+    const uint64_t numVertices = this->positions.size() / 3;
+    double value = 0.0;
+    for (const PlyProperty& property : this->plyFaces.properties)
+    {
+        double count = 1.0;
+        if (property.isList && !this->readPLYValue(property.countType, count))
+            return false;
+
+        bool isIndices = property.isList && (property.name == "vertex_indices" || property.name == "vertex_index");
+        for (uint32_t i = 0; i < static_cast<uint32_t>(count); i++)
+        {
+            if (!this->readPLYValue(property.type, value))
+                return false;
+            if (!isIndices)
+                continue;
+            if (value < 0.0 || value >= static_cast<double>(numVertices))
+                return this->fail("PLY face index out of range");
+            outIndices.push_back(static_cast<uint32_t>(value));
+        }
+    }
+
+    this->plyFacesRead++;
+    return true;
+}
+
+//================================//
+bool MeshStream::openOBJ()
+{
+    // Vertex pools only, the faces are streamed
+    std::string line;
+    while (std::getline(this->file, line))
+    {
+        const char* cursor = line.c_str();
+        while (*cursor == ' ' || *cursor == '\t')
+            cursor++;
+
+        if (cursor[0] == 'v' && (cursor[1] == ' ' || cursor[1] == '\t'))
+        {
+            char* end = const_cast<char*>(cursor + 1);
+            for (int axis = 0; axis < 3; axis++)
+                this->positions.push_back(std::strtof(end, &end));
+        }
+        else if (cursor[0] == 'v' && cursor[1] == 't' && (cursor[2] == ' ' || cursor[2] == '\t'))
+        {
+            char* end = nullptr;
+            float u = std::strtof(cursor + 2, &end);
+            float v = std::strtof(end, &end);
+            this->uvs.push_back(u);
+            this->uvs.push_back(1.0f - v);
+        }
+        else if (std::strncmp(cursor, "mtllib", 6) == 0 && (cursor[6] == ' ' || cursor[6] == '\t'))
+        {
+            std::string library = cursor + 7;
+            library.erase(0, library.find_first_not_of(" \t"));
+            library.erase(library.find_last_not_of(" \t\r") + 1);
+            std::replace(library.begin(), library.end(), '\\', '/'); // Files exported on Windows
+            this->loadOBJMaterials((std::filesystem::path(this->filename).parent_path() / library).string());
+        }
+    }
+
+    if (this->positions.empty())
+        return this->fail("OBJ without vertices");
+    this->dataStart = 0;
+    return true;
+}
+
+//================================//
+bool MeshStream::readOBJFace(std::vector<uint32_t>& outPositions, std::vector<uint32_t>& outUVs)
+{
+    const uint32_t numPositions = static_cast<uint32_t>(this->positions.size() / 3);
+    const uint32_t numUVs = static_cast<uint32_t>(this->uvs.size() / 2);
+
+    std::string line;
+    while (std::getline(this->file, line))
+    {
+        const char* cursor = line.c_str();
+        while (*cursor == ' ' || *cursor == '\t')
+            cursor++;
+
+        if (cursor[0] == 'v' && (cursor[1] == ' ' || cursor[1] == '\t'))
+        {
+            this->objPositionsSeen++;
+            continue;
+        }
+        if (cursor[0] == 'v' && cursor[1] == 't' && (cursor[2] == ' ' || cursor[2] == '\t'))
+        {
+            this->objUVsSeen++;
+            continue;
+        }
+        if (std::strncmp(cursor, "usemtl", 6) == 0 && (cursor[6] == ' ' || cursor[6] == '\t'))
+        {
+            std::string name = cursor + 7;
+            name.erase(0, name.find_first_not_of(" \t"));
+            name.erase(name.find_last_not_of(" \t\r") + 1);
+            auto found = this->materialIndices.find(name);
+            this->objMaterial = found != this->materialIndices.end() ? found->second : 0;
+            continue;
+        }
+        if (cursor[0] != 'f' || (cursor[1] != ' ' && cursor[1] != '\t'))
+            continue;
+
+        // Corners as position[/uv[/normal]], negative indices count back from the last vertex seen
+        outPositions.clear();
+        outUVs.clear();
+        bool allUVs = true;
+        char* end = const_cast<char*>(cursor + 1);
+        while (true)
+        {
+            long position = std::strtol(end, &end, 10);
+            if (position == 0)
+                break;
+
+            long uv = 0;
+            if (*end == '/')
+            {
+                end++;
+                if (*end != '/')
+                    uv = std::strtol(end, &end, 10);
+                if (*end == '/')
+                {
+                    end++;
+                    std::strtol(end, &end, 10);
+                }
+            }
+
+            long positionIndex = position > 0 ? position - 1 : static_cast<long>(this->objPositionsSeen) + position;
+            if (positionIndex < 0 || positionIndex >= static_cast<long>(numPositions))
+                return this->fail("OBJ face index out of range");
+            outPositions.push_back(static_cast<uint32_t>(positionIndex));
+
+            long uvIndex = uv > 0 ? uv - 1 : static_cast<long>(this->objUVsSeen) + uv;
+            if (uv == 0 || uvIndex < 0 || uvIndex >= static_cast<long>(numUVs))
+                allUVs = false;
+            else
+                outUVs.push_back(static_cast<uint32_t>(uvIndex));
+        }
+
+        if (!allUVs)
+            outUVs.clear();
+        if (outPositions.size() >= 3)
+            return true;
+    }
+
+    return false;
+}
+
+//================================//
+// Diffuse color and texture of every newmtl, textures are resolved against the directory of the library
+void MeshStream::loadOBJMaterials(const std::string& libraryPath)
+{
+    std::ifstream library(libraryPath);
+    if (!library.is_open())
+    {
+        std::cout << "[MeshStream] Failed to open material library " << libraryPath << std::endl;
+        return;
+    }
+
+    const std::filesystem::path libraryDirectory = std::filesystem::path(libraryPath).parent_path();
+    StreamedMaterial* material = nullptr;
+    std::string line;
+    while (std::getline(library, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+        if (keyword == "newmtl")
+        {
+            std::string name;
+            std::getline(words >> std::ws, name);
+            auto [it, inserted] = this->materialIndices.try_emplace(name, static_cast<uint32_t>(this->materials.size()));
+            if (inserted)
+                this->materials.push_back({name, "", {1.0f, 1.0f, 1.0f}});
+            material = &this->materials[it->second];
+        }
+        else if (material && keyword == "Kd")
+        {
+            words >> material->diffuse[0] >> material->diffuse[1] >> material->diffuse[2];
+        }
+        else if (material && keyword == "map_Kd")
+        {
+            // Options like -s or -o come first, the file name is last
+            std::string token, texture;
+            while (words >> token)
+                texture = token;
+            std::replace(texture.begin(), texture.end(), '\\', '/');
+            if (!texture.empty())
+                material->diffuseTexture = (libraryDirectory / texture).string();
+        }
+    }
+}
@@ -1,6 +1,38 @@
 #include "../../../includes/Rendering/Pipelines/pipelines.hpp"
 #include "../../../includes/constants.hpp"
 
+//================================//
+// HELPER FUNCTIONS
+//================================//
+// Replaces the //@marker line of a shader with generated code
+static void ReplaceShaderMarker(std::string& shaderCode, const std::string& marker, const std::string& generated)
+{
+    const std::string token = "//@" + marker;
+    const size_t position = shaderCode.find(token);
+    if (position == std::string::npos)
+    {
+        throw std::runtime_error("[PIPELINES] Shader marker " + token + " not found.");
+    }
+    shaderCode.replace(position, token.size(), generated);
+}
+
+//================================//
+// One copy of pattern per color pool, {i} is replaced by the pool index and {b} by its binding
+static std::string GenerateColorPoolCode(int numColorBuffers, uint32_t firstBinding, const std::string& pattern)
+{
+    std::string generated;
+    for (int i = 0; i < numColorBuffers; ++i)
+    {
+        std::string line = pattern;
+        for (size_t position = line.find("{i}"); position != std::string::npos; position = line.find("{i}"))
+            line.replace(position, 3, std::to_string(i));
+        for (size_t position = line.find("{b}"); position != std::string::npos; position = line.find("{b}"))
+            line.replace(position, 3, std::to_string(firstBinding + i));
+        generated += line;
+    }
+    return generated;
+}
+
 //================================//
 void CreateRenderPipelineDebug(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipelineWrapper)
 {
@@ -76,6 +108,12 @@ void CreateComputeVoxelPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& p
         );
     }
 
+    // WGSL has no binding arrays, the color pool bindings and their address translation are generated
+    ReplaceShaderMarker(shaderCode, "COLOR_POOL_BINDINGS", GenerateColorPoolCode(numColorBuffers, COMPUTE_VOXEL_COLOR_POOL_BINDING,
+        "@group(0) @binding({b})\nvar<storage, read> colorPool{i}: array<u32>;\n"));
+    ReplaceShaderMarker(shaderCode, "COLOR_POOL_READ_CASES", GenerateColorPoolCode(numColorBuffers, COMPUTE_VOXEL_COLOR_POOL_BINDING,
+        "case {i}u: { return colorPool{i}[localOffset]; }\n        "));
+
     wgpu::ShaderSourceWGSL wgsl{};
     wgsl.code = shaderCode.c_str();
 
@@ -98,7 +136,7 @@ void CreateComputeVoxelPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& p
     pipelineWrapper.associatedUniforms[0] = wgpuBundle.GetDevice().CreateBuffer(&uniformBufferDesc);
 
     // Bind Group Layout
-    wgpu::BindGroupLayoutEntry entries[10]{};
+    std::vector<wgpu::BindGroupLayoutEntry> entries(COMPUTE_VOXEL_COLOR_POOL_BINDING + numColorBuffers);
 
     // output texture
     entries[0].binding = 0;
@@ -134,21 +172,38 @@ void CreateComputeVoxelPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& p
     entries[5].visibility = wgpu::ShaderStage::Compute;
     entries[5].buffer.type = wgpu::BufferBindingType::Storage;
 
+    // Brick request flags
+    entries[6].binding = 6;
+    entries[6].visibility = wgpu::ShaderStage::Compute;
+    entries[6].buffer.type = wgpu::BufferBindingType::Storage;
+
+    // Brick page table
+    entries[7].binding = 7;
+    entries[7].visibility = wgpu::ShaderStage::Compute;
+    entries[7].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // Brick color offsets
+    entries[8].binding = 8;
+    entries[8].visibility = wgpu::ShaderStage::Compute;
+    entries[8].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // Brick coarse levels
+    entries[9].binding = 9;
+    entries[9].visibility = wgpu::ShaderStage::Compute;
+    entries[9].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
     // ColorPool
     for (int i = 0; i < numColorBuffers; ++i)
     {
-        entries[6 + i].binding = 6 + i;
-        entries[6 + i].visibility = wgpu::ShaderStage::Compute;
-        entries[6 + i].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+        const uint32_t binding = COMPUTE_VOXEL_COLOR_POOL_BINDING + i;
+        entries[binding].binding = binding;
+        entries[binding].visibility = wgpu::ShaderStage::Compute;
+        entries[binding].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
     }
 
-    entries[9].binding = 9;
-    entries[9].visibility = wgpu::ShaderStage::Compute;
-    entries[9].buffer.type = wgpu::BufferBindingType::Storage;
-
     wgpu::BindGroupLayoutDescriptor bindGroupLayoutDesc{};
-    bindGroupLayoutDesc.entryCount = 10;
-    bindGroupLayoutDesc.entries = entries;
+    bindGroupLayoutDesc.entryCount = static_cast<uint32_t>(entries.size());
+    bindGroupLayoutDesc.entries = entries.data();
     pipelineWrapper.bindGroupLayout = wgpuBundle.GetDevice().CreateBindGroupLayout(&bindGroupLayoutDesc);
 
     // Pipeline Layout
@@ -183,6 +238,11 @@ void CreateComputeUploadVoxelPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrap
         );
     }
 
+    ReplaceShaderMarker(shaderCode, "COLOR_POOL_BINDINGS", GenerateColorPoolCode(numColorBuffers, UPLOAD_VOXEL_COLOR_POOL_BINDING,
+        "@group(0) @binding({b})\nvar<storage, read_write> colorPool{i}: array<u32>;\n"));
+    ReplaceShaderMarker(shaderCode, "COLOR_POOL_WRITE_CASES", GenerateColorPoolCode(numColorBuffers, UPLOAD_VOXEL_COLOR_POOL_BINDING,
+        "case {i}u: { colorPool{i}[localOffset] = color; }\n        "));
+
     wgpu::ShaderSourceWGSL wgsl{};
     wgsl.code = shaderCode.c_str();
 
@@ -193,7 +253,7 @@ void CreateComputeUploadVoxelPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrap
     pipelineWrapper.shaderModule = wgpuBundle.GetDevice().CreateShaderModule(&shaderModuleDesc);
 
     // Bind Group Layout
-    wgpu::BindGroupLayoutEntry entries[6]{};
+    std::vector<wgpu::BindGroupLayoutEntry> entries(UPLOAD_VOXEL_COLOR_POOL_BINDING + numColorBuffers);
 
     // Read upload buffer
     entries[0].binding = 0;
@@ -209,16 +269,31 @@ void CreateComputeUploadVoxelPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrap
     entries[2].visibility = wgpu::ShaderStage::Compute;
     entries[2].buffer.type = wgpu::BufferBindingType::Storage;
 
+    // Brick color offsets, written along with the colors
+    entries[3].binding = 3;
+    entries[3].visibility = wgpu::ShaderStage::Compute;
+    entries[3].buffer.type = wgpu::BufferBindingType::Storage;
+
+    // Pointer updates, and the brick grid page pool they are scattered into
+    entries[4].binding = 4;
+    entries[4].visibility = wgpu::ShaderStage::Compute;
+    entries[4].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    entries[5].binding = 5;
+    entries[5].visibility = wgpu::ShaderStage::Compute;
+    entries[5].buffer.type = wgpu::BufferBindingType::Storage;
+
     for (int i = 0; i < numColorBuffers; ++i)
     {
-        entries[3 + i].binding = 3 + i;
-        entries[3 + i].visibility = wgpu::ShaderStage::Compute;
-        entries[3 + i].buffer.type = wgpu::BufferBindingType::Storage;
+        const uint32_t binding = UPLOAD_VOXEL_COLOR_POOL_BINDING + i;
+        entries[binding].binding = binding;
+        entries[binding].visibility = wgpu::ShaderStage::Compute;
+        entries[binding].buffer.type = wgpu::BufferBindingType::Storage;
     }
 
     wgpu::BindGroupLayoutDescriptor bindGroupLayoutDesc{};
-    bindGroupLayoutDesc.entryCount = 3 + numColorBuffers;
-    bindGroupLayoutDesc.entries = entries;
+    bindGroupLayoutDesc.entryCount = static_cast<uint32_t>(entries.size());
+    bindGroupLayoutDesc.entries = entries.data();
     pipelineWrapper.bindGroupLayout = wgpuBundle.GetDevice().CreateBindGroupLayout(&bindGroupLayoutDesc);
 
     // Pipeline Layout
@@ -234,6 +309,10 @@ void CreateComputeUploadVoxelPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrap
     computePipelineDesc.compute.entryPoint = "c";
     pipelineWrapper.computePipeline = wgpuBundle.GetDevice().CreateComputePipeline(&computePipelineDesc);
 
+    // Pointer scatter, dispatched after the bricks
+    computePipelineDesc.compute.entryPoint = "p";
+    pipelineWrapper.secondaryComputePipeline = wgpuBundle.GetDevice().CreateComputePipeline(&computePipelineDesc);
+
     pipelineWrapper.init = 1;
     pipelineWrapper.AssertConsistent();
 }
@@ -349,7 +428,105 @@ void CreateVoxelizationPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& p
     pipelineWrapper.shaderModule = wgpuBundle.GetDevice().CreateShaderModule(&shaderModuleDesc);
 
     // Bind Group Layout
-    wgpu::BindGroupLayoutEntry entries[7]{};
+    wgpu::BindGroupLayoutEntry entries[9]{};
+
+    // uniform
+    entries[0].binding = 0;
+    entries[0].visibility = wgpu::ShaderStage::Compute;
+    entries[0].buffer.type = wgpu::BufferBindingType::Uniform;
+
+    // vertex buffer
+    entries[1].binding = 1;
+    entries[1].visibility = wgpu::ShaderStage::Compute;
+    entries[1].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // triangle buffer
+    entries[2].binding = 2;
+    entries[2].visibility = wgpu::ShaderStage::Compute;
+    entries[2].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // occupancy buffer
+    entries[3].binding = 3;
+    entries[3].visibility = wgpu::ShaderStage::Compute;
+    entries[3].buffer.type = wgpu::BufferBindingType::Storage;
+
+    // voxel winners buffer
+    entries[4].binding = 4;
+    entries[4].visibility = wgpu::ShaderStage::Compute;
+    entries[4].buffer.type = wgpu::BufferBindingType::Storage;
+
+    // bin offsets buffer
+    entries[5].binding = 5;
+    entries[5].visibility = wgpu::ShaderStage::Compute;
+    entries[5].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // bin counts buffer
+    entries[6].binding = 6;
+    entries[6].visibility = wgpu::ShaderStage::Compute;
+    entries[6].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // binned triangles buffer
+    entries[7].binding = 7;
+    entries[7].visibility = wgpu::ShaderStage::Compute;
+    entries[7].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // candidate bricks buffer
+    entries[8].binding = 8;
+    entries[8].visibility = wgpu::ShaderStage::Compute;
+    entries[8].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    wgpu::BindGroupLayoutDescriptor bindGroupLayoutDesc{};
+    bindGroupLayoutDesc.entryCount = 9;
+    bindGroupLayoutDesc.entries = entries;
+    pipelineWrapper.bindGroupLayout = wgpuBundle.GetDevice().CreateBindGroupLayout(&bindGroupLayoutDesc);
+
+    // Pipeline Layout
+    wgpu::PipelineLayoutDescriptor pipelineLayoutDesc{};
+    pipelineLayoutDesc.bindGroupLayoutCount = 1;
+    pipelineLayoutDesc.bindGroupLayouts = &pipelineWrapper.bindGroupLayout;
+    pipelineWrapper.pipelineLayout = wgpuBundle.GetDevice().CreatePipelineLayout(&pipelineLayoutDesc);
+
+    // Compute Pipeline
+    wgpu::ComputePipelineDescriptor computePipelineDesc{};
+    computePipelineDesc.layout = pipelineWrapper.pipelineLayout;
+    computePipelineDesc.compute.module = pipelineWrapper.shaderModule;
+    computePipelineDesc.compute.entryPoint = "c";
+    pipelineWrapper.computePipeline = wgpuBundle.GetDevice().CreateComputePipeline(&computePipelineDesc);
+
+    // Triangle parallel mode, one invocation per binned triangle instead of per brick
+    computePipelineDesc.compute.entryPoint = "t";
+    pipelineWrapper.secondaryComputePipeline = wgpuBundle.GetDevice().CreateComputePipeline(&computePipelineDesc);
+
+    pipelineWrapper.init = 1;
+    pipelineWrapper.AssertConsistent();
+}
+
+//================================//
+void CreateVoxelColorPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipelineWrapper)
+{
+    pipelineWrapper.isCompute = true;
+
+    // SHADER 
+    std::string shaderCode;
+    if (getShaderCodeFromFile("Shaders/computeVoxelColors.wgsl", shaderCode) < 0)
+    {
+        throw std::runtime_error(
+            "[PIPELINES] Failed to load compute voxel colors shader code from path: " +
+            (getExecutableDirectory() / "Shaders/computeVoxelColors.wgsl").string()
+        );
+    }
+
+    wgpu::ShaderSourceWGSL wgsl{};
+    wgsl.code = shaderCode.c_str();
+
+    wgpu::ShaderModuleDescriptor shaderModuleDesc{};
+    shaderModuleDesc.nextInChain = &wgsl;
+    shaderModuleDesc.label = "ComputeVoxelColorsShaderModule";
+
+    pipelineWrapper.shaderModule = wgpuBundle.GetDevice().CreateShaderModule(&shaderModuleDesc);
+
+    // Bind Group Layout
+    wgpu::BindGroupLayoutEntry entries[8]{};
 
     // uniform
     entries[0].binding = 0;
@@ -370,7 +547,7 @@ void CreateVoxelizationPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& p
     entries[3].binding = 3;
     entries[3].visibility = wgpu::ShaderStage::Compute;
     entries[3].texture.sampleType = wgpu::TextureSampleType::Float;
-    entries[3].texture.viewDimension = wgpu::TextureViewDimension::e2D;
+    entries[3].texture.viewDimension = wgpu::TextureViewDimension::e2DArray; // Material layers
     entries[3].texture.multisampled = false;
 
     // Texture sampler
@@ -378,18 +555,23 @@ void CreateVoxelizationPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& p
     entries[4].visibility = wgpu::ShaderStage::Compute;
     entries[4].sampler.type = wgpu::SamplerBindingType::Filtering;
 
-    // occupancy buffer
+    // voxel winners buffer
     entries[5].binding = 5;
     entries[5].visibility = wgpu::ShaderStage::Compute;
-    entries[5].buffer.type = wgpu::BufferBindingType::Storage;
+    entries[5].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
 
     // dense colors buffer
     entries[6].binding = 6;
     entries[6].visibility = wgpu::ShaderStage::Compute;
     entries[6].buffer.type = wgpu::BufferBindingType::Storage;
 
+    // candidate bricks buffer
+    entries[7].binding = 7;
+    entries[7].visibility = wgpu::ShaderStage::Compute;
+    entries[7].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
     wgpu::BindGroupLayoutDescriptor bindGroupLayoutDesc{};
-    bindGroupLayoutDesc.entryCount = 7;
+    bindGroupLayoutDesc.entryCount = 8;
     bindGroupLayoutDesc.entries = entries;
     pipelineWrapper.bindGroupLayout = wgpuBundle.GetDevice().CreateBindGroupLayout(&bindGroupLayoutDesc);
 
@@ -487,4 +669,352 @@ void CreateCompactVoxelPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& p
     
     pipelineWrapper.init = 1;
     pipelineWrapper.AssertConsistent();
-}
\ No newline at end of file
+}
+
+//================================//
+void CreateTriangleBinningPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipelineWrapper)
+{
+    pipelineWrapper.isCompute = true;
+
+    // SHADER 
+    std::string shaderCode;
+    if (getShaderCodeFromFile("Shaders/computeTriangleBinning.wgsl", shaderCode) < 0)
+    {
+        throw std::runtime_error(
+            "[PIPELINES] Failed to load compute triangle binning shader code from path: " +
+            (getExecutableDirectory() / "Shaders/computeTriangleBinning.wgsl").string()
+        );
+    }
+
+    wgpu::ShaderSourceWGSL wgsl{};
+    wgsl.code = shaderCode.c_str();
+
+    wgpu::ShaderModuleDescriptor shaderModuleDesc{};
+    shaderModuleDesc.nextInChain = &wgsl;
+    shaderModuleDesc.label = "ComputeTriangleBinningShaderModule";
+
+    pipelineWrapper.shaderModule = wgpuBundle.GetDevice().CreateShaderModule(&shaderModuleDesc);
+
+    // Bind Group Layout
+    wgpu::BindGroupLayoutEntry entries[9]{};
+
+    // uniform
+    entries[0].binding = 0;
+    entries[0].visibility = wgpu::ShaderStage::Compute;
+    entries[0].buffer.type = wgpu::BufferBindingType::Uniform;
+
+    // vertex buffer
+    entries[1].binding = 1;
+    entries[1].visibility = wgpu::ShaderStage::Compute;
+    entries[1].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // triangle buffer
+    entries[2].binding = 2;
+    entries[2].visibility = wgpu::ShaderStage::Compute;
+    entries[2].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // bin counts buffer (atomics)
+    entries[3].binding = 3;
+    entries[3].visibility = wgpu::ShaderStage::Compute;
+    entries[3].buffer.type = wgpu::BufferBindingType::Storage;
+
+    // bin cursors buffer (atomics)
+    entries[4].binding = 4;
+    entries[4].visibility = wgpu::ShaderStage::Compute;
+    entries[4].buffer.type = wgpu::BufferBindingType::Storage;
+
+    // binned triangles buffer
+    entries[5].binding = 5;
+    entries[5].visibility = wgpu::ShaderStage::Compute;
+    entries[5].buffer.type = wgpu::BufferBindingType::Storage;
+
+    // candidate bits buffer
+    entries[6].binding = 6;
+    entries[6].visibility = wgpu::ShaderStage::Compute;
+    entries[6].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // candidate ranks buffer
+    entries[7].binding = 7;
+    entries[7].visibility = wgpu::ShaderStage::Compute;
+    entries[7].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // candidate bricks buffer
+    entries[8].binding = 8;
+    entries[8].visibility = wgpu::ShaderStage::Compute;
+    entries[8].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    wgpu::BindGroupLayoutDescriptor bindGroupLayoutDesc{};
+    bindGroupLayoutDesc.entryCount = 9;
+    bindGroupLayoutDesc.entries = entries;
+    pipelineWrapper.bindGroupLayout = wgpuBundle.GetDevice().CreateBindGroupLayout(&bindGroupLayoutDesc);
+
+    // Pipeline Layout
+    wgpu::PipelineLayoutDescriptor pipelineLayoutDesc{};
+    pipelineLayoutDesc.bindGroupLayoutCount = 1;
+    pipelineLayoutDesc.bindGroupLayouts = &pipelineWrapper.bindGroupLayout;
+    pipelineWrapper.pipelineLayout = wgpuBundle.GetDevice().CreatePipelineLayout(&pipelineLayoutDesc);
+
+    // Compute Pipeline, counts the triangles per brick
+    wgpu::ComputePipelineDescriptor computePipelineDesc{};
+    computePipelineDesc.layout = pipelineWrapper.pipelineLayout;
+    computePipelineDesc.compute.module = pipelineWrapper.shaderModule;
+    computePipelineDesc.compute.entryPoint = "c";
+    pipelineWrapper.computePipeline = wgpuBundle.GetDevice().CreateComputePipeline(&computePipelineDesc);
+
+    // Triangle scatter, dispatched after the prefix sum
+    computePipelineDesc.compute.entryPoint = "p";
+    pipelineWrapper.secondaryComputePipeline = wgpuBundle.GetDevice().CreateComputePipeline(&computePipelineDesc);
+
+    pipelineWrapper.init = 1;
+    pipelineWrapper.AssertConsistent();
+}
+
+//================================//
+void CreateBinPrefixSumPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipelineWrapper)
+{
+    pipelineWrapper.isCompute = true;
+
+    // SHADER 
+    std::string shaderCode;
+    if (getShaderCodeFromFile("Shaders/computeBinPrefixSum.wgsl", shaderCode) < 0)
+    {
+        throw std::runtime_error(
+            "[PIPELINES] Failed to load compute bin prefix sum shader code from path: " +
+            (getExecutableDirectory() / "Shaders/computeBinPrefixSum.wgsl").string()
+        );
+    }
+
+    wgpu::ShaderSourceWGSL wgsl{};
+    wgsl.code = shaderCode.c_str();
+
+    wgpu::ShaderModuleDescriptor shaderModuleDesc{};
+    shaderModuleDesc.nextInChain = &wgsl;
+    shaderModuleDesc.label = "ComputeBinPrefixSumShaderModule";
+
+    pipelineWrapper.shaderModule = wgpuBundle.GetDevice().CreateShaderModule(&shaderModuleDesc);
+
+    // Bind Group Layout
+    wgpu::BindGroupLayoutEntry entries[6]{};
+
+    // uniform
+    entries[0].binding = 0;
+    entries[0].visibility = wgpu::ShaderStage::Compute;
+    entries[0].buffer.type = wgpu::BufferBindingType::Uniform;
+
+    // bin counts buffer
+    entries[1].binding = 1;
+    entries[1].visibility = wgpu::ShaderStage::Compute;
+    entries[1].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // bin offsets buffer
+    entries[2].binding = 2;
+    entries[2].visibility = wgpu::ShaderStage::Compute;
+    entries[2].buffer.type = wgpu::BufferBindingType::Storage;
+
+    // block sums buffer
+    entries[3].binding = 3;
+    entries[3].visibility = wgpu::ShaderStage::Compute;
+    entries[3].buffer.type = wgpu::BufferBindingType::Storage;
+
+    // bin cursors buffer
+    entries[4].binding = 4;
+    entries[4].visibility = wgpu::ShaderStage::Compute;
+    entries[4].buffer.type = wgpu::BufferBindingType::Storage;
+
+    // bin total buffer
+    entries[5].binding = 5;
+    entries[5].visibility = wgpu::ShaderStage::Compute;
+    entries[5].buffer.type = wgpu::BufferBindingType::Storage;
+
+    wgpu::BindGroupLayoutDescriptor bindGroupLayoutDesc{};
+    bindGroupLayoutDesc.entryCount = 6;
+    bindGroupLayoutDesc.entries = entries;
+    pipelineWrapper.bindGroupLayout = wgpuBundle.GetDevice().CreateBindGroupLayout(&bindGroupLayoutDesc);
+
+    // Pipeline Layout
+    wgpu::PipelineLayoutDescriptor pipelineLayoutDesc{};
+    pipelineLayoutDesc.bindGroupLayoutCount = 1;
+    pipelineLayoutDesc.bindGroupLayouts = &pipelineWrapper.bindGroupLayout;
+    pipelineWrapper.pipelineLayout = wgpuBundle.GetDevice().CreatePipelineLayout(&pipelineLayoutDesc);
+
+    // Compute Pipeline, scans the blocks
+    wgpu::ComputePipelineDescriptor computePipelineDesc{};
+    computePipelineDesc.layout = pipelineWrapper.pipelineLayout;
+    computePipelineDesc.compute.module = pipelineWrapper.shaderModule;
+    computePipelineDesc.compute.entryPoint = "c";
+    pipelineWrapper.computePipeline = wgpuBundle.GetDevice().CreateComputePipeline(&computePipelineDesc);
+
+    // Block offsets, dispatched after the block scan
+    computePipelineDesc.compute.entryPoint = "p";
+    pipelineWrapper.secondaryComputePipeline = wgpuBundle.GetDevice().CreateComputePipeline(&computePipelineDesc);
+
+    pipelineWrapper.init = 1;
+    pipelineWrapper.AssertConsistent();
+}
+
+//================================//
+void CreateSolidFillPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipelineWrapper)
+{
+    pipelineWrapper.isCompute = true;
+
+    // SHADER 
+    std::string shaderCode;
+    if (getShaderCodeFromFile("Shaders/computeSolidFill.wgsl", shaderCode) < 0)
+    {
+        throw std::runtime_error(
+            "[PIPELINES] Failed to load compute solid fill shader code from path: " +
+            (getExecutableDirectory() / "Shaders/computeSolidFill.wgsl").string()
+        );
+    }
+
+    wgpu::ShaderSourceWGSL wgsl{};
+    wgsl.code = shaderCode.c_str();
+
+    wgpu::ShaderModuleDescriptor shaderModuleDesc{};
+    shaderModuleDesc.nextInChain = &wgsl;
+    shaderModuleDesc.label = "ComputeSolidFillShaderModule";
+
+    pipelineWrapper.shaderModule = wgpuBundle.GetDevice().CreateShaderModule(&shaderModuleDesc);
+
+    // Bind Group Layout
+    wgpu::BindGroupLayoutEntry entries[9]{};
+
+    // uniform
+    entries[0].binding = 0;
+    entries[0].visibility = wgpu::ShaderStage::Compute;
+    entries[0].buffer.type = wgpu::BufferBindingType::Uniform;
+
+    // vertex buffer
+    entries[1].binding = 1;
+    entries[1].visibility = wgpu::ShaderStage::Compute;
+    entries[1].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // triangle buffer
+    entries[2].binding = 2;
+    entries[2].visibility = wgpu::ShaderStage::Compute;
+    entries[2].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // parity flips buffer (atomics)
+    entries[3].binding = 3;
+    entries[3].visibility = wgpu::ShaderStage::Compute;
+    entries[3].buffer.type = wgpu::BufferBindingType::Storage;
+
+    // occupancy buffer (atomics)
+    entries[4].binding = 4;
+    entries[4].visibility = wgpu::ShaderStage::Compute;
+    entries[4].buffer.type = wgpu::BufferBindingType::Storage;
+
+    // dense color buffer
+    entries[5].binding = 5;
+    entries[5].visibility = wgpu::ShaderStage::Compute;
+    entries[5].buffer.type = wgpu::BufferBindingType::Storage;
+
+    // candidate bits buffer
+    entries[6].binding = 6;
+    entries[6].visibility = wgpu::ShaderStage::Compute;
+    entries[6].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // candidate ranks buffer
+    entries[7].binding = 7;
+    entries[7].visibility = wgpu::ShaderStage::Compute;
+    entries[7].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // candidate bricks buffer
+    entries[8].binding = 8;
+    entries[8].visibility = wgpu::ShaderStage::Compute;
+    entries[8].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    wgpu::BindGroupLayoutDescriptor bindGroupLayoutDesc{};
+    bindGroupLayoutDesc.entryCount = 9;
+    bindGroupLayoutDesc.entries = entries;
+    pipelineWrapper.bindGroupLayout = wgpuBundle.GetDevice().CreateBindGroupLayout(&bindGroupLayoutDesc);
+
+    // Pipeline Layout
+    wgpu::PipelineLayoutDescriptor pipelineLayoutDesc{};
+    pipelineLayoutDesc.bindGroupLayoutCount = 1;
+    pipelineLayoutDesc.bindGroupLayouts = &pipelineWrapper.bindGroupLayout;
+    pipelineWrapper.pipelineLayout = wgpuBundle.GetDevice().CreatePipelineLayout(&pipelineLayoutDesc);
+
+    // Compute Pipeline, parity flips of the triangle crossings
+    wgpu::ComputePipelineDescriptor computePipelineDesc{};
+    computePipelineDesc.layout = pipelineWrapper.pipelineLayout;
+    computePipelineDesc.compute.module = pipelineWrapper.shaderModule;
+    computePipelineDesc.compute.entryPoint = "c";
+    pipelineWrapper.computePipeline = wgpuBundle.GetDevice().CreateComputePipeline(&computePipelineDesc);
+
+    // Row fill, dispatched after every flip is in
+    computePipelineDesc.compute.entryPoint = "p";
+    pipelineWrapper.secondaryComputePipeline = wgpuBundle.GetDevice().CreateComputePipeline(&computePipelineDesc);
+
+    pipelineWrapper.init = 1;
+    pipelineWrapper.AssertConsistent();
+}
+
+//================================//
+void CreateCandidateBricksPipeline(WgpuBundle& wgpuBundle, RenderPipelineWrapper& pipelineWrapper)
+{
+    pipelineWrapper.isCompute = true;
+
+    // SHADER 
+    std::string shaderCode;
+    if (getShaderCodeFromFile("Shaders/computeCandidateBricks.wgsl", shaderCode) < 0)
+    {
+        throw std::runtime_error(
+            "[PIPELINES] Failed to load compute candidate bricks shader code from path: " +
+            (getExecutableDirectory() / "Shaders/computeCandidateBricks.wgsl").string()
+        );
+    }
+
+    wgpu::ShaderSourceWGSL wgsl{};
+    wgsl.code = shaderCode.c_str();
+
+    wgpu::ShaderModuleDescriptor shaderModuleDesc{};
+    shaderModuleDesc.nextInChain = &wgsl;
+    shaderModuleDesc.label = "ComputeCandidateBricksShaderModule";
+
+    pipelineWrapper.shaderModule = wgpuBundle.GetDevice().CreateShaderModule(&shaderModuleDesc);
+
+    // Bind Group Layout
+    wgpu::BindGroupLayoutEntry entries[4]{};
+
+    // uniform
+    entries[0].binding = 0;
+    entries[0].visibility = wgpu::ShaderStage::Compute;
+    entries[0].buffer.type = wgpu::BufferBindingType::Uniform;
+
+    // vertex buffer
+    entries[1].binding = 1;
+    entries[1].visibility = wgpu::ShaderStage::Compute;
+    entries[1].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // triangle buffer
+    entries[2].binding = 2;
+    entries[2].visibility = wgpu::ShaderStage::Compute;
+    entries[2].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+
+    // candidate bits buffer (atomics)
+    entries[3].binding = 3;
+    entries[3].visibility = wgpu::ShaderStage::Compute;
+    entries[3].buffer.type = wgpu::BufferBindingType::Storage;
+
+    wgpu::BindGroupLayoutDescriptor bindGroupLayoutDesc{};
+    bindGroupLayoutDesc.entryCount = 4;
+    bindGroupLayoutDesc.entries = entries;
+    pipelineWrapper.bindGroupLayout = wgpuBundle.GetDevice().CreateBindGroupLayout(&bindGroupLayoutDesc);
+
+    // Pipeline Layout
+    wgpu::PipelineLayoutDescriptor pipelineLayoutDesc{};
+    pipelineLayoutDesc.bindGroupLayoutCount = 1;
+    pipelineLayoutDesc.bindGroupLayouts = &pipelineWrapper.bindGroupLayout;
+    pipelineWrapper.pipelineLayout = wgpuBundle.GetDevice().CreatePipelineLayout(&pipelineLayoutDesc);
+
+    // Compute Pipeline
+    wgpu::ComputePipelineDescriptor computePipelineDesc{};
+    computePipelineDesc.layout = pipelineWrapper.pipelineLayout;
+    computePipelineDesc.compute.module = pipelineWrapper.shaderModule;
+    computePipelineDesc.compute.entryPoint = "c";
+    pipelineWrapper.computePipeline = wgpuBundle.GetDevice().CreateComputePipeline(&computePipelineDesc);
+
+    pipelineWrapper.init = 1;
+    pipelineWrapper.AssertConsistent();
+}
@@ -1,8 +1,11 @@
+#define _USE_MATH_DEFINES
+#include <cmath>
 #include "../../includes/Rendering/RenderEngine.hpp"
 #include <iostream>
 #include "../../includes/constants.hpp"
 #include <time.h>
 #include <numeric>
+#include <cstdio>
 
 //================================//
 void RenderEngine::InitImGui()
@@ -49,13 +52,15 @@ void RenderEngine::RenderImGui(wgpu::RenderPassEncoder& pass)
     ImGui::Begin("Voxel Controls");
 
     ImGui::Text("Voxel Resolution: %d", this->GetVoxelResolution());
+    if (this->voxelManager->IsRebuildingGrid())
+        ImGui::Text("Rebuilding grid...");
     ImGui::Separator();
 
     ImGui::InputInt("##VoxelResolutionInput", &resolutionDigitBoxValue);
     if (ImGui::IsItemDeactivatedAfterEdit() && resolutionDigitBoxValue != previousResolutionValue)
         onResolutionValueChanged(resolutionDigitBoxValue);
 
-    ImGui::SliderInt("Voxel resolution", &resolutionSliderValue, 1, 2048);
+    ImGui::SliderInt("Voxel resolution", &resolutionSliderValue, 1, static_cast<int>(MAX_BRICK_RESOLUTION * 8));
     if (ImGui::IsItemDeactivatedAfterEdit() && resolutionSliderValue != previousResolutionValue)
         onResolutionValueChanged(resolutionSliderValue);
 
@@ -71,6 +76,20 @@ void RenderEngine::RenderImGui(wgpu::RenderPassEncoder& pass)
     if (ImGui::IsItemDeactivatedAfterEdit() && visibleBricksSliderValue != previousVisibleBricksValue)
         onVisibleBricksValueChanged(visibleBricksSliderValue);
 
+    ImGui::Separator();
+    const ColorFormat currentColorFormat = this->voxelManager->GetColorFormat();
+    if (ImGui::BeginCombo("Color format", ColorFormatName(currentColorFormat)))
+    {
+        for (uint32_t i = 0; i < NUM_COLOR_FORMATS; ++i)
+        {
+            const ColorFormat format = static_cast<ColorFormat>(i);
+            if (ImGui::Selectable(ColorFormatName(format), format == currentColorFormat) && format != currentColorFormat)
+                this->voxelManager->ChangeColorFormat(*this->wgpuBundle, format);
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::Text("Color bytes per brick: %u", ColorBytesPerBrick(currentColorFormat));
+
     ImGui::Separator();
     ImGui::Text("Flip Axes:");
     if (ImGui::Checkbox("Flip X Axis", reinterpret_cast<bool*>(&flipXCheckbox)))
@@ -89,6 +108,80 @@ void RenderEngine::RenderImGui(wgpu::RenderPassEncoder& pass)
     ImGui::Text("GPU Blit Time: %.3f ms", this->gpuFrameTimeBlitMs);
     ImGui::Separator();
 
+    StreamingBudget& budget = this->voxelManager->streamingBudget;
+    ImGui::Text("Streaming Budget: %s", budget.GetDecisionName());
+    float targetFrameMs = budget.GetTargetFrameMs();
+    if (ImGui::SliderFloat("Target frame time (ms)", &targetFrameMs, 4.0f, 50.0f))
+        budget.SetTargetFrameMs(targetFrameMs);
+    ImGui::Text("Disk reads / frame: %u (queue depth %u)", budget.GetMaxDiskReads(), budget.GetDiskQueueDepth());
+    ImGui::Text("Decoded bricks / frame: %u", budget.GetMaxReadyBricks());
+    ImGui::Text("Uploads / frame: %u (%.4f ms per brick)", budget.GetMaxUploads(), budget.GetUploadCostPerBrickMs());
+    ImGui::Separator();
+
+    ImGui::Text("Editing:");
+    ImGui::SliderFloat("Brush radius", &brushRadius, 0.5f, 64.0f);
+    ImGui::SliderFloat("Brush distance", &brushDistance, 0.0f, 512.0f);
+    ImGui::ColorEdit3("Brush color", brushColor);
+    {
+        // Brush center in storage space, flipped axes are mirrored like the rays
+        Eigen::Vector3f forward = (this->camera->RotationMatrix() * Eigen::Vector4f(0, 0, 1, 0)).head<3>().normalized();
+        Eigen::Vector3f center = this->camera->GetPosition() + forward * brushDistance;
+        const float gridMax = static_cast<float>(this->GetVoxelResolution());
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (this->flipBits & (1u << axis))
+                center[axis] = gridMax - center[axis];
+        }
+
+        ColorRGB color = {
+            static_cast<uint8_t>(brushColor[0] * 255.0f),
+            static_cast<uint8_t>(brushColor[1] * 255.0f),
+            static_cast<uint8_t>(brushColor[2] * 255.0f),
+            0
+        };
+
+        if (ImGui::Button("Add sphere"))
+            this->voxelManager->EditSphere(center, brushRadius, VoxelEditOp::Set, color);
+        ImGui::SameLine();
+        if (ImGui::Button("Remove sphere"))
+            this->voxelManager->EditSphere(center, brushRadius, VoxelEditOp::Clear);
+        ImGui::SameLine();
+        if (ImGui::Button("Paint sphere"))
+            this->voxelManager->EditSphere(center, brushRadius, VoxelEditOp::Paint, color);
+    }
+    ImGui::Text("Edited bricks: %u", this->voxelManager->editedBrickCount);
+    if (this->editSavePath[0] == '\0')
+    {
+        // The streamed file itself cannot be overwritten, edits default to a copy next to it
+        const std::string& loadedFilename = this->voxelManager->GetLoadedFilename();
+        std::string defaultPath = "data/edited_voxel.vox";
+        const size_t extension = loadedFilename.find_last_of('.');
+        if (!loadedFilename.empty())
+            defaultPath = loadedFilename.substr(0, extension) + "_edited.vox";
+        std::snprintf(this->editSavePath, sizeof(this->editSavePath), "%s", defaultPath.c_str());
+    }
+    ImGui::InputText("Save path", this->editSavePath, sizeof(this->editSavePath));
+    if (ImGui::Button("Save edits"))
+        this->voxelManager->SaveToFile(this->editSavePath);
+    ImGui::Separator();
+
+    ImGui::SliderFloat("Coarse LOD threshold (px)", &coarseThresholdPixels, 0.0f, 8.0f);
+    ImGui::Separator();
+
+    ImGui::Text("Shared bricks: %u", this->voxelManager->sharedBrickCount);
+    ImGui::Text("Uniform bricks: %u", this->voxelManager->uniformBrickCount);
+    if (this->voxelManager->GetHasColor())
+    {
+        const ColorPoolAllocator& colorAllocator = this->voxelManager->GetColorAllocator();
+        const double toMB = sizeof(uint32_t) / (1024.0 * 1024.0);
+        ImGui::Text("Color pool: %.1f / %.1f MB (%.1f MB free listed)", colorAllocator.GetUsedWords() * toMB, colorAllocator.GetCapacityWords() * toMB, colorAllocator.GetFreeListWords() * toMB);
+        ImGui::Text("Color pool defragmentations: %u", this->voxelManager->colorPoolDefragCount);
+    }
+#ifdef SKYEGRID_COUNT_ALLOCATIONS
+    ImGui::Text("Frame loop allocations: %llu", static_cast<unsigned long long>(this->voxelManager->GetFrameAllocations()));
+#endif
+    ImGui::Separator();
+
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
     ImGui::End();
 
@@ -99,17 +192,8 @@ void RenderEngine::RenderImGui(wgpu::RenderPassEncoder& pass)
 //================================//
 void RenderEngine::onResolutionValueChanged(int newResolution)
 {
-    // Change only resolution
+    // Change only resolution, the grid is rebuilt in the background and swapped in by Render
     this->voxelManager->ChangeVoxelResolution(*this->wgpuBundle, newResolution);
-    this->resolutionSliderValue = this->voxelManager->GetVoxelResolution();
-    this->visibleBricksSliderValue = this->voxelManager->GetMaxVisibleBricks();
-    this->visibleBricksDigitBoxValue = this->visibleBricksSliderValue;
-    this->resolutionDigitBoxValue = this->resolutionSliderValue;
-
-    // recreate bind groups (needed)
-    this->resizePending = true;
-    this->voxelManager->createUploadBindGroup(this->computeUploadVoxelPipeline, *this->wgpuBundle);
-
     this->previousResolutionValue = newResolution;
 }
 
@@ -118,16 +202,21 @@ void RenderEngine::onVisibleBricksValueChanged(int newMaxVisibleBricks)
 {
     // Change only max visible bricks
     this->voxelManager->ChangeVoxelResolution(*this->wgpuBundle, this->GetVoxelResolution(), newMaxVisibleBricks);
-    this->visibleBricksSliderValue = this->voxelManager->GetMaxVisibleBricks();
+    this->previousVisibleBricksValue = newMaxVisibleBricks;
+}
+
+//================================//
+void RenderEngine::onGridRebuilt()
+{
+    // Show the clamped values
     this->resolutionSliderValue = this->voxelManager->GetVoxelResolution();
-    this->visibleBricksDigitBoxValue = this->visibleBricksSliderValue;
+    this->visibleBricksSliderValue = this->voxelManager->GetMaxVisibleBricks();
     this->resolutionDigitBoxValue = this->resolutionSliderValue;
+    this->visibleBricksDigitBoxValue = this->visibleBricksSliderValue;
 
     // recreate bind groups (needed)
     this->resizePending = true;
     this->voxelManager->createUploadBindGroup(this->computeUploadVoxelPipeline, *this->wgpuBundle);
-
-    this->previousVisibleBricksValue = newMaxVisibleBricks;
 }
 
 //================================//
@@ -167,7 +256,8 @@ void RenderEngine::RebuildVoxelPipelineResources(const RenderInfo& renderInfo)
     // Compute pipeline bind group
     // Bind Group
     this->computeVoxelPipeline.bindGroup = nullptr;
-    std::vector<wgpu::BindGroupEntry> entries(10);
+    const uint32_t numColorPools = this->voxelManager->GetMaxColorPools();
+    std::vector<wgpu::BindGroupEntry> entries(COMPUTE_VOXEL_COLOR_POOL_BINDING + numColorPools);
 
     entries[0].binding = 0;
     entries[0].textureView = this->computeVoxelPipeline.associatedTextureViews[0];
@@ -177,7 +267,7 @@ void RenderEngine::RebuildVoxelPipelineResources(const RenderInfo& renderInfo)
     entries[1].offset = 0;
     entries[1].size = this->computeVoxelPipeline.uniformSizes[0];
 
-    // Brick grid
+    // Brick grid page pool
     entries[2].binding = 2;
     entries[2].buffer = this->voxelManager->brickGridBuffer;
     entries[2].offset = 0;
@@ -201,19 +291,39 @@ void RenderEngine::RebuildVoxelPipelineResources(const RenderInfo& renderInfo)
     entries[5].offset = 0;
     entries[5].size = this->voxelManager->feedbackIndicesBuffer.GetSize();
 
-    // Color pool
-    for (int i = 0; i < MAX_COLOR_POOLS; ++i)
-    {
-        entries[6 + i].binding = 6 + i;
-        entries[6 + i].buffer = this->voxelManager->colorPoolBuffers[i];
-        entries[6 + i].offset = 0;
-        entries[6 + i].size = this->voxelManager->colorPoolBuffers[i].GetSize();
-    }
-
+    // Brick request flags
+    entries[6].binding = 6;
+    entries[6].buffer = this->voxelManager->brickRequestFlagsBuffer;
+    entries[6].offset = 0;
+    entries[6].size = this->voxelManager->brickRequestFlagsBuffer.GetSize();
+
+    // Brick page table
+    entries[7].binding = 7;
+    entries[7].buffer = this->voxelManager->brickPageTableBuffer;
+    entries[7].offset = 0;
+    entries[7].size = this->voxelManager->brickPageTableBuffer.GetSize();
+
+    // Brick color offsets
+    entries[8].binding = 8;
+    entries[8].buffer = this->voxelManager->brickColorOffsetsBuffer;
+    entries[8].offset = 0;
+    entries[8].size = this->voxelManager->brickColorOffsetsBuffer.GetSize();
+
+    // Brick coarse levels
     entries[9].binding = 9;
-    entries[9].buffer = this->voxelManager->brickRequestFlagsBuffer;
+    entries[9].buffer = this->voxelManager->brickCoarseBuffer;
     entries[9].offset = 0;
-    entries[9].size = this->voxelManager->brickRequestFlagsBuffer.GetSize();
+    entries[9].size = this->voxelManager->brickCoarseBuffer.GetSize();
+
+    // Color pools
+    for (uint32_t i = 0; i < numColorPools; ++i)
+    {
+        const uint32_t binding = COMPUTE_VOXEL_COLOR_POOL_BINDING + i;
+        entries[binding].binding = binding;
+        entries[binding].buffer = this->voxelManager->colorPoolBuffers[i];
+        entries[binding].offset = 0;
+        entries[binding].size = this->voxelManager->colorPoolBuffers[i].GetSize();
+    }
 
     wgpu::BindGroupDescriptor bindGroupDesc{};
     bindGroupDesc.layout = this->computeVoxelPipeline.bindGroupLayout;
@@ -242,6 +352,10 @@ void RenderEngine::Render(void* userData)
     if (renderInfo.resizeNeeded)
         this->resizePending = true;
 
+    // Swap in a grid rebuilt in the background, before anything binds the dynamic buffers
+    if (this->voxelManager->pollGridRebuild(*this->wgpuBundle))
+        this->onGridRebuilt();
+
     if (this->resizePending) // resizePending is true on start, so on first frame call
     {
         this->resizePending = false;
@@ -272,7 +386,13 @@ void RenderEngine::Render(void* userData)
     // PROCESS ASYNC OPERATIONS
     wgpu::Instance instance = this->wgpuBundle->GetInstance();
     this->voxelManager->processAsyncOperations(instance);
+    this->voxelManager->updateStreamingBudget(
+        this->gpuFrameTimeUploadMs,
+        this->gpuFrameTimeUploadMs + this->gpuFrameTimeRayTraceMs + this->gpuFrameTimeBlitMs,
+        this->cpuFrameTimeMS
+    );
     this->voxelManager->startOfFrame();
+    this->voxelManager->updatePrefetch(*this->camera, renderInfo.time, this->flipBits);
 
     wgpu::TextureView swapchainView = currentTexture.texture.CreateView();
 
@@ -289,12 +409,16 @@ void RenderEngine::Render(void* userData)
 
     // Upload pass
     const uint32_t uploadCount = this->voxelManager->pendingUploadCount;
+    const uint32_t pointerUpdateCount = this->voxelManager->pendingPointerUpdateCount;
     this->computeUploadVoxelPipeline.AssertConsistent();
     {
         UploadUniform uploadUniform{};
         uploadUniform.uploadCount = uploadCount;
         uploadUniform.maxColorBufferSize = this->voxelManager->maxColorBufferEntries;
         uploadUniform.hasColor = this->voxelManager->GetHasColor() ? 1 : 0;
+        uploadUniform.colorFormat = static_cast<uint32_t>(this->voxelManager->GetColorFormat());
+        uploadUniform.colorWordsPerBrick = ColorWordsPerBrick(this->voxelManager->GetColorFormat());
+        uploadUniform.pointerUpdateCount = pointerUpdateCount;
 
         // Write uniform
         queue.WriteBuffer(
@@ -325,6 +449,13 @@ void RenderEngine::Render(void* userData)
             pass.DispatchWorkgroups(dispatchX, 1, 1);
         }
 
+        // Grid pointers last, so a brick is never visible before its data
+        if (pointerUpdateCount > 0)
+        {
+            pass.SetPipeline(this->computeUploadVoxelPipeline.secondaryComputePipeline);
+            pass.DispatchWorkgroups((pointerUpdateCount + 127) / 128, 1, 1);
+        }
+
         pass.End();
     }
 
@@ -340,6 +471,10 @@ void RenderEngine::Render(void* userData)
         voxelParams.time = static_cast<float>(renderInfo.time);
         voxelParams.hasColor = this->voxelManager->GetHasColor() ? 1 : 0;
         voxelParams.flip = this->flipBits;
+        voxelParams.colorFormat = static_cast<uint32_t>(this->voxelManager->GetColorFormat());
+        voxelParams.colorWordsPerBrick = ColorWordsPerBrick(this->voxelManager->GetColorFormat());
+        voxelParams.pixelSpread = 2.0f * std::tan(this->camera->GetFov() * static_cast<float>(M_PI) / 360.0f) / std::max(this->camera->GetExtent().y(), 1.0f);
+        voxelParams.coarseThresholdPixels = this->coarseThresholdPixels;
 
         queue.WriteBuffer(
             this->computeVoxelPipeline.associatedUniforms[0],
@@ -186,4 +186,12 @@ void WgpuBundle::SafeCreateBuffer(const wgpu::BufferDescriptor* descriptor, wgpu
         std::cout << "[WgpuBundle] Failed to create buffer of size " << bufferRequestedSize << "." << std::endl;
         throw std::runtime_error("[WgpuBundle] Failed to create buffer.");
     }
+}
+
+//================================//
+void WgpuBundle::ReuseOrCreateBuffer(const wgpu::BufferDescriptor* descriptor, wgpu::Buffer& outBuffer)
+{
+    if (outBuffer && outBuffer.GetUsage() == descriptor->usage && outBuffer.GetSize() >= descriptor->size)
+        return;
+    this->SafeCreateBuffer(descriptor, outBuffer);
 }
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "../includes/StagingRing.hpp"
+#include <iostream>
+
+//================================//
+void StagingRing::Init(WgpuBundle& wgpuBundle, uint64_t chunkSize, uint32_t numChunks, const std::string& label)
+{
+    this->chunkSize = chunkSize;
+    this->chunks.clear();
+    this->chunks.resize(numChunks);
+    this->frameChunks.clear();
+    this->frameChunks.reserve(numChunks);
+    this->head = 0;
+
+    for (uint32_t i = 0; i < numChunks; ++i)
+    {
+        const std::string chunkLabel = label + " " + std::to_string(i);
+
+        wgpu::BufferDescriptor desc{};
+        desc.size = chunkSize;
+        desc.usage = wgpu::BufferUsage::MapWrite | wgpu::BufferUsage::CopySrc;
+        desc.label = chunkLabel.c_str();
+        desc.mappedAtCreation = true; // SO ALL CHUNKS ARE AVAILABLE INITIALLY
+        wgpuBundle.SafeCreateBuffer(&desc, this->chunks[i].buffer);
+
+        this->chunks[i].state = StagingChunkState::Mapped;
+        this->chunks[i].mappedData = static_cast<uint8_t*>(this->chunks[i].buffer.GetMappedRange(0, chunkSize));
+        this->chunks[i].cursor = 0;
+    }
+}
+
+//================================//
+void* StagingRing::Allocate(uint64_t size)
+{
+    size = (size + 3) & ~uint64_t(3); // Copies need 4 byte alignment
+    if (size > this->chunkSize || this->chunks.empty())
+        return nullptr;
+
+    const uint32_t numChunks = static_cast<uint32_t>(this->chunks.size());
+    for (uint32_t tried = 0; tried < numChunks; ++tried)
+    {
+        StagingChunk& chunk = this->chunks[this->head];
+
+        if (chunk.state == StagingChunkState::Mapped && chunk.mappedData && chunk.cursor + size <= this->chunkSize)
+        {
+            if (chunk.cursor == 0)
+                this->frameChunks.push_back(this->head);
+
+            void* ptr = chunk.mappedData + chunk.cursor;
+            chunk.cursor += size;
+            return ptr;
+        }
+
+        // Chunk is full or the GPU still uses it, skip to the next one
+        this->head = (this->head + 1) % numChunks;
+    }
+
+    return nullptr;
+}
+
+//================================//
+uint64_t StagingRing::Flush(const wgpu::CommandEncoder& encoder, const wgpu::Buffer& dst, uint64_t dstOffset)
+{
+    uint64_t copied = 0;
+    for (uint32_t chunkIndex : this->frameChunks)
+    {
+        StagingChunk& chunk = this->chunks[chunkIndex];
+
+        // Unmap the chunk before using it in a copy
+        chunk.buffer.Unmap();
+        chunk.mappedData = nullptr;
+        chunk.state = StagingChunkState::Submitted; // Will be re-mapped by RemapSubmitted
+
+        encoder.CopyBufferToBuffer(chunk.buffer, 0, dst, dstOffset + copied, chunk.cursor);
+        copied += chunk.cursor;
+        chunk.cursor = 0;
+    }
+
+    // Next frame starts after the last chunk written, so chunks are reused in submission order
+    if (!this->frameChunks.empty())
+        this->head = (this->frameChunks.back() + 1) % static_cast<uint32_t>(this->chunks.size());
+    this->frameChunks.clear();
+
+    return copied;
+}
+
+//================================//
+void StagingRing::RemapSubmitted()
+{
+    for (StagingChunk& chunk : this->chunks)
+    {
+        if (chunk.state != StagingChunkState::Submitted)
+            continue;
+
+        chunk.state = StagingChunkState::MappingInFlight;
+
+        // The map only completes once the GPU finished the copy reading from this chunk
+        chunk.buffer.MapAsync(
+            wgpu::MapMode::Write,
+            0,
+            this->chunkSize,
+            wgpu::CallbackMode::AllowProcessEvents,
+            [](wgpu::MapAsyncStatus status, wgpu::StringView message, StagingChunk* chunk) {
+                if (status == wgpu::MapAsyncStatus::Success)
+                {
+                    chunk->mappedData = static_cast<uint8_t*>(chunk->buffer.GetMappedRange());
+                    chunk->cursor = 0;
+                    chunk->state = StagingChunkState::Mapped;
+                }
+                else
+                {
+                    chunk->state = StagingChunkState::Submitted; // Try again next frame
+                    std::cerr << "[StagingRing] Staging chunk map failed: " << message << std::endl;
+                }
+            },
+            &chunk
+        );
+    }
+}
+
+//================================//
+uint32_t StagingRing::GetNumMappedChunks() const
+{
+    uint32_t count = 0;
+    for (const StagingChunk& chunk : this->chunks)
+    {
+        if (chunk.state == StagingChunkState::Mapped)
+            count++;
+    }
+    return count;
+}
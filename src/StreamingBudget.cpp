@@ -0,0 +1,87 @@
+#include "../includes/StreamingBudget.hpp"
+#include <algorithm>
+
+//================================//
+StreamingBudget::StreamingBudget(uint32_t initialDiskReads, uint32_t initialReadyBricks, uint32_t initialUploads, uint32_t maxUploads)
+    : diskReads(static_cast<float>(initialDiskReads)),
+      readyBricks(static_cast<float>(initialReadyBricks)),
+      uploads(static_cast<float>(initialUploads)),
+      maxUploads(static_cast<float>(maxUploads))
+{
+}
+
+//================================//
+void StreamingBudget::SetTargetFrameMs(float targetMs)
+{
+    this->targetFrameMs = std::max(targetMs, 1.0f);
+}
+
+//================================//
+void StreamingBudget::Update(float gpuUploadMs, float gpuFrameMs, float cpuFrameMs, uint32_t diskQueueDepth, uint32_t uploadedLastFrame)
+{
+    const float smoothing = 0.2f;
+    const float increaseStep = 16.0f;
+    const float decreaseFactor = 0.75f;
+
+    this->diskQueueDepth = diskQueueDepth;
+
+    // Upload pass cost per brick, the GPU timings are already averaged over a few frames
+    this->smoothedUploadMs += smoothing * (gpuUploadMs - this->smoothedUploadMs);
+    this->smoothedUploadCount += smoothing * (static_cast<float>(uploadedLastFrame) - this->smoothedUploadCount);
+    if (this->smoothedUploadCount > 1.0f && this->smoothedUploadMs > 0.0f)
+        this->uploadCostPerBrickMs = this->smoothedUploadMs / this->smoothedUploadCount;
+
+    const float frameMs = std::max(gpuFrameMs, cpuFrameMs);
+
+    if (frameMs > this->targetFrameMs * 1.05f)
+    {
+        this->decision = StreamingDecision::Decrease;
+        this->diskReads *= decreaseFactor;
+        this->readyBricks *= decreaseFactor;
+        this->uploads *= decreaseFactor;
+    }
+    else if (frameMs < this->targetFrameMs * 0.85f)
+    {
+        // More reads would only wait in the queue if the disk is already behind,
+        // but decoding and uploading what is there is still fine
+        if (static_cast<float>(diskQueueDepth) > this->diskReads * 2.0f)
+        {
+            this->decision = StreamingDecision::DiskBound;
+        }
+        else
+        {
+            this->decision = StreamingDecision::Increase;
+            this->diskReads += increaseStep;
+        }
+        this->readyBricks += increaseStep;
+        this->uploads += increaseStep;
+    }
+    else
+    {
+        this->decision = StreamingDecision::Hold;
+    }
+
+    // Never let the upload pass alone take more than its share of the frame
+    if (this->uploadCostPerBrickMs > 0.0f)
+    {
+        const float uploadsInShare = (STREAMING_UPLOAD_SHARE * this->targetFrameMs) / this->uploadCostPerBrickMs;
+        this->uploads = std::min(this->uploads, std::max(uploadsInShare, static_cast<float>(STREAMING_MIN_UPLOADS)));
+    }
+
+    this->diskReads = std::clamp(this->diskReads, static_cast<float>(STREAMING_MIN_DISK_READS), static_cast<float>(STREAMING_MAX_DISK_READS));
+    this->readyBricks = std::clamp(this->readyBricks, static_cast<float>(STREAMING_MIN_READY_BRICKS), static_cast<float>(STREAMING_MAX_READY_BRICKS));
+    this->uploads = std::clamp(this->uploads, static_cast<float>(STREAMING_MIN_UPLOADS), this->maxUploads);
+}
+
+//================================//
+const char* StreamingBudget::GetDecisionName() const
+{
+    switch (this->decision)
+    {
+        case StreamingDecision::Hold:      return "Hold";
+        case StreamingDecision::Increase:  return "Increase";
+        case StreamingDecision::Decrease:  return "Decrease";
+        case StreamingDecision::DiskBound: return "Disk bound";
+    }
+    return "Unknown";
+}
@@ -0,0 +1,193 @@
+#include "../includes/TextureArray.hpp"
+#include <cmath>
+#include <iostream>
+
+//================================//
+// Texels as RGBA8, gray and gray alpha images are expanded
+static std::vector<uint8_t> ToRGBA(const TextureInfo& texture)
+{
+    const size_t numTexels = static_cast<size_t>(texture.width) * texture.height;
+    std::vector<uint8_t> rgba(numTexels * 4, 255);
+    for (size_t i = 0; i < numTexels; i++)
+    {
+        const unsigned char* texel = texture.data + i * texture.channels;
+        if (texture.channels >= 3)
+        {
+            for (int channel = 0; channel < 3; channel++)
+                rgba[i * 4 + channel] = texel[channel];
+            if (texture.channels == 4)
+                rgba[i * 4 + 3] = texel[3];
+        }
+        else if (texture.channels >= 1)
+        {
+            rgba[i * 4 + 0] = texel[0];
+            rgba[i * 4 + 1] = texel[0];
+            rgba[i * 4 + 2] = texel[0];
+            if (texture.channels == 2)
+                rgba[i * 4 + 3] = texel[1];
+        }
+    }
+    return rgba;
+}
+
+//================================//
+// Bilinear RGBA at texel coordinates, texel centers at half integers, repeat addressing
+static void BilinearRepeat(const uint8_t* image, int width, int height, float x, float y, float out[4])
+{
+    x -= 0.5f;
+    y -= 0.5f;
+    float x0f = std::floor(x);
+    float y0f = std::floor(y);
+    float fx = x - x0f;
+    float fy = y - y0f;
+
+    int x0 = static_cast<int>(x0f) % width;
+    int y0 = static_cast<int>(y0f) % height;
+    if (x0 < 0) x0 += width;
+    if (y0 < 0) y0 += height;
+    int x1 = (x0 + 1) % width;
+    int y1 = (y0 + 1) % height;
+
+    const uint8_t* t00 = &image[(static_cast<size_t>(y0) * width + x0) * 4];
+    const uint8_t* t10 = &image[(static_cast<size_t>(y0) * width + x1) * 4];
+    const uint8_t* t01 = &image[(static_cast<size_t>(y1) * width + x0) * 4];
+    const uint8_t* t11 = &image[(static_cast<size_t>(y1) * width + x1) * 4];
+
+    for (int channel = 0; channel < 4; channel++)
+    {
+        float top = t00[channel] + (t10[channel] - t00[channel]) * fx;
+        float bottom = t01[channel] + (t11[channel] - t01[channel]) * fx;
+        out[channel] = top + (bottom - top) * fy;
+    }
+}
+
+//================================//
+void TextureArray::Build(const std::vector<TextureInfo>& textures)
+{
+    this->width = 1;
+    this->height = 1;
+    this->numLayers = std::max(static_cast<uint32_t>(textures.size()), 1u);
+    this->levels.clear();
+
+    for (const TextureInfo& texture : textures)
+    {
+        if (!texture.hasTexture)
+            continue;
+        this->width = std::max(this->width, static_cast<uint32_t>(texture.width));
+        this->height = std::max(this->height, static_cast<uint32_t>(texture.height));
+    }
+    this->width = std::min(this->width, TEXTURE_ARRAY_MAX_SIZE);
+    this->height = std::min(this->height, TEXTURE_ARRAY_MAX_SIZE);
+    while (static_cast<uint64_t>(this->width) * this->height * 4 * this->numLayers > TEXTURE_ARRAY_MAX_BYTES && (this->width > 1 || this->height > 1))
+    {
+        this->width = std::max(this->width / 2, 1u);
+        this->height = std::max(this->height / 2, 1u);
+    }
+
+    // Level 0, the textures of another size are resampled
+    const size_t layerBytes = static_cast<size_t>(this->width) * this->height * 4;
+    this->levels.emplace_back(layerBytes * this->numLayers, 255);
+    for (uint32_t layer = 0; layer < textures.size(); layer++)
+    {
+        const TextureInfo& texture = textures[layer];
+        if (!texture.hasTexture)
+            continue;
+
+        uint8_t* dst = this->levels[0].data() + layerBytes * layer;
+        std::vector<uint8_t> rgba = ToRGBA(texture);
+        if (static_cast<uint32_t>(texture.width) == this->width && static_cast<uint32_t>(texture.height) == this->height)
+        {
+            std::copy(rgba.begin(), rgba.end(), dst);
+            continue;
+        }
+
+        const float scaleX = static_cast<float>(texture.width) / this->width;
+        const float scaleY = static_cast<float>(texture.height) / this->height;
+        for (uint32_t y = 0; y < this->height; y++)
+        {
+            for (uint32_t x = 0; x < this->width; x++)
+            {
+                float texel[4];
+                BilinearRepeat(rgba.data(), texture.width, texture.height, (x + 0.5f) * scaleX, (y + 0.5f) * scaleY, texel);
+                for (int channel = 0; channel < 4; channel++)
+                    dst[(static_cast<size_t>(y) * this->width + x) * 4 + channel] = static_cast<uint8_t>(std::clamp(texel[channel] + 0.5f, 0.0f, 255.0f));
+            }
+        }
+        std::cout << "[TextureArray] Resampled " << texture.name << " from " << texture.width << "x" << texture.height
+                  << " to " << this->width << "x" << this->height << std::endl;
+    }
+
+    this->generateMips();
+}
+
+//================================//
+// Box filtered levels down to 1x1, odd sides repeat their last texel
+void TextureArray::generateMips()
+{
+    uint32_t numLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(this->width, this->height)))) + 1;
+    for (uint32_t level = 1; level < numLevels; level++)
+    {
+        const uint32_t srcWidth = this->GetMipWidth(level - 1);
+        const uint32_t srcHeight = this->GetMipHeight(level - 1);
+        const uint32_t dstWidth = this->GetMipWidth(level);
+        const uint32_t dstHeight = this->GetMipHeight(level);
+        const size_t srcLayerBytes = static_cast<size_t>(srcWidth) * srcHeight * 4;
+        const size_t dstLayerBytes = static_cast<size_t>(dstWidth) * dstHeight * 4;
+
+        std::vector<uint8_t> mip(dstLayerBytes * this->numLayers);
+        const std::vector<uint8_t>& previous = this->levels[level - 1];
+        for (uint32_t layer = 0; layer < this->numLayers; layer++)
+        {
+            const uint8_t* src = previous.data() + srcLayerBytes * layer;
+            uint8_t* dst = mip.data() + dstLayerBytes * layer;
+            for (uint32_t y = 0; y < dstHeight; y++)
+            {
+                const uint32_t y0 = std::min(y * 2, srcHeight - 1);
+                const uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+                for (uint32_t x = 0; x < dstWidth; x++)
+                {
+                    const uint32_t x0 = std::min(x * 2, srcWidth - 1);
+                    const uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+                    for (int channel = 0; channel < 4; channel++)
+                    {
+                        uint32_t sum = src[(static_cast<size_t>(y0) * srcWidth + x0) * 4 + channel]
+                                     + src[(static_cast<size_t>(y0) * srcWidth + x1) * 4 + channel]
+                                     + src[(static_cast<size_t>(y1) * srcWidth + x0) * 4 + channel]
+                                     + src[(static_cast<size_t>(y1) * srcWidth + x1) * 4 + channel];
+                        dst[(static_cast<size_t>(y) * dstWidth + x) * 4 + channel] = static_cast<uint8_t>((sum + 2) / 4);
+                    }
+                }
+            }
+        }
+        this->levels.push_back(std::move(mip));
+    }
+}
+
+//================================//
+uint32_t TextureArray::Sample(uint32_t layer, float u, float v, float lod) const
+{
+    layer = std::min(layer, this->numLayers - 1);
+    lod = std::clamp(lod, 0.0f, static_cast<float>(this->GetMipCount() - 1));
+    const uint32_t level0 = static_cast<uint32_t>(lod);
+    const uint32_t level1 = std::min(level0 + 1, this->GetMipCount() - 1);
+    const float blend = lod - static_cast<float>(level0);
+
+    float colors[2][4];
+    const uint32_t sampledLevels[2] = {level0, level1};
+    for (int i = 0; i < 2; i++)
+    {
+        const uint32_t mipWidth = this->GetMipWidth(sampledLevels[i]);
+        const uint32_t mipHeight = this->GetMipHeight(sampledLevels[i]);
+        const uint8_t* image = this->levels[sampledLevels[i]].data() + static_cast<size_t>(mipWidth) * mipHeight * 4 * layer;
+        BilinearRepeat(image, mipWidth, mipHeight, (u - std::floor(u)) * mipWidth, (v - std::floor(v)) * mipHeight, colors[i]);
+    }
+
+    uint32_t packed = 0;
+    for (int channel = 0; channel < 3; channel++)
+    {
+        float value = (colors[0][channel] + (colors[1][channel] - colors[0][channel]) * blend) / 255.0f;
+        uint32_t quantized = static_cast<uint32_t>(std::clamp(value * 255.0f, 0.0f, 255.0f));
+        packed |= (quantized & 0xFF) << (channel * 8);
+    }
+    return packed;
+}
@@ -1,25 +1,12 @@
 #include "../includes/VoxelManager.hpp"
 #include "../includes/constants.hpp"
+#include "../includes/ColorEncoding.hpp"
 #include <iostream>
 #include <bitset>
+#include <bit>
 #include <string>
 #include <fstream>
 
-//================================//
-// STRUCTS
-//================================//
-struct UploadMapCallbackContext 
-{
-    VoxelManager* voxelManager;
-    int slotIndex;
-};
-
-struct FeedbackMapCallbackContext 
-{
-    VoxelManager* voxelManager;
-    int slotIndex;
-};
-
 //================================//
 // HELPER FUNCTIONS
 //================================//
@@ -39,6 +26,16 @@ static uint32_t PackResident(uint32_t index)
     return  (index & 0x00FFFFFFu) | (1u << 31); // Set resident flag
 }
 
+//================================//
+static uint32_t PackUniform(ColorRGB c)
+{
+    // A solid brick of a single color needs no pool slot, the color goes in [23:0] and uniform [28] = 1
+    return  (uint32_t(c.r)      |
+            (uint32_t(c.g) << 8)  |
+            (uint32_t(c.b) << 16) |
+            (1u << 28));              // Set uniform flag
+}
+
 //================================//
 static uint32_t PackEmptyPointer()
 {
@@ -46,12 +43,80 @@ static uint32_t PackEmptyPointer()
 }
 
 //================================//
-void VoxelManager::validateResolution(WgpuBundle& bundle, int resolution, int maxVisibleBricks)
+// The file stores colors densely, only for the occupied voxels in voxel order, we expand them to the 512 voxels
+static void DecodeDiskBrick(const brickDataEntry& diskData, uint32_t occupancy[16], ColorRGB colors[512])
 {
+    std::memcpy(occupancy, diskData.occupancy, 16 * sizeof(uint32_t));
+
+    size_t colorIndex = 0;
+    for (int z = 0; z < 8 && colorIndex < diskData.colors.size(); ++z)
+    {
+        uint32_t firstSliceHalf = diskData.occupancy[2 * z];
+        uint32_t secondSliceHalf = diskData.occupancy[2 * z + 1];
+        uint64_t slice = (static_cast<uint64_t>(secondSliceHalf) << 32) | static_cast<uint64_t>(firstSliceHalf);
+
+        for (int bit = 0; bit < 64 && slice != 0; bit++)
+        {
+            if (slice & (1ull << bit)) // VOXEL OCCUPIED
+            {
+                int voxelIndex = z * 64 + bit;
+                if (colorIndex < diskData.colors.size())
+                {
+                    colors[voxelIndex].r = diskData.colors[colorIndex].r;
+                    colors[voxelIndex].g = diskData.colors[colorIndex].g;
+                    colors[voxelIndex].b = diskData.colors[colorIndex].b;
+                    colors[voxelIndex]._pad = 0;
+                    ++colorIndex;
+                }
+            }
+        }
+    }
+}
+
+//================================//
+static bool SameColor(ColorRGB a, ColorRGB b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+//================================//
+static uint64_t EstimatedColorBytesPerBrick(ColorFormat format)
+{
+    // Colors are only stored for occupied voxels, pools are sized for the average brick rather than the worst case
+    const uint64_t granularityBytes = COLOR_ALLOCATION_GRANULARITY * sizeof(uint32_t);
+    const uint64_t estimate = static_cast<uint64_t>(ColorBytesPerBrick(format) * COLOR_POOL_FILL_ESTIMATE);
+    return ((estimate + granularityBytes - 1) / granularityBytes) * granularityBytes;
+}
+
+//================================//
+// Every color pool is its own storage binding in the traversal shader, which also binds the other fixed buffers
+uint32_t VoxelManager::computeMaxColorPools(WgpuBundle& bundle) const
+{
+    const uint32_t maxStorageBuffers = bundle.GetLimits().maxStorageBuffersPerShaderStage;
+    if (maxStorageBuffers <= COMPUTE_VOXEL_FIXED_STORAGE_BUFFERS)
+    {
+        std::cout << "[VoxelManager] Device supports " << maxStorageBuffers << " storage buffers per shader stage, at least " << COMPUTE_VOXEL_FIXED_STORAGE_BUFFERS + 1 << " are needed." << std::endl;
+        throw std::runtime_error("[VoxelManager] Not enough storage buffers per shader stage for a color pool.");
+    }
+
+    const uint32_t maxColorPools = std::min(maxStorageBuffers - COMPUTE_VOXEL_FIXED_STORAGE_BUFFERS, MAX_COLOR_POOLS);
+    std::cout << "[VoxelManager] Up to " << maxColorPools << " color pool buffers." << std::endl;
+    return maxColorPools;
+}
+
+//================================//
+GridSettings VoxelManager::validateResolution(WgpuBundle& bundle, int resolution, int maxVisibleBricks, ColorFormat colorFormat) const
+{
+    GridSettings settings;
+    settings.colorFormat = colorFormat;
+
     // First of all, calculate limits to see if we support this resolution
+    // a color block never straddles two color pools, pools are a multiple of the allocation granularity
+    const uint64_t colorBytesPerBrick = EstimatedColorBytesPerBrick(colorFormat);
+    const uint64_t granularityBytes = COLOR_ALLOCATION_GRANULARITY * sizeof(uint32_t);
     uint64_t maxBufferSize = bundle.GetLimits().maxBufferSize;
-    uint64_t maxColorBufferSize = (maxBufferSize / static_cast<uint64_t>(COLOR_BYTES_PER_BRICK)) * static_cast<uint64_t>(COLOR_BYTES_PER_BRICK);
-    this->maxColorBufferEntries = static_cast<uint32_t>(maxColorBufferSize / sizeof(ColorRGB)); // in number of ColorRGB entries per buffer pool entry
+    uint64_t maxColorBufferSize = (maxBufferSize / granularityBytes) * granularityBytes;
+    settings.maxColorBufferEntries = static_cast<uint32_t>(maxColorBufferSize / sizeof(ColorRGB)); // in number of ColorRGB entries per buffer pool entry
 
     if (resolution <= 0)
     {
@@ -60,27 +125,27 @@ void VoxelManager::validateResolution(WgpuBundle& bundle, int resolution, int ma
     }
     else if (resolution < 8)
     {
-        this->voxelResolution = 8;
-        this->BrickResolution = 1;
-        this->numberOfColorPools = this->hasColor ? 1 : 0;
-        this->maxVisibleBricks = 1;
+        settings.voxelResolution = 8;
+        settings.brickResolution = 1;
+        settings.numberOfColorPools = this->hasColor ? 1 : 0;
+        settings.maxVisibleBricks = 1;
 
         std::cout << "[VoxelManager] Voxel resolution too low, clamping to 8." << std::endl;
-        return;
+        return settings;
     }
 
     if (this->hasColor)
     {
         // Now compute maximum possible resolution of visible bricks
-        uint64_t maxTotalVisibleColorSize = uint64_t(MAX_COLOR_POOLS) * maxColorBufferSize;
-        uint64_t maxVisibleBricksPossible = maxTotalVisibleColorSize / COLOR_BYTES_PER_BRICK;
+        uint64_t maxTotalVisibleColorSize = uint64_t(this->maxColorPools) * maxColorBufferSize;
+        uint64_t maxVisibleBricksPossible = maxTotalVisibleColorSize / colorBytesPerBrick;
 
-        // [1] clamp the max visible bricks to the possible maximum, with our 3 color pools
+        // [1] clamp the max visible bricks to the possible maximum, with the color pools the device can bind
         maxVisibleBricks = std::min(static_cast<uint64_t>(maxVisibleBricks), maxVisibleBricksPossible - 1);
     }
     else    
     {
-        this->numberOfColorPools = 0;
+        settings.numberOfColorPools = 0;
     }
 
     if (resolution % 8 != 0)
@@ -88,42 +153,65 @@ void VoxelManager::validateResolution(WgpuBundle& bundle, int resolution, int ma
         resolution = (resolution / 8) * 8; // floor to nearest multiple of 8
     }
 
-    // [2] check if the resolution forces a number of bricks higher than 24 bit encoding, max possible for our brick grid
+    // [2] check if the resolution forces a brick grid larger than what the paged grid can index
     int brickResolution = resolution / 8;
-    uint64_t numBricks = static_cast<uint64_t>(brickResolution) * static_cast<uint64_t>(brickResolution) * static_cast<uint64_t>(brickResolution);
-    if (numBricks > MAX_BRICKS + 1)
+    if (brickResolution > static_cast<int>(MAX_BRICK_RESOLUTION))
     {
-        // reduce resolution until it fits
-        while (numBricks >= MAX_BRICKS)
-        {
-            resolution -= 8;
-            brickResolution = resolution / 8;
-            numBricks = static_cast<uint64_t>(brickResolution) * static_cast<uint64_t>(brickResolution) * static_cast<uint64_t>(brickResolution);
-        }
+        std::cout << "[VoxelManager] Voxel resolution too high, clamping to " << MAX_BRICK_RESOLUTION * 8 << "." << std::endl;
+        brickResolution = static_cast<int>(MAX_BRICK_RESOLUTION);
+        resolution = brickResolution * 8;
     }
+    uint64_t numBricks = static_cast<uint64_t>(brickResolution) * static_cast<uint64_t>(brickResolution) * static_cast<uint64_t>(brickResolution);
 
-    this->voxelResolution = resolution;
-    this->BrickResolution = resolution / 8;
+    settings.voxelResolution = resolution;
+    settings.brickResolution = resolution / 8;
 
     // Now clamp max visible bricks to total number of bricks, we cannot have more visible bricks than total bricks
-    maxVisibleBricks = std::min(maxVisibleBricks, static_cast<int>(numBricks));
-    this->maxVisibleBricks = maxVisibleBricks;
+    // and brick pool slots must fit in the 24 bits of a resident pointer
+    maxVisibleBricks = std::min(maxVisibleBricks, static_cast<int>(std::min<uint64_t>(numBricks, MAX_BRICKS)));
+    settings.maxVisibleBricks = maxVisibleBricks;
     
     // Compute number of color pools needed
     if (this->hasColor)
     {
-        uint64_t totalColorBytesNeeded = static_cast<uint64_t>(this->maxVisibleBricks) * static_cast<uint64_t>(COLOR_BYTES_PER_BRICK);
-        this->numberOfColorPools = static_cast<uint32_t>((totalColorBytesNeeded + maxColorBufferSize - 1) / maxColorBufferSize);
-        if (this->numberOfColorPools > MAX_COLOR_POOLS)
+        uint64_t totalColorBytesNeeded = static_cast<uint64_t>(settings.maxVisibleBricks) * colorBytesPerBrick;
+        settings.numberOfColorPools = static_cast<uint32_t>((totalColorBytesNeeded + maxColorBufferSize - 1) / maxColorBufferSize);
+        if (settings.numberOfColorPools > this->maxColorPools)
         {
             std::cout << "[VoxelManager] Unable to allocate enough color pool buffers for the requested visible bricks (" << maxVisibleBricks << "). Max supported visible bricks is lower. THIS SHOULD NOT HAPPEN." << std::endl;
             throw std::runtime_error("[VoxelManager] Unable to allocate enough color pool buffers for the requested visible bricks.");
         }
     }
 
-    std::cout << "[VoxelManager] Voxel resolution set to " << this->voxelResolution << " (" << static_cast<uint64_t>(this->voxelResolution) * this->voxelResolution * this->voxelResolution << " total voxels)." << std::endl;
+    std::cout << "[VoxelManager] Voxel resolution set to " << settings.voxelResolution << " (" << static_cast<uint64_t>(settings.voxelResolution) * settings.voxelResolution * settings.voxelResolution << " total voxels)." << std::endl;
     std::cout << "[VoxelManager] Max visible bricks set to " << maxVisibleBricks << "." << std::endl;
-    std::cout << "[VoxelManager] Using " << numberOfColorPools << " color pool buffers." << std::endl;
+    std::cout << "[VoxelManager] Using " << settings.numberOfColorPools << " color pool buffers (" << ColorFormatName(colorFormat) << ", " << colorBytesPerBrick << " bytes per brick on average)." << std::endl;
+
+    return settings;
+}
+
+//================================//
+GridSettings VoxelManager::getGridSettings() const
+{
+    GridSettings settings;
+    settings.voxelResolution = this->voxelResolution;
+    settings.brickResolution = this->BrickResolution;
+    settings.maxVisibleBricks = this->maxVisibleBricks;
+    settings.numberOfColorPools = this->numberOfColorPools;
+    settings.maxColorBufferEntries = this->maxColorBufferEntries;
+    settings.colorFormat = this->colorFormat;
+    return settings;
+}
+
+//================================//
+void VoxelManager::applyGridSettings(const GridSettings& settings)
+{
+    this->voxelResolution = settings.voxelResolution;
+    this->BrickResolution = settings.brickResolution;
+    this->maxVisibleBricks = settings.maxVisibleBricks;
+    this->numberOfColorPools = settings.numberOfColorPools;
+    this->maxColorBufferEntries = settings.maxColorBufferEntries;
+    this->colorFormat = settings.colorFormat;
 }
 
 //================================//
@@ -181,7 +269,9 @@ void VoxelManager::loadFile(const std::string& filename)
         return;
     }
 
+    std::lock_guard<std::mutex> lock(fileReadMutex); // A grid build may be reading the index
     this->voxelFileReader = std::make_unique<VoxelFileReader>(filename);
+    this->loadedFilename = filename;
     this->loadedMesh = true;
 }
 
@@ -223,78 +313,98 @@ void VoxelManager::clearDiskReadQueues()
 {
     {
         std::lock_guard<std::mutex> lock(diskReadQueueMutex);
-        std::queue<uint32_t> empty;
-        std::swap(diskReadRequestQueue, empty);
+        diskReadRequestQueue.Clear();
+        diskPrefetchRequestQueue.Clear();
+
+        // A read the thread already started will land after this, tag it as stale
+        diskReadGeneration++;
     }
     {
         std::lock_guard<std::mutex> lock(diskReadResultMutex);
-        std::queue<DiskReadResult> empty;
-        std::swap(diskReadResultQueue, empty);
+        diskReadResultQueue.Clear();
     }
     {
-        for(auto& cell : brickGridCPU)
+        for (uint32_t pageSlot = 0; pageSlot < pageTable.GetNumAllocatedPages(); ++pageSlot)
         {
-            cell.reading = false;
-            cell.pendingRead = false;
+            BrickGridPage& page = pageTable.GetPage(pageSlot);
+            page.reading.ResetAll();
+            page.pendingRead.ResetAll();
         }
     }
 }
 
 //================================//
-void VoxelManager::queueDiskRead(uint32_t brickGridIndex)
+bool VoxelManager::queueDiskRead(uint32_t brickGridIndex)
 {
 #ifdef __EMSCRIPTEN__
     // Process immediately on web (synchronous read from virtual FS)
-    processSingleDiskRead(brickGridIndex);
+    return processSingleDiskRead(brickGridIndex);
+#else
+    {
+        std::lock_guard<std::mutex> lock(diskReadQueueMutex);
+        if (!diskReadRequestQueue.Push(brickGridIndex))
+            return false;
+    }
+    diskReadQueueCV.notify_one();
+    return true;
+#endif
+}
+
+//================================//
+bool VoxelManager::queuePrefetchRead(uint32_t brickGridIndex)
+{
+#ifdef __EMSCRIPTEN__
+    return processSingleDiskRead(brickGridIndex);
 #else
     {
         std::lock_guard<std::mutex> lock(diskReadQueueMutex);
-        diskReadRequestQueue.push(brickGridIndex);
+        if (!diskPrefetchRequestQueue.Push(brickGridIndex))
+            return false;
     }
     diskReadQueueCV.notify_one();
+    return true;
 #endif
 }
 
+//================================//
+// Prefetches that the reader thread did not start yet are dropped,
+// a newer prediction replaces them
+void VoxelManager::cancelPrefetchReads()
+{
+    // Drained under the lock, the reader thread never touches the pages
+    std::lock_guard<std::mutex> lock(diskReadQueueMutex);
+    while (!diskPrefetchRequestQueue.Empty())
+    {
+        uint32_t cellIndex;
+        BrickGridPage* page = pageTable.FindPage(diskPrefetchRequestQueue.Front(), cellIndex);
+        if (page)
+        {
+            page->reading.Reset(cellIndex);
+            page->pendingRead.Reset(cellIndex);
+        }
+        diskPrefetchRequestQueue.Pop();
+    }
+}
+
 //================================//
 #ifdef __EMSCRIPTEN__
-void VoxelManager::processSingleDiskRead(uint32_t brickGridIndex)
+bool VoxelManager::processSingleDiskRead(uint32_t brickGridIndex)
 {
+    if (diskReadResultQueue.Full())
+        return false; // Results are drained every frame, the brick is requested again later
+
     DiskReadResult result;
     result.brickGridIndex = brickGridIndex;
+    result.generation = diskReadGeneration;
     result.success = false;
     std::memset(result.occupancy, 0, sizeof(result.occupancy));
     std::memset(result.colors, 0, sizeof(result.colors));
 
     if (loadedMesh && voxelFileReader)
     {
-        brickDataEntry diskData;
-        if (voxelFileReader->getBrickData(brickGridIndex, diskData))
+        if (voxelFileReader->getBrickData(brickGridIndex, diskReadScratch))
         {
-            std::memcpy(result.occupancy, diskData.occupancy, sizeof(result.occupancy));
-            
-            size_t colorIndex = 0;
-            for (int z = 0; z < 8 && colorIndex < diskData.colors.size(); ++z)
-            {
-                uint32_t firstSliceHalf = diskData.occupancy[2 * z];
-                uint32_t secondSliceHalf = diskData.occupancy[2 * z + 1];
-                uint64_t slice = (static_cast<uint64_t>(secondSliceHalf) << 32) | static_cast<uint64_t>(firstSliceHalf);
-                
-                for (int bit = 0; bit < 64 && slice != 0; bit++)
-                {
-                    if (slice & (1ull << bit))
-                    {
-                        int voxelIndex = z * 64 + bit;
-                        if (colorIndex < diskData.colors.size())
-                        {
-                            result.colors[voxelIndex].r = diskData.colors[colorIndex].r;
-                            result.colors[voxelIndex].g = diskData.colors[colorIndex].g;
-                            result.colors[voxelIndex].b = diskData.colors[colorIndex].b;
-                            result.colors[voxelIndex]._pad = 0;
-                            ++colorIndex;
-                        }
-                    }
-                }
-            }
+            DecodeDiskBrick(diskReadScratch, result.occupancy, result.colors);
             result.success = true;
         }
     }
@@ -312,106 +422,112 @@ void VoxelManager::processSingleDiskRead(uint32_t brickGridIndex)
     }
 
     // Add directly to result queue
-    {
-        std::lock_guard<std::mutex> lock(diskReadResultMutex);
-        diskReadResultQueue.push(std::move(result));
-    }
+    std::lock_guard<std::mutex> lock(diskReadResultMutex);
+    return diskReadResultQueue.Push(result);
 }
 #endif
 
 //================================//
 void VoxelManager::diskReaderThreadFunc()
 {
+    // Reused for every batch, the colors keep their capacity
+    std::vector<uint32_t> batchIndices;
+    batchIndices.reserve(DISK_READ_BATCH);
+    std::vector<brickDataEntry> batchData(DISK_READ_BATCH);
+    for (brickDataEntry& diskData : batchData)
+        diskData.colors.reserve(512);
+    std::vector<uint8_t> batchFound(DISK_READ_BATCH, 0);
+    std::vector<DiskReadResult> batchResults(DISK_READ_BATCH);
+
     while (diskReaderThreadRunning.load())
     {
-        uint32_t brickGridIndex = UINT32_MAX;
+        uint32_t generation = 0;
+        batchIndices.clear();
         
         // here we wait fro requests to arrive
         {
             std::unique_lock<std::mutex> lock(diskReadQueueMutex);
             diskReadQueueCV.wait(lock, [this]() {
-                return !diskReadRequestQueue.empty() || !diskReaderThreadRunning.load();
+                return !diskReadRequestQueue.Empty() || !diskPrefetchRequestQueue.Empty() || !diskReaderThreadRunning.load();
             });
             
-            if (!diskReaderThreadRunning.load() && diskReadRequestQueue.empty())
+            if (!diskReaderThreadRunning.load() && diskReadRequestQueue.Empty())
                 break;
             
-            if (!diskReadRequestQueue.empty())
+            // Bricks the GPU asked for always go before predicted ones
+            while (batchIndices.size() < DISK_READ_BATCH && !diskReadRequestQueue.Empty())
             {
-                brickGridIndex = diskReadRequestQueue.front();
-                diskReadRequestQueue.pop();
+                batchIndices.push_back(diskReadRequestQueue.Front());
+                diskReadRequestQueue.Pop();
             }
+            while (batchIndices.size() < DISK_READ_BATCH && !diskPrefetchRequestQueue.Empty())
+            {
+                batchIndices.push_back(diskPrefetchRequestQueue.Front());
+                diskPrefetchRequestQueue.Pop();
+            }
+            generation = diskReadGeneration;
         }
         
-        if (brickGridIndex == UINT32_MAX)
+        if (batchIndices.empty())
             continue; // Meaning we did not find work
+
+        const uint32_t batchSize = static_cast<uint32_t>(batchIndices.size());
         
-        DiskReadResult result;
-        result.brickGridIndex = brickGridIndex;
-        result.success = false;
-        
-        // Initialize occupancy and colors to zero
-        std::memset(result.occupancy, 0, sizeof(result.occupancy));
-        std::memset(result.colors, 0, sizeof(result.colors));
-        
+        // [1] Reads go one after the other, the file is a single stream
         {
             std::lock_guard<std::mutex> lock(fileReadMutex); // majes the read thread safe
             
-            if (loadedMesh && voxelFileReader) // Only read if we have a loaded mesh
+            for (uint32_t i = 0; i < batchSize; ++i)
             {
-                brickDataEntry diskData;
-                if (voxelFileReader->getBrickData(brickGridIndex, diskData))
-                {
-                    std::memcpy(result.occupancy, diskData.occupancy, sizeof(result.occupancy));
-                    
-                    // The files stores colors densely, 
-                    // we need to map them in order 
-                    // with non empty voxels only
-                    size_t colorIndex = 0;
-                    for (int z = 0; z < 8 && colorIndex < diskData.colors.size(); ++z)
-                    {
-                        uint32_t firstSliceHalf = diskData.occupancy[2 * z];
-                        uint32_t secondSliceHalf = diskData.occupancy[2 * z + 1];
-                        uint64_t slice = (static_cast<uint64_t>(secondSliceHalf) << 32) | static_cast<uint64_t>(firstSliceHalf);
-                        
-                        for (int bit = 0; bit < 64 && slice != 0; bit++)
-                        {
-                            if (slice & (1ull << bit)) // VOXEL OCCUPIED
-                            {
-                                int voxelIndex = z * 64 + bit;
-                                if (colorIndex < diskData.colors.size())
-                                {
-                                    result.colors[voxelIndex].r = diskData.colors[colorIndex].r;
-                                    result.colors[voxelIndex].g = diskData.colors[colorIndex].g;
-                                    result.colors[voxelIndex].b = diskData.colors[colorIndex].b;
-                                    result.colors[voxelIndex]._pad = 0;
-                                    ++colorIndex;
-                                }
-                            }
-                        }
-                    }
-                    
-                    result.success = true;
-                }
+                // Only read if we have a loaded mesh
+                batchFound[i] = loadedMesh && voxelFileReader && voxelFileReader->getBrickData(batchIndices[i], batchData[i]);
             }
         }
-        
-        // Placeholder? FOr now only first voxel... TODO: better placeholder generation
-        if (!result.success)
-        {
-            // Generate a simple placeholder: single voxel with random color
-            result.occupancy[0] = 1u;
-            result.colors[0] = {
-                static_cast<uint8_t>(rand() % 256),
-                static_cast<uint8_t>(rand() % 256),
-                static_cast<uint8_t>(rand() % 256),
-                0
-            };
-            result.success = true;
-        }
+
+        // [2] Sparse to dense expansion in parallel. Shares the queue of the render thread, which can pick up
+        // some of these jobs while it waits on its own, kept short by the small grain
+        JobSystem::Shared().ParallelFor(batchSize, 4, [&](uint32_t i) {
+            DiskReadResult& result = batchResults[i];
+            result.brickGridIndex = batchIndices[i];
+            result.generation = generation;
+            result.success = batchFound[i] != 0;
+
+            // Initialize occupancy and colors to zero
+            std::memset(result.occupancy, 0, sizeof(result.occupancy));
+            std::memset(result.colors, 0, sizeof(result.colors));
+
+            if (result.success)
+                DecodeDiskBrick(batchData[i], result.occupancy, result.colors);
+        });
+
+        for (uint32_t i = 0; i < batchSize; ++i)
         {
-            std::lock_guard<std::mutex> lock(diskReadResultMutex);
-            diskReadResultQueue.push(std::move(result));
+            DiskReadResult& result = batchResults[i];
+        
+            // Placeholder? FOr now only first voxel... TODO: better placeholder generation
+            if (!result.success)
+            {
+                // Generate a simple placeholder: single voxel with random color
+                result.occupancy[0] = 1u;
+                result.colors[0] = {
+                    static_cast<uint8_t>(rand() % 256),
+                    static_cast<uint8_t>(rand() % 256),
+                    static_cast<uint8_t>(rand() % 256),
+                    0
+                };
+                result.success = true;
+            }
+
+            // The result ring is drained every frame, when the main thread falls behind we wait for room
+            while (diskReaderThreadRunning.load())
+            {
+                {
+                    std::lock_guard<std::mutex> lock(diskReadResultMutex);
+                    if (diskReadResultQueue.Push(result))
+                        break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
         }
     }
 }
@@ -421,62 +537,593 @@ void VoxelManager::diskReaderThreadFunc()
 // that are ready to be uploaded to GPU
 void VoxelManager::processCompletedDiskReads()
 {
-    const uint32_t maxValidIndex = static_cast<uint32_t>(brickGridCPU.size());
+    const int maxReadyBricks = static_cast<int>(streamingBudget.GetMaxReadyBricks());
     int processedCount = 0;
 
-    while (processedCount < MAX_READY_BRICKS)
+    while (processedCount < maxReadyBricks)
     {
-        DiskReadResult result;
-
-        // Get the completed read from complete queue
+        // The front slot is ours until we pop it, the reader thread only writes free slots
+        const DiskReadResult* result = nullptr;
         {
             std::lock_guard<std::mutex> lock(diskReadResultMutex);
-            if (diskReadResultQueue.empty())
+            if (diskReadResultQueue.Empty())
                 break;
-            
-            result = std::move(diskReadResultQueue.front());
-            diskReadResultQueue.pop();
+            result = &diskReadResultQueue.Front();
+        }
+
+        bool retry = false;
+        if (applyDiskReadResult(*result, retry))
+            processedCount++;
+
+        {
+            std::lock_guard<std::mutex> lock(diskReadResultMutex);
+            diskReadResultQueue.Pop();
+            if (retry)
+                diskReadResultQueue.Push(*result); // Always fits, we just freed a slot under the same lock
+        }
+    }
+}
+
+//================================//
+// Returns true when the result counts against the ready budget, outRetry when it must be applied again later
+bool VoxelManager::applyDiskReadResult(const DiskReadResult& result, bool& outRetry)
+{
+    outRetry = false;
+
+    // Only this thread bumps the generation, no need for the queue lock to read it
+    if (result.generation != diskReadGeneration)
+        return false; // Read for a grid that was rebuilt since
+
+    uint32_t brickGridIndex = result.brickGridIndex;
+
+    uint32_t cellIndex;
+    BrickGridPage* page = pageTable.FindPage(brickGridIndex, cellIndex);
+    if (!page)
+        return false; // This should in theory not happen, since we already check when queuing for read
+
+    page->reading.Reset(cellIndex);
+    page->pendingRead.Reset(cellIndex);
+
+    if (page->edited.Test(cellIndex))
+        return false; // Edited while the read was in flight, the disk copy is stale
+
+    if (!result.success)
+        return false; // read failed, we skip, but still we mark as tried to read this brick
+
+    // The previous slot of a reloaded brick is only released once the new one is assigned,
+    // so it keeps rendering if we run out of slots
+    const BrickResidency previousState = page->GetResidency(cellIndex);
+
+    if (!assignBrickSlot(brickGridIndex, *page, cellIndex, result.occupancy, result.colors))
+    {
+        page->reading.Set(cellIndex);
+        page->pendingRead.Set(cellIndex);
+        outRetry = true;
+        return true;
+    }
+
+    if (previousState.onGPU)
+        releaseBrickSlot(brickGridIndex, previousState);
+
+    BrickMapCPU& brickMap = brickMaps[brickGridIndex];
+    std::memcpy(brickMap.occupancy, result.occupancy, sizeof(brickMap.occupancy));
+    std::memcpy(brickMap.colors, result.colors, sizeof(brickMap.colors));
+
+    page->dirty.Set(cellIndex);
+    dirtyBrickIndices.push_back(brickGridIndex);
+    return true;
+}
+
+//================================//
+// BRICK SLOT SHARING
+//================================//
+bool VoxelManager::isUniformBrick(const uint32_t* occupancy, const ColorRGB* colors) const
+{
+    for (int i = 0; i < 16; ++i)
+    {
+        if (occupancy[i] != 0xFFFFFFFFu)
+            return false;
+    }
+
+    if (!this->hasColor)
+        return true;
+
+    for (int i = 1; i < 512; ++i)
+    {
+        if (colors[i].r != colors[0].r || colors[i].g != colors[0].g || colors[i].b != colors[0].b)
+            return false;
+    }
+    return true;
+}
+
+//================================//
+uint64_t VoxelManager::hashBrick(const uint32_t* occupancy, const ColorRGB* colors) const
+{
+    // FNV-1a over the occupancy, then the colors, empty voxels have zeroed colors so they hash the same
+    uint64_t hash = 14695981039346656037ull;
+    auto hashBytes = [&hash](const uint8_t* bytes, size_t size) {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+
+    hashBytes(reinterpret_cast<const uint8_t*>(occupancy), 16 * sizeof(uint32_t));
+    if (this->hasColor)
+        hashBytes(reinterpret_cast<const uint8_t*>(colors), 512 * sizeof(ColorRGB));
+    return hash;
+}
+
+//================================//
+// Returns false when a new slot is needed and none is free
+bool VoxelManager::assignBrickSlot(uint32_t brickGridIndex, BrickGridPage& page, uint32_t cellIndex, const uint32_t* occupancy, const ColorRGB* colors)
+{
+    // [1] Solid single color bricks are encoded in the pointer
+    if (isUniformBrick(occupancy, colors))
+    {
+        page.uniform.Set(cellIndex);
+        page.onGPU.Set(cellIndex);
+        page.SetBrickSlot(cellIndex, UINT32_MAX);
+        this->uniformBrickCount++;
+        return true;
+    }
+
+    // [2] An identical brick is already in the pool, share its slot
+    const uint64_t hash = hashBrick(occupancy, colors);
+    auto it = this->slotByHash.find(hash);
+    if (it != this->slotByHash.end())
+    {
+        const uint32_t slot = it->second;
+        const BrickMapCPU& owner = this->brickMaps[this->slotOwners[slot]];
+
+        const bool identical = std::memcmp(owner.occupancy, occupancy, sizeof(owner.occupancy)) == 0 &&
+            (!this->hasColor || std::memcmp(owner.colors, colors, sizeof(owner.colors)) == 0);
+        if (identical)
+        {
+            this->slotRefCounts[slot]++;
+            this->sharedBrickCount++;
+
+            page.uniform.Reset(cellIndex);
+            page.onGPU.Set(cellIndex);
+            page.SetBrickSlot(cellIndex, slot);
+            return true;
+        }
+    }
+
+    // [3] New content, take a free slot
+    if (this->freeBrickSlots.empty())
+        return false;
+
+    const uint32_t slot = this->freeBrickSlots.back();
+    this->freeBrickSlots.pop_back();
+
+    this->slotRefCounts[slot] = 1;
+    this->slotOwners[slot] = brickGridIndex;
+    this->slotNeedsUpload[slot] = 1;
+
+    // On a hash collision with different content the slot is simply not shared
+    this->slotHashed[slot] = it == this->slotByHash.end() ? 1 : 0;
+    this->slotHashes[slot] = hash;
+    if (this->slotHashed[slot])
+        this->slotByHash.emplace(hash, slot);
+
+    page.uniform.Reset(cellIndex);
+    page.onGPU.Set(cellIndex);
+    page.SetBrickSlot(cellIndex, slot);
+    return true;
+}
+
+//================================//
+void VoxelManager::releaseBrickSlot(uint32_t brickGridIndex, const BrickResidency& previousState)
+{
+    if (previousState.uniform)
+    {
+        this->uniformBrickCount--;
+        return;
+    }
+
+    const uint32_t slot = previousState.gpuBrickIndex;
+    if (slot >= this->slotRefCounts.size() || this->slotRefCounts[slot] == 0)
+        return;
+
+    // The content of the owner is what new bricks are compared against, once it changes the slot can no longer be shared
+    const bool ownerReleased = this->slotOwners[slot] == brickGridIndex;
+    if ((--this->slotRefCounts[slot] == 0 || ownerReleased) && this->slotHashed[slot])
+    {
+        this->slotByHash.erase(this->slotHashes[slot]);
+        this->slotHashed[slot] = 0;
+    }
+
+    if (this->slotRefCounts[slot] == 0)
+    {
+        this->colorAllocator.Free(this->slotColorOffsets[slot], this->slotColorBlockWords[slot]);
+        this->colorBlocksFreed |= this->slotColorBlockWords[slot] > 0;
+        this->slotColorBlockWords[slot] = 0;
+        this->freeBrickSlots.push_back(slot);
+    }
+    else
+    {
+        this->sharedBrickCount--;
+    }
+}
+
+//================================//
+// Freed color blocks are only reused by bricks of the same size class, once they add up to a large part of the pool
+// every resident brick is allocated again from an empty pool. Bricks keep their slot but render as LOD until re-uploaded
+void VoxelManager::defragmentColorPool()
+{
+    this->colorPoolDefragPending = false;
+    this->colorPoolDefragCount++;
+
+    this->colorAllocator.Reset();
+    std::fill(this->slotColorBlockWords.begin(), this->slotColorBlockWords.end(), 0u);
+    this->colorBlocksFreed = true;
+
+    // The LOD pointers go through the pointer scatter of the frame, ahead of the uploads that reuse the color blocks
+    uint32_t numLODPointers = 0;
+    for (const auto& [brickGridIndex, brickMap] : this->brickMaps)
+    {
+        uint32_t pageSlot, cellIndex;
+        if (!this->pageTable.Locate(brickGridIndex, pageSlot, cellIndex))
+            continue;
+
+        BrickGridPage& page = this->pageTable.GetPage(pageSlot);
+        if (!page.onGPU.Test(cellIndex) || page.uniform.Test(cellIndex))
+            continue;
+
+        page.cells[cellIndex].pointer = PackLOD(page.GetLODColor(cellIndex));
+        this->slotNeedsUpload[page.GetBrickSlot(cellIndex)] = 1;
+        if (!page.dirty.Test(cellIndex))
+        {
+            page.dirty.Set(cellIndex);
+            this->dirtyBrickIndices.push_back(brickGridIndex);
+        }
+        this->pendingPointerWrites.push_back(BrickPageTable::PoolIndex(pageSlot, cellIndex));
+        numLODPointers++;
+    }
+
+    std::cout << "[VoxelManager] Defragmented color pool, " << numLODPointers << " bricks re-uploading." << std::endl;
+}
+
+//================================//
+// A brick without a color block gives its slot back and goes back to LOD, instead of holding the slot while
+// it cannot render. pendingRead keeps feedback from requesting it again until blocks are freed
+void VoxelManager::parkForColorBlock(const UploadBatchEntry& batchEntry, std::vector<uint32_t>& modifiedIndices)
+{
+    BrickGridPage& page = *batchEntry.page;
+    const uint32_t cellIndex = batchEntry.cellIndex;
+    const uint32_t brickGridIndex = this->pageTable.BrickGridIndexOf(page.pageIndex, cellIndex);
+
+    releaseBrickSlot(brickGridIndex, page.GetResidency(cellIndex));
+    page.onGPU.Reset(cellIndex);
+    page.dirty.Reset(cellIndex);
+    page.SetBrickSlot(cellIndex, UINT32_MAX);
+
+    // The batch reserved a pointer update per brick
+    page.cells[cellIndex].pointer = PackLOD(page.GetLODColor(cellIndex));
+    modifiedIndices.push_back(BrickPageTable::PoolIndex(batchEntry.pageSlot, cellIndex));
+
+    // Reserved for the slot count, past it the brick is left to feedback
+    if (this->colorWaitingBricks.size() < this->colorWaitingBricks.capacity())
+    {
+        page.pendingRead.Set(cellIndex);
+        this->colorWaitingBricks.push_back(brickGridIndex);
+    }
+}
+
+//================================//
+// Only once blocks were freed, the bricks that still do not fit are parked again by the upload
+void VoxelManager::retryColorWaitingBricks()
+{
+    if (!this->colorBlocksFreed || this->colorWaitingBricks.empty())
+        return;
+    this->colorBlocksFreed = false;
+
+    size_t retried = 0;
+    for (; retried < this->colorWaitingBricks.size(); ++retried)
+    {
+        const uint32_t brickGridIndex = this->colorWaitingBricks[retried];
+        uint32_t cellIndex;
+        BrickGridPage* page = this->pageTable.FindPage(brickGridIndex, cellIndex);
+        if (!page || page->reading.Test(cellIndex))
+            continue; // Read again meanwhile, the read owns pendingRead
+        page->pendingRead.Reset(cellIndex);
+
+        auto brickMap = this->brickMaps.find(brickGridIndex);
+        if (brickMap == this->brickMaps.end() || page->onGPU.Test(cellIndex))
+            continue; // Emptied or edited back in meanwhile
+
+        if (!assignBrickSlot(brickGridIndex, *page, cellIndex, brickMap->second.occupancy, brickMap->second.colors))
+        {
+            page->pendingRead.Set(cellIndex);
+            break; // Out of slots, the rest waits for the next free
+        }
+        page->dirty.Set(cellIndex);
+        this->dirtyBrickIndices.push_back(brickGridIndex);
+    }
+    this->colorWaitingBricks.erase(this->colorWaitingBricks.begin(), this->colorWaitingBricks.begin() + retried);
+}
+
+//================================//
+// RUNTIME EDITING
+//================================//
+bool VoxelManager::SetVoxel(int x, int y, int z, ColorRGB color)
+{
+    return EditBox(Eigen::Vector3i(x, y, z), Eigen::Vector3i(x, y, z), VoxelEditOp::Set, color);
+}
+
+//================================//
+bool VoxelManager::ClearVoxel(int x, int y, int z)
+{
+    return EditBox(Eigen::Vector3i(x, y, z), Eigen::Vector3i(x, y, z), VoxelEditOp::Clear);
+}
+
+//================================//
+bool VoxelManager::EditBox(const Eigen::Vector3i& boxMin, const Eigen::Vector3i& boxMax, VoxelEditOp op, ColorRGB color)
+{
+    VoxelEditShape shape;
+    shape.boxMin = boxMin.cwiseMin(boxMax);
+    shape.boxMax = boxMin.cwiseMax(boxMax);
+    return applyEdit(shape, op, color);
+}
+
+//================================//
+bool VoxelManager::EditSphere(const Eigen::Vector3f& center, float radius, VoxelEditOp op, ColorRGB color)
+{
+    if (radius <= 0.0f)
+        return false;
+
+    VoxelEditShape shape;
+    shape.boxMin = (center.array() - radius).floor().cast<int>();
+    shape.boxMax = (center.array() + radius).ceil().cast<int>();
+    shape.sphere = true;
+    shape.center = center;
+    shape.radius = radius;
+    return applyEdit(shape, op, color);
+}
+
+//================================//
+// Every brick overlapping the shape is edited on a copy, only the ones that changed are committed
+bool VoxelManager::applyEdit(const VoxelEditShape& shape, VoxelEditOp op, ColorRGB color)
+{
+    if (IsRebuildingGrid())
+    {
+        std::cout << "[VoxelManager] Grid is being rebuilt, edit ignored." << std::endl;
+        return false;
+    }
+
+    const Eigen::Vector3i lo = shape.boxMin.cwiseMax(0);
+    const Eigen::Vector3i hi = shape.boxMax.cwiseMin(this->voxelResolution - 1);
+    if ((lo.array() > hi.array()).any())
+        return false;
+
+    color._pad = 0;
+    const float radiusSq = shape.radius * shape.radius;
+    const Eigen::Vector3i brickLo = lo / 8;
+    const Eigen::Vector3i brickHi = hi / 8;
+
+    bool changedAny = false;
+    BrickMapCPU brick;
+    for (int bz = brickLo.z(); bz <= brickHi.z(); ++bz)
+    for (int by = brickLo.y(); by <= brickHi.y(); ++by)
+    for (int bx = brickLo.x(); bx <= brickHi.x(); ++bx)
+    {
+        const uint32_t brickGridIndex = BrickGridIndex(bx, by, bz);
+
+        // Clearing or painting never creates bricks
+        const bool hasContent = loadEditableBrick(brickGridIndex, brick);
+        if (!hasContent && op != VoxelEditOp::Set)
+            continue;
+
+        bool changed = false;
+        for (int z = std::max(lo.z(), bz * 8); z <= std::min(hi.z(), bz * 8 + 7); ++z)
+        for (int y = std::max(lo.y(), by * 8); y <= std::min(hi.y(), by * 8 + 7); ++y)
+        for (int x = std::max(lo.x(), bx * 8); x <= std::min(hi.x(), bx * 8 + 7); ++x)
+        {
+            if (shape.sphere)
+            {
+                const Eigen::Vector3f voxelCenter = Eigen::Vector3f(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)).array() + 0.5f;
+                if ((voxelCenter - shape.center).squaredNorm() > radiusSq)
+                    continue;
+            }
+
+            const uint32_t voxelIndex = (x & 7) + (y & 7) * 8 + (z & 7) * 64;
+            uint32_t& word = brick.occupancy[voxelIndex >> 5];
+            const uint32_t mask = 1u << (voxelIndex & 31u);
+            const bool occupied = (word & mask) != 0u;
+
+            switch (op)
+            {
+                case VoxelEditOp::Set:
+                    if (occupied && SameColor(brick.colors[voxelIndex], color))
+                        continue;
+                    word |= mask;
+                    brick.colors[voxelIndex] = color;
+                    break;
+                case VoxelEditOp::Clear:
+                    if (!occupied)
+                        continue;
+                    word &= ~mask;
+                    brick.colors[voxelIndex] = {0, 0, 0, 0}; // Empty voxels keep zeroed colors for brick sharing
+                    break;
+                case VoxelEditOp::Paint:
+                    if (!occupied || SameColor(brick.colors[voxelIndex], color))
+                        continue;
+                    brick.colors[voxelIndex] = color;
+                    break;
+            }
+            changed = true;
+        }
+
+        if (changed && commitEditedBrick(brickGridIndex, brick))
+            changedAny = true;
+    }
+
+    return changedAny;
+}
+
+//================================//
+// Current content of a brick, read from disk right away if it was never streamed in. Returns false for empty bricks
+bool VoxelManager::loadEditableBrick(uint32_t brickGridIndex, BrickMapCPU& outBrick)
+{
+    std::memset(&outBrick, 0, sizeof(BrickMapCPU));
+
+    auto it = this->brickMaps.find(brickGridIndex);
+    if (it != this->brickMaps.end())
+    {
+        outBrick = it->second;
+        return true;
+    }
+
+    uint32_t pageSlot, cellIndex;
+    if (!this->pageTable.Locate(brickGridIndex, pageSlot, cellIndex))
+        return false;
+
+    // Only bricks with an unloaded LOD pointer exist in the file, and edited ones were changed since
+    const BrickGridPage& page = this->pageTable.GetPage(pageSlot);
+    if (page.edited.Test(cellIndex) || (page.cells[cellIndex].pointer & (1u << 29)) == 0u)
+        return false;
+
+    std::lock_guard<std::mutex> lock(fileReadMutex);
+    brickDataEntry diskData;
+    if (!this->loadedMesh || !this->voxelFileReader || !this->voxelFileReader->getBrickData(brickGridIndex, diskData))
+        return false;
+
+    DecodeDiskBrick(diskData, outBrick.occupancy, outBrick.colors);
+    return true;
+}
+
+//================================//
+// Same path as a brick coming from disk, a shared slot is left to the other bricks and this one gets its own
+bool VoxelManager::commitEditedBrick(uint32_t brickGridIndex, const BrickMapCPU& brick)
+{
+    const uint32_t numPagesBefore = this->pageTable.GetNumAllocatedPages();
+    const uint32_t pageSlot = this->pageTable.AllocatePage(this->pageTable.PageIndexOf(brickGridIndex));
+    if (this->pageTable.GetNumAllocatedPages() != numPagesBefore)
+        this->pageTableDirty = true;
+
+    const uint32_t cellIndex = this->pageTable.CellIndexOf(brickGridIndex);
+    BrickGridPage& page = this->pageTable.GetPage(pageSlot);
+    const BrickResidency previousState = page.GetResidency(cellIndex);
+
+    bool empty = true;
+    for (int i = 0; i < 16 && empty; ++i)
+        empty = brick.occupancy[i] == 0u;
+
+    // [1] Emptied brick, no slot and an empty pointer
+    if (empty)
+    {
+        if (previousState.onGPU)
+            releaseBrickSlot(brickGridIndex, previousState);
+
+        page.onGPU.Reset(cellIndex);
+        page.uniform.Reset(cellIndex);
+        page.dirty.Reset(cellIndex);
+        page.SetBrickSlot(cellIndex, UINT32_MAX);
+        this->brickMaps.erase(brickGridIndex);
+
+        page.cells[cellIndex].pointer = PackEmptyPointer();
+        this->pendingPointerWrites.push_back(BrickPageTable::PoolIndex(pageSlot, cellIndex));
+    }
+    else
+    {
+        // [2] New content, the old slot is only released once the new one is assigned
+        if (!assignBrickSlot(brickGridIndex, page, cellIndex, brick.occupancy, brick.colors))
+        {
+            std::cout << "[VoxelManager] Out of brick slots, edit of brick " << brickGridIndex << " dropped." << std::endl;
+            return false;
         }
+        if (previousState.onGPU)
+            releaseBrickSlot(brickGridIndex, previousState);
 
-        uint32_t brickGridIndex = result.brickGridIndex;
+        this->brickMaps[brickGridIndex] = brick;
+        page.SetLODColor(cellIndex, computeBrickAverageColor(brick));
+        if (!page.dirty.Test(cellIndex))
+        {
+            page.dirty.Set(cellIndex);
+            this->dirtyBrickIndices.push_back(brickGridIndex);
+        }
+    }
+
+    if (!page.edited.Test(cellIndex))
+        this->editedBrickCount++;
+    page.edited.Set(cellIndex);
+
+    this->pageTable.BuildCoarseCells(pageSlot);
+    this->pendingCoarseWrites.push_back(pageSlot);
+    return true;
+}
+
+//================================//
+bool VoxelManager::SaveToFile(const std::string& filename)
+{
+    if (this->loadedMesh && filename == this->loadedFilename)
+    {
+        std::cout << "[VoxelManager] Cannot save over the voxel file being streamed from (" << filename << ")." << std::endl;
+        return false;
+    }
 
-        if (brickGridIndex >= maxValidIndex)
-            continue; // This should in theory not happen, since we already check when queuing for read
+    try
+    {
+        VoxelFileWriter writer(filename, static_cast<uint32_t>(this->voxelResolution));
+        uint32_t savedBricks = 0;
 
-        BrickGridCellCPU& brickCell = brickGridCPU[brickGridIndex];
-        brickCell.reading = false;
-        brickCell.pendingRead = false;
+        auto addBrick = [&writer, &savedBricks](uint32_t brickGridIndex, const uint32_t occupancy[16], const ColorRGB colors[512], ColorRGB lod) {
+            std::vector<VoxelColorRGB> denseColors;
+            for (uint32_t voxelIndex = 0; voxelIndex < 512; ++voxelIndex)
+            {
+                if (occupancy[voxelIndex >> 5] & (1u << (voxelIndex & 31u)))
+                    denseColors.push_back({colors[voxelIndex].r, colors[voxelIndex].g, colors[voxelIndex].b});
+            }
+            if (denseColors.empty())
+                return;
 
-        if (!result.success)
-            continue; // read failed, we skip, but still we mark as tried to read this brick
+            writer.AddBrick(brickGridIndex, occupancy, denseColors, {lod.r, lod.g, lod.b});
+            savedBricks++;
+        };
 
-        if(!brickCell.onGPU) // We need to allocate a brick slot
+        // [1] Bricks still only on disk
         {
-            if (freeBrickSlots.empty())
+            std::lock_guard<std::mutex> lock(fileReadMutex);
+            if (this->loadedMesh && this->voxelFileReader && this->voxelFileReader->getResolution() == static_cast<uint32_t>(this->voxelResolution))
             {
-                brickCell.reading = true;
-                brickCell.pendingRead = true;
+                std::vector<brickIndexEntry> fileBricks;
+                this->voxelFileReader->getInitialOccupiedBricks(fileBricks);
+
+                BrickMapCPU diskBrick;
+                for (const brickIndexEntry& entry : fileBricks)
                 {
-                    std::lock_guard<std::mutex> lock(diskReadResultMutex);
-                    diskReadResultQueue.push(std::move(result));
+                    uint32_t cellIndex;
+                    const BrickGridPage* page = this->pageTable.FindPage(entry.brickGridIndex, cellIndex);
+                    if (this->brickMaps.count(entry.brickGridIndex) || (page && page->edited.Test(cellIndex)))
+                        continue;
+
+                    brickDataEntry diskData;
+                    if (!this->voxelFileReader->getBrickData(entry.brickGridIndex, diskData))
+                        continue;
+
+                    std::memset(&diskBrick, 0, sizeof(BrickMapCPU));
+                    DecodeDiskBrick(diskData, diskBrick.occupancy, diskBrick.colors);
+                    addBrick(entry.brickGridIndex, diskBrick.occupancy, diskBrick.colors, {entry.LOD_R, entry.LOD_G, entry.LOD_B, 0});
                 }
-                processedCount++;
-                continue;
             }
-            
-            brickCell.gpuBrickIndex = freeBrickSlots.back();
-            freeBrickSlots.pop_back();
-            brickCell.onGPU = true;
         }
 
-        BrickMapCPU& brickMap = brickMaps[brickGridIndex];
-        std::memcpy(brickMap.occupancy, result.occupancy, sizeof(brickMap.occupancy));
-        std::memcpy(brickMap.colors, result.colors, sizeof(brickMap.colors));
+        // [2] Bricks in memory, streamed in or edited
+        for (const auto& [brickGridIndex, brickMap] : this->brickMaps)
+            addBrick(brickGridIndex, brickMap.occupancy, brickMap.colors, computeBrickAverageColor(brickMap));
 
-        brickCell.dirty = true;
-        dirtyBrickIndices.push_back(brickGridIndex);
-        processedCount++;
+        writer.EndFile();
+        std::cout << "[VoxelManager] Saved " << savedBricks << " bricks to " << filename << "." << std::endl;
     }
+    catch (const std::exception& e)
+    {
+        std::cout << "[VoxelManager] Failed to save voxel file " << filename << ": " << e.what() << std::endl;
+        return false;
+    }
+
+    return true;
 }
 
 //================================//
@@ -484,66 +1131,81 @@ void VoxelManager::processCompletedDiskReads()
 //================================//
 void VoxelManager::startOfFrame()
 {
+    frameAllocations = 0;
+    beginAllocationScope();
+
     pendingUploadCount = 0;
-    std::vector<uint32_t> stillDirty;
-    for (uint32_t idx : dirtyBrickIndices)
-    {
-        if (idx < brickGridCPU.size() && brickGridCPU[idx].dirty && brickGridCPU[idx].onGPU)
-        {
-            stillDirty.push_back(idx);
-        }
-    }
-    dirtyBrickIndices = std::move(stillDirty);
+    pendingPointerUpdateCount = 0;
+
+    // Compacted in place, keeps its capacity from frame to frame
+    std::erase_if(dirtyBrickIndices, [this](uint32_t idx) {
+        uint32_t cellIndex;
+        const BrickGridPage* page = pageTable.FindPage(idx, cellIndex);
+        return !page || !page->dirty.Test(cellIndex) || !page->onGPU.Test(cellIndex);
+    });
 
     // Process any completed disk reads AKA read from complete read queues
     processCompletedDiskReads();
 
     // Process any pending feedback that was read from previous frames
     processPendingFeedback();
+
+    retryColorWaitingBricks();
+
+    endAllocationScope();
 }
 
 //================================//
-void VoxelManager::processPendingFeedback()
+void VoxelManager::updatePrefetch(const Camera& camera, double time, uint32_t flipBits)
 {
-    if (!hasPendingFeedback)
+    if (!this->loadedMesh || !this->prefetcher.Update(camera, time))
         return;
 
-    this->requestRead( this->feedbackRequests );
-    this->feedbackRequests.clear();
-    this->hasPendingFeedback = false;
+    // Keep brick slots for what the GPU actually sees
+    if (freeBrickSlots.size() < static_cast<size_t>(MAX_READY_BRICKS + MAX_PREFETCH_READS))
+        return;
+
+    cancelPrefetchReads();
+    this->prefetcher.CollectBricks(this->pageTable, flipBits, this->voxelResolution, MAX_PREFETCH_READS, this->prefetchRequests);
+
+    for (uint32_t brickGridIndex : this->prefetchRequests)
+    {
+        uint32_t cellIndex;
+        BrickGridPage* page = pageTable.FindPage(brickGridIndex, cellIndex);
+        if (!page || page->onGPU.Test(cellIndex) || page->reading.Test(cellIndex) || page->pendingRead.Test(cellIndex))
+            continue;
+
+        if (!queuePrefetchRead(brickGridIndex))
+            break; // Queue full, the next prediction tries again
+
+        page->pendingRead.Set(cellIndex);
+        page->reading.Set(cellIndex);
+    }
 }
 
 //================================//
-void VoxelManager::requestUploadBufferMap(int slotIndex)
+// Called before startOfFrame, pendingUploadCount still holds the uploads of the last frame
+void VoxelManager::updateStreamingBudget(float gpuUploadMs, float gpuFrameMs, float cpuFrameMs)
 {
-    UploadBufferSlot& slot = uploadBufferSlots[slotIndex];
-    
-    if (slot.state != BufferState::Available)
-        return; // Already mapping or mapped, we cannot request again on this slot
-    
-    slot.state = BufferState::MappingInFlight;
-    
-    UploadMapCallbackContext* ctx = new UploadMapCallbackContext{this, slotIndex};
-    
-    slot.cpuBuffer.MapAsync(
-        wgpu::MapMode::Write,
-        0,
-        MAX_FEEDBACK * sizeof(UploadEntry),
-        wgpu::CallbackMode::AllowProcessEvents,
-        [](wgpu::MapAsyncStatus status, wgpu::StringView message, UploadMapCallbackContext* ctx) {
-            if (status == wgpu::MapAsyncStatus::Success)
-            {
-                ctx->voxelManager->uploadBufferSlots[ctx->slotIndex].state = BufferState::Mapped;
-            }
-            else
-            {
-                ctx->voxelManager->uploadBufferSlots[ctx->slotIndex].state = BufferState::Available;
-                std::cerr << "[VoxelManager] Upload buffer map failed for slot " << ctx->slotIndex << std::endl;
-            }
-            delete ctx;
-        },
-        ctx
-    );
+    this->streamingBudget.Update(gpuUploadMs, gpuFrameMs, cpuFrameMs, GetDiskQueueDepth(), this->pendingUploadCount);
+}
+
+//================================//
+uint32_t VoxelManager::GetDiskQueueDepth()
+{
+    std::lock_guard<std::mutex> lock(diskReadQueueMutex);
+    return diskReadRequestQueue.Size();
+}
+
+//================================//
+void VoxelManager::processPendingFeedback()
+{
+    if (!hasPendingFeedback)
+        return;
+
+    this->requestRead( this->feedbackRequests );
+    this->feedbackRequests.clear();
+    this->hasPendingFeedback = false;
 }
 
 //================================//
@@ -556,8 +1218,10 @@ void VoxelManager::requestFeedbackBufferMap(int slotIndex)
     
     slot.state = BufferState::MappingInFlight;
     
-    // Create context for callback
-    FeedbackMapCallbackContext* ctx = new FeedbackMapCallbackContext{this, slotIndex};
+    // Context for the callback, owned by the slot so mapping does not allocate
+    FeedbackMapCallbackContext* ctx = &slot.mapContext;
+    ctx->voxelManager = this;
+    ctx->slotIndex = slotIndex;
     
     size_t bufferSize = sizeof(uint32_t) + MAX_FEEDBACK * sizeof(uint32_t);
     
@@ -583,7 +1247,7 @@ void VoxelManager::requestFeedbackBufferMap(int slotIndex)
                     mappedData + sizeof(uint32_t)
                 );
                 
-                // Copy feedback data
+                // Copy feedback data, within the MAX_FEEDBACK reserved up front
                 ctx->voxelManager->feedbackRequests.resize(count);
                 if (count > 0)
                 {
@@ -601,8 +1265,6 @@ void VoxelManager::requestFeedbackBufferMap(int slotIndex)
                 slot.state = BufferState::Available;
                 std::cerr << "[VoxelManager] Feedback buffer map failed for slot " << ctx->slotIndex << std::endl;
             }
-            
-            delete ctx;
         },
         ctx
     );
@@ -613,39 +1275,38 @@ void VoxelManager::requestFeedbackBufferMap(int slotIndex)
 void VoxelManager::processAsyncOperations(wgpu::Instance& instance)
 {
     instance.ProcessEvents(); // Apparently this fires the callbacks for mapping
-    
-    for (int i = 0; i < NUM_UPLOAD_BUFFERS; ++i)
-    {
-        if (uploadBufferSlots[i].state == BufferState::Available)
-        {
-            requestUploadBufferMap(i);
-        }
-    }
+
+    // Chunks copied from last frame were submitted by now
+    uploadStaging.RemapSubmitted();
+    pointerStaging.RemapSubmitted();
 }
 
 //================================//
 void VoxelManager::requestRead(const std::vector<uint32_t>& indices)
 {
-    const uint32_t maxValidIndex = static_cast<uint32_t>(brickGridCPU.size());
+    const int maxDiskReads = static_cast<int>(streamingBudget.GetMaxDiskReads());
     int queuedCount = 0;
 
     for (uint32_t requestedBrickIndex : indices)
     {
-        if (queuedCount >= MAX_PENDING_DISK_READS)
+        if (queuedCount >= maxDiskReads)
             break; // We cannot add more reads this frame, we will catch up next frame
 
-        if (requestedBrickIndex >= maxValidIndex)
-            continue; // Invalid index, skip (we filter here)
+        uint32_t cellIndex;
+        BrickGridPage* page = pageTable.FindPage(requestedBrickIndex, cellIndex);
+        if (!page)
+            continue; // Invalid index or empty page, skip (we filter here)
 
-        BrickGridCellCPU& brickCell = brickGridCPU[requestedBrickIndex];
-
-        if (brickCell.onGPU || brickCell.reading || brickCell.pendingRead)
+        if (page->onGPU.Test(cellIndex) || page->reading.Test(cellIndex) || page->pendingRead.Test(cellIndex))
             continue;
+        if (page->edited.Test(cellIndex))
+            continue; // Lives in brickMaps, the disk copy is stale
 
-        brickCell.pendingRead = true;
-        brickCell.reading = true;
+        if (!queueDiskRead(requestedBrickIndex))
+            break; // Reader is that far behind, the GPU asks again next frame
 
-        queueDiskRead(requestedBrickIndex);
+        page->pendingRead.Set(cellIndex);
+        page->reading.Set(cellIndex);
         queuedCount++;
     }
 }
@@ -653,21 +1314,45 @@ void VoxelManager::requestRead(const std::vector<uint32_t>& indices)
 //================================//
 void VoxelManager::update(WgpuBundle& wgpuBundle, const wgpu::Queue& queue, const wgpu::CommandEncoder& encoder)
 {
-    // Try to find an available mapped upload buffer
-    int availableSlot = -1;
-    for (int i = 0; i < NUM_UPLOAD_BUFFERS; ++i)
+    // Edits can allocate pages, they reach the GPU once the page pool grew to hold them
+    const bool pagePoolReady = pageTable.GetNumAllocatedPages() <= pagePoolCapacity;
+
+    // Requested by the previous frame, dirtyBrickIndices can only change outside of the upload loop.
+    // Waits for the page pool so its LOD pointers are published before any upload reuses the color blocks
+    if (colorPoolDefragPending && pagePoolReady)
+        defragmentColorPool();
+    if (pageTableDirty && pagePoolReady)
+    {
+        queue.WriteBuffer(brickPageTableBuffer, 0, pageTable.GetEntries().data(), pageTable.GetEntries().size() * sizeof(uint32_t));
+        pageTableDirty = false;
+    }
+
+    if (!pendingCoarseWrites.empty() && pagePoolReady)
     {
-        if (uploadBufferSlots[i].state == BufferState::Mapped)
+        std::sort(pendingCoarseWrites.begin(), pendingCoarseWrites.end());
+        pendingCoarseWrites.erase(std::unique(pendingCoarseWrites.begin(), pendingCoarseWrites.end()), pendingCoarseWrites.end());
+        for (uint32_t pageSlot : pendingCoarseWrites)
         {
-            availableSlot = i;
-            break;
+            queue.WriteBuffer(brickCoarseBuffer, static_cast<uint64_t>(pageSlot) * BRICK_PAGE_COARSE_CELLS * sizeof(uint32_t),
+                              pageTable.GetPage(pageSlot).coarseCells, BRICK_PAGE_COARSE_CELLS * sizeof(uint32_t));
         }
+        pendingCoarseWrites.clear();
     }
 
-    // if we find NO available mapped buffer, therefore we cannot upload this frame, 
-    // or no need to upload anything, szwe pass
-    if (availableSlot < 0 || dirtyBrickIndices.empty())
+    beginAllocationScope();
+
+    // Room for every pointer this frame can publish, reserved up front so bricks are never uploaded without their pointer
+    const uint32_t maxPointerUpdates = static_cast<uint32_t>(std::min<size_t>(MAX_POINTER_UPDATES, dirtyBrickIndices.size() + pendingPointerWrites.size()));
+    PointerUpdate* pointerUpdates = nullptr;
+    if (maxPointerUpdates > 0)
+        pointerUpdates = static_cast<PointerUpdate*>(pointerStaging.Allocate(maxPointerUpdates * sizeof(PointerUpdate)));
+
+    // No need to upload anything (or no staging room left for the pointers), we pass
+    if (!pointerUpdates)
     {
+        endAllocationScope();
+        checkFrameAllocations();
+
         // Still reset feedback count for next frame (htis is free)
         encoder.CopyBufferToBuffer(
             feedbackCountRESET, 0,
@@ -684,56 +1369,94 @@ void VoxelManager::update(WgpuBundle& wgpuBundle, const wgpu::Queue& queue, cons
         return;
     }
 
-    // If we are here, we can map and upload
-    UploadBufferSlot& slot = uploadBufferSlots[availableSlot];
-    
-    // Get the mapped range
-    UploadEntry* uploads = static_cast<UploadEntry*>(slot.cpuBuffer.GetMappedRange(0, MAX_FEEDBACK * sizeof(UploadEntry)));
-    if (!uploads)
+    // Reserved for MAX_POINTER_UPDATES, never grows
+    std::vector<uint32_t>& modifiedIndices = modifiedPoolIndices;
+    modifiedIndices.clear();
+
+    // Bricks emptied by edits, pointer only
+    if (pagePoolReady)
     {
-        std::cerr << "[VoxelManager] Failed to get mapped range for upload buffer" << std::endl;
-        return;
+        const size_t taken = std::min<size_t>(pendingPointerWrites.size(), maxPointerUpdates);
+        modifiedIndices.insert(modifiedIndices.end(), pendingPointerWrites.begin(), pendingPointerWrites.begin() + taken);
+        pendingPointerWrites.erase(pendingPointerWrites.begin(), pendingPointerWrites.begin() + taken);
     }
 
-    std::vector<uint32_t> modifiedIndices;
-    modifiedIndices.reserve(dirtyBrickIndices.size());
-
-    for (uint32_t brickGridIndex : dirtyBrickIndices)
+    const uint32_t maxUploads = std::min(streamingBudget.GetMaxUploads(), static_cast<uint32_t>(MAX_FEEDBACK));
+    size_t dirtyCursor = 0;
+    bool frameFull = false;
+    while (!frameFull && dirtyCursor < dirtyBrickIndices.size())
     {
-        if (pendingUploadCount >= MAX_FEEDBACK) break;
+        // [1] Pick the next bricks in order, pointer only changes are done right away
+        uploadBatch.clear();
+        while (dirtyCursor < dirtyBrickIndices.size() && uploadBatch.size() < UPLOAD_BATCH_BRICKS)
+        {
+            if (pendingUploadCount + uploadBatch.size() >= maxUploads || modifiedIndices.size() + uploadBatch.size() >= maxPointerUpdates)
+            {
+                frameFull = true;
+                break;
+            }
 
-        BrickGridCellCPU& brick = brickGridCPU[brickGridIndex];
+            const uint32_t brickGridIndex = dirtyBrickIndices[dirtyCursor++];
 
-        if (!brick.dirty || !brick.onGPU)
-            continue;
+            uint32_t pageSlot, cellIndex;
+            if (!pageTable.Locate(brickGridIndex, pageSlot, cellIndex) || pageSlot >= pagePoolCapacity)
+                continue;
+
+            BrickGridPage& page = pageTable.GetPage(pageSlot);
+            if (!page.dirty.Test(cellIndex) || !page.onGPU.Test(cellIndex))
+                continue;
 
-        BrickMapCPU& brickMap = brickMaps[brickGridIndex];
-        UploadEntry& entry = uploads[pendingUploadCount++];
+            const BrickMapCPU& brickMap = brickMaps[brickGridIndex];
 
-        entry.gpuBrickSlot = brick.gpuBrickIndex;
-        assert(entry.gpuBrickSlot < static_cast<uint32_t>(maxVisibleBricks));
+            if (page.uniform.Test(cellIndex))
+            {
+                // Pointer only, nothing to upload
+                page.cells[cellIndex].pointer = PackUniform(brickMap.colors[0]);
+                page.dirty.Reset(cellIndex);
+                modifiedIndices.push_back(BrickPageTable::PoolIndex(pageSlot, cellIndex));
+                continue;
+            }
 
-        std::memcpy(entry.occupancy, brickMap.occupancy, sizeof(entry.occupancy));
-        std::memcpy(entry.colors, brickMap.colors, sizeof(entry.colors));
+            // Shared slots are uploaded once, by whichever brick using them comes first
+            const uint32_t slot = page.GetBrickSlot(cellIndex);
+            assert(slot < static_cast<uint32_t>(maxVisibleBricks));
+            if (slotNeedsUpload[slot] == 2)
+                continue; // Already in this batch, this brick only needs its pointer once the upload is staged, next frame
 
-        brickGrid[brickGridIndex].pointer = PackResident(brick.gpuBrickIndex);
-        brick.dirty = false;
-        modifiedIndices.push_back(brickGridIndex);
-    }
+            if (slotNeedsUpload[slot] == 0)
+            {
+                page.cells[cellIndex].pointer = PackResident(slot);
+                page.dirty.Reset(cellIndex);
+                modifiedIndices.push_back(BrickPageTable::PoolIndex(pageSlot, cellIndex));
+                continue;
+            }
+
+            slotNeedsUpload[slot] = 2;
+            uploadBatch.push_back({&brickMap, &page, pageSlot, cellIndex, slot, 0, nullptr});
+        }
 
-    // Unmap the buffer before using it in a copy
-    slot.cpuBuffer.Unmap();
-    slot.state = BufferState::Available;  // Will be re-mapped by processAsyncOperations
-    slot.pendingCount = pendingUploadCount;
+        if (!uploadBatch.empty() && !stageUploadBatch(modifiedIndices))
+            frameFull = true;
+    }
 
-    if (pendingUploadCount > 0)
+    // Pointers are published by the upload shader once the bricks are written, a cell changed twice is only sent once
+    std::sort(modifiedIndices.begin(), modifiedIndices.end());
+    modifiedIndices.erase(std::unique(modifiedIndices.begin(), modifiedIndices.end()), modifiedIndices.end());
+    for (size_t i = 0; i < modifiedIndices.size(); ++i)
     {
-        encoder.CopyBufferToBuffer(
-            slot.cpuBuffer, 0,
-            uploadBuffer, 0,
-            pendingUploadCount * sizeof(UploadEntry)
-        );
+        const uint32_t poolIndex = modifiedIndices[i];
+        pointerUpdates[i].poolIndex = poolIndex;
+        pointerUpdates[i].pointer = pageTable.GetPage(poolIndex / BRICK_PAGE_CELLS).cells[poolIndex % BRICK_PAGE_CELLS].pointer;
     }
+    pendingPointerUpdateCount = static_cast<uint32_t>(modifiedIndices.size());
+
+    // Commands are recorded last, what the WebGPU implementation allocates for them is not ours to count
+    endAllocationScope();
+    checkFrameAllocations();
+
+    // Copies every staging chunk written this frame, entries land contiguous in uploadBuffer
+    uploadStaging.Flush(encoder, uploadBuffer, 0);
+    pointerStaging.Flush(encoder, pointerUpdateBuffer, 0);
 
     // Set feedback count to 0 for next frame
     encoder.CopyBufferToBuffer(
@@ -747,37 +1470,114 @@ void VoxelManager::update(WgpuBundle& wgpuBundle, const wgpu::Queue& queue, cons
         brickRequestFlagsBuffer, 0,
         brickRequestFlagsBuffer.GetSize()
     );
+}
+
+//================================//
+// Colors are encoded in parallel first, their size decides the color block. Color blocks and staging
+// entries are then taken in order, and the entries filled in parallel
+bool VoxelManager::stageUploadBatch(std::vector<uint32_t>& modifiedIndices)
+{
+    JobSystem& jobs = JobSystem::Shared();
+    const uint32_t batchSize = static_cast<uint32_t>(uploadBatch.size());
 
-    // Write updated brick grid to GPU
-    if (!modifiedIndices.empty())
+    // [1] Encode
+    if (hasColor)
     {
-        std::sort(modifiedIndices.begin(), modifiedIndices.end());
-        
-        const size_t count = modifiedIndices.size();
-        size_t i = 0;
-        
-        while (i < count)
+        jobs.ParallelFor(batchSize, 8, [this](uint32_t i) {
+            UploadBatchEntry& batchEntry = this->uploadBatch[i];
+            batchEntry.colorWords = EncodeBrickColors(this->colorFormat, batchEntry.brickMap->occupancy, batchEntry.brickMap->colors, &this->uploadBatchColors[static_cast<size_t>(i) * 512]);
+        });
+    }
+
+    // [2] Color blocks and staging entries, in order
+    bool frameFull = false;
+    for (uint32_t i = 0; i < batchSize; ++i)
+    {
+        UploadBatchEntry& batchEntry = uploadBatch[i];
+        const uint32_t slot = batchEntry.slot;
+        slotNeedsUpload[slot] = 1; // Back to waiting unless staged below
+
+        if (frameFull)
+            continue;
+
+        // The block is kept when the staging ring was full last frame
+        const uint32_t poolWords = ColorPoolWords(colorFormat, batchEntry.colorWords);
+        if (poolWords > 0 && slotColorBlockWords[slot] == 0 &&
+            !colorAllocator.Allocate(poolWords, slotColorOffsets[slot], slotColorBlockWords[slot]))
         {
-            uint32_t rangeStart = modifiedIndices[i];
-            uint32_t rangeEnd = rangeStart;
-            
-            while (i + 1 < count && modifiedIndices[i + 1] == rangeEnd + 1)
+            // Enough freed space but too scattered, compact it next frame
+            if (colorAllocator.GetFreeListWords() >= colorAllocator.GetCapacityWords() / 8)
             {
-                i++;
-                rangeEnd++;
+                colorPoolDefragPending = true;
+                frameFull = true;
+                continue;
             }
-            
-            // Write the contiguous range
-            uint32_t rangeSize = rangeEnd - rangeStart + 1;
-            queue.WriteBuffer(
-                brickGridBuffer,
-                rangeStart * sizeof(BrickGridCell),
-                &brickGrid[rangeStart],
-                rangeSize * sizeof(BrickGridCell)
-            );
-            i++;
+            parkForColorBlock(batchEntry, modifiedIndices); // Color pool full
+            continue;
+        }
+
+        // Out of mapped staging memory, the rest stays dirty for next frame
+        batchEntry.stagedEntry = static_cast<UploadEntry*>(uploadStaging.Allocate(sizeof(UploadEntry)));
+        if (!batchEntry.stagedEntry)
+        {
+            frameFull = true;
+            continue;
         }
+
+        pendingUploadCount++;
+        slotNeedsUpload[slot] = 0;
+
+        batchEntry.page->cells[batchEntry.cellIndex].pointer = PackResident(slot);
+        batchEntry.page->dirty.Reset(batchEntry.cellIndex);
+        modifiedIndices.push_back(BrickPageTable::PoolIndex(batchEntry.pageSlot, batchEntry.cellIndex));
+    }
+
+    // [3] Fill the staged entries
+    jobs.ParallelFor(batchSize, 8, [this](uint32_t i) {
+        const UploadBatchEntry& batchEntry = this->uploadBatch[i];
+        if (!batchEntry.stagedEntry)
+            return;
+
+        UploadEntry& entry = *batchEntry.stagedEntry;
+        entry.gpuBrickSlot = batchEntry.slot;
+        entry.colorOffset = static_cast<uint32_t>(this->slotColorOffsets[batchEntry.slot] / COLOR_ALLOCATION_GRANULARITY);
+        entry.colorWords = batchEntry.colorWords;
+        std::memcpy(entry.occupancy, batchEntry.brickMap->occupancy, sizeof(entry.occupancy));
+        std::memcpy(entry.colors, &this->uploadBatchColors[static_cast<size_t>(i) * 512], batchEntry.colorWords * sizeof(uint32_t));
+    });
+
+    return !frameFull;
+}
+
+//================================//
+void VoxelManager::beginAllocationScope()
+{
+    allocationScopeStart = GetThreadAllocationCount();
+    storageGrowthScopeStart = brickStorageUpstream.GetAllocationCount();
+}
+
+//================================//
+void VoxelManager::endAllocationScope()
+{
+    // Brick storage grows by whole chunks as bricks stream in, that is not churn
+    const uint64_t storageGrowth = brickStorageUpstream.GetAllocationCount() - storageGrowthScopeStart;
+    frameAllocations += GetThreadAllocationCount() - allocationScopeStart - storageGrowth;
+}
+
+//================================//
+void VoxelManager::checkFrameAllocations()
+{
+#ifdef SKYEGRID_COUNT_ALLOCATIONS
+    if (allocationWarmupFrames > 0)
+    {
+        allocationWarmupFrames--;
+        return;
     }
+
+    if (frameAllocations > 0)
+        std::cout << "[VoxelManager] " << frameAllocations << " heap allocations in the frame loop." << std::endl;
+    assert(frameAllocations == 0);
+#endif
 }
 
 //================================//
@@ -824,19 +1624,214 @@ void VoxelManager::prepareFeedback(const wgpu::Queue& queue, const wgpu::Command
     currentFeedbackReadSlot = writeSlot;
 }
 
+//================================//
+// GRID REBUILD
+//================================//
+void VoxelManager::ChangeVoxelResolution(WgpuBundle& bundle, int newResolution, int maxVisibleBricks)
+{
+    if (maxVisibleBricks < 0)
+        maxVisibleBricks = this->maxVisibleBricks;
+    requestGridRebuild(validateResolution(bundle, newResolution, maxVisibleBricks, this->colorFormat));
+}
+
+//================================//
+void VoxelManager::ChangeColorFormat(WgpuBundle& bundle, ColorFormat newColorFormat)
+{
+    // Pool sizes depend on the format, resident bricks are carried over and re-encoded
+    requestGridRebuild(validateResolution(bundle, this->voxelResolution, this->maxVisibleBricks, newColorFormat));
+}
+
+//================================//
+void VoxelManager::requestGridRebuild(const GridSettings& settings)
+{
+    // Edits are carried over by brick index, a new brick grid or a pool too small for them would lose the unsaved ones
+    if (this->editedBrickCount > 0 &&
+        (settings.brickResolution != this->BrickResolution || settings.maxVisibleBricks < static_cast<int>(this->editedBrickCount)))
+    {
+        std::cout << "[VoxelManager] " << this->editedBrickCount << " edited bricks are not saved, save them before changing the grid." << std::endl;
+        return;
+    }
+
+    // Only one build at a time, the latest request is started when the running one completes
+    if (this->pendingGridBuild.valid())
+    {
+        this->queuedGridSettings = settings;
+        this->hasQueuedGridBuild = true;
+        return;
+    }
+
+    if (settings == getGridSettings())
+        return; // We literally did not change anything
+
+    startGridRebuild(settings);
+}
+
+//================================//
+void VoxelManager::startGridRebuild(const GridSettings& settings)
+{
+    // NO THREADING ON WEB, the build runs inside pollGridRebuild on the next frame
+#ifdef __EMSCRIPTEN__
+    const std::launch policy = std::launch::deferred;
+#else
+    const std::launch policy = std::launch::async;
+#endif
+    this->pendingGridBuild = std::async(policy, [this, settings]() { return buildGrid(settings); });
+}
+
+//================================//
+bool VoxelManager::pollGridRebuild(WgpuBundle& bundle)
+{
+    const bool pagePoolGrew = growPagePool(bundle);
+
+    if (!this->pendingGridBuild.valid())
+        return pagePoolGrew;
+    if (this->pendingGridBuild.wait_for(std::chrono::seconds(0)) == std::future_status::timeout)
+        return pagePoolGrew; // Still building, keep rendering the current grid
+
+    GridBuildResult result = this->pendingGridBuild.get();
+
+    if (this->hasQueuedGridBuild)
+    {
+        this->hasQueuedGridBuild = false;
+        if (!(this->queuedGridSettings == result.settings))
+        {
+            // The user moved on while we were building, this grid is already stale
+            if (!(this->queuedGridSettings == getGridSettings()))
+                startGridRebuild(this->queuedGridSettings);
+            return pagePoolGrew;
+        }
+    }
+
+    // Clear any pending feedback/uploads that reference old brick indices
+    feedbackRequests.clear();
+    dirtyBrickIndices.clear();
+    colorWaitingBricks.clear();
+    hasPendingFeedback = false;
+    pendingUploadCount = 0;
+    pendingPointerUpdateCount = 0;
+
+    clearDiskReadQueues();
+    prefetcher.Reset();
+
+    // Same brick grid, only the pool size changed, resident and edited bricks are still valid
+    BrickMapStore residentBricks(&this->brickStoragePool);
+    std::vector<uint32_t> editedBricks;
+    if (result.settings.brickResolution == this->BrickResolution)
+    {
+        std::swap(residentBricks, this->brickMaps);
+        editedBricks = collectEditedBricks();
+    }
+
+    applyGrid(bundle, result);
+    carryOverResidentBricks(residentBricks, editedBricks);
+
+    return true;
+}
+
+//================================//
+// Grid indices of the bricks changed at runtime, emptied ones included
+std::vector<uint32_t> VoxelManager::collectEditedBricks() const
+{
+    std::vector<uint32_t> editedBricks;
+    editedBricks.reserve(this->editedBrickCount);
+    for (uint32_t pageSlot = 0; pageSlot < this->pageTable.GetNumAllocatedPages(); pageSlot++)
+    {
+        const BrickGridPage& page = this->pageTable.GetPage(pageSlot);
+        for (uint32_t word = 0; word < BRICK_PAGE_CELLS / 32; word++)
+        {
+            for (uint32_t remaining = page.edited.words[word]; remaining != 0; remaining &= remaining - 1)
+            {
+                const uint32_t cellIndex = word * 32 + static_cast<uint32_t>(std::countr_zero(remaining));
+                editedBricks.push_back(this->pageTable.BrickGridIndexOf(page.pageIndex, cellIndex));
+            }
+        }
+    }
+    return editedBricks;
+}
+
+//================================//
+// Edits are committed again first, the new file knows nothing of them. Then bricks that were resident
+// in the previous pool are re-uploaded, they render as LOD until then
+void VoxelManager::carryOverResidentBricks(BrickMapStore& residentBricks, const std::vector<uint32_t>& editedBricks)
+{
+    static const BrickMapCPU emptyBrick{};
+
+    uint32_t restoredEdits = 0;
+    for (uint32_t brickGridIndex : editedBricks)
+    {
+        // Emptied bricks have no map
+        auto it = residentBricks.find(brickGridIndex);
+        const BrickMapCPU& brick = it != residentBricks.end() ? it->second : emptyBrick;
+        if (commitEditedBrick(brickGridIndex, brick))
+            restoredEdits++;
+        if (it != residentBricks.end())
+            residentBricks.erase(it);
+    }
+    if (restoredEdits != editedBricks.size())
+    {
+        std::cout << "[VoxelManager] Warning: " << (editedBricks.size() - restoredEdits)
+                  << " edited bricks did not fit in the new grid and were lost." << std::endl;
+    }
+
+    uint32_t carried = 0;
+    for (auto it = residentBricks.begin(); it != residentBricks.end();)
+    {
+        auto current = it++;
+        const uint32_t brickGridIndex = current->first;
+
+        uint32_t cellIndex;
+        BrickGridPage* page = this->pageTable.FindPage(brickGridIndex, cellIndex);
+        if (!page)
+            continue;
+
+        const BrickMapCPU& brickMap = current->second;
+        if (!assignBrickSlot(brickGridIndex, *page, cellIndex, brickMap.occupancy, brickMap.colors))
+            break; // The new pool is smaller, the rest will be streamed again on demand
+        page->dirty.Set(cellIndex);
+
+        this->brickMaps.insert(residentBricks.extract(current)); // Moves the node, no brick copy
+        this->dirtyBrickIndices.push_back(brickGridIndex);
+        carried++;
+    }
+
+    if (carried > 0 || restoredEdits > 0)
+        std::cout << "[VoxelManager] Carried " << carried << " resident bricks and " << restoredEdits << " edited bricks over to the new grid." << std::endl;
+}
+
 //================================//
 // WGPU OBJECTS MANAGEMENT
 //================================//
 void VoxelManager::cleanupBuffers()
 {
-    this->brickGrid.clear();
-    this->brickGridCPU.clear();
+    this->pageTable.Clear();
     this->brickMaps.clear();
     this->freeBrickSlots.clear();
 
+    this->slotByHash.clear();
+    this->slotRefCounts.clear();
+    this->slotOwners.clear();
+    this->slotHashed.clear();
+    this->slotHashes.clear();
+    this->slotNeedsUpload.clear();
+    this->slotColorOffsets.clear();
+    this->slotColorBlockWords.clear();
+    this->colorAllocator.Reset();
+    this->colorPoolDefragPending = false;
+    this->colorWaitingBricks.clear();
+    this->colorBlocksFreed = false;
+    this->sharedBrickCount = 0;
+    this->uniformBrickCount = 0;
+    this->editedBrickCount = 0;
+    this->pendingPointerWrites.clear();
+    this->pendingCoarseWrites.clear();
+    this->pageTableDirty = false;
+
+    this->brickPageTableBuffer = nullptr;
     this->brickGridBuffer = nullptr;
+    this->brickCoarseBuffer = nullptr;
     this->brickPoolBuffer = nullptr;
     this->colorPoolBuffers.clear();
+    this->brickColorOffsetsBuffer = nullptr;
 
     this->brickRequestFlagsBuffer = nullptr;
     this->brickRequestFlagsRESET = nullptr;
@@ -890,17 +1885,17 @@ void VoxelManager::initStaticBuffers(WgpuBundle& wgpuBundle)
     desc.mappedAtCreation = false;
     wgpuBundle.SafeCreateBuffer(&desc, this->uploadBuffer);
 
-    // Double-buffered CPU upload buffers
-    for (int i = 0; i < NUM_UPLOAD_BUFFERS; ++i)
-    {
-        desc.size = MAX_FEEDBACK * sizeof(UploadEntry);
-        desc.usage = wgpu::BufferUsage::MapWrite | wgpu::BufferUsage::CopySrc;
-        desc.label = ("Upload Buffer CPU " + std::to_string(i)).c_str();
-        desc.mappedAtCreation = true; // SO ALL IN POOL ARE AVAILABLE INITIALLY
-        wgpuBundle.SafeCreateBuffer(&desc, uploadBufferSlots[i].cpuBuffer);
-        uploadBufferSlots[i].state = BufferState::Mapped;
-        uploadBufferSlots[i].pendingCount = 0;
-    }
+    // CPU staging ring for the upload entries
+    static_assert(sizeof(UploadEntry) <= STAGING_CHUNK_SIZE);
+    this->uploadStaging.Init(wgpuBundle, STAGING_CHUNK_SIZE, STAGING_RING_CHUNKS, "Upload Staging Chunk");
+
+    // Pointer updates, scattered into the brick grid after the uploads
+    desc.size = MAX_POINTER_UPDATES * sizeof(PointerUpdate);
+    desc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+    desc.label = "Pointer Update Buffer (GPU)";
+    desc.mappedAtCreation = false;
+    wgpuBundle.SafeCreateBuffer(&desc, this->pointerUpdateBuffer);
+    this->pointerStaging.Init(wgpuBundle, MAX_POINTER_UPDATES * sizeof(PointerUpdate), POINTER_STAGING_CHUNKS, "Pointer Staging Chunk");
 
     // Upload count uniform buffer
     desc.size = sizeof(UploadUniform);
@@ -913,39 +1908,40 @@ void VoxelManager::initStaticBuffers(WgpuBundle& wgpuBundle)
 //================================//
 void VoxelManager::initDynamicBuffers(WgpuBundle& wgpuBundle)
 {
-    cleanupBuffers();
+    // Synchronous path, used at startup when there is no grid to keep rendering
+    GridBuildResult result = buildGrid(getGridSettings());
+    applyGrid(wgpuBundle, result);
+}
 
-    const uint32_t numBricks = static_cast<uint64_t>(this->BrickResolution) * static_cast<uint64_t>(this->BrickResolution) * static_cast<uint64_t>(this->BrickResolution);
-    const uint32_t numVisibleBricks = static_cast<uint32_t>(this->maxVisibleBricks);
-    const uint64_t numVoxels = static_cast<uint64_t>(numBricks) * 512;
+//================================//
+// Runs on the grid builder thread, must only touch the result and the file index
+GridBuildResult VoxelManager::buildGrid(const GridSettings& settings)
+{
+    GridBuildResult result;
+    result.settings = settings;
+
+    const uint64_t numBricks = static_cast<uint64_t>(settings.brickResolution) * static_cast<uint64_t>(settings.brickResolution) * static_cast<uint64_t>(settings.brickResolution);
+    const uint32_t numVisibleBricks = static_cast<uint32_t>(settings.maxVisibleBricks);
 
-    // CPU storage initialization
-    this->brickGrid.resize(numBricks);
-    this->brickGridCPU.resize(numBricks);
-    this->freeBrickSlots.resize(numVisibleBricks);
+    // CPU storage initialization, pages are only allocated for occupied bricks
+    result.pageTable.Init(static_cast<uint32_t>(settings.brickResolution));
+    result.freeBrickSlots.resize(numVisibleBricks);
 
     // If loaded file, and matching resolution, get info on bricks here
     std::vector<brickIndexEntry> loadedBricks;
     bool matchingResolution = false;
-    if (this->loadedMesh)
     {
-        this->voxelFileReader->getInitialOccupiedBricks(loadedBricks);
-        matchingResolution = (this->voxelFileReader->getResolution() == this->voxelResolution);
+        std::lock_guard<std::mutex> lock(fileReadMutex);
+        if (this->loadedMesh)
+        {
+            this->voxelFileReader->getInitialOccupiedBricks(loadedBricks);
+            matchingResolution = (this->voxelFileReader->getResolution() == static_cast<uint32_t>(settings.voxelResolution));
+        }
     }
 
-    for(uint32_t i = 0; i < this->brickGrid.size(); ++i)
-    {
-        this->brickGrid[i].pointer = PackEmptyPointer();
-
-        BrickGridCellCPU& cell = this->brickGridCPU[i];
-        cell.dirty = false;
-        cell.onGPU = false;
-        cell.gpuBrickIndex = UINT32_MAX;
-        cell.LODColor = {0,0,0};
-    }
     for (uint32_t i = 0; i < numVisibleBricks; ++i)
     {
-        freeBrickSlots[i] = numVisibleBricks - 1 - i;
+        result.freeBrickSlots[i] = numVisibleBricks - 1 - i;
     }
 
     if (matchingResolution)
@@ -955,25 +1951,64 @@ void VoxelManager::initDynamicBuffers(WgpuBundle& wgpuBundle)
             if (entry.brickGridIndex >= numBricks)
                 continue;
 
-            ColorRGB lod = {entry.LOD_R, entry.LOD_G, entry.LOD_B};
-            this->brickGrid[entry.brickGridIndex].pointer = PackLOD(lod);
+            const uint32_t pageSlot = result.pageTable.AllocatePage(result.pageTable.PageIndexOf(entry.brickGridIndex));
+            const uint32_t cellIndex = result.pageTable.CellIndexOf(entry.brickGridIndex);
+            BrickGridPage& page = result.pageTable.GetPage(pageSlot);
+
+            ColorRGB lod = {entry.LOD_R, entry.LOD_G, entry.LOD_B, 0};
+            page.cells[cellIndex].pointer = PackLOD(lod);
+            page.SetLODColor(cellIndex, lod);
+        }
 
-            BrickGridCellCPU& cell = this->brickGridCPU[entry.brickGridIndex];
-            cell.LODColor = lod;
+        for (uint32_t pageSlot = 0; pageSlot < result.pageTable.GetNumAllocatedPages(); ++pageSlot)
+        {
+            result.pageTable.BuildCoarseCells(pageSlot);
         }
     }
 
+    return result;
+}
+
+//================================//
+// Swaps the built grid in and creates the GPU buffers sized for it, render thread only
+void VoxelManager::applyGrid(WgpuBundle& wgpuBundle, GridBuildResult& result)
+{
+    cleanupBuffers();
+
+    applyGridSettings(result.settings);
+    this->pageTable = std::move(result.pageTable);
+    this->freeBrickSlots = std::move(result.freeBrickSlots);
+
+    const uint32_t numVisibleBricks = static_cast<uint32_t>(this->maxVisibleBricks);
+    const uint32_t numPages = this->pageTable.GetNumPages();
+
+    this->slotRefCounts.assign(numVisibleBricks, 0);
+    this->slotOwners.assign(numVisibleBricks, UINT32_MAX);
+    this->slotHashed.assign(numVisibleBricks, 0);
+    this->slotHashes.assign(numVisibleBricks, 0);
+    this->slotNeedsUpload.assign(numVisibleBricks, 0);
+    this->slotColorOffsets.assign(numVisibleBricks, 0);
+    this->slotColorBlockWords.assign(numVisibleBricks, 0);
+    this->pagePoolCapacity = std::max(1u, this->pageTable.GetNumAllocatedPages());
+    this->dirtyBrickIndices.reserve(numVisibleBricks);
+    this->pendingPointerWrites.reserve(numVisibleBricks);
+    this->colorWaitingBricks.reserve(numVisibleBricks);
+    this->allocationWarmupFrames = ALLOCATION_WARMUP_FRAMES;
+    std::cout << "[VoxelManager] Allocated " << this->pageTable.GetNumAllocatedPages() << " / " << numPages << " brick pages." << std::endl;
+
     // GPU storage initialization
     wgpu::Queue queue = wgpuBundle.GetDevice().GetQueue();
 
-    // [1] BRICK GRID CELL
+    // [1] BRICK PAGE TABLE AND BRICK GRID PAGE POOL
     wgpu::BufferDescriptor desc{};
-    desc.size = numBricks * sizeof(BrickGridCell); // a single uint32_t pointer per cell
+    desc.size = numPages * sizeof(uint32_t);
     desc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
-    desc.label = "Brick Grid Buffer";
+    desc.label = "Brick Page Table Buffer";
     desc.mappedAtCreation = false;
-    wgpuBundle.SafeCreateBuffer(&desc, this->brickGridBuffer);
-    queue.WriteBuffer(brickGridBuffer, 0, brickGrid.data(), desc.size);
+    wgpuBundle.SafeCreateBuffer(&desc, this->brickPageTableBuffer);
+    queue.WriteBuffer(brickPageTableBuffer, 0, this->pageTable.GetEntries().data(), desc.size);
+
+    createPagePoolBuffers(wgpuBundle);
 
     // [2] BRICK POOL BUFFER
     // The max number of bricks, is given by the Maximum Voxel Resolution divided by 8 (brick size)
@@ -983,29 +2018,21 @@ void VoxelManager::initDynamicBuffers(WgpuBundle& wgpuBundle)
     desc.mappedAtCreation = false;
     wgpuBundle.SafeCreateBuffer(&desc, this->brickPoolBuffer);
 
-    desc.size = numBricks * sizeof(uint32_t);
-    desc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
-    desc.label = "Brick Request Flags Buffer";
-    desc.mappedAtCreation = false;
-    wgpuBundle.SafeCreateBuffer(&desc, this->brickRequestFlagsBuffer);
-
-    std::vector<uint32_t> zeroFlags(numBricks, 0);
-    desc.size = numBricks * sizeof(uint32_t);
-    desc.usage = wgpu::BufferUsage::MapWrite | wgpu::BufferUsage::CopySrc;
-    desc.label = "Brick Request Flags Reset Buffer";
-    desc.mappedAtCreation = true;
-    wgpuBundle.SafeCreateBuffer(&desc, this->brickRequestFlagsRESET);
-    memcpy(brickRequestFlagsRESET.GetMappedRange(), zeroFlags.data(), numBricks * sizeof(uint32_t));
-    brickRequestFlagsRESET.Unmap();
-
     // [3] COLOR POOL BUFFERS
-    // 512 voxels * 3 bytes per voxel
-    this->colorPoolBuffers.resize(MAX_COLOR_POOLS);
-    uint64_t poolSize = this->maxColorBufferEntries * sizeof(uint32_t);
-    uint64_t totalColorSizeNeeded = static_cast<uint64_t>(numVisibleBricks) * static_cast<uint64_t>(COLOR_BYTES_PER_BRICK);
+    // Variable size color blocks, sub-allocated by colorAllocator over all the pools
+    this->colorPoolBuffers.resize(this->maxColorPools);
+    uint64_t poolSize = static_cast<uint64_t>(this->maxColorBufferEntries) * sizeof(uint32_t);
+    uint64_t totalColorSizeNeeded = static_cast<uint64_t>(numVisibleBricks) * EstimatedColorBytesPerBrick(this->colorFormat);
     uint64_t remaining = totalColorSizeNeeded; // total size needed across all pools
+    this->colorAllocator.Init(this->hasColor ? totalColorSizeNeeded / sizeof(uint32_t) : 0, this->maxColorBufferEntries);
+
+    desc.size = std::max<uint64_t>(numVisibleBricks, 1) * sizeof(uint32_t);
+    desc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+    desc.label = "Brick Color Offsets Buffer";
+    desc.mappedAtCreation = false;
+    wgpuBundle.SafeCreateBuffer(&desc, this->brickColorOffsetsBuffer);
 
-    for (uint32_t i = 0; i < MAX_COLOR_POOLS; ++i)
+    for (uint32_t i = 0; i < this->maxColorPools; ++i)
     {
         uint64_t bufferSize = 0;
 
@@ -1040,11 +2067,81 @@ void VoxelManager::initDynamicBuffers(WgpuBundle& wgpuBundle)
     }
 }
 
+//================================//
+// Brick grid page pool, its coarse levels and the request flags, all sized by pagePoolCapacity, filled from the CPU pages
+void VoxelManager::createPagePoolBuffers(WgpuBundle& wgpuBundle)
+{
+    wgpu::BufferDescriptor desc{};
+    desc.size = static_cast<uint64_t>(this->pagePoolCapacity) * BRICK_PAGE_CELLS * sizeof(BrickGridCell); // a single uint32_t pointer per cell
+    desc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+    desc.label = "Brick Grid Buffer";
+    desc.mappedAtCreation = true;
+    wgpuBundle.SafeCreateBuffer(&desc, this->brickGridBuffer);
+    {
+        BrickGridCell* mappedCells = static_cast<BrickGridCell*>(brickGridBuffer.GetMappedRange());
+        for (uint32_t pageSlot = 0; pageSlot < this->pageTable.GetNumAllocatedPages(); ++pageSlot)
+        {
+            std::memcpy(mappedCells + BrickPageTable::PoolIndex(pageSlot, 0), this->pageTable.GetPage(pageSlot).cells, BRICK_PAGE_CELLS * sizeof(BrickGridCell));
+        }
+        brickGridBuffer.Unmap();
+    }
+
+    desc.size = static_cast<uint64_t>(this->pagePoolCapacity) * BRICK_PAGE_COARSE_CELLS * sizeof(uint32_t);
+    desc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+    desc.label = "Brick Coarse Buffer";
+    desc.mappedAtCreation = true;
+    wgpuBundle.SafeCreateBuffer(&desc, this->brickCoarseBuffer);
+    {
+        uint32_t* mappedCoarse = static_cast<uint32_t*>(brickCoarseBuffer.GetMappedRange());
+        for (uint32_t pageSlot = 0; pageSlot < this->pageTable.GetNumAllocatedPages(); ++pageSlot)
+        {
+            std::memcpy(mappedCoarse + pageSlot * BRICK_PAGE_COARSE_CELLS, this->pageTable.GetPage(pageSlot).coarseCells, BRICK_PAGE_COARSE_CELLS * sizeof(uint32_t));
+        }
+        brickCoarseBuffer.Unmap();
+    }
+
+    // Request flags, a bitset per allocated page
+    const uint64_t requestFlagsSize = static_cast<uint64_t>(this->pagePoolCapacity) * BRICK_PAGE_REQUEST_WORDS * sizeof(uint32_t);
+    desc.size = requestFlagsSize;
+    desc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+    desc.label = "Brick Request Flags Buffer";
+    desc.mappedAtCreation = false;
+    wgpuBundle.SafeCreateBuffer(&desc, this->brickRequestFlagsBuffer);
+
+    // Mapped at creation memory is zero initialized
+    desc.size = requestFlagsSize;
+    desc.usage = wgpu::BufferUsage::MapWrite | wgpu::BufferUsage::CopySrc;
+    desc.label = "Brick Request Flags Reset Buffer";
+    desc.mappedAtCreation = true;
+    wgpuBundle.SafeCreateBuffer(&desc, this->brickRequestFlagsRESET);
+    std::memset(brickRequestFlagsRESET.GetMappedRange(), 0, requestFlagsSize);
+    brickRequestFlagsRESET.Unmap();
+}
+
+//================================//
+// Edits allocated pages past the pool, the pool is recreated bigger and every page copied back from the CPU
+bool VoxelManager::growPagePool(WgpuBundle& wgpuBundle)
+{
+    const uint32_t numAllocatedPages = this->pageTable.GetNumAllocatedPages();
+    if (numAllocatedPages <= this->pagePoolCapacity)
+        return false;
+
+    this->pagePoolCapacity = std::min(std::max(numAllocatedPages, this->pagePoolCapacity * 2), this->pageTable.GetNumPages());
+    createPagePoolBuffers(wgpuBundle);
+
+    wgpu::Queue queue = wgpuBundle.GetDevice().GetQueue();
+    queue.WriteBuffer(this->brickPageTableBuffer, 0, this->pageTable.GetEntries().data(), this->pageTable.GetEntries().size() * sizeof(uint32_t));
+    this->pageTableDirty = false;
+
+    std::cout << "[VoxelManager] Page pool grew to " << this->pagePoolCapacity << " pages." << std::endl;
+    return true;
+}
+
 //================================//
 void VoxelManager::createUploadBindGroup(RenderPipelineWrapper& pipelineWrapper, WgpuBundle& wgpuBundle)
 {
-    // entries: 6, since max color pools is 3
-    wgpu::BindGroupEntry entries[6]{};
+    // entries: the fixed bindings, then one per color pool
+    std::vector<wgpu::BindGroupEntry> entries(UPLOAD_VOXEL_COLOR_POOL_BINDING + this->maxColorPools);
 
     entries[0].binding = 0;
     entries[0].buffer = this->uploadBuffer;
@@ -1061,18 +2158,34 @@ void VoxelManager::createUploadBindGroup(RenderPipelineWrapper& pipelineWrapper,
     entries[2].offset = 0;
     entries[2].size = this->brickPoolBuffer.GetSize();
 
-    for (int i = 0; i < MAX_COLOR_POOLS; ++i)
+    entries[3].binding = 3;
+    entries[3].buffer = this->brickColorOffsetsBuffer;
+    entries[3].offset = 0;
+    entries[3].size = this->brickColorOffsetsBuffer.GetSize();
+
+    entries[4].binding = 4;
+    entries[4].buffer = this->pointerUpdateBuffer;
+    entries[4].offset = 0;
+    entries[4].size = this->pointerUpdateBuffer.GetSize();
+
+    entries[5].binding = 5;
+    entries[5].buffer = this->brickGridBuffer;
+    entries[5].offset = 0;
+    entries[5].size = this->brickGridBuffer.GetSize();
+
+    for (uint32_t i = 0; i < this->maxColorPools; ++i)
     {
-        entries[3 + i].binding = 3 + i;
-        entries[3 + i].buffer = this->colorPoolBuffers[i];
-        entries[3 + i].offset = 0;
-        entries[3 + i].size = this->colorPoolBuffers[i].GetSize();
+        const uint32_t binding = UPLOAD_VOXEL_COLOR_POOL_BINDING + i;
+        entries[binding].binding = binding;
+        entries[binding].buffer = this->colorPoolBuffers[i];
+        entries[binding].offset = 0;
+        entries[binding].size = this->colorPoolBuffers[i].GetSize();
     }
 
     wgpu::BindGroupDescriptor bindGroupDesc{};
     bindGroupDesc.layout = pipelineWrapper.bindGroupLayout;
-    bindGroupDesc.entryCount = 6;
-    bindGroupDesc.entries = entries;
+    bindGroupDesc.entryCount = static_cast<uint32_t>(entries.size());
+    bindGroupDesc.entries = entries.data();
 
     pipelineWrapper.bindGroup = wgpuBundle.GetDevice().CreateBindGroup(&bindGroupDesc);
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "../includes/Voxelizer.hpp"
 #include "../includes/VoxelIO.hpp"
+#include "../includes/JobSystem.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -7,6 +8,11 @@
 
 #include <iostream>
 #include <filesystem>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h" 
@@ -22,25 +28,39 @@ struct BrickOutput {
 };
 
 //================================//
-Voxelizer::Voxelizer()
+Voxelizer::Voxelizer(VoxelizerBackend backend) : backend(backend)
 {
+    if (this->backend == VoxelizerBackend::CPU)
+        return; // No device needed
+
     this->gpuBundle = std::make_unique<WgpuBundle>(WindowFormat{nullptr, 1, 1, false});
 
     CreateVoxelizationPipeline(*this->gpuBundle, this->voxelizationPipeline);
+    CreateVoxelColorPipeline(*this->gpuBundle, this->voxelColorPipeline);
     CreateCompactVoxelPipeline(*this->gpuBundle, this->compactVoxelPipeline);
+    CreateTriangleBinningPipeline(*this->gpuBundle, this->triangleBinningPipeline);
+    CreateBinPrefixSumPipeline(*this->gpuBundle, this->binPrefixSumPipeline);
+    CreateSolidFillPipeline(*this->gpuBundle, this->solidFillPipeline);
+    CreateCandidateBricksPipeline(*this->gpuBundle, this->candidateBricksPipeline);
 }
 
 //================================//
-Voxelizer::~Voxelizer()
+static void freeTextureData(std::vector<TextureInfo>& texturesInfo)
 {
-    int numTextures = static_cast<int>(this->texturesInfo.size());
-    for (int i = 0; i < numTextures; i++)
+    for (TextureInfo& texInfo : texturesInfo)
     {
-        if (this->texturesInfo[i].data) 
+        if (texInfo.data) 
         {
-            stbi_image_free(this->texturesInfo[i].data);
+            stbi_image_free(texInfo.data);
         }
     }
+    texturesInfo.clear();
+}
+
+//================================//
+Voxelizer::~Voxelizer()
+{
+    freeTextureData(this->texturesInfo);
 }
 
 //================================//
@@ -68,9 +88,16 @@ bool Voxelizer::loadMesh(const std::string& filename, const std::string& texture
     this->facesVec.clear();
     this->normalsVec.clear();
     this->uvsVec.clear();
-    this->texturesInfo.clear();
+    freeTextureData(this->texturesInfo);
     this->textureIndicesVec.clear();
+    this->meshStream.reset();
 
+    if (this->streamChunkTriangles > 0 && MeshStream::IsSupported(filename))
+    {
+        if (this->backend == VoxelizerBackend::GPU)
+            return this->openMeshStream(filename, texturePath);
+        std::cout << "[Voxelizer] Streaming is only supported by the GPU backend, loading the whole mesh" << std::endl;
+    }
 
     Assimp::Importer importer;
     
@@ -89,8 +116,15 @@ bool Voxelizer::loadMesh(const std::string& filename, const std::string& texture
         return false;
     }
 
-    unsigned int numEmbeddedTextures = scene->mNumTextures;
-    std::cout << numEmbeddedTextures << " embedded textures found in the model." << std::endl;
+    // Texture array layer of each material. A texture given on the command line, or found next to the model, is used by all
+    std::vector<int> materialLayers;
+    if (texturePath.empty())
+        materialLayers = this->loadMaterialTextures(scene, filename);
+    if (this->texturesInfo.empty())
+    {
+        this->loadMeshTexture(filename, texturePath);
+        materialLayers.assign(scene->mNumMaterials, 0);
+    }
 
     size_t totalVertices = 0;
     size_t totalFaces = 0;
@@ -151,14 +185,7 @@ bool Voxelizer::loadMesh(const std::string& filename, const std::string& texture
             }
 
             // Which texture is it going to use
-            if (numEmbeddedTextures > 0)
-            {
-                this->textureIndicesVec.push_back(mesh->mMaterialIndex);
-            }
-            else
-            {
-                this->textureIndicesVec.push_back(0); // First texture
-            }
+            this->textureIndicesVec.push_back(materialLayers[mesh->mMaterialIndex]);
         }
 
         // FACES
@@ -209,88 +236,447 @@ bool Voxelizer::loadMesh(const std::string& filename, const std::string& texture
     this->meshHeight = this->meshMaxBounds[1] - this->meshMinBounds[1];
     this->meshDepth = this->meshMaxBounds[2] - this->meshMinBounds[2];
 
-    // Embedded texture?
-    if (scene->HasTextures() && scene->mNumTextures > 0)
+    // UV bounds, the vertices are quantized over them
+    this->uvMinBounds = {std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+    this->uvMaxBounds = {std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()};
+    for (const auto& uv : this->uvsVec)
     {
-        for (int i = 0; i < scene->mNumTextures; i++)
+        this->uvMinBounds[0] = std::min(this->uvMinBounds[0], uv[0]);
+        this->uvMinBounds[1] = std::min(this->uvMinBounds[1], uv[1]);
+        this->uvMaxBounds[0] = std::max(this->uvMaxBounds[0], uv[0]);
+        this->uvMaxBounds[1] = std::max(this->uvMaxBounds[1], uv[1]);
+    }
+
+    this->weldVertices();
+    this->sortTrianglesSpatially();
+
+    this->textureArray.Build(this->texturesInfo);
+    std::cout << "[Voxelizer] Total textures loaded: " << this->texturesInfo.size() << ", array layers of "
+              << this->textureArray.GetWidth() << "x" << this->textureArray.GetHeight() << " with "
+              << this->textureArray.GetMipCount() << " mip levels" << std::endl;
+    return true;
+}
+
+//================================//
+void Voxelizer::weldVertices()
+{
+    // Assimp splits vertices per face, they are merged on position, UV and texture. The normals are not voxelized
+    struct WeldKeyHash
+    {
+        size_t operator()(const std::array<double, 6>& key) const
         {
-            this->texturesInfo.push_back({false, 0, 0, 0, nullptr, ""});
-            aiTexture* tex = scene->mTextures[i];
+            size_t hash = 0;
+            for (double value : key)
+                hash = hash * 1000003u ^ std::hash<double>()(value);
+            return hash;
+        }
+    };
 
-            if (tex->mHeight == 0) // Compressed texture like PNG or JPG
-            {
-                this->texturesInfo[i].data = stbi_load_from_memory(
-                    reinterpret_cast<unsigned char*>(tex->pcData),
-                    tex->mWidth,
-                    &this->texturesInfo[i].width, &this->texturesInfo[i].height, &this->texturesInfo[i].channels, 0
-                );
-                this->texturesInfo[i].hasTexture = (this->texturesInfo[i].data != nullptr);
-                if (this->texturesInfo[i].hasTexture)
-                {
-                    this->texturesInfo[i].name = tex->mFilename.C_Str();
-                    std::cout << "[Voxelizer] Loaded embedded texture: " 
-                            << this->texturesInfo[i].width << "x" << this->texturesInfo[i].height << " with name: " << this->texturesInfo[i].name << std::endl;
-                }
-            }
-            else // Raw, uncompressed texture data
+    const size_t numVertices = this->verticesVec.size();
+    std::unordered_map<std::array<double, 6>, int, WeldKeyHash> weldedIndices;
+    weldedIndices.reserve(numVertices);
+    std::vector<int> remap(numVertices);
+
+    size_t numWelded = 0;
+    for (size_t i = 0; i < numVertices; i++)
+    {
+        const std::array<double, 3>& position = this->verticesVec[i];
+        const std::array<double, 2>& uv = this->uvsVec[i];
+        std::array<double, 6> key = {position[0], position[1], position[2], uv[0], uv[1], static_cast<double>(this->textureIndicesVec[i])};
+
+        auto [it, inserted] = weldedIndices.try_emplace(key, static_cast<int>(numWelded));
+        if (inserted)
+        {
+            this->verticesVec[numWelded] = this->verticesVec[i];
+            this->normalsVec[numWelded] = this->normalsVec[i];
+            this->uvsVec[numWelded] = this->uvsVec[i];
+            this->textureIndicesVec[numWelded] = this->textureIndicesVec[i];
+            numWelded++;
+        }
+        remap[i] = it->second;
+    }
+
+    this->verticesVec.resize(numWelded);
+    this->normalsVec.resize(numWelded);
+    this->uvsVec.resize(numWelded);
+    this->textureIndicesVec.resize(numWelded);
+    for (auto& face : this->facesVec)
+    {
+        for (int& index : face)
+            index = remap[index];
+    }
+
+    std::cout << "[Voxelizer] Welded " << numVertices << " vertices into " << numWelded << std::endl;
+}
+
+//================================//
+static uint32_t SpreadBits10(uint32_t value)
+{
+    value &= 0x3FF;
+    value = (value | (value << 16)) & 0x030000FF;
+    value = (value | (value << 8)) & 0x0300F00F;
+    value = (value | (value << 4)) & 0x030C30C3;
+    value = (value | (value << 2)) & 0x09249249;
+    return value;
+}
+
+//================================//
+void Voxelizer::sortTrianglesSpatially()
+{
+    double maxExtent = std::max({meshWidth, meshHeight, meshDepth});
+    if (this->facesVec.empty() || maxExtent <= 0.0)
+        return;
+
+    // Morton code of the centroids on a 1024^3 grid. Neighbouring triangles share vertices and bricks,
+    // so the vertex fetches of a workgroup and the triangle ranges of the binning stay local
+    const size_t numFaces = this->facesVec.size();
+    std::vector<std::pair<uint32_t, uint32_t>> order(numFaces);
+    for (size_t f = 0; f < numFaces; f++)
+    {
+        const std::array<int, 3>& face = this->facesVec[f];
+        uint32_t code = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            double centroid = (this->verticesVec[face[0]][axis] + this->verticesVec[face[1]][axis] + this->verticesVec[face[2]][axis]) / 3.0;
+            double cell = std::clamp((centroid - this->meshMinBounds[axis]) / maxExtent * 1024.0, 0.0, 1023.0);
+            code |= SpreadBits10(static_cast<uint32_t>(cell)) << axis;
+        }
+        order[f] = {code, static_cast<uint32_t>(f)};
+    }
+    std::sort(order.begin(), order.end());
+
+    // Vertices in first use order, consecutive triangles read neighbouring vertices
+    std::vector<std::array<int, 3>> sortedFaces(numFaces);
+    std::vector<int> newIndices(this->verticesVec.size(), -1);
+    std::vector<std::array<double, 3>> sortedVertices;
+    std::vector<std::array<double, 3>> sortedNormals;
+    std::vector<std::array<double, 2>> sortedUVs;
+    std::vector<int> sortedTextureIndices;
+    sortedVertices.reserve(this->verticesVec.size());
+    sortedNormals.reserve(this->verticesVec.size());
+    sortedUVs.reserve(this->verticesVec.size());
+    sortedTextureIndices.reserve(this->verticesVec.size());
+
+    for (size_t f = 0; f < numFaces; f++)
+    {
+        const std::array<int, 3>& face = this->facesVec[order[f].second];
+        for (int corner = 0; corner < 3; corner++)
+        {
+            int& newIndex = newIndices[face[corner]];
+            if (newIndex < 0)
             {
-                this->texturesInfo[i].width = tex->mWidth;
-                this->texturesInfo[i].height = tex->mHeight;
-                this->texturesInfo[i].channels = 4; // ARGB8888
-                size_t dataSize = tex->mWidth * tex->mHeight * 4;
-                this->texturesInfo[i].data = new unsigned char[dataSize];
-                std::memcpy(this->texturesInfo[i].data, tex->pcData, dataSize);
-                this->texturesInfo[i].hasTexture = true;
-                this->texturesInfo[i].name = tex->mFilename.C_Str();
-                std::cout << "[Voxelizer] Loaded RAW embedded texture: " 
-                        << this->texturesInfo[i].width << "x" << this->texturesInfo[i].height << " with name: " << this->texturesInfo[i].name << std::endl;
+                newIndex = static_cast<int>(sortedVertices.size());
+                sortedVertices.push_back(this->verticesVec[face[corner]]);
+                sortedNormals.push_back(this->normalsVec[face[corner]]);
+                sortedUVs.push_back(this->uvsVec[face[corner]]);
+                sortedTextureIndices.push_back(this->textureIndicesVec[face[corner]]);
             }
+            sortedFaces[f][corner] = newIndex;
+        }
+    }
+
+    this->facesVec = std::move(sortedFaces);
+    this->verticesVec = std::move(sortedVertices);
+    this->normalsVec = std::move(sortedNormals);
+    this->uvsVec = std::move(sortedUVs);
+    this->textureIndicesVec = std::move(sortedTextureIndices);
+}
+
+//================================//
+static bool loadEmbeddedTexture(const aiTexture* tex, TextureInfo& texInfo)
+{
+    if (tex->mHeight == 0) // Compressed texture like PNG or JPG
+    {
+        texInfo.data = stbi_load_from_memory(
+            reinterpret_cast<const unsigned char*>(tex->pcData),
+            tex->mWidth,
+            &texInfo.width, &texInfo.height, &texInfo.channels, 0
+        );
+        texInfo.hasTexture = (texInfo.data != nullptr);
+    }
+    else // Raw, uncompressed texture data in BGRA texels
+    {
+        texInfo.width = tex->mWidth;
+        texInfo.height = tex->mHeight;
+        texInfo.channels = 4;
+        size_t numTexels = static_cast<size_t>(tex->mWidth) * tex->mHeight;
+        texInfo.data = static_cast<unsigned char*>(std::malloc(numTexels * 4));
+        for (size_t i = 0; i < numTexels; i++)
+        {
+            texInfo.data[i * 4 + 0] = tex->pcData[i].r;
+            texInfo.data[i * 4 + 1] = tex->pcData[i].g;
+            texInfo.data[i * 4 + 2] = tex->pcData[i].b;
+            texInfo.data[i * 4 + 3] = tex->pcData[i].a;
+        }
+        texInfo.hasTexture = true;
+    }
+    return texInfo.hasTexture;
+}
+
+//================================//
+// Embedded textures and files relative to the model, see buildMaterialLayers
+std::vector<int> Voxelizer::loadMaterialTextures(const aiScene* scene, const std::string& filename)
+{
+    // Diffuse, or base color for PBR materials
+    std::vector<std::string> materialTextures(scene->mNumMaterials);
+    std::vector<std::array<float, 3>> diffuseColors(scene->mNumMaterials);
+    for (unsigned int m = 0; m < scene->mNumMaterials; m++)
+    {
+        const aiMaterial* material = scene->mMaterials[m];
+        aiString path;
+        if (material->GetTexture(aiTextureType_DIFFUSE, 0, &path) == AI_SUCCESS ||
+            material->GetTexture(aiTextureType_BASE_COLOR, 0, &path) == AI_SUCCESS)
+        {
+            materialTextures[m] = path.C_Str();
         }
+
+        aiColor3D diffuse(1.0f, 1.0f, 1.0f);
+        material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuse);
+        diffuseColors[m] = {diffuse.r, diffuse.g, diffuse.b};
     }
 
-    if (numEmbeddedTextures == 0) // Load from file near the model
+    const std::filesystem::path modelDirectory = std::filesystem::path(filename).parent_path();
+    return this->buildMaterialLayers(materialTextures, diffuseColors, [&](const std::string& key, TextureInfo& texInfo) {
+        if (const aiTexture* embedded = scene->GetEmbeddedTexture(key.c_str()))
+            return loadEmbeddedTexture(embedded, texInfo);
+
+        std::string relativePath = key;
+        std::replace(relativePath.begin(), relativePath.end(), '\\', '/'); // Models exported on Windows
+        return safeTextureLoad((modelDirectory / relativePath).string(), &texInfo.data, &texInfo.width, &texInfo.height, &texInfo.channels);
+    });
+}
+
+//================================//
+// Each distinct texture is loaded once. When some material has a texture, the untextured ones get a one texel
+// layer of their diffuse color. Nothing is loaded when no material has a texture
+std::vector<int> Voxelizer::buildMaterialLayers(const std::vector<std::string>& materialTextures, const std::vector<std::array<float, 3>>& diffuseColors,
+                                                const std::function<bool(const std::string& texture, TextureInfo& texInfo)>& loadTexture)
+{
+    const size_t numMaterials = materialTextures.size();
+    std::vector<int> materialLayers(numMaterials, 0);
+    if (std::all_of(materialTextures.begin(), materialTextures.end(), [](const std::string& texture) { return texture.empty(); }))
+        return materialLayers;
+
+    std::unordered_map<std::string, int> layersByKey; // Texture path, or diffuse color of the untextured materials
+    for (size_t m = 0; m < numMaterials; m++)
     {
-        this->texturesInfo.push_back({false, 0, 0, 0, nullptr, ""});
-        if (!texturePath.empty())
+        std::string key = materialTextures[m];
+        uint8_t color[4] = {255, 255, 255, 255};
+        if (key.empty())
+        {
+            for (int channel = 0; channel < 3; channel++)
+                color[channel] = static_cast<uint8_t>(std::clamp(diffuseColors[m][channel], 0.0f, 1.0f) * 255.0f + 0.5f);
+            key = "color " + std::to_string(color[0]) + " " + std::to_string(color[1]) + " " + std::to_string(color[2]);
+        }
+
+        auto found = layersByKey.find(key);
+        if (found != layersByKey.end())
+        {
+            materialLayers[m] = found->second;
+            continue;
+        }
+        if (this->texturesInfo.size() >= MAX_TEXTURES)
+        {
+            std::cout << "[Voxelizer] Warning: More than " << MAX_TEXTURES << " material textures, " << key << " uses the first one" << std::endl;
+            continue;
+        }
+
+        TextureInfo texInfo{false, 0, 0, 0, nullptr, key};
+        if (materialTextures[m].empty())
         {
-            this->texturesInfo.back().hasTexture = safeTextureLoad(texturePath, &this->texturesInfo.back().data, 
-                                                &this->texturesInfo.back().width, &this->texturesInfo.back().height, &this->texturesInfo.back().channels);
+            texInfo.width = 1;
+            texInfo.height = 1;
+            texInfo.channels = 4;
+            texInfo.data = static_cast<unsigned char*>(std::malloc(4));
+            std::memcpy(texInfo.data, color, 4);
+            texInfo.hasTexture = true;
         }
         else
         {
-            std::string basePath = filename.substr(0, filename.find_last_of('.'));
-            std::vector<std::string> extensions = {".png", ".jpg", ".jpeg", ".tga", ".bmp"};
-            
-            for (const auto& ext : extensions)
-            {
-                if (safeTextureLoad(basePath + ext, &this->texturesInfo.back().data, 
-                                    &this->texturesInfo.back().width, &this->texturesInfo.back().height, &this->texturesInfo.back().channels))
-                {
-                    this->texturesInfo.back().hasTexture = true;
-                    this->texturesInfo.back().name = basePath + ext;
-                    break;
-                }
-            }
+            texInfo.hasTexture = loadTexture(key, texInfo) && texInfo.data != nullptr;
         }
 
-        if (this->texturesInfo.back().hasTexture)
+        if (texInfo.hasTexture)
         {
-            std::cout << "[Voxelizer] Successfully loaded texture with size "
-                        << this->texturesInfo.back().width << "x" << this->texturesInfo.back().height << " and "
-                        << this->texturesInfo.back().channels << " channels." << std::endl;
+            std::cout << "[Voxelizer] Loaded material texture " << key << ": "
+                      << texInfo.width << "x" << texInfo.height << " with " << texInfo.channels << " channels" << std::endl;
         }
         else
         {
-            std::cout << "[Voxelizer] Failed to load texture for the mesh." << std::endl;
+            std::cout << "[Voxelizer] Failed to load material texture " << key << ", it is left white" << std::endl;
+        }
+
+        materialLayers[m] = static_cast<int>(this->texturesInfo.size());
+        layersByKey[key] = materialLayers[m];
+        this->texturesInfo.push_back(texInfo);
+    }
+    return materialLayers;
+}
+
+//================================//
+// Texture given on the command line, or next to the mesh with the same name
+void Voxelizer::loadMeshTexture(const std::string& filename, const std::string& texturePath)
+{
+    this->texturesInfo.push_back({false, 0, 0, 0, nullptr, ""});
+    if (!texturePath.empty())
+    {
+        this->texturesInfo.back().hasTexture = safeTextureLoad(texturePath, &this->texturesInfo.back().data, 
+                                            &this->texturesInfo.back().width, &this->texturesInfo.back().height, &this->texturesInfo.back().channels);
+    }
+    else
+    {
+        std::string basePath = filename.substr(0, filename.find_last_of('.'));
+        std::vector<std::string> extensions = {".png", ".jpg", ".jpeg", ".tga", ".bmp"};
+        
+        for (const auto& ext : extensions)
+        {
+            if (safeTextureLoad(basePath + ext, &this->texturesInfo.back().data, 
+                                &this->texturesInfo.back().width, &this->texturesInfo.back().height, &this->texturesInfo.back().channels))
+            {
+                this->texturesInfo.back().hasTexture = true;
+                this->texturesInfo.back().name = basePath + ext;
+                break;
+            }
+        }
+    }
+
+    if (this->texturesInfo.back().hasTexture)
+    {
+        std::cout << "[Voxelizer] Successfully loaded texture with size "
+                    << this->texturesInfo.back().width << "x" << this->texturesInfo.back().height << " and "
+                    << this->texturesInfo.back().channels << " channels." << std::endl;
+    }
+    else
+    {
+        std::cout << "[Voxelizer] Failed to load texture for the mesh." << std::endl;
+    }
+}
+
+//================================//
+bool Voxelizer::openMeshStream(const std::string& filename, const std::string& texturePath)
+{
+    this->meshStream = std::make_unique<MeshStream>();
+    if (!this->meshStream->Open(filename))
+    {
+        std::cout << "[Voxelizer] Failed to stream mesh from " << filename << std::endl;
+        this->meshStream.reset();
+        return false;
+    }
+
+    this->meshMinBounds = this->meshStream->GetMinBounds();
+    this->meshMaxBounds = this->meshStream->GetMaxBounds();
+    this->meshWidth = this->meshMaxBounds[0] - this->meshMinBounds[0];
+    this->meshHeight = this->meshMaxBounds[1] - this->meshMinBounds[1];
+    this->meshDepth = this->meshMaxBounds[2] - this->meshMinBounds[2];
+    this->uvMinBounds = this->meshStream->GetUVMinBounds();
+    this->uvMaxBounds = this->meshStream->GetUVMaxBounds();
+
+    // Texture array layer of each OBJ material, like the Assimp path
+    const std::vector<StreamedMaterial>& materials = this->meshStream->GetMaterials();
+    this->streamMaterialLayers.clear();
+    if (texturePath.empty() && !materials.empty())
+    {
+        std::vector<std::string> materialTextures;
+        std::vector<std::array<float, 3>> diffuseColors;
+        for (const StreamedMaterial& material : materials)
+        {
+            materialTextures.push_back(material.diffuseTexture);
+            diffuseColors.push_back({material.diffuse[0], material.diffuse[1], material.diffuse[2]});
         }
+        this->streamMaterialLayers = this->buildMaterialLayers(materialTextures, diffuseColors, [](const std::string& path, TextureInfo& texInfo) {
+            return safeTextureLoad(path, &texInfo.data, &texInfo.width, &texInfo.height, &texInfo.channels);
+        });
+    }
+    if (this->texturesInfo.empty())
+    {
+        this->loadMeshTexture(filename, texturePath);
+        this->streamMaterialLayers.assign(materials.size(), 0);
     }
 
+    this->textureArray.Build(this->texturesInfo);
     std::cout << "[Voxelizer] Total textures loaded: " << this->texturesInfo.size() << std::endl;
     return true;
 }
 
 //================================//
-void Voxelizer::initializeGpuResources(uint32_t maxBricksPerPass)
+void Voxelizer::swapMesh(Voxelizer& other)
+{
+    std::swap(this->verticesVec, other.verticesVec);
+    std::swap(this->facesVec, other.facesVec);
+    std::swap(this->normalsVec, other.normalsVec);
+    std::swap(this->uvsVec, other.uvsVec);
+    std::swap(this->textureIndicesVec, other.textureIndicesVec);
+    std::swap(this->texturesInfo, other.texturesInfo);
+    std::swap(this->textureArray, other.textureArray);
+    std::swap(this->meshStream, other.meshStream);
+    std::swap(this->streamMaterialLayers, other.streamMaterialLayers);
+    std::swap(this->meshWidth, other.meshWidth);
+    std::swap(this->meshHeight, other.meshHeight);
+    std::swap(this->meshDepth, other.meshDepth);
+    std::swap(this->meshMinBounds, other.meshMinBounds);
+    std::swap(this->meshMaxBounds, other.meshMaxBounds);
+    std::swap(this->uvMinBounds, other.uvMinBounds);
+    std::swap(this->uvMaxBounds, other.uvMaxBounds);
+}
+
+//================================//
+static uint32_t QuantizeUnorm16(double value, double minValue, double extent)
+{
+    if (extent <= 0.0)
+        return 0;
+    return static_cast<uint32_t>(std::clamp(std::round((value - minValue) / extent * 65535.0), 0.0, 65535.0));
+}
+
+//================================//
+Vertex Voxelizer::packVertex(const double position[3], const double uv[2], uint32_t layer) const
+{
+    uint32_t x = QuantizeUnorm16(position[0], this->meshMinBounds[0], this->meshWidth);
+    uint32_t y = QuantizeUnorm16(position[1], this->meshMinBounds[1], this->meshHeight);
+    uint32_t z = QuantizeUnorm16(position[2], this->meshMinBounds[2], this->meshDepth);
+    uint32_t u = QuantizeUnorm16(uv[0], this->uvMinBounds[0], this->uvMaxBounds[0] - this->uvMinBounds[0]);
+    uint32_t v = QuantizeUnorm16(uv[1], this->uvMinBounds[1], this->uvMaxBounds[1] - this->uvMinBounds[1]);
+
+    Vertex vertex;
+    vertex.words[0] = x | (y << 16);
+    vertex.words[1] = z | (u << 16);
+    vertex.words[2] = v | (layer << 16);
+    return vertex;
+}
+
+//================================//
+// Same arithmetic as vertexPosition and vertexUV in the shaders
+void Voxelizer::unpackVertex(const Vertex& vertex, float outPosition[3], float outUV[2]) const
+{
+    const float unorms[5] = {
+        static_cast<float>(vertex.words[0] & 0xFFFF) / 65535.0f,
+        static_cast<float>(vertex.words[0] >> 16) / 65535.0f,
+        static_cast<float>(vertex.words[1] & 0xFFFF) / 65535.0f,
+        static_cast<float>(vertex.words[1] >> 16) / 65535.0f,
+        static_cast<float>(vertex.words[2] & 0xFFFF) / 65535.0f,
+    };
+    const double extents[3] = {this->meshWidth, this->meshHeight, this->meshDepth};
+
+    for (int axis = 0; axis < 3; axis++)
+        outPosition[axis] = static_cast<float>(this->meshMinBounds[axis]) + unorms[axis] * static_cast<float>(extents[axis]);
+    for (int axis = 0; axis < 2; axis++)
+        outUV[axis] = static_cast<float>(this->uvMinBounds[axis]) + unorms[3 + axis] * static_cast<float>(this->uvMaxBounds[axis] - this->uvMinBounds[axis]);
+}
+
+//================================//
+void Voxelizer::setQuantizationUniforms(VoxelizerUniforms& uniforms) const
+{
+    uniforms.meshExtent[0] = static_cast<float>(this->meshWidth);
+    uniforms.meshExtent[1] = static_cast<float>(this->meshHeight);
+    uniforms.meshExtent[2] = static_cast<float>(this->meshDepth);
+    uniforms._pad2 = 0;
+    uniforms.uvOffset[0] = static_cast<float>(this->uvMinBounds[0]);
+    uniforms.uvOffset[1] = static_cast<float>(this->uvMinBounds[1]);
+    uniforms.uvExtent[0] = static_cast<float>(this->uvMaxBounds[0] - this->uvMinBounds[0]);
+    uniforms.uvExtent[1] = static_cast<float>(this->uvMaxBounds[1] - this->uvMinBounds[1]);
+}
+
+//================================//
+void Voxelizer::uploadMeshBuffers()
 {
     std::vector<Vertex> vertexData;
     std::vector<Triangle> triangleData;
@@ -298,32 +684,34 @@ void Voxelizer::initializeGpuResources(uint32_t maxBricksPerPass)
     wgpu::BufferDescriptor  bufferDesc{};
     wgpu::Queue queue = this->gpuBundle->GetDevice().GetQueue();
 
+    // Streamed chunks are written over the same buffers, at most three vertices per triangle
+    if (this->meshStream)
+    {
+        const uint64_t maxBindingSize = this->gpuBundle->GetLimits().maxStorageBufferBindingSize;
+        this->streamChunkTriangles = static_cast<uint32_t>(std::min<uint64_t>(this->streamChunkTriangles, maxBindingSize / (sizeof(Vertex) * 3)));
+
+        bufferDesc.size = sizeof(Vertex) * 3 * this->streamChunkTriangles;
+        bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+        bufferDesc.mappedAtCreation = false;
+        bufferDesc.label = "Vertex Chunk Buffer";
+        this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->vertexBuffer);
+
+        bufferDesc.size = sizeof(Triangle) * this->streamChunkTriangles;
+        bufferDesc.label = "Triangle Chunk Buffer";
+        this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->triangleBuffer);
+        return;
+    }
+
     // [1] vertex data
     vertexData.resize(this->verticesVec.size());
     for (size_t i = 0; i < this->verticesVec.size(); i++)
-    {
-        Vertex v;
-
-        v.position[0] = static_cast<float>(this->verticesVec[i][0]);
-        v.position[1] = static_cast<float>(this->verticesVec[i][1]);
-        v.position[2] = static_cast<float>(this->verticesVec[i][2]);
-
-        v.uv[0] = static_cast<float>(this->uvsVec[i][0]);
-        v.uv[1] = static_cast<float>(this->uvsVec[i][1]);
-
-        v.normal[0] = static_cast<float>(this->normalsVec[i][0]);
-        v.normal[1] = static_cast<float>(this->normalsVec[i][1]);
-        v.normal[2] = static_cast<float>(this->normalsVec[i][2]);
-
-        v.padding = 0.0f;
-        vertexData[i] = v;
-    }
+        vertexData[i] = this->packVertex(this->verticesVec[i].data(), this->uvsVec[i].data(), static_cast<uint32_t>(this->textureIndicesVec[i]));
 
     bufferDesc.size = sizeof(Vertex) * vertexData.size();
     bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
     bufferDesc.mappedAtCreation = false;
     bufferDesc.label = "Vertex Buffer";
-    this->gpuBundle->SafeCreateBuffer(&bufferDesc, this->vertexBuffer);
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->vertexBuffer);
     queue.WriteBuffer(this->vertexBuffer, 0, vertexData.data(), bufferDesc.size);
 
     // [2] triangle data
@@ -334,7 +722,6 @@ void Voxelizer::initializeGpuResources(uint32_t maxBricksPerPass)
         t.indices[0] = static_cast<uint32_t>(this->facesVec[i][0]);
         t.indices[1] = static_cast<uint32_t>(this->facesVec[i][1]);
         t.indices[2] = static_cast<uint32_t>(this->facesVec[i][2]);
-        t._pad = 0;
         triangleData[i] = t;
     }
 
@@ -342,224 +729,268 @@ void Voxelizer::initializeGpuResources(uint32_t maxBricksPerPass)
     bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
     bufferDesc.mappedAtCreation = false;
     bufferDesc.label = "Triangle Buffer";
-    this->gpuBundle->SafeCreateBuffer(&bufferDesc, this->triangleBuffer);
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->triangleBuffer);
     queue.WriteBuffer(this->triangleBuffer, 0, triangleData.data(), bufferDesc.size);
+}
+
+//================================//
+// Hash of a packed vertex, the chunk corners are welded on it
+struct PackedVertexHash
+{
+    size_t operator()(const std::array<uint32_t, 3>& words) const
+    {
+        uint64_t hash = ((static_cast<uint64_t>(words[0]) << 32) | words[1]) * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(hash ^ (hash >> 29) ^ words[2]);
+    }
+};
+
+//================================//
+void Voxelizer::uploadMeshChunk(const std::vector<StreamedTriangle>& chunk)
+{
+    std::vector<Vertex> vertexData;
+    std::vector<Triangle> triangleData(chunk.size());
+    std::unordered_map<std::array<uint32_t, 3>, uint32_t, PackedVertexHash> chunkIndices;
+    vertexData.reserve(chunk.size());
+    chunkIndices.reserve(chunk.size());
+
+    // Corners are quantized then welded, the chunks come as triangle soups
+    for (size_t i = 0; i < chunk.size(); i++)
+    {
+        for (int corner = 0; corner < 3; corner++)
+        {
+            const double position[3] = {chunk[i].positions[corner][0], chunk[i].positions[corner][1], chunk[i].positions[corner][2]};
+            const double uv[2] = {chunk[i].uvs[corner][0], chunk[i].uvs[corner][1]};
+            const uint32_t layer = chunk[i].material < this->streamMaterialLayers.size() ? static_cast<uint32_t>(this->streamMaterialLayers[chunk[i].material]) : 0;
+            Vertex vertex = this->packVertex(position, uv, layer);
+
+            std::array<uint32_t, 3> key = {vertex.words[0], vertex.words[1], vertex.words[2]};
+            auto [it, inserted] = chunkIndices.try_emplace(key, static_cast<uint32_t>(vertexData.size()));
+            if (inserted)
+                vertexData.push_back(vertex);
+            triangleData[i].indices[corner] = it->second;
+        }
+    }
+
+    wgpu::Queue queue = this->gpuBundle->GetDevice().GetQueue();
+    queue.WriteBuffer(this->vertexBuffer, 0, vertexData.data(), sizeof(Vertex) * vertexData.size());
+    queue.WriteBuffer(this->triangleBuffer, 0, triangleData.data(), sizeof(Triangle) * triangleData.size());
+}
+
+//================================//
+bool Voxelizer::forEachMeshChunk(const std::function<bool(uint32_t numTriangles)>& processChunk)
+{
+    if (!this->meshStream)
+        return processChunk(static_cast<uint32_t>(this->facesVec.size()));
+
+    // Writes to the chunk buffers are ordered after the work submitted on the previous chunk
+    this->meshStream->Rewind();
+    std::vector<StreamedTriangle> chunk;
+    while (this->meshStream->ReadChunk(chunk, this->streamChunkTriangles))
+    {
+        this->uploadMeshChunk(chunk);
+        if (!processChunk(static_cast<uint32_t>(chunk.size())))
+            return false;
+    }
+
+    if (this->meshStream->Failed())
+    {
+        std::cerr << "[Voxelizer] Failed to read the next triangle chunk" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//================================//
+void Voxelizer::initializeGpuResources(uint32_t maxBricksPerPass)
+{
+    wgpu::BufferDescriptor  bufferDesc{};
+    wgpu::Queue queue = this->gpuBundle->GetDevice().GetQueue();
+
+    // [1] vertex and [2] triangle data are uploaded by the candidate search of checkLimits
 
     // [3] Occupancy
     bufferDesc.size = sizeof(uint32_t) * 16 * maxBricksPerPass;
     bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopySrc | wgpu::BufferUsage::CopyDst;
     bufferDesc.mappedAtCreation = false;
     bufferDesc.label = "Occupancy Buffer";
-    this->gpuBundle->SafeCreateBuffer(&bufferDesc, this->occupancyBuffer);
-    std::vector<uint32_t> zeros(16 * maxBricksPerPass, 0);
-    queue.WriteBuffer(this->occupancyBuffer, 0, zeros.data(), bufferDesc.size);
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->occupancyBuffer);
 
     // [4] Dense Colors
     bufferDesc.size = sizeof(uint32_t) * maxBricksPerPass * 512;
     bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopySrc | wgpu::BufferUsage::CopyDst;
     bufferDesc.mappedAtCreation = false;
     bufferDesc.label = "Dense Colors Buffer";
-    this->gpuBundle->SafeCreateBuffer(&bufferDesc, this->denseColorsBuffer);
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->denseColorsBuffer);
+
+    // Triangle each dense color is sampled from
+    bufferDesc.size = sizeof(uint32_t) * maxBricksPerPass * 512;
+    bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+    bufferDesc.mappedAtCreation = false;
+    bufferDesc.label = "Voxel Winners Buffer";
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->voxelWinnersBuffer);
 
     // [5] brick output buffer
     bufferDesc.size = sizeof(BrickOutput) * maxBricksPerPass;
     bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopySrc;
     bufferDesc.mappedAtCreation = false;
     bufferDesc.label = "Brick Output Buffer";
-    this->gpuBundle->SafeCreateBuffer(&bufferDesc, this->brickOutputBuffer);
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->brickOutputBuffer);
 
     // [6] packed color buffer
     bufferDesc.size = sizeof(uint32_t) * maxBricksPerPass * 512;
     bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopySrc;
     bufferDesc.mappedAtCreation = false;
     bufferDesc.label = "Packed Color Buffer";
-    this->gpuBundle->SafeCreateBuffer(&bufferDesc, this->packedColorBuffer);
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->packedColorBuffer);
 
     // [7] atomic counters
     bufferDesc.size = sizeof(uint32_t) * 2;
     bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::CopySrc;
     bufferDesc.mappedAtCreation = false;
     bufferDesc.label = "Counters Buffer";
-    this->gpuBundle->SafeCreateBuffer(&bufferDesc, this->countersBuffer);
-    uint32_t counterZeros[2] = {0, 0};
-    queue.WriteBuffer(this->countersBuffer, 0, counterZeros, sizeof(counterZeros));
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->countersBuffer);
 
-    //[8] readback buffers, at worst case scenario size initialization with maxBricksPerPass
-    bufferDesc.size = sizeof(uint32_t) * 2;
-    bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::MapRead;
-    bufferDesc.mappedAtCreation = false;
-    bufferDesc.label = "Counter Readback Buffer";
-    this->gpuBundle->SafeCreateBuffer(&bufferDesc, this->counterReadbackBuffer);
+    //[8] readback buffers, at worst case scenario size initialization with maxBricksPerPass. Two sets, one per pass in flight
+    for (PassReadback& readback : this->passReadbacks)
+    {
+        readback.pending = false;
 
-    bufferDesc.size = sizeof(uint32_t) * 16 * maxBricksPerPass;
-    bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::MapRead;
+        bufferDesc.size = sizeof(uint32_t) * 2;
+        bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::MapRead;
+        bufferDesc.mappedAtCreation = false;
+        bufferDesc.label = "Counter Readback Buffer";
+        this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, readback.counters);
+
+        bufferDesc.size = sizeof(uint32_t) * 16 * maxBricksPerPass;
+        bufferDesc.label = "Occupancy Readback Buffer";
+        this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, readback.occupancy);
+
+        bufferDesc.size = sizeof(BrickOutput) * maxBricksPerPass;
+        bufferDesc.label = "Brick Output Readback Buffer";
+        this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, readback.brickOutput);
+
+        bufferDesc.size = sizeof(uint32_t) * maxBricksPerPass * 512;
+        bufferDesc.label = "Packed Color Readback Buffer";
+        this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, readback.packedColors);
+    }
+
+    // [9] triangle binning, the triangle list starts with one entry per triangle or per brick, whichever is more, and grows on demand
+    bufferDesc.size = sizeof(uint32_t) * maxBricksPerPass;
+    bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
     bufferDesc.mappedAtCreation = false;
-    bufferDesc.label = "Occupancy Readback Buffer";
-    this->gpuBundle->SafeCreateBuffer(&bufferDesc, this->occupancyReadbackBuffer);
-
-    uint32_t occupiedBrickCount = maxBricksPerPass;
-    bufferDesc.size = sizeof(BrickOutput) * occupiedBrickCount;
-    bufferDesc.label = "Brick Output Readback Buffer";
-    this->gpuBundle->SafeCreateBuffer(&bufferDesc, this->brickOutputReadbackBuffer);
-
-    uint32_t totalColorCount = maxBricksPerPass * 512;
-    bufferDesc.size = sizeof(uint32_t) * totalColorCount;;
-    bufferDesc.label = "Packed Color Readback Buffer";
-    this->gpuBundle->SafeCreateBuffer(&bufferDesc, this->packedColorReadbackBuffer);
-
-    // [8] texture, texture view, sampler
-    this->textures.clear();
-    this->textureViews.clear();
-    this->textureSamplers.clear();
-    
-    unsigned int numTextures = std::min(static_cast<unsigned int>(this->texturesInfo.size()), MAX_TEXTURES);
- 
-    if (numTextures != 0)
-    {
-        this->textures.resize(numTextures);
-        this->textureViews.resize(numTextures);
-        this->textureSamplers.resize(numTextures);
+    bufferDesc.label = "Bin Counts Buffer";
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->binCountsBuffer);
 
-        for (int i = 0; i < numTextures; i++)
-        {
-            TextureInfo& texInfo = this->texturesInfo[i];
-            if (!texInfo.hasTexture)
-                continue;
+    bufferDesc.usage = wgpu::BufferUsage::Storage;
+    bufferDesc.label = "Bin Offsets Buffer";
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->binOffsetsBuffer);
 
-            wgpu::TextureDescriptor textureDesc{};
-            textureDesc.size = {static_cast<uint32_t>(texInfo.width), static_cast<uint32_t>(texInfo.height), 1};
-            textureDesc.mipLevelCount = 1;
-            textureDesc.sampleCount = 1;
-            textureDesc.dimension = wgpu::TextureDimension::e2D;
-            textureDesc.format = wgpu::TextureFormat::RGBA8Unorm;
-            textureDesc.usage = wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst;
-            textureDesc.label = "Mesh Texture";
-
-            this->textures[i] = this->gpuBundle->GetDevice().CreateTexture(&textureDesc);
-            std::vector<uint8_t> rgbaData;
-            if (texInfo.channels == 3) // Convert to RGBA, NEEDED IN COMPUTE SHADER
-            {
-                rgbaData.resize(texInfo.width * texInfo.height * 4);
-                for(int i = 0; i < texInfo.width * texInfo.height; i++)
-                {
-                    rgbaData[i * 4 + 0] = texInfo.data[i * 3 + 0];
-                    rgbaData[i * 4 + 1] = texInfo.data[i * 3 + 1];
-                    rgbaData[i * 4 + 2] = texInfo.data[i * 3 + 2];
-                    rgbaData[i * 4 + 3] = 255;
-                }
-            }
-            else if (texInfo.channels == 4)
-            {
-                rgbaData.assign(texInfo.data, texInfo.data + (texInfo.width * texInfo.height * texInfo.channels));
-            }
-            else if (texInfo.channels == 1)
-            {
-                rgbaData.resize(texInfo.width * texInfo.height * 4);
-                for(int i = 0; i < texInfo.width * texInfo.height; i++)
-                {
-                    uint8_t value = texInfo.data[i];
-                    rgbaData[i * 4 + 0] = value;
-                    rgbaData[i * 4 + 1] = value;
-                    rgbaData[i * 4 + 2] = value;
-                    rgbaData[i * 4 + 3] = 255;
-                }
-            }
-            else
-            {
-                rgbaData.resize(texInfo.width * texInfo.height * 4, 255); // default white
-            }
+    bufferDesc.label = "Bin Cursors Buffer";
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->binCursorsBuffer);
+
+    bufferDesc.size = sizeof(uint32_t) * ((maxBricksPerPass + BIN_PREFIX_SUM_BLOCK_SIZE - 1) / BIN_PREFIX_SUM_BLOCK_SIZE);
+    bufferDesc.label = "Bin Block Sums Buffer";
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->binBlockSumsBuffer);
+
+    bufferDesc.size = sizeof(uint32_t);
+    bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopySrc;
+    bufferDesc.label = "Bin Total Buffer";
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->binTotalBuffer);
 
-            wgpu::TexelCopyTextureInfo dstTexture{};
-            dstTexture.texture = this->textures[i];
-            dstTexture.mipLevel = 0;
-            dstTexture.origin = {0, 0, 0};
-            dstTexture.aspect = wgpu::TextureAspect::All;
-
-            wgpu::TexelCopyBufferLayout srcBufferLayout{};
-            srcBufferLayout.offset = 0;
-            srcBufferLayout.bytesPerRow = texInfo.width * 4;
-            srcBufferLayout.rowsPerImage = texInfo.height;
-
-            wgpu::Extent3D writeSize{
-                static_cast<uint32_t>(texInfo.width),
-                static_cast<uint32_t>(texInfo.height),
-                1
-            };
-
-            queue.WriteTexture(&dstTexture, rgbaData.data(), rgbaData.size(), &srcBufferLayout, &writeSize);
-
-            wgpu::TextureViewDescriptor viewDesc{};
-            viewDesc.format = wgpu::TextureFormat::RGBA8Unorm;
-            viewDesc.dimension = wgpu::TextureViewDimension::e2D;
-            viewDesc.baseMipLevel = 0;
-            viewDesc.mipLevelCount = 1;
-            viewDesc.baseArrayLayer = 0;
-            viewDesc.arrayLayerCount = 1;
-            viewDesc.aspect = wgpu::TextureAspect::All;
-            viewDesc.label = "Mesh Texture View";
-            this->textureViews[i] = this->textures[i].CreateView(&viewDesc);
-
-            wgpu::SamplerDescriptor samplerDesc{};
-            samplerDesc.addressModeU = wgpu::AddressMode::Repeat;
-            samplerDesc.addressModeV = wgpu::AddressMode::Repeat;
-            samplerDesc.addressModeW = wgpu::AddressMode::Repeat;
-            samplerDesc.magFilter = wgpu::FilterMode::Linear;
-            samplerDesc.minFilter = wgpu::FilterMode::Linear;
-            samplerDesc.mipmapFilter = wgpu::MipmapFilterMode::Nearest;
-            samplerDesc.lodMaxClamp = 1.0f;
-            samplerDesc.lodMinClamp = 0.0f;
-            samplerDesc.compare = wgpu::CompareFunction::Undefined;
-            samplerDesc.maxAnisotropy = 1;
-            samplerDesc.label = "Mesh Texture Sampler";
-
-            this->textureSamplers[i] = this->gpuBundle->GetDevice().CreateSampler(&samplerDesc);
+    bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::MapRead;
+    bufferDesc.label = "Bin Total Readback Buffer";
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->binTotalReadbackBuffer);
+
+    // Kept from the previous job when large enough, it only grows
+    if (!this->reserveBinnedTriangles(std::max(maxBricksPerPass, static_cast<uint32_t>(this->triangleBuffer.GetSize() / sizeof(Triangle)))))
+    {
+        // A single triangle can overlap every brick of the pass, less than that and binning cannot make progress
+        if (!this->reserveBinnedTriangles(maxBricksPerPass))
+        {
+            std::cout << "[Voxelizer] Triangle list buffer cannot hold " << maxBricksPerPass << " entries" << std::endl;
+            throw std::runtime_error("[Voxelizer] Triangle list buffer cannot hold one entry per brick of the pass");
         }
     }
-    else // ALL WHITE TEXTURE BY DEFAULT
+
+    // [10] solid fill parity flips
+    if (this->solid)
     {
-        this->textures.resize(1);
-        this->textureViews.resize(1);
-        this->textureSamplers.resize(1);
-        
-        wgpu::TextureDescriptor textureDesc{};
-        textureDesc.size = {1, 1, 1};
-        textureDesc.mipLevelCount = 1;
-        textureDesc.sampleCount = 1;
-        textureDesc.dimension = wgpu::TextureDimension::e2D;
-        textureDesc.format = wgpu::TextureFormat::RGBA8Unorm;
-        textureDesc.usage = wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst;
-        this->textures[0] = this->gpuBundle->GetDevice().CreateTexture(&textureDesc);
+        bufferDesc.size = sizeof(uint32_t) * 16 * maxBricksPerPass;
+        bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+        bufferDesc.mappedAtCreation = false;
+        bufferDesc.label = "Parity Flips Buffer";
+        this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->parityFlipsBuffer);
+    }
 
-        uint8_t whitePixel[4] = {255, 255, 255, 255};
+    // [11] material texture array with its mip chain, texture view, sampler
+    wgpu::TextureDescriptor textureDesc{};
+    textureDesc.size = {this->textureArray.GetWidth(), this->textureArray.GetHeight(), this->textureArray.GetLayerCount()};
+    textureDesc.mipLevelCount = this->textureArray.GetMipCount();
+    textureDesc.sampleCount = 1;
+    textureDesc.dimension = wgpu::TextureDimension::e2D;
+    textureDesc.format = wgpu::TextureFormat::RGBA8Unorm;
+    textureDesc.usage = wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst;
+    textureDesc.label = "Mesh Texture Array";
+    const bool sameTexture = this->texture && this->texture.GetWidth() == textureDesc.size.width && this->texture.GetHeight() == textureDesc.size.height &&
+                             this->texture.GetDepthOrArrayLayers() == textureDesc.size.depthOrArrayLayers && this->texture.GetMipLevelCount() == textureDesc.mipLevelCount;
+    if (!sameTexture)
+        this->texture = this->gpuBundle->GetDevice().CreateTexture(&textureDesc);
+
+    for (uint32_t level = 0; level < this->textureArray.GetMipCount(); level++)
+    {
+        const std::vector<uint8_t>& mip = this->textureArray.GetMip(level);
 
         wgpu::TexelCopyTextureInfo dstTexture{};
-        dstTexture.texture = this->textures[0];
-        dstTexture.mipLevel = 0;
+        dstTexture.texture = this->texture;
+        dstTexture.mipLevel = level;
         dstTexture.origin = {0, 0, 0};
+        dstTexture.aspect = wgpu::TextureAspect::All;
 
         wgpu::TexelCopyBufferLayout srcBufferLayout{};
         srcBufferLayout.offset = 0;
-        srcBufferLayout.bytesPerRow = 4;
-        srcBufferLayout.rowsPerImage = 1;
+        srcBufferLayout.bytesPerRow = this->textureArray.GetMipWidth(level) * 4;
+        srcBufferLayout.rowsPerImage = this->textureArray.GetMipHeight(level);
 
-        wgpu::Extent3D writeSize{1,1,1};
-
-        queue.WriteTexture(&dstTexture, whitePixel, sizeof(whitePixel), &srcBufferLayout, &writeSize);
-        this->textureViews[0] = this->textures[0].CreateView();
+        wgpu::Extent3D writeSize{
+            this->textureArray.GetMipWidth(level),
+            this->textureArray.GetMipHeight(level),
+            this->textureArray.GetLayerCount()
+        };
 
-        wgpu::SamplerDescriptor samplerDesc{};
-        samplerDesc.magFilter = wgpu::FilterMode::Nearest;
-        samplerDesc.minFilter = wgpu::FilterMode::Nearest;
-        this->textureSamplers[0] = this->gpuBundle->GetDevice().CreateSampler(&samplerDesc);
+        queue.WriteTexture(&dstTexture, mip.data(), mip.size(), &srcBufferLayout, &writeSize);
     }
+
+    wgpu::TextureViewDescriptor viewDesc{};
+    viewDesc.format = wgpu::TextureFormat::RGBA8Unorm;
+    viewDesc.dimension = wgpu::TextureViewDimension::e2DArray;
+    viewDesc.baseMipLevel = 0;
+    viewDesc.mipLevelCount = this->textureArray.GetMipCount();
+    viewDesc.baseArrayLayer = 0;
+    viewDesc.arrayLayerCount = this->textureArray.GetLayerCount();
+    viewDesc.aspect = wgpu::TextureAspect::All;
+    viewDesc.label = "Mesh Texture Array View";
+    this->textureView = this->texture.CreateView(&viewDesc);
+
+    // Trilinear, the shader picks the level from the texel footprint of a voxel
+    wgpu::SamplerDescriptor samplerDesc{};
+    samplerDesc.addressModeU = wgpu::AddressMode::Repeat;
+    samplerDesc.addressModeV = wgpu::AddressMode::Repeat;
+    samplerDesc.addressModeW = wgpu::AddressMode::Repeat;
+    samplerDesc.magFilter = wgpu::FilterMode::Linear;
+    samplerDesc.minFilter = wgpu::FilterMode::Linear;
+    samplerDesc.mipmapFilter = wgpu::MipmapFilterMode::Linear;
+    samplerDesc.lodMaxClamp = static_cast<float>(this->textureArray.GetMipCount());
+    samplerDesc.lodMinClamp = 0.0f;
+    samplerDesc.compare = wgpu::CompareFunction::Undefined;
+    samplerDesc.maxAnisotropy = 1;
+    samplerDesc.label = "Mesh Texture Sampler";
+    this->textureSampler = this->gpuBundle->GetDevice().CreateSampler(&samplerDesc);
 }
 
 //================================//
-void Voxelizer::checkLimits(uint32_t& voxelResolution, uint32_t& maxBricksPerPass, uint8_t& numPasses)
+void Voxelizer::checkLimits(uint32_t& voxelResolution, uint32_t& maxBricksPerPass, uint32_t& numPasses)
 {
     const uint64_t colorBytesPerBrick = sizeof(uint32_t) * 8 * 8 * 8;
-    uint64_t maxBufferSize = this->gpuBundle->GetLimits().maxBufferSize * 0.6;
-    uint64_t maxColorBufferSize = (maxBufferSize / static_cast<uint64_t>(colorBytesPerBrick)) * static_cast<uint64_t>(colorBytesPerBrick);
 
     if(voxelResolution <= 0) voxelResolution = 8;
     voxelResolution = (voxelResolution / 8) * 8; // ensure multiple of 8
@@ -574,27 +1005,607 @@ void Voxelizer::checkLimits(uint32_t& voxelResolution, uint32_t& maxBricksPerPas
     }
 
     uint64_t totalBricks = static_cast<uint64_t>(brickResolution) * brickResolution * brickResolution;
-    uint64_t totalColorBufferSize = totalBricks * colorBytesPerBrick;
+
+    // The CPU backend works one brick slice at a time, no buffer limits
+    if (this->backend == VoxelizerBackend::CPU)
+    {
+        maxBricksPerPass = static_cast<uint32_t>(totalBricks);
+        numPasses = 1;
+        return;
+    }
+
+    // Passes only cover the bricks some triangle overlaps
+    this->findCandidateBricks(voxelResolution);
+    uint64_t numCandidates = this->candidateBricks.size();
+    if (numCandidates == 0)
+    {
+        std::cout << "[Voxelizer] Warning: No brick overlaps the mesh, nothing to voxelize." << std::endl;
+        maxBricksPerPass = brickResolution;
+        numPasses = 0;
+        return;
+    }
+
+    uint64_t maxBufferSize = this->gpuBundle->GetLimits().maxBufferSize * 0.6;
+    uint64_t maxColorBufferSize = (maxBufferSize / static_cast<uint64_t>(colorBytesPerBrick)) * static_cast<uint64_t>(colorBytesPerBrick);
+    uint64_t totalColorBufferSize = numCandidates * colorBytesPerBrick;
     if(totalColorBufferSize > maxColorBufferSize)
     {
+        // Whole brick rows along x, the solid fill needs complete rows within a pass
         maxBricksPerPass = static_cast<uint32_t>(maxColorBufferSize / colorBytesPerBrick);
+        maxBricksPerPass = std::max(brickResolution, maxBricksPerPass / brickResolution * brickResolution);
         std::cout << "[Voxelizer] Warning: Voxel resolution too high for available GPU memory, max bricks per pass set to " <<
             maxBricksPerPass << " (" << (maxBricksPerPass * 8) << "^3 voxels)" << std::endl;
-        numPasses = static_cast<uint8_t>((totalBricks + maxBricksPerPass - 1) / maxBricksPerPass);
-        std::cout << "[Voxelizer] Voxelization will be performed in " << static_cast<uint32_t>(numPasses) << " passes." << std::endl;
+        numPasses = static_cast<uint32_t>((numCandidates + maxBricksPerPass - 1) / maxBricksPerPass);
+        std::cout << "[Voxelizer] Voxelization will be performed in " << numPasses << " passes." << std::endl;
     }
     else
     {
-        maxBricksPerPass = static_cast<uint32_t>(totalBricks);
+        maxBricksPerPass = static_cast<uint32_t>(numCandidates);
         std::cout << "[Voxelizer] Voxelization can proceed with " << maxBricksPerPass << " bricks in only one pass." << std::endl;
         numPasses = 1;
     }
 }
 
 //================================//
-bool Voxelizer::voxelizeMesh(const std::string& outputVoxelFile, uint32_t voxelResolution, uint32_t maxBricksPerPass, uint8_t numPasses)
+// Past the per dimension limit the workgroups spill into y, the binning shaders rebuild a linear index
+static void DispatchLinear(wgpu::ComputePassEncoder& pass, uint32_t numWorkGroups)
+{
+    if (numWorkGroups == 0)
+        return;
+
+    const uint32_t maxWorkGroupsPerDimension = 65535;
+    uint32_t workGroupsX = std::min(numWorkGroups, maxWorkGroupsPerDimension);
+    uint32_t workGroupsY = (numWorkGroups + workGroupsX - 1) / workGroupsX;
+    pass.DispatchWorkgroups(workGroupsX, workGroupsY, 1);
+}
+
+//================================//
+void Voxelizer::findCandidateBricks(uint32_t voxelResolution)
+{
+    wgpu::Device& device = this->gpuBundle->GetDevice();
+    wgpu::Queue queue = device.GetQueue();
+
+    this->uploadMeshBuffers();
+
+    const uint32_t brickResolution = voxelResolution / 8;
+    const uint32_t totalBricks = brickResolution * brickResolution * brickResolution;
+    const uint32_t numWords = (totalBricks + 31) / 32;
+    double maxExtent = std::max({meshWidth, meshHeight, meshDepth});
+
+    VoxelizerUniforms uniforms{};
+    uniforms.voxelResolution = voxelResolution;
+    uniforms.brickResolution = brickResolution;
+    uniforms.voxelSize = static_cast<float>(maxExtent / voxelResolution);
+    uniforms.meshMinBounds[0] = static_cast<float>(this->meshMinBounds[0]);
+    uniforms.meshMinBounds[1] = static_cast<float>(this->meshMinBounds[1]);
+    uniforms.meshMinBounds[2] = static_cast<float>(this->meshMinBounds[2]);
+    this->setQuantizationUniforms(uniforms);
+    uniforms.brickStart = 0;
+    uniforms.brickEnd = totalBricks;
+    uniforms.triangleStart = 0;
+
+    wgpu::BufferDescriptor bufferDesc{};
+    bufferDesc.size = sizeof(VoxelizerUniforms);
+    bufferDesc.usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::CopyDst;
+    bufferDesc.mappedAtCreation = false;
+    bufferDesc.label = "Candidate Bricks Uniform Buffer";
+    wgpu::Buffer uniformBuffer;
+    this->gpuBundle->SafeCreateBuffer(&bufferDesc, uniformBuffer);
+
+    bufferDesc.size = sizeof(uint32_t) * numWords;
+    bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopySrc | wgpu::BufferUsage::CopyDst;
+    bufferDesc.label = "Candidate Bits Buffer";
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->candidateBitsBuffer);
+
+    bufferDesc.usage = wgpu::BufferUsage::MapRead | wgpu::BufferUsage::CopyDst;
+    bufferDesc.label = "Candidate Bits Readback Buffer";
+    wgpu::Buffer readbackBuffer;
+    this->gpuBundle->SafeCreateBuffer(&bufferDesc, readbackBuffer);
+
+    wgpu::BindGroupEntry entries[4]{};
+    entries[0].binding = 0; entries[0].buffer = uniformBuffer; entries[0].size = sizeof(VoxelizerUniforms);
+    entries[1].binding = 1; entries[1].buffer = this->vertexBuffer; entries[1].size = this->vertexBuffer.GetSize();
+    entries[2].binding = 2; entries[2].buffer = this->triangleBuffer; entries[2].size = this->triangleBuffer.GetSize();
+    entries[3].binding = 3; entries[3].buffer = this->candidateBitsBuffer; entries[3].size = sizeof(uint32_t) * numWords;
+
+    wgpu::BindGroupDescriptor bindGroupDesc{};
+    bindGroupDesc.layout = this->candidateBricksPipeline.bindGroupLayout;
+    bindGroupDesc.entryCount = 4;
+    bindGroupDesc.entries = entries;
+    wgpu::BindGroup bindGroup = device.CreateBindGroup(&bindGroupDesc);
+
+    // One bit per brick overlapped by a triangle, same test as the binning
+    wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
+    encoder.ClearBuffer(this->candidateBitsBuffer, 0, sizeof(uint32_t) * numWords);
+    wgpu::CommandBuffer commandBuffer = encoder.Finish();
+    queue.Submit(1, &commandBuffer);
+
+    bool allChunks = this->forEachMeshChunk([&](uint32_t numTriangles) {
+        uniforms.numTriangles = numTriangles;
+        uniforms.triangleEnd = numTriangles;
+        queue.WriteBuffer(uniformBuffer, 0, &uniforms, sizeof(VoxelizerUniforms));
+
+        wgpu::CommandEncoder chunkEncoder = device.CreateCommandEncoder();
+        wgpu::ComputePassEncoder pass = chunkEncoder.BeginComputePass();
+        pass.SetPipeline(this->candidateBricksPipeline.computePipeline);
+        pass.SetBindGroup(0, bindGroup);
+        DispatchLinear(pass, (numTriangles + TRIANGLE_BINNING_WORKGROUP_SIZE - 1) / TRIANGLE_BINNING_WORKGROUP_SIZE);
+        pass.End();
+        wgpu::CommandBuffer chunkCommandBuffer = chunkEncoder.Finish();
+        queue.Submit(1, &chunkCommandBuffer);
+        return true;
+    });
+    if (!allChunks)
+    {
+        std::cout << "[Voxelizer] Failed to read the mesh for the candidate bricks" << std::endl;
+        throw std::runtime_error("Failed to read the mesh for the candidate bricks");
+    }
+
+    encoder = device.CreateCommandEncoder();
+    encoder.CopyBufferToBuffer(this->candidateBitsBuffer, 0, readbackBuffer, 0, sizeof(uint32_t) * numWords);
+    commandBuffer = encoder.Finish();
+    queue.Submit(1, &commandBuffer);
+
+    wgpu::Future mapFuture = readbackBuffer.MapAsync(
+        wgpu::MapMode::Read, 0, sizeof(uint32_t) * numWords,
+        wgpu::CallbackMode::WaitAnyOnly,
+        [](wgpu::MapAsyncStatus status, wgpu::StringView message) {
+            if (status != wgpu::MapAsyncStatus::Success) {
+                std::cerr << "[Voxelizer] Candidate bits map failed: " << std::string(message.data, message.length) << std::endl;
+            }
+        }
+    );
+    this->gpuBundle->GetInstance().WaitAny(mapFuture, UINT64_MAX);
+
+    const uint32_t* data = static_cast<const uint32_t*>(readbackBuffer.GetConstMappedRange(0, sizeof(uint32_t) * numWords));
+    if (!data)
+    {
+        std::cout << "[Voxelizer] Failed to get mapped range for candidate bits" << std::endl;
+        throw std::runtime_error("Failed to read back candidate bricks");
+    }
+    std::vector<uint32_t> bits(data, data + numWords);
+    readbackBuffer.Unmap();
+
+    // The solid fill walks whole rows along x, a row with any candidate is taken entirely
+    if (this->solid)
+    {
+        for (uint32_t row = 0; row < brickResolution * brickResolution; row++)
+        {
+            uint32_t first = row * brickResolution;
+            bool anyCandidate = false;
+            for (uint32_t x = 0; x < brickResolution && !anyCandidate; x++)
+                anyCandidate = (bits[(first + x) / 32] >> ((first + x) % 32)) & 1u;
+            if (!anyCandidate)
+                continue;
+            for (uint32_t x = 0; x < brickResolution; x++)
+                bits[(first + x) / 32] |= 1u << ((first + x) % 32);
+        }
+    }
+
+    // Candidates before each word, and the list in grid order
+    std::vector<uint32_t> ranks(numWords);
+    this->candidateBricks.clear();
+    for (uint32_t word = 0; word < numWords; word++)
+    {
+        ranks[word] = static_cast<uint32_t>(this->candidateBricks.size());
+        for (uint32_t remaining = bits[word]; remaining != 0; remaining &= remaining - 1)
+            this->candidateBricks.push_back(word * 32 + static_cast<uint32_t>(std::countr_zero(remaining)));
+    }
+
+    queue.WriteBuffer(this->candidateBitsBuffer, 0, bits.data(), sizeof(uint32_t) * numWords);
+
+    bufferDesc.size = sizeof(uint32_t) * numWords;
+    bufferDesc.usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst;
+    bufferDesc.label = "Candidate Ranks Buffer";
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->candidateRanksBuffer);
+    queue.WriteBuffer(this->candidateRanksBuffer, 0, ranks.data(), bufferDesc.size);
+
+    bufferDesc.size = sizeof(uint32_t) * std::max<size_t>(1, this->candidateBricks.size());
+    bufferDesc.label = "Candidate Bricks Buffer";
+    this->gpuBundle->ReuseOrCreateBuffer(&bufferDesc, this->candidateBricksBuffer);
+    if (!this->candidateBricks.empty())
+        queue.WriteBuffer(this->candidateBricksBuffer, 0, this->candidateBricks.data(), sizeof(uint32_t) * this->candidateBricks.size());
+
+    std::cout << "[Voxelizer] " << this->candidateBricks.size() << " of " << totalBricks << " bricks overlap the mesh" << std::endl;
+}
+
+//================================//
+wgpu::BindGroup Voxelizer::createTriangleBinningBindGroup(const wgpu::Buffer& uniformBuffer, uint32_t bricksThisPass)
+{
+    wgpu::BindGroupEntry entries[9]{};
+    entries[0].binding = 0; entries[0].buffer = uniformBuffer; entries[0].size = sizeof(VoxelizerUniforms);
+    entries[1].binding = 1; entries[1].buffer = this->vertexBuffer; entries[1].size = this->vertexBuffer.GetSize();
+    entries[2].binding = 2; entries[2].buffer = this->triangleBuffer; entries[2].size = this->triangleBuffer.GetSize();
+    entries[3].binding = 3; entries[3].buffer = this->binCountsBuffer; entries[3].size = sizeof(uint32_t) * bricksThisPass;
+    entries[4].binding = 4; entries[4].buffer = this->binCursorsBuffer; entries[4].size = sizeof(uint32_t) * bricksThisPass;
+    entries[5].binding = 5; entries[5].buffer = this->binnedTrianglesBuffer; entries[5].size = sizeof(uint32_t) * this->binnedTrianglesCapacity;
+    entries[6].binding = 6; entries[6].buffer = this->candidateBitsBuffer; entries[6].size = this->candidateBitsBuffer.GetSize();
+    entries[7].binding = 7; entries[7].buffer = this->candidateRanksBuffer; entries[7].size = this->candidateRanksBuffer.GetSize();
+    entries[8].binding = 8; entries[8].buffer = this->candidateBricksBuffer; entries[8].size = this->candidateBricksBuffer.GetSize();
+
+    wgpu::BindGroupDescriptor bindGroupDesc{};
+    bindGroupDesc.layout = this->triangleBinningPipeline.bindGroupLayout;
+    bindGroupDesc.entryCount = 9;
+    bindGroupDesc.entries = entries;
+    return this->gpuBundle->GetDevice().CreateBindGroup(&bindGroupDesc);
+}
+
+//================================//
+bool Voxelizer::countTriangleBins(const wgpu::Buffer& uniformBuffer, uint32_t bricksThisPass, uint32_t numTrianglesInRange, uint32_t& outNumBinned)
+{
+    wgpu::Device& device = this->gpuBundle->GetDevice();
+    wgpu::Queue queue = device.GetQueue();
+
+    const uint32_t numBlocks = (bricksThisPass + BIN_PREFIX_SUM_BLOCK_SIZE - 1) / BIN_PREFIX_SUM_BLOCK_SIZE;
+    wgpu::BindGroup binningBindGroup = this->createTriangleBinningBindGroup(uniformBuffer, bricksThisPass);
+
+    wgpu::BindGroupEntry entries[6]{};
+    entries[0].binding = 0; entries[0].buffer = uniformBuffer; entries[0].size = sizeof(VoxelizerUniforms);
+    entries[1].binding = 1; entries[1].buffer = this->binCountsBuffer; entries[1].size = sizeof(uint32_t) * bricksThisPass;
+    entries[2].binding = 2; entries[2].buffer = this->binOffsetsBuffer; entries[2].size = sizeof(uint32_t) * bricksThisPass;
+    entries[3].binding = 3; entries[3].buffer = this->binBlockSumsBuffer; entries[3].size = sizeof(uint32_t) * numBlocks;
+    entries[4].binding = 4; entries[4].buffer = this->binCursorsBuffer; entries[4].size = sizeof(uint32_t) * bricksThisPass;
+    entries[5].binding = 5; entries[5].buffer = this->binTotalBuffer; entries[5].size = sizeof(uint32_t);
+
+    wgpu::BindGroupDescriptor bindGroupDesc{};
+    bindGroupDesc.layout = this->binPrefixSumPipeline.bindGroupLayout;
+    bindGroupDesc.entryCount = 6;
+    bindGroupDesc.entries = entries;
+    wgpu::BindGroup prefixSumBindGroup = device.CreateBindGroup(&bindGroupDesc);
+
+    // Count, then offsets and cursors from the counts
+    wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
+    encoder.ClearBuffer(this->binCountsBuffer, 0, sizeof(uint32_t) * bricksThisPass);
+
+    wgpu::ComputePassEncoder pass = encoder.BeginComputePass();
+    pass.SetPipeline(this->triangleBinningPipeline.computePipeline);
+    pass.SetBindGroup(0, binningBindGroup);
+    DispatchLinear(pass, (numTrianglesInRange + TRIANGLE_BINNING_WORKGROUP_SIZE - 1) / TRIANGLE_BINNING_WORKGROUP_SIZE);
+
+    pass.SetPipeline(this->binPrefixSumPipeline.computePipeline);
+    pass.SetBindGroup(0, prefixSumBindGroup);
+    DispatchLinear(pass, numBlocks);
+    pass.SetPipeline(this->binPrefixSumPipeline.secondaryComputePipeline);
+    DispatchLinear(pass, numBlocks);
+    pass.End();
+
+    encoder.CopyBufferToBuffer(this->binTotalBuffer, 0, this->binTotalReadbackBuffer, 0, sizeof(uint32_t));
+    wgpu::CommandBuffer commandBuffer = encoder.Finish();
+    queue.Submit(1, &commandBuffer);
+
+    // The total sizes the triangle list before the scatter
+    wgpu::Future mapFuture = this->binTotalReadbackBuffer.MapAsync(
+        wgpu::MapMode::Read, 0, sizeof(uint32_t),
+        wgpu::CallbackMode::WaitAnyOnly,
+        [](wgpu::MapAsyncStatus status, wgpu::StringView message) {
+            if (status != wgpu::MapAsyncStatus::Success) {
+                std::cerr << "[Voxelizer] Bin total map failed: " << std::string(message.data, message.length) << std::endl;
+            }
+        }
+    );
+    this->gpuBundle->GetInstance().WaitAny(mapFuture, UINT64_MAX);
+
+    const uint32_t* data = static_cast<const uint32_t*>(this->binTotalReadbackBuffer.GetConstMappedRange(0, sizeof(uint32_t)));
+    if (!data)
+    {
+        std::cerr << "[Voxelizer] Failed to get mapped range for bin total" << std::endl;
+        return false;
+    }
+    outNumBinned = data[0];
+    this->binTotalReadbackBuffer.Unmap();
+    return true;
+}
+
+//================================//
+bool Voxelizer::reserveBinnedTriangles(uint32_t numBinned)
+{
+    if (numBinned <= this->binnedTrianglesCapacity && this->binnedTrianglesBuffer)
+        return true;
+
+    const wgpu::Limits& limits = this->gpuBundle->GetLimits();
+    const uint64_t maxEntries = std::min(limits.maxStorageBufferBindingSize, limits.maxBufferSize) / sizeof(uint32_t);
+    if (numBinned > maxEntries)
+        return false;
+
+    // Headroom so the next ranges and passes rarely grow it again
+    uint64_t capacity = std::min<uint64_t>(maxEntries, static_cast<uint64_t>(std::max(numBinned, 1u)) * 3 / 2 + 1);
+
+    wgpu::BufferDescriptor bufferDesc{};
+    bufferDesc.size = sizeof(uint32_t) * capacity;
+    bufferDesc.usage = wgpu::BufferUsage::Storage;
+    bufferDesc.mappedAtCreation = false;
+    bufferDesc.label = "Binned Triangles Buffer";
+    this->gpuBundle->SafeCreateBuffer(&bufferDesc, this->binnedTrianglesBuffer);
+    this->binnedTrianglesCapacity = static_cast<uint32_t>(capacity);
+    return true;
+}
+
+//================================//
+void Voxelizer::voxelizeBinnedTriangles(const wgpu::Buffer& uniformBuffer, uint32_t bricksThisPass, uint32_t numTrianglesInRange, uint32_t numBinned)
+{
+    wgpu::Device& device = this->gpuBundle->GetDevice();
+    wgpu::Queue queue = device.GetQueue();
+
+    // Created after the list was sized, the buffer may have been replaced
+    wgpu::BindGroup binningBindGroup = this->createTriangleBinningBindGroup(uniformBuffer, bricksThisPass);
+
+    wgpu::BindGroupEntry entries[9]{};
+    entries[0].binding = 0; entries[0].buffer = uniformBuffer; entries[0].size = sizeof(VoxelizerUniforms);
+    entries[1].binding = 1; entries[1].buffer = this->vertexBuffer; entries[1].size = this->vertexBuffer.GetSize();
+    entries[2].binding = 2; entries[2].buffer = this->triangleBuffer; entries[2].size = this->triangleBuffer.GetSize();
+    entries[3].binding = 3; entries[3].buffer = this->occupancyBuffer; entries[3].size = sizeof(uint32_t) * 16 * bricksThisPass;
+    entries[4].binding = 4; entries[4].buffer = this->voxelWinnersBuffer; entries[4].size = sizeof(uint32_t) * bricksThisPass * 512;
+    entries[5].binding = 5; entries[5].buffer = this->binOffsetsBuffer; entries[5].size = sizeof(uint32_t) * bricksThisPass;
+    entries[6].binding = 6; entries[6].buffer = this->binCountsBuffer; entries[6].size = sizeof(uint32_t) * bricksThisPass;
+    entries[7].binding = 7; entries[7].buffer = this->binnedTrianglesBuffer; entries[7].size = sizeof(uint32_t) * this->binnedTrianglesCapacity;
+    entries[8].binding = 8; entries[8].buffer = this->candidateBricksBuffer; entries[8].size = this->candidateBricksBuffer.GetSize();
+
+    wgpu::BindGroupDescriptor bindGroupDesc{};
+    bindGroupDesc.layout = this->voxelizationPipeline.bindGroupLayout;
+    bindGroupDesc.entryCount = 9;
+    bindGroupDesc.entries = entries;
+    wgpu::BindGroup voxelizationBindGroup = device.CreateBindGroup(&bindGroupDesc);
+
+    wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
+    wgpu::ComputePassEncoder pass = encoder.BeginComputePass();
+
+    // Scatter the triangle ids into the lists
+    pass.SetPipeline(this->triangleBinningPipeline.secondaryComputePipeline);
+    pass.SetBindGroup(0, binningBindGroup);
+    DispatchLinear(pass, (numTrianglesInRange + TRIANGLE_BINNING_WORKGROUP_SIZE - 1) / TRIANGLE_BINNING_WORKGROUP_SIZE);
+
+    // Every brick tests its own list only, either walking it or with one invocation per entry
+    pass.SetBindGroup(0, voxelizationBindGroup);
+    if (this->voxelizationMode == VoxelizationMode::TriangleParallel)
+    {
+        pass.SetPipeline(this->voxelizationPipeline.secondaryComputePipeline);
+        DispatchLinear(pass, (numBinned + 63) / 64);
+    }
+    else
+    {
+        pass.SetPipeline(this->voxelizationPipeline.computePipeline);
+        uint32_t numWorkGroups = (bricksThisPass + 63) / 64;
+        pass.DispatchWorkgroups(numWorkGroups, 1, 1);
+    }
+    pass.End();
+
+    wgpu::CommandBuffer commandBuffer = encoder.Finish();
+    queue.Submit(1, &commandBuffer);
+}
+
+//================================//
+void Voxelizer::resolveVoxelColors(const wgpu::Buffer& uniformBuffer, uint32_t bricksThisPass)
+{
+    wgpu::Device& device = this->gpuBundle->GetDevice();
+    wgpu::Queue queue = device.GetQueue();
+
+    wgpu::BindGroupEntry entries[8]{};
+    entries[0].binding = 0; entries[0].buffer = uniformBuffer; entries[0].size = sizeof(VoxelizerUniforms);
+    entries[1].binding = 1; entries[1].buffer = this->vertexBuffer; entries[1].size = this->vertexBuffer.GetSize();
+    entries[2].binding = 2; entries[2].buffer = this->triangleBuffer; entries[2].size = this->triangleBuffer.GetSize();
+    entries[3].binding = 3; entries[3].textureView = this->textureView;
+    entries[4].binding = 4; entries[4].sampler = this->textureSampler;
+    entries[5].binding = 5; entries[5].buffer = this->voxelWinnersBuffer; entries[5].size = sizeof(uint32_t) * bricksThisPass * 512;
+    entries[6].binding = 6; entries[6].buffer = this->denseColorsBuffer; entries[6].size = sizeof(uint32_t) * bricksThisPass * 512;
+    entries[7].binding = 7; entries[7].buffer = this->candidateBricksBuffer; entries[7].size = this->candidateBricksBuffer.GetSize();
+
+    wgpu::BindGroupDescriptor bindGroupDesc{};
+    bindGroupDesc.layout = this->voxelColorPipeline.bindGroupLayout;
+    bindGroupDesc.entryCount = 8;
+    bindGroupDesc.entries = entries;
+    wgpu::BindGroup bindGroup = device.CreateBindGroup(&bindGroupDesc);
+
+    wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
+    wgpu::ComputePassEncoder pass = encoder.BeginComputePass();
+    pass.SetPipeline(this->voxelColorPipeline.computePipeline);
+    pass.SetBindGroup(0, bindGroup);
+    DispatchLinear(pass, (bricksThisPass * 512 + 63) / 64);
+    pass.End();
+
+    wgpu::CommandBuffer commandBuffer = encoder.Finish();
+    queue.Submit(1, &commandBuffer);
+}
+
+//================================//
+wgpu::BindGroup Voxelizer::createSolidFillBindGroup(const wgpu::Buffer& uniformBuffer, uint32_t bricksThisPass)
+{
+    wgpu::BindGroupEntry entries[9]{};
+    entries[0].binding = 0; entries[0].buffer = uniformBuffer; entries[0].size = sizeof(VoxelizerUniforms);
+    entries[1].binding = 1; entries[1].buffer = this->vertexBuffer; entries[1].size = this->vertexBuffer.GetSize();
+    entries[2].binding = 2; entries[2].buffer = this->triangleBuffer; entries[2].size = this->triangleBuffer.GetSize();
+    entries[3].binding = 3; entries[3].buffer = this->parityFlipsBuffer; entries[3].size = sizeof(uint32_t) * 16 * bricksThisPass;
+    entries[4].binding = 4; entries[4].buffer = this->occupancyBuffer; entries[4].size = sizeof(uint32_t) * 16 * bricksThisPass;
+    entries[5].binding = 5; entries[5].buffer = this->denseColorsBuffer; entries[5].size = sizeof(uint32_t) * bricksThisPass * 512;
+    entries[6].binding = 6; entries[6].buffer = this->candidateBitsBuffer; entries[6].size = this->candidateBitsBuffer.GetSize();
+    entries[7].binding = 7; entries[7].buffer = this->candidateRanksBuffer; entries[7].size = this->candidateRanksBuffer.GetSize();
+    entries[8].binding = 8; entries[8].buffer = this->candidateBricksBuffer; entries[8].size = this->candidateBricksBuffer.GetSize();
+
+    wgpu::BindGroupDescriptor bindGroupDesc{};
+    bindGroupDesc.layout = this->solidFillPipeline.bindGroupLayout;
+    bindGroupDesc.entryCount = 9;
+    bindGroupDesc.entries = entries;
+    return this->gpuBundle->GetDevice().CreateBindGroup(&bindGroupDesc);
+}
+
+//================================//
+void Voxelizer::flipSolidCrossings(const wgpu::Buffer& uniformBuffer, VoxelizerUniforms& uniforms, uint32_t bricksThisPass, uint32_t numTriangles)
+{
+    wgpu::Device& device = this->gpuBundle->GetDevice();
+    wgpu::Queue queue = device.GetQueue();
+
+    // Crossings of every triangle of the chunk, not only the last range binned
+    uniforms.triangleStart = 0;
+    uniforms.triangleEnd = numTriangles;
+    queue.WriteBuffer(uniformBuffer, 0, &uniforms, sizeof(VoxelizerUniforms));
+
+    wgpu::BindGroup bindGroup = this->createSolidFillBindGroup(uniformBuffer, bricksThisPass);
+    wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
+    wgpu::ComputePassEncoder pass = encoder.BeginComputePass();
+    pass.SetBindGroup(0, bindGroup);
+    pass.SetPipeline(this->solidFillPipeline.computePipeline);
+    DispatchLinear(pass, (numTriangles + 63) / 64);
+    pass.End();
+
+    wgpu::CommandBuffer commandBuffer = encoder.Finish();
+    queue.Submit(1, &commandBuffer);
+}
+
+//================================//
+void Voxelizer::fillSolidInterior(wgpu::CommandEncoder& encoder, const wgpu::Buffer& uniformBuffer, const VoxelizerUniforms& uniforms, uint32_t bricksThisPass)
+{
+    wgpu::BindGroup bindGroup = this->createSolidFillBindGroup(uniformBuffer, bricksThisPass);
+
+    // 64 rows of voxels per brick row, passes hold whole brick rows
+    const uint32_t numRows = bricksThisPass / uniforms.brickResolution * 64;
+    wgpu::ComputePassEncoder pass = encoder.BeginComputePass();
+    pass.SetBindGroup(0, bindGroup);
+    pass.SetPipeline(this->solidFillPipeline.secondaryComputePipeline);
+    DispatchLinear(pass, (numRows + 63) / 64);
+    pass.End();
+}
+
+//================================//
+VoxelizationMode Voxelizer::chooseVoxelizationMode(double voxelSize) const
+{
+    const double numTriangles = this->meshStream ? static_cast<double>(this->meshStream->GetTriangleCount()) : static_cast<double>(this->facesVec.size());
+    if (voxelSize <= 0.0 || numTriangles == 0.0)
+        return VoxelizationMode::BrickParallel;
+
+    // Mean of the largest bounds side of the triangles. Small triangles leave a brick long lists
+    // to walk alone, one invocation per entry spreads them instead. A stream sums them when opened
+    double extentSum = this->meshStream ? this->meshStream->GetExtentSum() : 0.0;
+    for (const auto& face : this->facesVec)
+    {
+        const std::array<double, 3>& a = this->verticesVec[face[0]];
+        const std::array<double, 3>& b = this->verticesVec[face[1]];
+        const std::array<double, 3>& c = this->verticesVec[face[2]];
+
+        double extent = 0.0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            double minValue = std::min({a[axis], b[axis], c[axis]});
+            double maxValue = std::max({a[axis], b[axis], c[axis]});
+            extent = std::max(extent, maxValue - minValue);
+        }
+        extentSum += extent;
+    }
+
+    double meanExtent = extentSum / (numTriangles * voxelSize);
+    VoxelizationMode mode = meanExtent <= TRIANGLE_PARALLEL_MAX_EXTENT ? VoxelizationMode::TriangleParallel : VoxelizationMode::BrickParallel;
+
+    std::cout << "[Voxelizer] Mean triangle extent of " << meanExtent << " voxels, using the "
+              << (mode == VoxelizationMode::TriangleParallel ? "triangle" : "brick") << " parallel mode" << std::endl;
+    return mode;
+}
+
+//================================//
+bool Voxelizer::readPassCounters(PassReadback& readback)
 {
-    if (this->verticesVec.empty() || this->facesVec.empty()) 
+    this->gpuBundle->GetInstance().WaitAny(readback.countersMap, UINT64_MAX);
+
+    const uint32_t* data = static_cast<const uint32_t*>(readback.counters.GetConstMappedRange(0, sizeof(uint32_t) * 2));
+    if (!data)
+    {
+        std::cerr << "[Voxelizer] Failed to get mapped range for counters" << std::endl;
+        return false;
+    }
+    readback.occupiedBrickCount = data[0];
+    readback.totalColorCount = data[1];
+    readback.counters.Unmap();
+
+    assert(readback.occupiedBrickCount <= readback.bricksThisPass);
+    assert(readback.totalColorCount <= readback.bricksThisPass * 512);
+    return true;
+}
+
+//================================//
+void Voxelizer::requestPassData(PassReadback& readback)
+{
+    wgpu::Device& device = this->gpuBundle->GetDevice();
+    wgpu::Queue queue = device.GetQueue();
+
+    // Only what the pass produced
+    const uint64_t occupancySize = sizeof(uint32_t) * 16 * readback.bricksThisPass;
+    const uint64_t brickOutputSize = sizeof(BrickOutput) * readback.occupiedBrickCount;
+    const uint64_t colorsSize = sizeof(uint32_t) * readback.totalColorCount;
+
+    wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
+    encoder.CopyBufferToBuffer(this->occupancyBuffer, 0, readback.occupancy, 0, occupancySize);
+    encoder.CopyBufferToBuffer(this->brickOutputBuffer, 0, readback.brickOutput, 0, brickOutputSize);
+    encoder.CopyBufferToBuffer(this->packedColorBuffer, 0, readback.packedColors, 0, colorsSize);
+    wgpu::CommandBuffer commandBuffer = encoder.Finish();
+    queue.Submit(1, &commandBuffer);
+
+    auto onMapped = [](wgpu::MapAsyncStatus status, wgpu::StringView message) {
+        if (status != wgpu::MapAsyncStatus::Success) {
+            std::cerr << "[Voxelizer] Pass readback map failed: " << std::string(message.data, message.length) << std::endl;
+        }
+    };
+    readback.dataMaps[0] = readback.occupancy.MapAsync(wgpu::MapMode::Read, 0, occupancySize, wgpu::CallbackMode::WaitAnyOnly, onMapped);
+    readback.dataMaps[1] = readback.brickOutput.MapAsync(wgpu::MapMode::Read, 0, brickOutputSize, wgpu::CallbackMode::WaitAnyOnly, onMapped);
+    readback.dataMaps[2] = readback.packedColors.MapAsync(wgpu::MapMode::Read, 0, colorsSize, wgpu::CallbackMode::WaitAnyOnly, onMapped);
+    readback.pending = true;
+}
+
+//================================//
+bool Voxelizer::writePassData(PassReadback& readback, VoxelFileWriter& writer)
+{
+    // WaitAny returns on the first completion, each map is waited on
+    for (wgpu::Future& future : readback.dataMaps)
+        this->gpuBundle->GetInstance().WaitAny(future, UINT64_MAX);
+    readback.pending = false;
+
+    const uint32_t occupiedBrickCount = readback.occupiedBrickCount;
+    const uint32_t* occupancyData = static_cast<const uint32_t*>(readback.occupancy.GetConstMappedRange(0, sizeof(uint32_t) * 16 * readback.bricksThisPass));
+    const BrickOutput* brickOutputData = static_cast<const BrickOutput*>(readback.brickOutput.GetConstMappedRange(0, sizeof(BrickOutput) * occupiedBrickCount));
+    const uint32_t* colorData = static_cast<const uint32_t*>(readback.packedColors.GetConstMappedRange(0, sizeof(uint32_t) * readback.totalColorCount));
+
+    if (!occupancyData || !brickOutputData || !colorData)
+    {
+        std::cerr << "[Voxelizer] Failed to get mapped range from buffers" << std::endl;
+        return false;
+    }
+
+    // Repacked in parallel, then handed to the writer in order
+    std::vector<brickDataEntry> passBricks(occupiedBrickCount);
+    JobSystem::Shared().ParallelFor(occupiedBrickCount, 64, [&](uint32_t i) {
+        const BrickOutput& brick = brickOutputData[i];
+        brickDataEntry& dataEntry = passBricks[i];
+
+        std::memcpy(dataEntry.occupancy, &occupancyData[brick.brickGridIndex * 16], sizeof(uint32_t) * 16);
+
+        dataEntry.colors.resize(brick.numOccupied);
+        for (uint32_t c = 0; c < brick.numOccupied; c++)
+        {
+            uint32_t packedColor = colorData[brick.dataOffset + c];
+            dataEntry.colors[c].r = packedColor & 0xFF;
+            dataEntry.colors[c].g = (packedColor >> 8) & 0xFF;
+            dataEntry.colors[c].b = (packedColor >> 16) & 0xFF;
+        }
+    });
+
+    for (uint32_t i = 0; i < occupiedBrickCount; i++)
+    {
+        const BrickOutput& brick = brickOutputData[i];
+
+        VoxelColorRGB lodColor;
+        lodColor.r = brick.lodColor & 0xFF;
+        lodColor.g = (brick.lodColor >> 8) & 0xFF;
+        lodColor.b = (brick.lodColor >> 16) & 0xFF;
+
+        writer.AddBrick(this->candidateBricks[readback.brickStart + brick.brickGridIndex], std::move(passBricks[i]), lodColor);
+    }
+
+    readback.occupancy.Unmap();
+    readback.brickOutput.Unmap();
+    readback.packedColors.Unmap();
+    return true;
+}
+
+//================================//
+bool Voxelizer::voxelizeMesh(const std::string& outputVoxelFile, uint32_t voxelResolution, uint32_t maxBricksPerPass, uint32_t numPasses)
+{
+    if (!this->meshStream && (this->verticesVec.empty() || this->facesVec.empty()))
     {
         std::cerr << "[Voxelizer] No mesh loaded" << std::endl;
         return false;
@@ -602,8 +1613,12 @@ bool Voxelizer::voxelizeMesh(const std::string& outputVoxelFile, uint32_t voxelR
 
     std::cout << "[Voxelizer] Starting voxelization with resolution " << voxelResolution 
               << " (" << (voxelResolution * voxelResolution * voxelResolution) << " voxels)" << std::endl;
+
+    if (this->backend == VoxelizerBackend::CPU)
+        return this->voxelizeMeshCPU(outputVoxelFile, voxelResolution);
+
     std::cout << "[Voxelizer] Max bricks per pass: " << maxBricksPerPass << std::endl;
-    std::cout << "[Voxelizer] Number of passes: " << static_cast<uint32_t>(numPasses) << std::endl;
+    std::cout << "[Voxelizer] Number of passes: " << numPasses << std::endl;
 
     this->initializeGpuResources(maxBricksPerPass);
 
@@ -612,6 +1627,7 @@ bool Voxelizer::voxelizeMesh(const std::string& outputVoxelFile, uint32_t voxelR
 
     double maxExtent = std::max({meshWidth, meshHeight, meshDepth});
     float voxelSize = static_cast<float>(maxExtent / voxelResolution);
+    this->voxelizationMode = this->chooseVoxelizationMode(maxExtent / voxelResolution);
 
     VoxelFileWriter writer(outputVoxelFile, voxelResolution);
 
@@ -620,13 +1636,14 @@ bool Voxelizer::voxelizeMesh(const std::string& outputVoxelFile, uint32_t voxelR
     uniforms.voxelResolution = voxelResolution;
     uniforms.brickResolution = voxelResolution / 8;
     uniforms.voxelSize = voxelSize;
-    uniforms.numTriangles = static_cast<uint32_t>(this->facesVec.size());
+    uniforms.numTriangles = 0;
     uniforms.meshMinBounds[0] = static_cast<float>(this->meshMinBounds[0]);
     uniforms.meshMinBounds[1] = static_cast<float>(this->meshMinBounds[1]);
     uniforms.meshMinBounds[2] = static_cast<float>(this->meshMinBounds[2]);
-    uniforms._pad1 = 0;
-    uniforms._pad2[0] = 0;
-    uniforms._pad2[1] = 0;
+    uniforms.triangleBase = 0;
+    this->setQuantizationUniforms(uniforms);
+    uniforms.triangleStart = 0;
+    uniforms.triangleEnd = 0;
 
     wgpu::BufferDescriptor uniformBufferDesc{};
     uniformBufferDesc.size = sizeof(VoxelizerUniforms);
@@ -636,64 +1653,103 @@ bool Voxelizer::voxelizeMesh(const std::string& outputVoxelFile, uint32_t voxelR
     wgpu::Buffer uniformBuffer;;
     this->gpuBundle->SafeCreateBuffer(&uniformBufferDesc, uniformBuffer);
 
+    // Pass N is written out while pass N + 1 computes, each pass reads back into its own set of buffers
     uint32_t bricksProcessed = 0;
-    for (uint8_t pass = 0; pass < numPasses; pass++)
+    for (uint32_t pass = 0; pass < numPasses; pass++)
     {
-        std::clock_t startPassTime = std::clock();
+        auto startPassTime = std::chrono::steady_clock::now();
+
+        PassReadback& readback = this->passReadbacks[pass % 2];
+        PassReadback& previousReadback = this->passReadbacks[(pass + 1) % 2];
 
         uint32_t brickStart = bricksProcessed;
-        uint32_t bricksThisPass = std::min(maxBricksPerPass, (voxelResolution / 8) * (voxelResolution / 8) * (voxelResolution / 8) - bricksProcessed);
+        uint32_t bricksThisPass = std::min(maxBricksPerPass, static_cast<uint32_t>(this->candidateBricks.size()) - bricksProcessed);
         uint32_t brickEnd = brickStart + bricksThisPass;
 
         uniforms.brickStart = brickStart;
         uniforms.brickEnd = brickEnd;
         queue.WriteBuffer(uniformBuffer, 0, &uniforms, sizeof(VoxelizerUniforms));
 
-        std::cout << "[Voxelizer] Pass " << (pass + 1) << "/" << (int)numPasses 
-                  << ": Processing bricks " << brickStart << " to " << brickEnd - 1 << std::endl;
+        std::cout << "[Voxelizer] Pass " << (pass + 1) << "/" << numPasses
+                  << ": Processing candidate bricks " << brickStart << " to " << brickEnd - 1 << std::endl;
 
-        // Reset counters
-        uint32_t counterZeros[2] = {0, 0};
-        queue.WriteBuffer(this->countersBuffer, 0, counterZeros, sizeof(counterZeros));
+        // Reset counters, occupancy and dense colors on the GPU, ordered after the copies of the previous pass
+        {
+            wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
+            encoder.ClearBuffer(this->countersBuffer, 0, sizeof(uint32_t) * 2);
+            encoder.ClearBuffer(this->occupancyBuffer, 0, sizeof(uint32_t) * 16 * bricksThisPass);
+            encoder.ClearBuffer(this->denseColorsBuffer, 0, sizeof(uint32_t) * 512 * bricksThisPass);
+            encoder.ClearBuffer(this->voxelWinnersBuffer, 0, sizeof(uint32_t) * 512 * bricksThisPass);
+            if (this->solid)
+                encoder.ClearBuffer(this->parityFlipsBuffer, 0, sizeof(uint32_t) * 16 * bricksThisPass);
+            wgpu::CommandBuffer commandBuffer = encoder.Finish();
+            queue.Submit(1, &commandBuffer);
+        }
 
-        // Clear occupancy buffer and color dense buffer for this pass
-        std::vector<uint32_t> occZeros(16 * bricksThisPass, 0);
-        queue.WriteBuffer(this->occupancyBuffer, 0, occZeros.data(), sizeof(uint32_t) * 16 * bricksThisPass);
-        std::vector<uint32_t> colorZeros(512 * bricksThisPass, 0);
-        queue.WriteBuffer(this->denseColorsBuffer, 0, colorZeros.data(), sizeof(uint32_t) * 512 * bricksThisPass);
+        // [1] Binning and voxelization of every chunk of the mesh, in as many triangle ranges as it takes for
+        // their lists to fit. Occupancy and winning triangles accumulate over the chunks and ranges
+        uniforms.triangleBase = 0;
+        bool allChunks = this->forEachMeshChunk([&](uint32_t numTriangles) {
+            uint32_t trianglesPerRange = numTriangles;
+            uint32_t triangleStart = 0;
+            bool anyBinned = false;
+            while (triangleStart < numTriangles)
+            {
+                uniforms.numTriangles = numTriangles;
+                uniforms.triangleStart = triangleStart;
+                uniforms.triangleEnd = triangleStart + std::min(trianglesPerRange, numTriangles - triangleStart);
+                queue.WriteBuffer(uniformBuffer, 0, &uniforms, sizeof(VoxelizerUniforms));
+                const uint32_t numTrianglesInRange = uniforms.triangleEnd - uniforms.triangleStart;
 
-        // [1] Voxelization pass
-        {
-            wgpu::BindGroupEntry entries[7]{};
-            entries[0].binding = 0; entries[0].buffer = uniformBuffer; entries[0].size = sizeof(VoxelizerUniforms);
-            entries[1].binding = 1; entries[1].buffer = this->vertexBuffer; entries[1].size = sizeof(Vertex) * verticesVec.size();
-            entries[2].binding = 2; entries[2].buffer = this->triangleBuffer; entries[2].size = sizeof(Triangle) * facesVec.size();
-            entries[3].binding = 3; entries[3].textureView = this->textureViews[0];
-            entries[4].binding = 4; entries[4].sampler = this-> textureSamplers[0];
-            entries[5].binding = 5; entries[5].buffer = this->occupancyBuffer; entries[5].size = sizeof(uint32_t) * 16 * bricksThisPass;
-            entries[6].binding = 6; entries[6].buffer = this->denseColorsBuffer; entries[6].size = sizeof(uint32_t) * bricksThisPass * 512;
+                uint32_t numBinned = 0;
+                if (!this->countTriangleBins(uniformBuffer, bricksThisPass, numTrianglesInRange, numBinned))
+                    return false;
 
-            wgpu::BindGroupDescriptor bindGroupDesc{};
-            bindGroupDesc.layout = this->voxelizationPipeline.bindGroupLayout;
-            bindGroupDesc.entryCount = 7;
-            bindGroupDesc.entries = entries;
-            wgpu::BindGroup bindGroup = device.CreateBindGroup(&bindGroupDesc);
+                if (!this->reserveBinnedTriangles(numBinned))
+                {
+                    if (numTrianglesInRange == 1)
+                    {
+                        std::cerr << "[Voxelizer] Triangle " << triangleStart << " overlaps more bricks than the triangle list holds" << std::endl;
+                        return false;
+                    }
 
-            wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
-            wgpu::ComputePassEncoder pass = encoder.BeginComputePass();
-            pass.SetPipeline(this->voxelizationPipeline.computePipeline);
-            pass.SetBindGroup(0, bindGroup);
+                    trianglesPerRange = (numTrianglesInRange + 1) / 2;
+                    std::cout << "[Voxelizer] " << numBinned << " triangle-brick overlaps do not fit, binning "
+                              << trianglesPerRange << " triangles at a time" << std::endl;
+                    continue;
+                }
 
-            uint32_t numWorkGroups = (bricksThisPass + 63) / 64;
-            pass.DispatchWorkgroups(numWorkGroups, 1, 1);
-            pass.End();
+                if (numBinned > 0)
+                {
+                    this->voxelizeBinnedTriangles(uniformBuffer, bricksThisPass, numTrianglesInRange, numBinned);
+                    anyBinned = true;
+                }
 
-            wgpu::CommandBuffer commandBuffer = encoder.Finish();
-            queue.Submit(1, &commandBuffer);
-        }
+                triangleStart = uniforms.triangleEnd;
+            }
 
-        // [2] Compact
+            // Voxels won by a triangle of the chunk take its color, later chunks overwrite the ones they win
+            if (anyBinned)
+                this->resolveVoxelColors(uniformBuffer, bricksThisPass);
+
+            // Crossings are counted while the chunk is on the GPU, the rows are filled once every chunk went through
+            if (this->solid)
+                this->flipSolidCrossings(uniformBuffer, uniforms, bricksThisPass, numTriangles);
+
+            uniforms.triangleBase += numTriangles;
+            return true;
+        });
+        if (!allChunks)
+            return false;
+
+        // [2] Solid fill, compaction and counter copy in a single submission
         {
+            wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
+
+            // Every triangle of the mesh has been through the pass
+            if (this->solid)
+                this->fillSolidInterior(encoder, uniformBuffer, uniforms, bricksThisPass);
+
             wgpu::BindGroupEntry entries[6]{};
             entries[0].binding = 0; entries[0].buffer = uniformBuffer; entries[0].size = sizeof(VoxelizerUniforms);
             entries[1].binding = 1; entries[1].buffer = this->occupancyBuffer; entries[1].size = sizeof(uint32_t) * 16 * bricksThisPass;
@@ -708,7 +1764,6 @@ bool Voxelizer::voxelizeMesh(const std::string& outputVoxelFile, uint32_t voxelR
             bindGroupDesc.entries = entries;
             wgpu::BindGroup bindGroup = device.CreateBindGroup(&bindGroupDesc);
 
-            wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
             wgpu::ComputePassEncoder pass = encoder.BeginComputePass();
             pass.SetPipeline(this->compactVoxelPipeline.computePipeline);
             pass.SetBindGroup(0, bindGroup);
@@ -717,169 +1772,51 @@ bool Voxelizer::voxelizeMesh(const std::string& outputVoxelFile, uint32_t voxelR
             pass.DispatchWorkgroups(numWorkGroups, 1, 1);
             pass.End();
 
+            encoder.CopyBufferToBuffer(this->countersBuffer, 0, readback.counters, 0, sizeof(uint32_t) * 2);
             wgpu::CommandBuffer commandBuffer = encoder.Finish();
             queue.Submit(1, &commandBuffer);
         }
 
-        // We can wait fer the GPU to finish here
-        {
-            wgpu::Future workDoneFuture = queue.OnSubmittedWorkDone(
-                wgpu::CallbackMode::WaitAnyOnly,
-                [](wgpu::QueueWorkDoneStatus status, wgpu::StringView message) {
-                    if (status != wgpu::QueueWorkDoneStatus::Success) {
-                        std::cerr << "[Voxelizer] Queue work failed: " << std::string(message.data, message.length) << std::endl;
-                    }
-                }
-            );
-            this->gpuBundle->GetInstance().WaitAny(workDoneFuture, UINT64_MAX);
-            this->gpuBundle->GetInstance().WaitAny(workDoneFuture, UINT64_MAX);
-        }
-
-        // Reset readback buffer descriptors
-        {
-            wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
-            encoder.CopyBufferToBuffer(this->countersBuffer, 0, this->counterReadbackBuffer, 0, sizeof(uint32_t) * 2);
-            wgpu::CommandBuffer commandBuffer = encoder.Finish();
-            queue.Submit(1, &commandBuffer);
-        }
-
-        uint32_t occupiedBrickCount = 0;
-        uint32_t totalColorCount = 0;
-        {
-            wgpu::Future mapFuture = this->counterReadbackBuffer.MapAsync(
-                wgpu::MapMode::Read, 0, sizeof(uint32_t) * 2,
-                wgpu::CallbackMode::WaitAnyOnly,
-                [](wgpu::MapAsyncStatus status, wgpu::StringView message) {
-                    if (status != wgpu::MapAsyncStatus::Success) {
-                        std::cerr << "[Voxelizer] Counter map failed: " << std::string(message.data, message.length) << std::endl;
-                    }
-                }
-            );
-            this->gpuBundle->GetInstance().WaitAny(mapFuture, UINT64_MAX);
-            
-            const uint32_t* data = static_cast<const uint32_t*>(this->counterReadbackBuffer.GetConstMappedRange(0, sizeof(uint32_t) * 2));
-            if (!data) 
-            {
-                std::cerr << "[Voxelizer] Failed to get mapped range for counters" << std::endl;
-                return false;
-            }
-            occupiedBrickCount = data[0];
-            totalColorCount = data[1];
-            this->counterReadbackBuffer.Unmap();
-        }
-
-        assert(occupiedBrickCount <= bricksThisPass);
-        assert(totalColorCount <= bricksThisPass * 512);
-
-        std::cout << "[Voxelizer] Pass " << (pass + 1) << ": " << occupiedBrickCount 
-                  << " occupied bricks, " << totalColorCount << " colors" << std::endl;
-
-                
-        if (occupiedBrickCount == 0) 
-        {
-            bricksProcessed += bricksThisPass;
-            continue;
-        }
-
-        // Prepare to read the data back, in this pass
-        {
-            wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
-            encoder.CopyBufferToBuffer(this->occupancyBuffer, 0, this->occupancyReadbackBuffer, 0, sizeof(uint32_t) * 16 * bricksThisPass);
-            encoder.CopyBufferToBuffer(this->brickOutputBuffer, 0, this->brickOutputReadbackBuffer, 0, sizeof(BrickOutput) * occupiedBrickCount);
-            encoder.CopyBufferToBuffer(this->packedColorBuffer, 0, this->packedColorReadbackBuffer, 0, sizeof(uint32_t) * totalColorCount);
-            wgpu::CommandBuffer commandBuffer = encoder.Finish();
-            queue.Submit(1, &commandBuffer);
-        }
-
-        wgpu::Future occMapFuture = this->occupancyReadbackBuffer.MapAsync(
-            wgpu::MapMode::Read, 0, sizeof(uint32_t) * 16 * bricksThisPass,
-            wgpu::CallbackMode::WaitAnyOnly,
-            [](wgpu::MapAsyncStatus status, wgpu::StringView message) {
-                if (status != wgpu::MapAsyncStatus::Success) {
-                    std::cerr << "[Voxelizer] Occupancy map failed: " << std::string(message.data, message.length) << std::endl;
-                }
-            }
-        );
-
-        wgpu::Future brickMapFuture = this->brickOutputReadbackBuffer.MapAsync(
-            wgpu::MapMode::Read, 0, sizeof(BrickOutput) * occupiedBrickCount,
+        readback.brickStart = brickStart;
+        readback.bricksThisPass = bricksThisPass;
+        readback.countersMap = readback.counters.MapAsync(
+            wgpu::MapMode::Read, 0, sizeof(uint32_t) * 2,
             wgpu::CallbackMode::WaitAnyOnly,
             [](wgpu::MapAsyncStatus status, wgpu::StringView message) {
                 if (status != wgpu::MapAsyncStatus::Success) {
-                    std::cerr << "[Voxelizer] Brick output map failed: " << std::string(message.data, message.length) << std::endl;
+                    std::cerr << "[Voxelizer] Counter map failed: " << std::string(message.data, message.length) << std::endl;
                 }
             }
         );
 
-        wgpu::Future colorMapFuture = this->packedColorReadbackBuffer.MapAsync(
-            wgpu::MapMode::Read, 0, sizeof(uint32_t) * totalColorCount,
-            wgpu::CallbackMode::WaitAnyOnly,
-            [](wgpu::MapAsyncStatus status, wgpu::StringView message) {
-                if (status != wgpu::MapAsyncStatus::Success) {
-                    std::cerr << "[Voxelizer] Colors map failed: " << std::string(message.data, message.length) << std::endl;
-                }
-            }
-        );
-
-        // Wait for all three maps
-        wgpu::FutureWaitInfo waitInfos[3] = {
-            {occMapFuture, false},
-            {brickMapFuture, false},
-            {colorMapFuture, false}
-        };
-        this->gpuBundle->GetInstance().WaitAny(3, waitInfos, UINT64_MAX);
-
-        // Final raw data:
-        const uint32_t* occupancyData = static_cast<const uint32_t*>(this->occupancyReadbackBuffer.GetConstMappedRange(0, sizeof(uint32_t) * 16 * bricksThisPass));
-        const BrickOutput* brickOutputData = static_cast<const BrickOutput*>(this->brickOutputReadbackBuffer.GetConstMappedRange(0, sizeof(BrickOutput) * occupiedBrickCount));
-        const uint32_t* colorData = static_cast<const uint32_t*>(this->packedColorReadbackBuffer.GetConstMappedRange(0, sizeof(uint32_t) * totalColorCount));
-
-        if (!occupancyData || !brickOutputData || !colorData) 
-        {
-            std::cerr << "[Voxelizer] Failed to get mapped range from buffers" << std::endl;
+        // [3] The previous pass is written out while this one computes
+        if (previousReadback.pending && !this->writePassData(previousReadback, writer))
             return false;
-        }
 
-        for (uint32_t i = 0; i < occupiedBrickCount; i++)
-        {
-            const BrickOutput& brick = brickOutputData[i];
-
-            uint32_t localBrickIndex = brick.brickGridIndex;
-            uint32_t globalBrickIndex = brickStart + localBrickIndex;
-
-            uint32_t occupancy[16];
-            std::memcpy(occupancy, &occupancyData[localBrickIndex * 16], sizeof(uint32_t) * 16);
-
-            std::vector<VoxelColorRGB> colors(brick.numOccupied);
-            for (uint32_t c = 0; c < brick.numOccupied; c++)
-            {
-                uint32_t packedColor = colorData[brick.dataOffset + c];
-                VoxelColorRGB color;
-                colors[c].r = packedColor & 0xFF;
-                colors[c].g = (packedColor >> 8) & 0xFF;
-                colors[c].b = (packedColor >> 16) & 0xFF;
-            }
-
-            VoxelColorRGB lodColor;
-            lodColor.r = brick.lodColor & 0xFF;
-            lodColor.g = (brick.lodColor >> 8) & 0xFF;
-            lodColor.b = (brick.lodColor >> 16) & 0xFF;
+        // [4] Sizes of this pass, its data is copied and mapped now and written out during the next pass
+        if (!this->readPassCounters(readback))
+            return false;
 
-            writer.AddBrick(globalBrickIndex, occupancy, colors, lodColor);
-        }
+        std::cout << "[Voxelizer] Pass " << (pass + 1) << ": " << readback.occupiedBrickCount
+                  << " occupied bricks, " << readback.totalColorCount << " colors" << std::endl;
 
-        this->occupancyReadbackBuffer.Unmap();
-        this->brickOutputReadbackBuffer.Unmap();
-        this->packedColorReadbackBuffer.Unmap();
+        if (readback.occupiedBrickCount > 0)
+            this->requestPassData(readback);
 
         bricksProcessed += bricksThisPass;
 
-        std::clock_t endPassTime = std::clock();
-        double passDuration = double(endPassTime - startPassTime) / CLOCKS_PER_SEC;
-        std::cout << "[Voxelizer] Pass " << (pass + 1) << " completed in " 
+        double passDuration = std::chrono::duration<double>(std::chrono::steady_clock::now() - startPassTime).count();
+        std::cout << "[Voxelizer] Pass " << (pass + 1) << " submitted in "
                   << passDuration << " seconds." << std::endl;
     }
 
+    // The last pass has no next one to overlap with
+    for (PassReadback& readback : this->passReadbacks)
+    {
+        if (readback.pending && !this->writePassData(readback, writer))
+            return false;
+    }
+
     writer.EndFile();
 
     std::cout << "[Voxelizer] Voxelization complete. Voxel file saved to " << outputVoxelFile << std::endl;
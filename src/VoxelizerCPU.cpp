@@ -0,0 +1,835 @@
+#include "../includes/Voxelizer.hpp"
+#include "../includes/VoxelIO.hpp"
+#include "../includes/JobSystem.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define VOXELIZER_CPU_NEON
+#elif defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#define VOXELIZER_CPU_AVX2 // Only the row test kernel is built for AVX2, picked at runtime
+#endif
+
+#if defined(VOXELIZER_CPU_AVX2) && (defined(__GNUC__) || defined(__clang__))
+#define VOXELIZER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define VOXELIZER_TARGET_AVX2
+#endif
+
+// Same tolerance as the overlap test of computeVoxelization.wgsl
+const float CPU_OVERLAP_EPSILON = 1e-6f;
+// Bricks per job, a brick with a long triangle list can take a while so keep them small enough to balance
+const uint32_t CPU_VOXELIZER_BRICK_GRAIN = 8;
+
+//================================//
+// One brick row of voxel centers along x, tested with a single instruction per separating axis
+#if defined(VOXELIZER_CPU_NEON)
+struct RowLanes { float32x4_t low; float32x4_t high; };
+
+static inline RowLanes LoadRow(const float centersX[8]) { return { vld1q_f32(centersX), vld1q_f32(centersX + 4) }; }
+
+//================================//
+static inline uint32_t InRangeMask4(float32x4_t x, float scale, float lo, float hi)
+{
+    static const uint32_t laneBits[4] = {1, 2, 4, 8};
+    float32x4_t projection = vmulq_n_f32(x, scale);
+    uint32x4_t inside = vandq_u32(vcgeq_f32(projection, vdupq_n_f32(lo)), vcleq_f32(projection, vdupq_n_f32(hi)));
+    return vaddvq_u32(vandq_u32(inside, vld1q_u32(laneBits)));
+}
+
+//================================//
+static inline uint32_t InRangeMask(const RowLanes& row, float scale, float lo, float hi)
+{
+    return InRangeMask4(row.low, scale, lo, hi) | (InRangeMask4(row.high, scale, lo, hi) << 4);
+}
+#else
+// Plain floats on x86 too, the AVX2 kernel loads them itself so the rest of the file builds for any CPU
+struct RowLanes { float x[8]; };
+
+static inline RowLanes LoadRow(const float centersX[8])
+{
+    RowLanes row;
+    std::memcpy(row.x, centersX, sizeof(row.x));
+    return row;
+}
+
+//================================//
+static inline uint32_t InRangeMask(const RowLanes& row, float scale, float lo, float hi)
+{
+    uint32_t mask = 0;
+    for (uint32_t lane = 0; lane < 8; lane++)
+    {
+        float projection = row.x[lane] * scale;
+        if (projection >= lo && projection <= hi)
+            mask |= 1u << lane;
+    }
+    return mask;
+}
+#endif
+
+#if defined(VOXELIZER_CPU_AVX2)
+//================================//
+static bool CpuHasAVX2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// Checked once, the row tests branch on it
+static const bool CPU_HAS_AVX2 = CpuHasAVX2();
+#endif
+
+//================================//
+// Separating axes of a triangle against boxes, the triangle projects on [minProj, maxProj]
+struct CpuSeparatingAxis
+{
+    float axis[3];
+    float minProj;
+    float maxProj;
+    float absSum; // Box projection radius is halfSize * absSum
+};
+
+struct CpuTriangleAxes
+{
+    CpuSeparatingAxis axes[13]; // 3 box axes, the normal, 9 edge cross products
+    uint32_t numAxes = 0;
+};
+
+//================================//
+// Mesh as the GPU sees it, float positions and the material texture array
+struct CpuMeshView
+{
+    const std::vector<std::array<int, 3>>* faces;
+    std::vector<std::array<float, 3>> positions;
+    std::vector<std::array<float, 2>> uvs;
+    std::vector<uint32_t> layers;
+    float meshMinBounds[3];
+    float voxelSize;
+    uint32_t brickResolution;
+
+    const TextureArray* textureArray;
+};
+
+//================================//
+// Reference: Akenine-Möller "Fast 3D Triangle-Box Overlap Testing", the axes do not depend on the box
+static void SetupTriangleAxes(const float* p0, const float* p1, const float* p2, CpuTriangleAxes& outAxes)
+{
+    outAxes.numAxes = 0;
+
+    auto addAxis = [&](float x, float y, float z) {
+        CpuSeparatingAxis& axis = outAxes.axes[outAxes.numAxes++];
+        axis.axis[0] = x; axis.axis[1] = y; axis.axis[2] = z;
+
+        float proj0 = x * p0[0] + y * p0[1] + z * p0[2];
+        float proj1 = x * p1[0] + y * p1[1] + z * p1[2];
+        float proj2 = x * p2[0] + y * p2[1] + z * p2[2];
+        axis.minProj = std::min({proj0, proj1, proj2});
+        axis.maxProj = std::max({proj0, proj1, proj2});
+        axis.absSum = std::abs(x) + std::abs(y) + std::abs(z);
+    };
+
+    // [1] box axes
+    addAxis(1.0f, 0.0f, 0.0f);
+    addAxis(0.0f, 1.0f, 0.0f);
+    addAxis(0.0f, 0.0f, 1.0f);
+
+    // [2] triangle normal
+    float edges[3][3];
+    for (int i = 0; i < 3; i++)
+    {
+        edges[0][i] = p1[i] - p0[i];
+        edges[1][i] = p2[i] - p1[i];
+        edges[2][i] = p0[i] - p2[i];
+    }
+    addAxis(edges[0][1] * edges[1][2] - edges[0][2] * edges[1][1],
+            edges[0][2] * edges[1][0] - edges[0][0] * edges[1][2],
+            edges[0][0] * edges[1][1] - edges[0][1] * edges[1][0]);
+
+    // [3] box axes crossed with the edges, degenerate ones skipped like on the GPU
+    for (int j = 0; j < 3; j++)
+    {
+        const float* e = edges[j];
+        const float crossAxes[3][3] = {
+            {0.0f, -e[2], e[1]},
+            {e[2], 0.0f, -e[0]},
+            {-e[1], e[0], 0.0f}
+        };
+        for (int i = 0; i < 3; i++)
+        {
+            const float* a = crossAxes[i];
+            if (a[0] * a[0] + a[1] * a[1] + a[2] * a[2] < 1e-10f)
+                continue;
+            addAxis(a[0], a[1], a[2]);
+        }
+    }
+}
+
+//================================//
+static bool TriangleOverlapsBox(const CpuTriangleAxes& axes, const float center[3], float halfSize)
+{
+    for (uint32_t i = 0; i < axes.numAxes; i++)
+    {
+        const CpuSeparatingAxis& axis = axes.axes[i];
+        float projection = axis.axis[0] * center[0] + axis.axis[1] * center[1] + axis.axis[2] * center[2];
+        float radius = halfSize * axis.absSum + CPU_OVERLAP_EPSILON;
+        if (projection < axis.minProj - radius || projection > axis.maxProj + radius)
+            return false;
+    }
+    return true;
+}
+
+//================================//
+// Range of scale * x along the row inside which an axis does not separate the triangle from a voxel
+static inline void RowAxisRange(const CpuSeparatingAxis& axis, float centerY, float centerZ, float halfVoxel, float& lo, float& hi)
+{
+    float rowOffset = axis.axis[1] * centerY + axis.axis[2] * centerZ;
+    float radius = halfVoxel * axis.absSum + CPU_OVERLAP_EPSILON;
+    lo = axis.minProj - radius - rowOffset;
+    hi = axis.maxProj + radius - rowOffset;
+}
+
+#if defined(VOXELIZER_CPU_AVX2)
+//================================//
+// TriangleOverlapsRow with all 8 voxels per instruction, only called when the CPU has AVX2
+VOXELIZER_TARGET_AVX2 static uint32_t TriangleOverlapsRowAVX2(const CpuTriangleAxes& axes, const RowLanes& centersX, float centerY, float centerZ, float halfVoxel)
+{
+    const __m256 row = _mm256_loadu_ps(centersX.x);
+    uint32_t mask = 0xFF;
+    for (uint32_t i = 0; i < axes.numAxes && mask != 0; i++)
+    {
+        const CpuSeparatingAxis& axis = axes.axes[i];
+        float lo, hi;
+        RowAxisRange(axis, centerY, centerZ, halfVoxel, lo, hi);
+
+        if (axis.axis[0] == 0.0f)
+        {
+            if (lo > 0.0f || hi < 0.0f)
+                return 0;
+            continue;
+        }
+        __m256 projection = _mm256_mul_ps(row, _mm256_set1_ps(axis.axis[0]));
+        __m256 inside = _mm256_and_ps(
+            _mm256_cmp_ps(projection, _mm256_set1_ps(lo), _CMP_GE_OQ),
+            _mm256_cmp_ps(projection, _mm256_set1_ps(hi), _CMP_LE_OQ));
+        mask &= static_cast<uint32_t>(_mm256_movemask_ps(inside));
+    }
+    return mask;
+}
+#endif
+
+//================================//
+// Voxels of one row the triangle overlaps, bit x for voxel x of the row
+static uint32_t TriangleOverlapsRow(const CpuTriangleAxes& axes, const RowLanes& centersX, float centerY, float centerZ, float halfVoxel)
+{
+#if defined(VOXELIZER_CPU_AVX2)
+    if (CPU_HAS_AVX2)
+        return TriangleOverlapsRowAVX2(axes, centersX, centerY, centerZ, halfVoxel);
+#endif
+
+    uint32_t mask = 0xFF;
+    for (uint32_t i = 0; i < axes.numAxes && mask != 0; i++)
+    {
+        const CpuSeparatingAxis& axis = axes.axes[i];
+        float lo, hi;
+        RowAxisRange(axis, centerY, centerZ, halfVoxel, lo, hi);
+
+        if (axis.axis[0] == 0.0f) // Same for the whole row
+        {
+            if (lo > 0.0f || hi < 0.0f)
+                return 0;
+            continue;
+        }
+        mask &= InRangeMask(centersX, axis.axis[0], lo, hi);
+    }
+    return mask;
+}
+
+//================================//
+// Same as computeVoxelization.wgsl, clamped barycentric coordinates of p
+static void Barycentric(const float* p, const float* v0, const float* v1, const float* v2, float outBary[3])
+{
+    float e0[3], e1[3], e2[3];
+    for (int i = 0; i < 3; i++)
+    {
+        e0[i] = v1[i] - v0[i];
+        e1[i] = v2[i] - v0[i];
+        e2[i] = p[i] - v0[i];
+    }
+
+    float d00 = e0[0] * e0[0] + e0[1] * e0[1] + e0[2] * e0[2];
+    float d01 = e0[0] * e1[0] + e0[1] * e1[1] + e0[2] * e1[2];
+    float d11 = e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2];
+    float d20 = e2[0] * e0[0] + e2[1] * e0[1] + e2[2] * e0[2];
+    float d21 = e2[0] * e1[0] + e2[1] * e1[1] + e2[2] * e1[2];
+
+    float denom = d00 * d11 - d01 * d01;
+    if (std::abs(denom) < 1e-10f)
+    {
+        outBary[0] = 1.0f; outBary[1] = 0.0f; outBary[2] = 0.0f;
+        return;
+    }
+
+    float v = std::clamp((d11 * d20 - d01 * d21) / denom, 0.0f, 1.0f);
+    float w = std::clamp((d00 * d21 - d01 * d20) / denom, 0.0f, 1.0f);
+    if (v + w > 1.0f)
+    {
+        float scale = 1.0f / (v + w);
+        v *= scale;
+        w *= scale;
+    }
+    outBary[0] = 1.0f - v - w;
+    outBary[1] = v;
+    outBary[2] = w;
+}
+
+//================================//
+// Same as triangleTextureLod in computeVoxelization.wgsl, the mip level where a texel covers about a voxel
+static float TriangleTextureLod(const CpuMeshView& mesh, const float* p0, const float* p1, const float* p2,
+                                const std::array<float, 2>& uv0, const std::array<float, 2>& uv1, const std::array<float, 2>& uv2)
+{
+    const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    const float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+    const float worldArea = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+    const float width = static_cast<float>(mesh.textureArray->GetWidth());
+    const float height = static_cast<float>(mesh.textureArray->GetHeight());
+    const float texel1[2] = { (uv1[0] - uv0[0]) * width, (uv1[1] - uv0[1]) * height };
+    const float texel2[2] = { (uv2[0] - uv0[0]) * width, (uv2[1] - uv0[1]) * height };
+    const float texelArea = std::abs(texel1[0] * texel2[1] - texel1[1] * texel2[0]);
+    if (worldArea <= 0.0f || texelArea <= 0.0f)
+        return 0.0f;
+    return std::max(std::log2(std::sqrt(texelArea / worldArea) * mesh.voxelSize), 0.0f);
+}
+
+//================================//
+// Voxelizes the surface of one brick from its triangle list, the later triangles win the colors of shared voxels
+static void VoxelizeBrickSurface(const CpuMeshView& mesh, uint32_t brickX, uint32_t brickY, uint32_t brickZ,
+                                 const uint32_t* triangles, uint32_t numTriangles, uint32_t occupancy[16], uint32_t denseColors[512])
+{
+    const float voxelSize = mesh.voxelSize;
+    const float halfVoxel = voxelSize * 0.5f;
+    const int voxelBase[3] = { static_cast<int>(brickX * 8), static_cast<int>(brickY * 8), static_cast<int>(brickZ * 8) };
+
+    // Slightly larger than the brick, like the GPU binning
+    const float brickHalfSize = voxelSize * 4.0f + voxelSize * 0.01f;
+    const float brickCenter[3] = {
+        mesh.meshMinBounds[0] + (voxelBase[0] + 4.0f) * voxelSize,
+        mesh.meshMinBounds[1] + (voxelBase[1] + 4.0f) * voxelSize,
+        mesh.meshMinBounds[2] + (voxelBase[2] + 4.0f) * voxelSize
+    };
+
+    float centersX[8];
+    for (int x = 0; x < 8; x++)
+        centersX[x] = mesh.meshMinBounds[0] + (static_cast<float>(voxelBase[0] + x) + 0.5f) * voxelSize;
+    const RowLanes rowCentersX = LoadRow(centersX);
+
+    std::memset(occupancy, 0, sizeof(uint32_t) * 16);
+
+    CpuTriangleAxes axes;
+    for (uint32_t t = 0; t < numTriangles; t++)
+    {
+        const std::array<int, 3>& face = (*mesh.faces)[triangles[t]];
+        const float* p0 = mesh.positions[face[0]].data();
+        const float* p1 = mesh.positions[face[1]].data();
+        const float* p2 = mesh.positions[face[2]].data();
+
+        SetupTriangleAxes(p0, p1, p2, axes);
+        if (!TriangleOverlapsBox(axes, brickCenter, brickHalfSize))
+            continue;
+
+        // Rows of the brick inside the triangle bounds, padded for the test epsilon like the GPU
+        int rowMin[2], rowMax[2];
+        for (int axis = 1; axis < 3; axis++)
+        {
+            float triMin = std::min({p0[axis], p1[axis], p2[axis]});
+            float triMax = std::max({p0[axis], p1[axis], p2[axis]});
+            int voxelMin = static_cast<int>(std::floor((triMin - mesh.meshMinBounds[axis]) / voxelSize - 0.001f));
+            int voxelMax = static_cast<int>(std::floor((triMax - mesh.meshMinBounds[axis]) / voxelSize + 0.001f));
+            rowMin[axis - 1] = std::max(voxelMin - voxelBase[axis], 0);
+            rowMax[axis - 1] = std::min(voxelMax - voxelBase[axis], 7);
+        }
+
+        // The material and mip level are the same for the whole triangle
+        const std::array<float, 2>& uv0 = mesh.uvs[face[0]];
+        const std::array<float, 2>& uv1 = mesh.uvs[face[1]];
+        const std::array<float, 2>& uv2 = mesh.uvs[face[2]];
+        const uint32_t layer = mesh.layers[face[0]];
+        const float lod = TriangleTextureLod(mesh, p0, p1, p2, uv0, uv1, uv2);
+
+        for (int z = rowMin[1]; z <= rowMax[1]; z++)
+        {
+            float centerZ = mesh.meshMinBounds[2] + (static_cast<float>(voxelBase[2] + z) + 0.5f) * voxelSize;
+            for (int y = rowMin[0]; y <= rowMax[0]; y++)
+            {
+                float centerY = mesh.meshMinBounds[1] + (static_cast<float>(voxelBase[1] + y) + 0.5f) * voxelSize;
+                uint32_t rowMask = TriangleOverlapsRow(axes, rowCentersX, centerY, centerZ, halfVoxel);
+                if (rowMask == 0)
+                    continue;
+
+                // A row is one byte of the occupancy, voxel index x + y * 8 + z * 64
+                uint32_t rowBase = static_cast<uint32_t>(y * 8 + z * 64);
+                occupancy[rowBase / 32] |= rowMask << (rowBase % 32);
+
+                // Colors of the voxels hit
+                while (rowMask != 0)
+                {
+                    int x = std::countr_zero(rowMask);
+                    rowMask &= rowMask - 1;
+
+                    const float voxelCenter[3] = { centersX[x], centerY, centerZ };
+                    float bary[3];
+                    Barycentric(voxelCenter, p0, p1, p2, bary);
+                    float u = bary[0] * uv0[0] + bary[1] * uv1[0] + bary[2] * uv2[0];
+                    float v = bary[0] * uv0[1] + bary[1] * uv1[1] + bary[2] * uv2[1];
+                    denseColors[rowBase + x] = mesh.textureArray->Sample(layer, u, v, lod);
+                }
+            }
+        }
+    }
+
+}
+
+//================================//
+// Compaction and LOD color follow computeCompactVoxel.wgsl. Returns false for an empty brick
+static bool CompactBrick(const uint32_t occupancy[16], const uint32_t denseColors[512], brickDataEntry& outEntry, VoxelColorRGB& outLod)
+{
+    uint32_t numOccupied = 0;
+    for (int i = 0; i < 16; i++)
+        numOccupied += std::popcount(occupancy[i]);
+    if (numOccupied == 0)
+        return false;
+
+    std::memcpy(outEntry.occupancy, occupancy, sizeof(uint32_t) * 16);
+    outEntry.colors.resize(numOccupied);
+
+    uint32_t colorSum[3] = {0, 0, 0};
+    uint32_t colorIndex = 0;
+    for (uint32_t voxel = 0; voxel < 512; voxel++)
+    {
+        if ((occupancy[voxel / 32] & (1u << (voxel % 32))) == 0)
+            continue;
+
+        uint32_t packed = denseColors[voxel];
+        VoxelColorRGB& color = outEntry.colors[colorIndex++];
+        color.r = packed & 0xFF;
+        color.g = (packed >> 8) & 0xFF;
+        color.b = (packed >> 16) & 0xFF;
+        colorSum[0] += color.r;
+        colorSum[1] += color.g;
+        colorSum[2] += color.b;
+    }
+
+    outLod.r = static_cast<uint8_t>(colorSum[0] / numOccupied);
+    outLod.g = static_cast<uint8_t>(colorSum[1] / numOccupied);
+    outLod.b = static_cast<uint8_t>(colorSum[2] / numOccupied);
+    return true;
+}
+
+//================================//
+static bool VoxelizeBrick(const CpuMeshView& mesh, uint32_t brickX, uint32_t brickY, uint32_t brickZ,
+                          const uint32_t* triangles, uint32_t numTriangles, brickDataEntry& outEntry, VoxelColorRGB& outLod)
+{
+    uint32_t occupancy[16];
+    uint32_t denseColors[512];
+    VoxelizeBrickSurface(mesh, brickX, brickY, brickZ, triangles, numTriangles, occupancy, denseColors);
+    return CompactBrick(occupancy, denseColors, outEntry, outLod);
+}
+
+//================================//
+// Same as computeSolidFill.wgsl, endpoints in a fixed order so the two triangles sharing an edge get exactly opposite values
+static float EdgeFunction(const float a[2], const float b[2], const float p[2])
+{
+    if (a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]))
+        return (b[0] - a[0]) * (p[1] - a[1]) - (b[1] - a[1]) * (p[0] - a[0]);
+    return -((a[0] - b[0]) * (p[1] - b[1]) - (a[1] - b[1]) * (p[0] - b[0]));
+}
+
+//================================//
+// Points exactly on an edge belong to one side only
+static bool OwnsEdge(const float from[2], const float to[2], float w)
+{
+    if (w != 0.0f)
+        return w > 0.0f;
+    float edge[2] = { to[0] - from[0], to[1] - from[1] };
+    return edge[1] > 0.0f || (edge[1] == 0.0f && edge[0] < 0.0f);
+}
+
+//================================//
+// Whether the row through p along x crosses the triangle projected on the yz plane
+static bool RowCrossesTriangle(const float a[2], const float b[2], const float c[2], const float p[2])
+{
+    float area = EdgeFunction(a, b, c);
+    if (area == 0.0f)
+        return false; // Parallel to the rows
+
+    // Counter clockwise order
+    const float* v1 = area > 0.0f ? b : c;
+    const float* v2 = area > 0.0f ? c : b;
+    return OwnsEdge(a, v1, EdgeFunction(a, v1, p)) &&
+           OwnsEdge(v1, v2, EdgeFunction(v1, v2, p)) &&
+           OwnsEdge(v2, a, EdgeFunction(v2, a, p));
+}
+
+//================================//
+// Parity flips of the crossings inside the x range of one brick, bit x + y * 8 of layer z of the brick holding
+// the first voxel past the crossing. outFlips has 8 layers per brick of the row
+static void AccumulateParityFlips(const CpuMeshView& mesh, uint32_t brickX, uint32_t brickY, uint32_t brickZ,
+                                  const uint32_t* triangles, uint32_t numTriangles, uint64_t* outFlips)
+{
+    const float voxelSize = mesh.voxelSize;
+    const int voxelResolution = static_cast<int>(mesh.brickResolution * 8);
+    const int voxelBase[3] = { static_cast<int>(brickX * 8), static_cast<int>(brickY * 8), static_cast<int>(brickZ * 8) };
+
+    const float brickSize = voxelSize * 8.0f;
+
+    for (uint32_t t = 0; t < numTriangles; t++)
+    {
+        const std::array<int, 3>& face = (*mesh.faces)[triangles[t]];
+        const float* p0 = mesh.positions[face[0]].data();
+        const float* p1 = mesh.positions[face[1]].data();
+        const float* p2 = mesh.positions[face[2]].data();
+
+        float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float normal[3] = {
+            e0[1] * e1[2] - e0[2] * e1[1],
+            e0[2] * e1[0] - e0[0] * e1[2],
+            e0[0] * e1[1] - e0[1] * e1[0]
+        };
+        if (normal[0] == 0.0f)
+            continue;
+
+        // Rows of the brick whose center falls in the projected bounds
+        int rowMin[2], rowMax[2];
+        for (int axis = 1; axis < 3; axis++)
+        {
+            float triMin = std::min({p0[axis], p1[axis], p2[axis]});
+            float triMax = std::max({p0[axis], p1[axis], p2[axis]});
+            int voxelMin = static_cast<int>(std::ceil((triMin - mesh.meshMinBounds[axis]) / voxelSize - 0.5f));
+            int voxelMax = static_cast<int>(std::floor((triMax - mesh.meshMinBounds[axis]) / voxelSize - 0.5f));
+            rowMin[axis - 1] = std::max(voxelMin - voxelBase[axis], 0);
+            rowMax[axis - 1] = std::min(voxelMax - voxelBase[axis], 7);
+        }
+
+        const float a[2] = { p0[1], p0[2] };
+        const float b[2] = { p1[1], p1[2] };
+        const float c[2] = { p2[1], p2[2] };
+        for (int z = rowMin[1]; z <= rowMax[1]; z++)
+        {
+            for (int y = rowMin[0]; y <= rowMax[0]; y++)
+            {
+                const float center[2] = {
+                    mesh.meshMinBounds[1] + (static_cast<float>(voxelBase[1] + y) + 0.5f) * voxelSize,
+                    mesh.meshMinBounds[2] + (static_cast<float>(voxelBase[2] + z) + 0.5f) * voxelSize
+                };
+                if (!RowCrossesTriangle(a, b, c, center))
+                    continue;
+
+                // Each crossing belongs to one brick of the row, found like the triangle brick bounds so it is always
+                // one of the bricks listing the triangle
+                float crossingX = p0[0] - (normal[1] * (center[0] - p0[1]) + normal[2] * (center[1] - p0[2])) / normal[0];
+                crossingX = std::clamp(crossingX, std::min({p0[0], p1[0], p2[0]}), std::max({p0[0], p1[0], p2[0]}));
+                float crossingBrick = std::floor((crossingX - mesh.meshMinBounds[0]) / brickSize);
+                if (std::clamp(crossingBrick, 0.0f, static_cast<float>(mesh.brickResolution - 1)) != static_cast<float>(brickX))
+                    continue;
+
+                int firstVoxel = std::max(static_cast<int>(std::floor((crossingX - mesh.meshMinBounds[0]) / voxelSize - 0.5f)) + 1, 0);
+                if (firstVoxel >= voxelResolution)
+                    continue;
+
+                outFlips[(firstVoxel / 8) * 8 + z] ^= 1ull << ((firstVoxel % 8) + y * 8);
+            }
+        }
+    }
+}
+
+//================================//
+// Turns the flips of a brick row into inside bits, one 8x8 layer of a brick at a time. The prefix XOR runs along
+// the 8 bits of every row of the layer at once, the parity of each row carries into the next brick.
+// On return flips holds the filled voxels
+static void FillRowInterior(uint32_t brickResolution, uint32_t* occupancy, uint64_t* flips)
+{
+    for (uint32_t z = 0; z < 8; z++)
+    {
+        uint64_t carry = 0; // 0xFF in the rows that enter the brick inside
+        for (uint32_t brickX = 0; brickX < brickResolution; brickX++)
+        {
+            uint64_t inside = flips[brickX * 8 + z];
+            inside ^= (inside << 1) & 0xFEFEFEFEFEFEFEFEull;
+            inside ^= (inside << 2) & 0xFCFCFCFCFCFCFCFCull;
+            inside ^= (inside << 4) & 0xF0F0F0F0F0F0F0F0ull;
+            inside ^= carry;
+            carry = ((inside >> 7) & 0x0101010101010101ull) * 0xFF;
+
+            uint32_t* layer = occupancy + brickX * 16 + z * 2;
+            uint64_t surface = static_cast<uint64_t>(layer[0]) | (static_cast<uint64_t>(layer[1]) << 32);
+            uint64_t fill = inside & ~surface;
+            layer[0] |= static_cast<uint32_t>(fill);
+            layer[1] |= static_cast<uint32_t>(fill >> 32);
+            flips[brickX * 8 + z] = fill;
+        }
+    }
+}
+
+//================================//
+// Filled voxels take the color of the closer of the surface voxels around them on their row, like computeSolidFill.wgsl
+static void ColorRowInterior(uint32_t brickResolution, const uint32_t* occupancy, const uint64_t* fills, uint32_t* denseColors)
+{
+    for (uint32_t row = 0; row < 64; row++)
+    {
+        const uint32_t y = row % 8;
+        const uint32_t z = row / 8;
+
+        int entryX = -1;
+        uint32_t entryColor = 0xFFFFFF;
+        int runStart = -1;
+
+        for (uint32_t brickX = 0; brickX < brickResolution; brickX++)
+        {
+            const uint32_t rowBase = y * 8 + z * 64;
+            uint32_t fill = static_cast<uint32_t>(fills[brickX * 8 + z] >> (y * 8)) & 0xFF;
+            uint32_t surface = ((occupancy[brickX * 16 + rowBase / 32] >> (rowBase % 32)) & 0xFF) & ~fill;
+            if ((fill | surface) == 0)
+            {
+                runStart = -1;
+                continue;
+            }
+
+            for (uint32_t bit = 0; bit < 8; bit++)
+            {
+                const int x = static_cast<int>(brickX * 8 + bit);
+                uint32_t& color = denseColors[brickX * 512 + rowBase + bit];
+
+                if (surface & (1u << bit))
+                {
+                    // The second half of the run is closer to this voxel
+                    if (runStart >= 0)
+                    {
+                        int from = entryX >= 0 ? std::max(runStart, (entryX + x + 1) / 2) : runStart;
+                        for (int runX = from; runX < x; runX++)
+                            denseColors[(runX / 8) * 512 + rowBase + runX % 8] = color;
+                    }
+
+                    entryX = x;
+                    entryColor = color;
+                    runStart = -1;
+                }
+                else if (fill & (1u << bit))
+                {
+                    color = entryColor;
+                    if (runStart < 0)
+                        runStart = x;
+                }
+                else
+                {
+                    runStart = -1;
+                }
+            }
+        }
+    }
+}
+
+//================================//
+bool Voxelizer::voxelizeMeshCPU(const std::string& outputVoxelFile, uint32_t voxelResolution)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    JobSystem& jobSystem = JobSystem::Shared();
+
+    const uint32_t brickResolution = voxelResolution / 8;
+    const uint32_t bricksPerSlice = brickResolution * brickResolution;
+    const uint32_t numTriangles = static_cast<uint32_t>(this->facesVec.size());
+
+    std::cout << "[Voxelizer] CPU voxelization on " << jobSystem.GetNumThreads() << " threads, "
+#if defined(VOXELIZER_CPU_AVX2)
+              << (CPU_HAS_AVX2 ? "AVX2" : "scalar")
+#elif defined(VOXELIZER_CPU_NEON)
+              << "NEON"
+#else
+              << "scalar"
+#endif
+              << " row tests" << std::endl;
+
+    // [1] Float mesh and texture array, the same data the GPU path uploads
+    CpuMeshView mesh;
+    mesh.faces = &this->facesVec;
+    mesh.brickResolution = brickResolution;
+    double maxExtent = std::max({meshWidth, meshHeight, meshDepth});
+    mesh.voxelSize = static_cast<float>(maxExtent / voxelResolution);
+    for (int i = 0; i < 3; i++)
+        mesh.meshMinBounds[i] = static_cast<float>(this->meshMinBounds[i]);
+
+    // Quantized and unpacked again, both backends test the same positions
+    mesh.positions.resize(this->verticesVec.size());
+    mesh.uvs.resize(this->verticesVec.size());
+    mesh.layers.resize(this->verticesVec.size());
+    for (size_t i = 0; i < this->verticesVec.size(); i++)
+    {
+        Vertex vertex = this->packVertex(this->verticesVec[i].data(), this->uvsVec[i].data(), static_cast<uint32_t>(this->textureIndicesVec[i]));
+        this->unpackVertex(vertex, mesh.positions[i].data(), mesh.uvs[i].data());
+        mesh.layers[i] = vertex.words[2] >> 16;
+    }
+
+    mesh.textureArray = &this->textureArray;
+
+    // [2] Brick bounds of every triangle, then the triangles of each brick slice
+    const float brickSize = mesh.voxelSize * 8.0f;
+    std::vector<std::array<uint16_t, 6>> triangleBricks(numTriangles);
+    jobSystem.ParallelFor(numTriangles, 1024, [&](uint32_t t) {
+        const std::array<int, 3>& face = this->facesVec[t];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float triMin = std::min({mesh.positions[face[0]][axis], mesh.positions[face[1]][axis], mesh.positions[face[2]][axis]});
+            float triMax = std::max({mesh.positions[face[0]][axis], mesh.positions[face[1]][axis], mesh.positions[face[2]][axis]});
+            float brickMin = std::floor((triMin - mesh.meshMinBounds[axis]) / brickSize);
+            float brickMax = std::floor((triMax - mesh.meshMinBounds[axis]) / brickSize);
+            triangleBricks[t][axis] = static_cast<uint16_t>(std::clamp(brickMin, 0.0f, static_cast<float>(brickResolution - 1)));
+            triangleBricks[t][axis + 3] = static_cast<uint16_t>(std::clamp(brickMax, 0.0f, static_cast<float>(brickResolution - 1)));
+        }
+    });
+
+    std::vector<uint32_t> sliceOffsets(brickResolution + 1, 0);
+    for (uint32_t t = 0; t < numTriangles; t++)
+    {
+        for (uint32_t z = triangleBricks[t][2]; z <= triangleBricks[t][5]; z++)
+            sliceOffsets[z + 1]++;
+    }
+    for (uint32_t z = 0; z < brickResolution; z++)
+        sliceOffsets[z + 1] += sliceOffsets[z];
+
+    std::vector<uint32_t> sliceTriangles(sliceOffsets[brickResolution]);
+    {
+        std::vector<uint32_t> cursors(sliceOffsets.begin(), sliceOffsets.end() - 1);
+        for (uint32_t t = 0; t < numTriangles; t++)
+        {
+            for (uint32_t z = triangleBricks[t][2]; z <= triangleBricks[t][5]; z++)
+                sliceTriangles[cursors[z]++] = t;
+        }
+    }
+
+    // [3] One slice at a time, its bricks in parallel. Lists stay in triangle order, so the output is deterministic
+    VoxelFileWriter writer(outputVoxelFile, voxelResolution);
+
+    std::vector<uint32_t> brickOffsets(bricksPerSlice + 1);
+    std::vector<uint32_t> brickCursors(bricksPerSlice);
+    std::vector<uint32_t> brickTriangles;
+    std::vector<brickDataEntry> sliceBricks(bricksPerSlice);
+    std::vector<VoxelColorRGB> sliceLods(bricksPerSlice);
+    std::vector<uint8_t> sliceOccupied(bricksPerSlice);
+    uint64_t occupiedBricks = 0;
+
+    for (uint32_t z = 0; z < brickResolution; z++)
+    {
+        const uint32_t* triangles = sliceTriangles.data() + sliceOffsets[z];
+        const uint32_t numSliceTriangles = sliceOffsets[z + 1] - sliceOffsets[z];
+
+        std::fill(brickOffsets.begin(), brickOffsets.end(), 0);
+        for (uint32_t i = 0; i < numSliceTriangles; i++)
+        {
+            const std::array<uint16_t, 6>& bricks = triangleBricks[triangles[i]];
+            for (uint32_t y = bricks[1]; y <= bricks[4]; y++)
+                for (uint32_t x = bricks[0]; x <= bricks[3]; x++)
+                    brickOffsets[x + y * brickResolution + 1]++;
+        }
+        for (uint32_t b = 0; b < bricksPerSlice; b++)
+            brickOffsets[b + 1] += brickOffsets[b];
+
+        brickTriangles.resize(brickOffsets[bricksPerSlice]);
+        std::copy(brickOffsets.begin(), brickOffsets.end() - 1, brickCursors.begin());
+        for (uint32_t i = 0; i < numSliceTriangles; i++)
+        {
+            const std::array<uint16_t, 6>& bricks = triangleBricks[triangles[i]];
+            for (uint32_t y = bricks[1]; y <= bricks[4]; y++)
+                for (uint32_t x = bricks[0]; x <= bricks[3]; x++)
+                    brickTriangles[brickCursors[x + y * brickResolution]++] = triangles[i];
+        }
+
+        if (this->solid)
+        {
+            // Whole brick rows along x, the fill needs the crossings of the full row
+            jobSystem.ParallelFor(brickResolution, 1, [&](uint32_t y) {
+                const uint32_t rowStart = y * brickResolution;
+                std::fill(sliceOccupied.begin() + rowStart, sliceOccupied.begin() + rowStart + brickResolution, 0);
+                if (brickOffsets[rowStart + brickResolution] == brickOffsets[rowStart])
+                    return;
+
+                // Reused by every row the thread runs
+                static thread_local std::vector<uint32_t> rowOccupancy;
+                static thread_local std::vector<uint32_t> rowColors;
+                static thread_local std::vector<uint64_t> rowFlips;
+                rowOccupancy.assign(static_cast<size_t>(brickResolution) * 16, 0);
+                rowColors.resize(static_cast<size_t>(brickResolution) * 512);
+                rowFlips.assign(static_cast<size_t>(brickResolution) * 8, 0);
+
+                for (uint32_t x = 0; x < brickResolution; x++)
+                {
+                    const uint32_t b = rowStart + x;
+                    const uint32_t numBrickTriangles = brickOffsets[b + 1] - brickOffsets[b];
+                    if (numBrickTriangles == 0)
+                        continue;
+
+                    const uint32_t* triangles = brickTriangles.data() + brickOffsets[b];
+                    VoxelizeBrickSurface(mesh, x, y, z, triangles, numBrickTriangles, &rowOccupancy[x * 16], &rowColors[x * 512]);
+                    AccumulateParityFlips(mesh, x, y, z, triangles, numBrickTriangles, rowFlips.data());
+                }
+
+                FillRowInterior(brickResolution, rowOccupancy.data(), rowFlips.data());
+                ColorRowInterior(brickResolution, rowOccupancy.data(), rowFlips.data(), rowColors.data());
+
+                for (uint32_t x = 0; x < brickResolution; x++)
+                {
+                    const uint32_t b = rowStart + x;
+                    sliceOccupied[b] = CompactBrick(&rowOccupancy[x * 16], &rowColors[x * 512], sliceBricks[b], sliceLods[b]) ? 1 : 0;
+                }
+            });
+        }
+        else
+        {
+            jobSystem.ParallelFor(bricksPerSlice, CPU_VOXELIZER_BRICK_GRAIN, [&](uint32_t b) {
+                sliceOccupied[b] = 0;
+                uint32_t numBrickTriangles = brickOffsets[b + 1] - brickOffsets[b];
+                if (numBrickTriangles == 0)
+                    return;
+
+                sliceOccupied[b] = VoxelizeBrick(mesh, b % brickResolution, b / brickResolution, z,
+                    brickTriangles.data() + brickOffsets[b], numBrickTriangles, sliceBricks[b], sliceLods[b]) ? 1 : 0;
+            });
+        }
+
+        for (uint32_t b = 0; b < bricksPerSlice; b++)
+        {
+            if (!sliceOccupied[b])
+                continue;
+            writer.AddBrick(z * bricksPerSlice + b, std::move(sliceBricks[b]), sliceLods[b]);
+            occupiedBricks++;
+        }
+
+        if ((z + 1) % (brickResolution / 10 + 1) == 0)
+        {
+            std::cout << "[Voxelizer] Progress: "
+                      << (100 * (z + 1) / brickResolution) << "%" << std::endl;
+        }
+    }
+
+    writer.EndFile();
+
+    double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "[Voxelizer] CPU voxelization complete in " << duration << " seconds, " << occupiedBricks
+              << " occupied bricks. Voxel file saved to " << outputVoxelFile << std::endl;
+    return true;
+}